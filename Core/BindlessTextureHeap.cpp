@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "BindlessTextureHeap.h"
+#include "CommandContext.h"
+#include "GraphicsCore.h"
+
+BindlessTextureHeap::BindlessTextureHeap(U32 textureCapacity, U32 frameDescriptorCapacity)
+    : m_heap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, textureCapacity + kFrameCount * frameDescriptorCapacity),
+    m_textureCapacity(textureCapacity),
+    m_frameDescriptorCapacity(frameDescriptorCapacity)
+{
+}
+
+void BindlessTextureHeap::Create(const std::wstring& name)
+{
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ASSERT_SUCCEEDED(Graphics::g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    ASSERT(options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2, "Bindless textures need resource binding tier 2");
+
+    m_heap.Create(name);
+    m_textureCount = 0;
+    m_textureIndices.clear();
+    m_frameSlot = 0;
+    m_frameOffset = 0;
+}
+
+void BindlessTextureHeap::Destroy()
+{
+    m_heap.Destroy();
+    m_textureCount = 0;
+    m_textureIndices.clear();
+}
+
+U32 BindlessTextureHeap::AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv)
+{
+    const auto found = m_textureIndices.find(srv.ptr);
+    if (found != m_textureIndices.end())
+        return found->second;
+
+    ASSERT(m_textureCount < m_textureCapacity, "Bindless texture table is full");
+    const U32 index = m_textureCount++;
+    Graphics::g_Device->CopyDescriptorsSimple(1, m_heap.GetHandleAtOffset(index).GetCpuHandle(), srv,
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_textureIndices.emplace(srv.ptr, index);
+    return index;
+}
+
+void BindlessTextureHeap::BeginFrame()
+{
+    m_frameSlot = (m_frameSlot + 1) % kFrameCount;
+    m_frameOffset = 0;
+    Graphics::g_CommandManager.WaitForFence(m_frameFences[m_frameSlot]);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessTextureHeap::AddFrameDescriptors(U32 count, const D3D12_CPU_DESCRIPTOR_HANDLE handles[])
+{
+    ASSERT(m_frameOffset + count <= m_frameDescriptorCapacity, "Bindless frame descriptors exhausted");
+    const DescriptorHandle first = m_heap.GetHandleAtOffset(
+        m_textureCapacity + m_frameSlot * m_frameDescriptorCapacity + m_frameOffset);
+    m_frameOffset += count;
+
+    // The sources are scattered, so each one is its own range of a single descriptor.
+    UINT sourceSizes[16];
+    ASSERT(count <= _countof(sourceSizes));
+    for (U32 i = 0; i < count; i++)
+        sourceSizes[i] = 1;
+    const D3D12_CPU_DESCRIPTOR_HANDLE destStart = first.GetCpuHandle();
+    Graphics::g_Device->CopyDescriptors(1, &destStart, &count, count, handles, sourceSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return first.GetGpuHandle();
+}
+
+void BindlessTextureHeap::EndFrame(uint64_t fenceValue)
+{
+    m_frameFences[m_frameSlot] = fenceValue;
+}
+
+void BindlessTextureHeap::Bind(CommandContext& context) const
+{
+    context.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_heap.GetHeapPointer());
+}
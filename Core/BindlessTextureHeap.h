@@ -0,0 +1,57 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include "DescriptorHeap.h"
+#include <unordered_map>
+#pragma region
+
+class CommandContext;
+
+// Shader-visible SRV heap for bindless drawing.  The front of the heap is a persistent texture table: each
+// texture is copied in once and shaders index it directly, so changing material costs no descriptor copies.
+// The back is a ring of per-frame slices for pass-level descriptors (shadow maps, G-buffers, light grids),
+// which have to live in the same heap because only one CBV_SRV_UAV heap can be bound at a time.
+class BindlessTextureHeap
+{
+public:
+    BindlessTextureHeap(U32 textureCapacity, U32 frameDescriptorCapacity);
+
+    // Requires resource binding tier 2 for the unbounded texture table.
+    void Create(const std::wstring& name);
+
+    void Destroy();
+
+    // Copies a texture SRV into the persistent table and returns its index.  A handle that was added before
+    // returns its existing index, so textures shared between materials occupy one slot.
+    U32 AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv);
+
+    // Switches to the next frame slice, waiting if the GPU may still read the descriptors it holds.
+    void BeginFrame();
+
+    // Copies descriptors into the current frame slice and returns the start of the table they form.
+    D3D12_GPU_DESCRIPTOR_HANDLE AddFrameDescriptors(U32 count, const D3D12_CPU_DESCRIPTOR_HANDLE handles[]);
+
+    // Tags the current frame slice with the fence returned by Finish.
+    void EndFrame(uint64_t fenceValue);
+
+    // Binds the heap.  Descriptor tables set before another heap was bound must be set again.
+    void Bind(CommandContext& context) const;
+
+    inline D3D12_GPU_DESCRIPTOR_HANDLE GetTextureTable() const { return m_heap.GetHandleAtOffset(0).GetGpuHandle(); }
+    inline U32 GetTextureCount() const { return m_textureCount; }
+    // Descriptors copied in the current frame, all of them pass-level.
+    inline U32 GetFrameDescriptorCount() const { return m_frameOffset; }
+
+private:
+    static const U32 kFrameCount = 3;
+
+    UserDescriptorHeap m_heap;
+    U32 m_textureCapacity;
+    U32 m_frameDescriptorCapacity;
+    U32 m_textureCount = 0;
+    std::unordered_map<size_t, U32> m_textureIndices;
+    uint64_t m_frameFences[kFrameCount] = {};
+    U32 m_frameSlot = 0;
+    U32 m_frameOffset = 0;
+};
@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "BrickMap.h"
+#include <algorithm>
+#include <cmath>
+
+void BrickAllocator::Reset(uint32_t capacity)
+{
+    m_capacity = 0;
+    m_freeSlots.clear();
+    Grow(capacity);
+}
+
+void BrickAllocator::Grow(uint32_t capacity)
+{
+    ASSERT(capacity >= m_capacity);
+    // Hand out the low slots first.
+    m_freeSlots.insert(m_freeSlots.begin(), capacity - m_capacity, 0);
+    for (uint32_t i = 0; i < capacity - m_capacity; ++i)
+        m_freeSlots[i] = capacity - 1 - i;
+    m_capacity = capacity;
+}
+
+uint32_t BrickAllocator::Allocate()
+{
+    if (m_freeSlots.empty())
+        return INVALID_BRICK;
+    const uint32_t slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return slot;
+}
+
+void BrickAllocator::Free(uint32_t slot)
+{
+    ASSERT(slot < m_capacity, "Brick slot %u is outside the atlas", slot);
+    m_freeSlots.push_back(slot);
+}
+
+void BrickMap::Reset(uint32_t levelCount, int32_t resolution, uint32_t capacity)
+{
+    ASSERT(resolution % BRICK_SIZE == 0 && (resolution & (resolution - 1)) == 0);
+    m_levelCount = levelCount;
+    m_resolution = resolution;
+    m_bricksPerAxis = resolution / BRICK_SIZE;
+    const size_t brickCount = size_t(levelCount) * m_bricksPerAxis * m_bricksPerAxis * m_bricksPerAxis;
+    m_allocator.Reset(capacity);
+    m_indirection.assign(brickCount, INVALID_BRICK);
+    m_touched.assign(brickCount, 0);
+    m_occupied.assign(brickCount, 0);
+    m_newBricks.clear();
+    m_update = 0;
+    m_dirty = false;
+    m_stats = {};
+    m_stats.capacity = capacity;
+}
+
+void BrickMap::BeginFrame()
+{
+    m_newBricks.clear();
+    m_dirty = false;
+    m_stats.newBricks = 0;
+    m_stats.freedBricks = 0;
+    m_stats.overflows = 0;
+}
+
+uint32_t BrickMap::GetBrickIndex(uint32_t level, const int32_t brick[3]) const
+{
+    return ((level * m_bricksPerAxis + brick[2]) * m_bricksPerAxis + brick[1]) * m_bricksPerAxis + brick[0];
+}
+
+uint32_t BrickMap::GetSlot(uint32_t level, const int32_t imageCoords[3]) const
+{
+    const int32_t brick[3] = { imageCoords[0] / BRICK_SIZE, imageCoords[1] / BRICK_SIZE, imageCoords[2] / BRICK_SIZE };
+    return m_indirection[GetBrickIndex(level, brick)];
+}
+
+template <typename ActionT>
+void BrickMap::forEachBrick(uint32_t level, const int32_t minPos[3], const int32_t maxPos[3], ActionT&& action) const
+{
+    // Per axis, the run of bricks the voxels wrap onto.  A run long enough to wrap back into its first brick takes
+    // them all.  The resolution is a power of two, so the mask wraps negative coordinates too.
+    int32_t first[3], count[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int32_t length = maxPos[axis] - minPos[axis];
+        if (length > m_resolution - BRICK_SIZE)
+        {
+            first[axis] = 0;
+            count[axis] = m_bricksPerAxis;
+            continue;
+        }
+        const int32_t imageMin = minPos[axis] & (m_resolution - 1);
+        first[axis] = imageMin / BRICK_SIZE;
+        count[axis] = (imageMin + length - 1) / BRICK_SIZE - first[axis] + 1;
+    }
+
+    const int32_t mask = m_bricksPerAxis - 1;
+    for (int32_t z = 0; z < count[2]; ++z)
+    {
+        for (int32_t y = 0; y < count[1]; ++y)
+        {
+            for (int32_t x = 0; x < count[0]; ++x)
+            {
+                const int32_t brick[3] = { (first[0] + x) & mask, (first[1] + y) & mask, (first[2] + z) & mask };
+                action(GetBrickIndex(level, brick));
+            }
+        }
+    }
+}
+
+uint32_t BrickMap::allocate()
+{
+    uint32_t slot = m_allocator.Allocate();
+    if (slot != INVALID_BRICK)
+        return slot;
+
+    // A quarter more, in whole layers, and never more than a slot per brick.
+    m_stats.overflows++;
+    m_stats.totalOverflows++;
+    const uint32_t capacity = m_allocator.GetCapacity();
+    const uint32_t maxCapacity = static_cast<uint32_t>(m_indirection.size() + BRICK_ATLAS_LAYER - 1) / BRICK_ATLAS_LAYER * BRICK_ATLAS_LAYER;
+    const uint32_t grown = (capacity + std::max(capacity / 4, 1u) + BRICK_ATLAS_LAYER - 1) / BRICK_ATLAS_LAYER * BRICK_ATLAS_LAYER;
+    m_allocator.Grow(std::min(grown, maxCapacity));
+    m_stats.capacity = m_allocator.GetCapacity();
+    slot = m_allocator.Allocate();
+    ASSERT(slot != INVALID_BRICK);
+    return slot;
+}
+
+void BrickMap::UpdateRegion(uint32_t level, const ClipmapBox& clipRegion, float voxelSize, const ClipmapBox& region,
+    std::initializer_list<const MeshBoundsSoA*> occupancy)
+{
+    ASSERT(level < m_levelCount);
+    ++m_update;
+    m_touchedBricks.clear();
+    const int32_t regionMax[3] = { region.minPos[0] + region.extent[0], region.minPos[1] + region.extent[1], region.minPos[2] + region.extent[2] };
+    forEachBrick(level, region.minPos, regionMax, [&](uint32_t index)
+    {
+        if (m_touched[index] != m_update)
+        {
+            m_touched[index] = m_update;
+            m_touchedBricks.push_back(index);
+        }
+    });
+
+    // A brick holds voxels of the region and others of the clip region, possibly from its far side when the brick
+    // straddles the toroidal seam, so the boxes are tested against the whole clip region and mark every touched brick
+    // they reach.  A voxel of margin absorbs the rounding of the pixel shader's image coordinates.  The boxes are
+    // culled against the clip region grown by that margin, or a box just outside would miss the bricks its margin
+    // reaches, and the untouched ones would keep missing them once the box scrolls in.
+    int32_t clipMax[3];
+    float clipMinWorld[3], clipMaxWorld[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        clipMax[axis] = clipRegion.minPos[axis] + clipRegion.extent[axis];
+        clipMinWorld[axis] = (clipRegion.minPos[axis] - 2) * voxelSize;
+        clipMaxWorld[axis] = (clipMax[axis] + 1) * voxelSize;
+    }
+    for (const MeshBoundsSoA* boxes : occupancy)
+    {
+        m_visible.clear();
+        boxes->Cull(clipMinWorld, clipMaxWorld, m_visible);
+        for (uint32_t i : m_visible)
+        {
+            float minBound[3], maxBound[3];
+            boxes->GetBounds(i, minBound, maxBound);
+            int32_t minPos[3], maxPos[3];
+            bool empty = false;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                minPos[axis] = std::max(static_cast<int32_t>(std::floor(minBound[axis] / voxelSize)) - 1, clipRegion.minPos[axis]);
+                maxPos[axis] = std::min(static_cast<int32_t>(std::floor(maxBound[axis] / voxelSize)) + 2, clipMax[axis]);
+                empty |= maxPos[axis] <= minPos[axis];
+            }
+            if (empty)
+                continue;
+            forEachBrick(level, minPos, maxPos, [&](uint32_t index)
+            {
+                if (m_touched[index] == m_update)
+                    m_occupied[index] = m_update;
+            });
+        }
+    }
+
+    for (uint32_t index : m_touchedBricks)
+    {
+        uint32_t& slot = m_indirection[index];
+        const bool occupied = m_occupied[index] == m_update;
+        if (occupied && slot == INVALID_BRICK)
+        {
+            slot = allocate();
+            m_newBricks.push_back(slot);
+            m_stats.newBricks++;
+            m_dirty = true;
+        }
+        else if (!occupied && slot != INVALID_BRICK)
+        {
+            m_allocator.Free(slot);
+            slot = INVALID_BRICK;
+            m_stats.freedBricks++;
+            m_dirty = true;
+        }
+    }
+    m_stats.allocated = m_allocator.GetAllocatedCount();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#pragma  region HEADER
+#include "ClipmapPlanner.h"
+#include "RegionCulling.h"
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#pragma region
+
+// Edge of a brick in voxels.  Mirrors BRICK_SIZE in VoxelBricks.hlsli.
+const int32_t BRICK_SIZE = 8;
+
+// Bricks along x and y of the atlas, a layer of it; the atlas has as many layers along z as its capacity needs.
+// Mirrors BRICK_ATLAS_BRICKS in VoxelBricks.hlsli.
+const int32_t BRICK_ATLAS_BRICKS = 16;
+
+const uint32_t BRICK_ATLAS_LAYER = BRICK_ATLAS_BRICKS * BRICK_ATLAS_BRICKS;
+
+const uint32_t INVALID_BRICK = ~0u;
+
+// Hands out the slots of the brick atlas.  Freed slots are reused first, so the atlas stays compact as the clipmap
+// scrolls.
+class BrickAllocator
+{
+public:
+    void Reset(uint32_t capacity);
+
+    // Adds the slots up to the new capacity.
+    void Grow(uint32_t capacity);
+
+    // Returns a free slot, or INVALID_BRICK when every slot is taken.
+    uint32_t Allocate();
+
+    void Free(uint32_t slot);
+
+    uint32_t GetCapacity() const { return m_capacity; }
+
+    uint32_t GetAllocatedCount() const { return m_capacity - static_cast<uint32_t>(m_freeSlots.size()); }
+
+private:
+    std::vector<uint32_t> m_freeSlots;
+    uint32_t m_capacity = 0;
+};
+
+struct BrickMapStats
+{
+    uint32_t allocated;
+    uint32_t capacity;
+    // Bricks given a slot and bricks that gave theirs back this frame.
+    uint32_t newBricks;
+    uint32_t freedBricks;
+    // Times a brick with geometry found the atlas full and grew it, this frame and since the reset.
+    uint32_t overflows;
+    uint64_t totalOverflows;
+};
+
+// The sparse layout of a voxel clipmap: every level is cut into bricks of BRICK_SIZE^3 voxels in image space, and
+// only the bricks that may hold geometry get a slot of the atlas.  The indirection maps a brick to its slot, or to
+// INVALID_BRICK when the brick is empty.
+//
+// Bricks are reallocated where regions are revoxelized.  Occupancy is tested against bounding boxes, so a brick with
+// a slot may still turn out empty, but a brick without one never has geometry.  A brick that finds the atlas full
+// grows it by whole layers, up to a slot for every brick of the clipmap, the dense layout; the owner of the atlas
+// textures follows GetStats().capacity.
+class BrickMap
+{
+public:
+    void Reset(uint32_t levelCount, int32_t resolution, uint32_t capacity);
+
+    // Starts a frame's updates: clears the new bricks and the dirty flag.
+    void BeginFrame();
+
+    // Gives a slot to every brick of the level the region touches that overlaps one of the occupancy boxes where it
+    // lies inside the clip region, and takes it from the others.  The boxes are in world coordinates, the regions in
+    // world voxel coordinates of the level.
+    void UpdateRegion(uint32_t level, const ClipmapBox& clipRegion, float voxelSize, const ClipmapBox& region,
+        std::initializer_list<const MeshBoundsSoA*> occupancy);
+
+    // Slots per level and brick, indexed by GetBrickIndex.
+    const std::vector<uint32_t>& GetIndirection() const { return m_indirection; }
+
+    // Slots handed out since BeginFrame; their voxels are stale and have to be cleared before use.
+    const std::vector<uint32_t>& GetNewBricks() const { return m_newBricks; }
+
+    // Whether the indirection changed since BeginFrame.
+    bool IsDirty() const { return m_dirty; }
+
+    const BrickMapStats& GetStats() const { return m_stats; }
+
+    int32_t GetBricksPerAxis() const { return m_bricksPerAxis; }
+
+    uint32_t GetBrickIndex(uint32_t level, const int32_t brick[3]) const;
+
+    // The slot of the brick holding a voxel, imageCoords being its toroidal coordinates inside the level.
+    uint32_t GetSlot(uint32_t level, const int32_t imageCoords[3]) const;
+
+private:
+    // Calls the action with the index of every image brick holding one of the voxels [minPos, maxPos) of the level.
+    template <typename ActionT>
+    void forEachBrick(uint32_t level, const int32_t minPos[3], const int32_t maxPos[3], ActionT&& action) const;
+
+    // A slot for a brick, growing the atlas when it is full.
+    uint32_t allocate();
+
+    BrickAllocator m_allocator;
+    std::vector<uint32_t> m_indirection;
+    // The UpdateRegion call that last touched a brick, and that found geometry in it.
+    std::vector<uint32_t> m_touched;
+    std::vector<uint32_t> m_occupied;
+    std::vector<uint32_t> m_touchedBricks;
+    std::vector<uint32_t> m_visible;
+    std::vector<uint32_t> m_newBricks;
+    uint32_t m_levelCount = 0;
+    int32_t m_resolution = 0;
+    int32_t m_bricksPerAxis = 0;
+    uint32_t m_update = 0;
+    bool m_dirty = false;
+    BrickMapStats m_stats = {};
+};
@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "CameraPredictor.h"
+#include <fstream>
+
+using namespace Math;
+
+namespace
+{
+    struct CameraPathHeader
+    {
+        uint32_t magic;
+        uint32_t frameCount;
+    };
+
+    const uint32_t kCameraPathMagic = 0x31484350;    // "PCH1"
+
+    // Weight of the newest frame's motion; the rest is the motion tracked so far, which smooths out frame time noise.
+    const float kVelocitySmoothing = 0.5f;
+}
+
+void CameraPredictor::Reset()
+{
+    m_velocity = Vector3(kZero);
+    m_angularVelocity = Vector3(kZero);
+    m_tracking = false;
+}
+
+void CameraPredictor::Update(const BaseCamera& camera, float deltaT)
+{
+    const Vector3 position = camera.GetPosition();
+    const Quaternion rotation = camera.GetRotation();
+    if (m_tracking && deltaT > 0.0f)
+    {
+        const Vector3 velocity = (position - m_position) / deltaT;
+
+        // The rotation that took last frame's orientation to this one, taken the short way round.
+        XMVECTOR delta = rotation * ~m_rotation;
+        if (XMVectorGetW(delta) < 0.0f)
+            delta = XMVectorNegate(delta);
+        XMVECTOR axis;
+        float angle;
+        XMQuaternionToAxisAngle(&axis, &angle, delta);
+        const Vector3 angularVelocity = angle > 1e-6f ? Normalize(Vector3(axis)) * (angle / deltaT) : Vector3(kZero);
+
+        m_velocity = m_velocity * (1.0f - kVelocitySmoothing) + velocity * kVelocitySmoothing;
+        m_angularVelocity = m_angularVelocity * (1.0f - kVelocitySmoothing) + angularVelocity * kVelocitySmoothing;
+    }
+    m_position = position;
+    m_rotation = rotation;
+    m_tracking = true;
+}
+
+Camera CameraPredictor::Predict(const Camera& camera, float seconds) const
+{
+    Camera predicted = camera;
+    const float angle = Length(m_angularVelocity) * seconds;
+    if (angle > 1e-6f)
+        predicted.SetRotation(Quaternion(Normalize(m_angularVelocity), angle) * camera.GetRotation());
+    predicted.SetPosition(camera.GetPosition() + m_velocity * seconds);
+    predicted.Update();
+    return predicted;
+}
+
+bool SaveCameraPath(const std::wstring& path, const std::vector<CameraPathFrame>& frames)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    const CameraPathHeader header = { kCameraPathMagic, static_cast<uint32_t>(frames.size()) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(CameraPathFrame));
+    return file.good();
+}
+
+bool LoadCameraPath(const std::wstring& path, std::vector<CameraPathFrame>& frames)
+{
+    std::ifstream file(path, std::ios::binary);
+    CameraPathHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kCameraPathMagic)
+        return false;
+    frames.resize(header.frameCount);
+    return !!file.read(reinterpret_cast<char*>(frames.data()), frames.size() * sizeof(CameraPathFrame));
+}
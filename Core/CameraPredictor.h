@@ -0,0 +1,45 @@
+#pragma once
+
+#pragma  region HEADER
+#include "Camera.h"
+#include <string>
+#include <vector>
+#pragma region
+
+// Tracks a camera's linear and angular velocity from frame to frame and extrapolates where it will be, so
+// streaming systems can ask for what the camera is about to see.
+class CameraPredictor
+{
+public:
+    // Forgets the tracked motion, e.g. after the camera jumped.
+    void Reset();
+
+    // Call once per frame after the camera was moved, with the time the frame took.
+    void Update(const Math::BaseCamera& camera, float deltaT);
+
+    // World space velocity, and angular velocity as an axis scaled by radians per second.
+    inline Math::Vector3 GetVelocity() const { return m_velocity; }
+    inline Math::Vector3 GetAngularVelocity() const { return m_angularVelocity; }
+
+    // Returns camera moved on for the given number of seconds at the tracked velocities.
+    Math::Camera Predict(const Math::Camera& camera, float seconds) const;
+
+private:
+    Math::Vector3 m_position = Math::Vector3(Math::kZero);
+    Math::Quaternion m_rotation;
+    Math::Vector3 m_velocity = Math::Vector3(Math::kZero);
+    Math::Vector3 m_angularVelocity = Math::Vector3(Math::kZero);
+    bool m_tracking = false;
+};
+
+// One frame of a recorded camera path.
+struct CameraPathFrame
+{
+    float deltaT;
+    XMFLOAT3 position;
+    XMFLOAT4 rotation;
+};
+
+// Paths are the frames behind a small header, for replaying the same camera motion across runs.
+bool SaveCameraPath(const std::wstring& path, const std::vector<CameraPathFrame>& frames);
+bool LoadCameraPath(const std::wstring& path, std::vector<CameraPathFrame>& frames);
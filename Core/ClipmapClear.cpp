@@ -0,0 +1,44 @@
+#include "pch.h"
+#include "ClipmapClear.h"
+
+void ClipmapClear::AppendRegion(std::vector<ClipmapClearRegion>& regions, const ClipmapBox& box, uint32_t clipmapLevel, int32_t resolution)
+{
+    ClipmapClearRegion region;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        region.imageMin[axis] = (box.minPos[axis] % resolution + resolution) % resolution;
+        region.extent[axis] = box.extent[axis];
+    }
+    region.clipmapLevel = static_cast<int32_t>(clipmapLevel);
+    region.firstVoxel = CountVoxels(regions);
+    regions.push_back(region);
+}
+
+uint32_t ClipmapClear::CountVoxels(const std::vector<ClipmapClearRegion>& regions)
+{
+    if (regions.empty())
+        return 0;
+    const ClipmapClearRegion& last = regions.back();
+    return last.firstVoxel + static_cast<uint32_t>(last.extent[0] * last.extent[1] * last.extent[2]);
+}
+
+uint32_t ClipmapClear::FindRegion(const std::vector<ClipmapClearRegion>& regions, uint32_t voxel)
+{
+    uint32_t r = 0;
+    for (uint32_t i = 1; i < regions.size(); ++i)
+    {
+        if (regions[i].firstVoxel <= voxel)
+            r = i;
+    }
+    return r;
+}
+
+void ClipmapClear::GetImageCoords(const ClipmapClearRegion& region, uint32_t voxel, int32_t resolution, int32_t imageCoords[3])
+{
+    const int32_t local = static_cast<int32_t>(voxel - region.firstVoxel);
+    const int32_t offset[3] = { local % region.extent[0], (local / region.extent[0]) % region.extent[1],
+        local / (region.extent[0] * region.extent[1]) };
+    // resolution is a power of two, so the mask wraps past the image's far side.
+    for (int axis = 0; axis < 3; ++axis)
+        imageCoords[axis] = (region.imageMin[axis] + offset[axis]) & (resolution - 1);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#pragma  region HEADER
+#include "ClipmapPlanner.h"
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// One region of a clipmap level to clear, in image coordinates of the level.  The clear dispatch numbers the voxels
+// of all its regions in a row, firstVoxel being the count of the regions before this one.  Mirrors ClearRegion in
+// ClearClipMap.hlsli.
+struct alignas(16) ClipmapClearRegion
+{
+    int32_t imageMin[3];
+    int32_t clipmapLevel;
+    int32_t extent[3];
+    uint32_t firstVoxel;
+};
+
+// How the clear dispatch of the VCT sample maps its threads to the voxels of the regions, step for step as
+// getRegionVoxel and getVoxelTexel in ClearClipMap.hlsli do it.
+namespace ClipmapClear
+{
+    // Appends the region of a box of the level, in world voxel coordinates, numbered after the regions before it.
+    // resolution is the level's power of two image extent.
+    void AppendRegion(std::vector<ClipmapClearRegion>& regions, const ClipmapBox& box, uint32_t clipmapLevel, int32_t resolution);
+
+    // The voxels of all the regions, the size of the dispatch.
+    uint32_t CountVoxels(const std::vector<ClipmapClearRegion>& regions);
+
+    // The region of a voxel of the dispatch: the last one starting at or before it.
+    uint32_t FindRegion(const std::vector<ClipmapClearRegion>& regions, uint32_t voxel);
+
+    // The image coordinates inside the level of a voxel of the region, wrapping toroidally.
+    void GetImageCoords(const ClipmapClearRegion& region, uint32_t voxel, int32_t resolution, int32_t imageCoords[3]);
+}
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "ClipmapPlanner.h"
+#include <cmath>
+#include <cstdlib>
+
+void ClipmapPlanner::ComputeDelta(const ClipmapBox& region, float voxelSize, const float boxMin[3], int32_t minChange, int32_t delta[3])
+{
+    const float minChangeW = voxelSize * float(minChange);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float deltaW = boxMin[axis] - float(region.minPos[axis]) * voxelSize;
+        delta[axis] = int32_t(std::trunc(deltaW / minChangeW)) * minChange;
+    }
+}
+
+uint32_t ClipmapPlanner::Move(ClipmapBox& region, float voxelSize, const float boxMin[3], int32_t minChange, std::vector<ClipmapBox>& slabs)
+{
+    int32_t delta[3];
+    ComputeDelta(region, voxelSize, boxMin, minChange, delta);
+    bool whole = false;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        region.minPos[axis] += delta[axis];
+        whole = whole || std::abs(delta[axis]) >= region.extent[axis];
+    }
+    if (whole)
+    {
+        slabs.push_back(region);
+        return 1;
+    }
+
+    uint32_t slabCount = 0;
+    ClipmapBox remaining = region;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int32_t absDelta = std::abs(delta[axis]);
+        if (absDelta < minChange)
+            continue;
+
+        ClipmapBox slab = remaining;
+        slab.extent[axis] = absDelta;
+        remaining.extent[axis] -= absDelta;
+        if (delta[axis] < 0)
+            remaining.minPos[axis] += absDelta;
+        else
+            slab.minPos[axis] = remaining.minPos[axis] + remaining.extent[axis];
+        slabs.push_back(slab);
+        slabCount++;
+    }
+    return slabCount;
+}
+
+uint64_t ClipmapPlanner::CountVoxels(const ClipmapBox& box)
+{
+    return uint64_t(box.extent[0]) * uint64_t(box.extent[1]) * uint64_t(box.extent[2]);
+}
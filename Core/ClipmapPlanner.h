@@ -0,0 +1,30 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// A box of voxels of a clipmap level in world voxel coordinates: voxel v covers [v, v + 1) times the voxel size.
+struct ClipmapBox
+{
+    int32_t minPos[3];
+    int32_t extent[3];
+};
+
+// How the clip regions of a clipmap follow the camera, and which voxels a move exposes.  A region only moves in
+// whole steps of minChange voxels, which trades voxels kept a little off center for fewer, thicker slabs to
+// revoxelize.
+namespace ClipmapPlanner
+{
+    // The move, in voxels, that brings the region's min corner to the box's, truncated to whole steps of minChange
+    // voxels toward the region's current place.
+    void ComputeDelta(const ClipmapBox& region, float voxelSize, const float boxMin[3], int32_t minChange, int32_t delta[3]);
+
+    // Moves the region to the box and appends the slabs it moved into.  Each slab is cut from what the previous ones
+    // left of the region, so the slabs are disjoint and no corner is revoxelized twice.  The whole region is
+    // appended when it moved by its extent or more.  Returns the number of boxes appended.
+    uint32_t Move(ClipmapBox& region, float voxelSize, const float boxMin[3], int32_t minChange, std::vector<ClipmapBox>& slabs);
+
+    uint64_t CountVoxels(const ClipmapBox& box);
+}
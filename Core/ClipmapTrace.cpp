@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "ClipmapTrace.h"
+
+namespace
+{
+    const uint32_t kClipmapTraceMagic = 0x31544D43;    // "CMT1"
+    const uint32_t kClipmapTraceVersion = 1;
+}
+
+bool ClipmapTraceRecorder::Open(const std::wstring& path, const ClipmapTraceHeader& header)
+{
+    Close();
+    if (header.levelCount == 0 || header.levelCount > kClipmapTraceMaxLevels)
+        return false;
+    m_file.open(path, std::ios::binary);
+    if (!m_file)
+        return false;
+    ClipmapTraceHeader written = header;
+    written.magic = kClipmapTraceMagic;
+    written.version = kClipmapTraceVersion;
+    written.frameCount = 0;
+    m_file.write(reinterpret_cast<const char*>(&written), sizeof(written));
+    m_levelCount = header.levelCount;
+    m_frameCount = 0;
+    return m_file.good();
+}
+
+void ClipmapTraceRecorder::WriteFrame(const ClipmapTraceBox* boxes)
+{
+    m_file.write(reinterpret_cast<const char*>(boxes), m_levelCount * sizeof(ClipmapTraceBox));
+    m_frameCount++;
+}
+
+void ClipmapTraceRecorder::Close()
+{
+    if (!m_file.is_open())
+        return;
+    m_file.seekp(offsetof(ClipmapTraceHeader, frameCount));
+    m_file.write(reinterpret_cast<const char*>(&m_frameCount), sizeof(m_frameCount));
+    m_file.close();
+}
+
+bool LoadClipmapTrace(const std::wstring& path, ClipmapTraceHeader& header, std::vector<ClipmapTraceBox>& boxes)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kClipmapTraceMagic ||
+        header.version != kClipmapTraceVersion || header.levelCount == 0 || header.levelCount > kClipmapTraceMaxLevels ||
+        header.resolution == 0 || !(header.voxelSize > 0.0f))
+        return false;
+
+    boxes.resize(size_t(header.frameCount) * header.levelCount);
+    return bool(file.read(reinterpret_cast<char*>(boxes.data()), boxes.size() * sizeof(ClipmapTraceBox)));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#pragma region
+
+const uint32_t kClipmapTraceMaxLevels = 8;
+
+// A clipmap trace is the camera boxes a clipmap followed, frame by frame, so ClipmapPlanner can be replayed without
+// a device against other steps (see Tools/ClipmapReplay).
+struct ClipmapTraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levelCount;
+    uint32_t resolution;
+    // The voxel size of level 0; level k's is 2^k times that.
+    float voxelSize;
+    // The steps of the recording, the replay's defaults.
+    uint32_t minChange[kClipmapTraceMaxLevels];
+    uint32_t frameCount;
+};
+
+struct ClipmapTraceBox
+{
+    float min[3];
+    float max[3];
+};
+
+class ClipmapTraceRecorder
+{
+public:
+    ~ClipmapTraceRecorder() { Close(); }
+
+    // header.magic, version and frameCount are filled in.
+    bool Open(const std::wstring& path, const ClipmapTraceHeader& header);
+    // One box per level.
+    void WriteFrame(const ClipmapTraceBox* boxes);
+    // Patches the frame count into the header.
+    void Close();
+
+    inline bool IsOpen() const { return m_file.is_open(); }
+
+private:
+    std::ofstream m_file;
+    uint32_t m_levelCount = 0;
+    uint32_t m_frameCount = 0;
+};
+
+// boxes holds header.levelCount boxes per frame.
+bool LoadClipmapTrace(const std::wstring& path, ClipmapTraceHeader& header, std::vector<ClipmapTraceBox>& boxes);
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "ClipmapUpdateScheduler.h"
+#include <algorithm>
+
+namespace
+{
+    // The throughput assumed until a frame has been measured, in voxels per millisecond.
+    const double kInitialVoxelsPerMs = 1 << 20;
+
+    // Weight of the newest frame in the moving averages.
+    const double kAverageWeight = 0.1;
+}
+
+void ClipmapUpdateScheduler::Reset(uint32_t levelCount)
+{
+    m_pendingSince.assign(levelCount, kNotPending);
+    for (FrameVoxels& frameVoxels : m_frameVoxels)
+        frameVoxels = FrameVoxels{ kNotPending, 0 };
+    m_averageVoxels = 0.0;
+    m_averageMs = 0.0;
+    m_stats = {};
+}
+
+void ClipmapUpdateScheduler::Request(uint32_t level, uint64_t frame)
+{
+    m_pendingSince[level] = std::min(m_pendingSince[level], frame);
+}
+
+void ClipmapUpdateScheduler::RecordVoxels(uint64_t frame, uint64_t voxels)
+{
+    m_frameVoxels[frame % kFrameHistory] = FrameVoxels{ frame, voxels };
+}
+
+void ClipmapUpdateScheduler::Measure(uint64_t frame, float gpuMs)
+{
+    const FrameVoxels& frameVoxels = m_frameVoxels[frame % kFrameHistory];
+    if (gpuMs <= 0.0f || frameVoxels.frame != frame)
+        return;
+    m_stats.measuredMs = gpuMs;
+    // A frame that only kept the bricks up to date says nothing about the cost of a voxel.
+    if (frameVoxels.voxels == 0)
+        return;
+    if (m_averageMs == 0.0)
+    {
+        m_averageVoxels = double(frameVoxels.voxels);
+        m_averageMs = gpuMs;
+        return;
+    }
+    m_averageVoxels += (double(frameVoxels.voxels) - m_averageVoxels) * kAverageWeight;
+    m_averageMs += (gpuMs - m_averageMs) * kAverageWeight;
+}
+
+bool ClipmapUpdateScheduler::IsDue(uint32_t level, uint64_t frame, uint32_t periodShift)
+{
+    const uint32_t shift = std::min(level * periodShift, 30u);
+    if (shift == 0)
+        return true;
+    // Level k is due on the frames where frame + 1 is an odd multiple of half its period, which no other level
+    // of the same shift shares.
+    const uint64_t period = 1ull << shift;
+    return ((frame + 1) & (period - 1)) == period / 2;
+}
+
+uint32_t ClipmapUpdateScheduler::Schedule(uint64_t frame, const std::vector<uint64_t>& levelVoxels, uint32_t periodShift, float budgetMs, uint32_t maxLatency)
+{
+    const double voxelsPerMs = m_averageMs > 0.0 && m_averageVoxels > 0.0 ? m_averageVoxels / m_averageMs : kInitialVoxelsPerMs;
+
+    m_stats.updatedLevels = 0;
+    m_stats.deferredLevels = 0;
+    m_stats.scheduledVoxels = 0;
+    m_stats.estimatedMs = 0.0f;
+    m_stats.budgetMs = budgetMs;
+    m_stats.voxelsPerMs = float(voxelsPerMs);
+    m_stats.maxWait = 0;
+
+    // Levels that waited maxLatency frames go first, longest waiting first, then the rest finest first.
+    std::vector<uint32_t>& candidates = m_candidates;
+    candidates.clear();
+    for (uint32_t level = 0; level < m_pendingSince.size(); ++level)
+    {
+        if (IsDue(level, frame, periodShift))
+            Request(level, frame);
+        if (m_pendingSince[level] == kNotPending)
+            continue;
+        if (levelVoxels[level] == 0)
+        {
+            m_pendingSince[level] = kNotPending;
+            continue;
+        }
+        candidates.push_back(level);
+    }
+    auto isOverdue = [&](uint32_t level) { return frame - m_pendingSince[level] >= maxLatency; };
+    std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b)
+    {
+        if (isOverdue(a) != isOverdue(b))
+            return isOverdue(a);
+        return isOverdue(a) && m_pendingSince[a] < m_pendingSince[b];
+    });
+
+    // The first candidate is taken whatever it costs, so a level requested with all the others, as after a full
+    // revoxelization, takes its turn rather than all of them landing on the same frame.
+    double estimatedMs = 0.0;
+    for (uint32_t level : candidates)
+    {
+        const uint64_t wait = frame - m_pendingSince[level];
+        const double cost = double(levelVoxels[level]) / voxelsPerMs;
+        if (m_stats.updatedLevels != 0 && estimatedMs + cost > budgetMs)
+        {
+            m_stats.deferredLevels |= 1u << level;
+            m_stats.maxWait = std::max(m_stats.maxWait, uint32_t(wait));
+            continue;
+        }
+
+        estimatedMs += cost;
+        m_stats.updatedLevels |= 1u << level;
+        m_stats.scheduledVoxels += levelVoxels[level];
+        m_pendingSince[level] = kNotPending;
+    }
+    m_stats.estimatedMs = float(estimatedMs);
+    return m_stats.updatedLevels;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+struct ClipmapUpdateStats
+{
+    // Bit k is set for level k.
+    uint32_t updatedLevels;
+    uint32_t deferredLevels;
+    uint64_t scheduledVoxels;
+    // The estimate the levels were scheduled against, and the last measured GPU time.
+    float estimatedMs;
+    float measuredMs;
+    float budgetMs;
+    float voxelsPerMs;
+    // Frames the longest waiting level has been deferred.
+    uint32_t maxWait;
+};
+
+// Spreads the revoxelization of the clipmap levels over frames, so its cost stays flat instead of landing whole on
+// the frames the camera crosses a voxel boundary on every level at once.
+//
+// Level k falls due every 2^(k * periodShift) frames, phased so that at most one coarser level falls due on any frame
+// besides level 0, and stays pending until it is updated.  Pending levels are taken finest first while their
+// estimated cost fits the budget; the estimate is the voxel throughput of the last measured frames.  Levels that have
+// waited maxLatency frames go ahead of the others, and the first level in line is taken whatever the budget, so every
+// level keeps up.
+class ClipmapUpdateScheduler
+{
+public:
+    // Frames whose voxel counts are kept for their GPU times to be paired with.
+    static constexpr uint32_t kFrameHistory = 4;
+
+    void Reset(uint32_t levelCount);
+
+    // Makes the level pending now, whether or not it is due.
+    void Request(uint32_t level, uint64_t frame);
+
+    // The voxels the voxel passes of a frame covered, kept until the frame's GPU time is read back.
+    void RecordVoxels(uint64_t frame, uint64_t voxels);
+
+    // Feeds back the GPU time of a frame's voxel passes, which is paired with the voxels recorded for that frame.
+    // Times of 0, from frames without a measurement, frames that covered no voxels and frames no longer recorded
+    // are ignored.
+    void Measure(uint64_t frame, float gpuMs);
+
+    // Picks the levels to update this frame.  levelVoxels holds, per level, the voxels its update would cover, 0 when
+    // there is nothing to do.  Returns a mask with bit k set for level k; those levels stop being pending.
+    uint32_t Schedule(uint64_t frame, const std::vector<uint64_t>& levelVoxels, uint32_t periodShift, float budgetMs, uint32_t maxLatency);
+
+    static bool IsDue(uint32_t level, uint64_t frame, uint32_t periodShift);
+
+    inline const ClipmapUpdateStats& GetStats() const { return m_stats; }
+
+private:
+    // The frame each level became pending on, or kNotPending.
+    static constexpr uint64_t kNotPending = ~0ull;
+
+    struct FrameVoxels
+    {
+        uint64_t frame;
+        uint64_t voxels;
+    };
+
+    std::vector<uint64_t> m_pendingSince;
+    std::vector<uint32_t> m_candidates;
+    // Indexed by frame % kFrameHistory.
+    FrameVoxels m_frameVoxels[kFrameHistory];
+    // Moving averages of the voxels covered and the GPU time of the measured frames.
+    double m_averageVoxels = 0.0;
+    double m_averageMs = 0.0;
+    ClipmapUpdateStats m_stats = {};
+};
@@ -0,0 +1,303 @@
+#include "pch.h"
+#include "ClusteredLightGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace
+{
+    // Summed in the same order as the SSE path so both round alike.
+    inline float Distance(float nx, float ny, float nz, float w, const float c[3])
+    {
+        return ((nx * c[0] + ny * c[1]) + nz * c[2]) + w;
+    }
+
+    inline uint32_t CountLights(uint32_t counts)
+    {
+        return (counts & 0xff) + ((counts >> 8) & 0xff) + ((counts >> 16) & 0xff);
+    }
+
+    // The view space point at a positive depth that projects to ndcX, ndcY.  The projection maps x to
+    // (scaleX * x + offsetX * z) / -z, so at z = -depth, x = (ndcX + offsetX) * depth / scaleX, and y likewise.
+    inline void Unproject(const LightClusterDesc& desc, float ndcX, float ndcY, float depth, float point[3])
+    {
+        point[0] = (ndcX + desc.projOffsetX) * depth / desc.projScaleX;
+        point[1] = (ndcY + desc.projOffsetY) * depth / desc.projScaleY;
+        point[2] = -depth;
+    }
+
+    // The unit plane through a, b and c, facing inside.
+    inline void GetPlane(const float a[3], const float b[3], const float c[3], const float inside[3], float plane[4])
+    {
+        const float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        float invLength = 1.0f / std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (n[0] * (inside[0] - a[0]) + n[1] * (inside[1] - a[1]) + n[2] * (inside[2] - a[2]) < 0.0f)
+            invLength = -invLength;
+        for (int i = 0; i < 3; ++i)
+            plane[i] = n[i] * invLength;
+        plane[3] = -(plane[0] * a[0] + plane[1] * a[1] + plane[2] * a[2]);
+    }
+}
+
+void ClusteredLightGrid::Boundaries::Reset(uint32_t cells)
+{
+    // The SSE loop reads the boundaries i to i + 4 for the last i below cells that is a multiple of four.
+    cellCount = cells;
+    const size_t padded = ((cells + 1 + 3) & ~3u) + 4;
+    for (int c = 0; c < 3; ++c)
+        n[c].assign(padded, 0.0f);
+    w.assign(padded, 0.0f);
+}
+
+void ClusteredLightGrid::Boundaries::Set(uint32_t i, float nx, float ny, float nz, float d)
+{
+    const float invLength = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+    n[0][i] = nx * invLength;
+    n[1][i] = ny * invLength;
+    n[2][i] = nz * invLength;
+    w[i] = d * invLength;
+}
+
+void ClusteredLightGrid::reset(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights)
+{
+    m_desc = desc;
+    m_tileCountX = (desc.viewportWidth + desc.tileDim - 1) / desc.tileDim;
+    m_tileCountY = (desc.viewportHeight + desc.tileDim - 1) / desc.tileDim;
+
+    // A point is right of the column boundary x_ndc when scaleX * x + offsetX * z > x_ndc * -z, below the row
+    // boundary y_ndc when scaleY * y + offsetY * z < y_ndc * -z, and past the slice boundary d when -z > d.
+    m_columnPlanes.Reset(m_tileCountX);
+    for (uint32_t i = 0; i <= m_tileCountX; ++i)
+    {
+        const float ndc = 2.0f * float(i * desc.tileDim) / float(desc.viewportWidth) - 1.0f;
+        m_columnPlanes.Set(i, desc.projScaleX, 0.0f, desc.projOffsetX + ndc, 0.0f);
+    }
+    m_rowPlanes.Reset(m_tileCountY);
+    for (uint32_t i = 0; i <= m_tileCountY; ++i)
+    {
+        const float ndc = 1.0f - 2.0f * float(i * desc.tileDim) / float(desc.viewportHeight);
+        m_rowPlanes.Set(i, 0.0f, -desc.projScaleY, -(desc.projOffsetY + ndc), 0.0f);
+    }
+    m_slicePlanes.Reset(desc.sliceCount);
+    for (uint32_t i = 0; i <= desc.sliceCount; ++i)
+    {
+        const float depth = i == desc.sliceCount ? desc.farZ : desc.nearZ * std::pow(desc.farZ / desc.nearZ, float(i) / float(desc.sliceCount));
+        m_slicePlanes.Set(i, 0.0f, 0.0f, -1.0f, -depth);
+    }
+
+    m_order.resize(lights.size());
+    for (uint32_t i = 0; i < m_order.size(); ++i)
+        m_order[i] = i;
+    std::stable_sort(m_order.begin(), m_order.end(), [&lights](uint32_t a, uint32_t b) { return lights[a].type < lights[b].type; });
+
+    // The count words are kept apart while appending, where they stay in cache, and written by finish.  The indices
+    // past a cell's count are never read, so the grid is not cleared.
+    m_grid.resize(size_t(GetClusterCount()) * (1 + desc.cellCapacity));
+    m_counts.assign(GetClusterCount(), 0);
+    m_bitMask.assign(size_t(GetClusterCount()) * desc.bitMaskWords, 0);
+    m_stats = LightClusterStats();
+}
+
+void ClusteredLightGrid::gatherCells(const Boundaries& boundaries, const float pos[3], float radius, bool simd, std::vector<uint32_t>& cells)
+{
+    cells.clear();
+    m_distances.resize(boundaries.w.size());
+    if (!simd)
+    {
+        for (uint32_t i = 0; i <= boundaries.cellCount; ++i)
+            m_distances[i] = Distance(boundaries.n[0][i], boundaries.n[1][i], boundaries.n[2][i], boundaries.w[i], pos);
+        // The distance to the boundary facing back is exactly the negated distance.
+        for (uint32_t i = 0; i < boundaries.cellCount; ++i)
+        {
+            if (m_distances[i] >= -radius && -m_distances[i + 1] >= -radius)
+                cells.push_back(i);
+        }
+        return;
+    }
+
+    const __m128 px = _mm_set1_ps(pos[0]);
+    const __m128 py = _mm_set1_ps(pos[1]);
+    const __m128 pz = _mm_set1_ps(pos[2]);
+    for (size_t i = 0; i < m_distances.size(); i += 4)
+    {
+        __m128 d = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&boundaries.n[0][i]), px), _mm_mul_ps(_mm_loadu_ps(&boundaries.n[1][i]), py));
+        d = _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(&boundaries.n[2][i]), pz)), _mm_loadu_ps(&boundaries.w[i]));
+        _mm_storeu_ps(&m_distances[i], d);
+    }
+    const __m128 minusRadius = _mm_set1_ps(-radius);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (uint32_t i = 0; i < boundaries.cellCount; i += 4)
+    {
+        const __m128 front = _mm_cmpge_ps(_mm_loadu_ps(&m_distances[i]), minusRadius);
+        const __m128 back = _mm_cmpge_ps(_mm_xor_ps(_mm_loadu_ps(&m_distances[i + 1]), signBit), minusRadius);
+        uint32_t mask = uint32_t(_mm_movemask_ps(_mm_and_ps(front, back)));
+        if (boundaries.cellCount - i < 4)
+            mask &= (1u << (boundaries.cellCount - i)) - 1;
+        for (uint32_t bit = 0; mask != 0; ++bit, mask >>= 1)
+        {
+            if (mask & 1)
+                cells.push_back(i + bit);
+        }
+    }
+}
+
+void ClusteredLightGrid::append(uint32_t cluster, uint32_t light, uint32_t type)
+{
+    if (light < m_desc.bitMaskWords * 32)
+        m_bitMask[size_t(cluster) * m_desc.bitMaskWords + light / 32] |= 1u << (light % 32);
+    if (type >= kLightClusterTypeCount)
+        return;
+
+    uint32_t& counts = m_counts[cluster];
+    const uint32_t count = CountLights(counts);
+    if (count == m_desc.cellCapacity || ((counts >> (8 * type)) & 0xff) == 0xff)
+    {
+        m_stats.droppedIndices++;
+        return;
+    }
+    m_grid[size_t(cluster) * (1 + m_desc.cellCapacity) + 1 + count] = light;
+    counts += 1u << (8 * type);
+}
+
+void ClusteredLightGrid::finish()
+{
+    for (uint32_t cluster = 0; cluster < m_counts.size(); ++cluster)
+    {
+        const uint32_t counts = m_counts[cluster];
+        m_grid[size_t(cluster) * (1 + m_desc.cellCapacity)] = counts;
+        const uint32_t count = CountLights(counts);
+        m_stats.indices += count;
+        m_stats.occupiedCells += count > 0 ? 1 : 0;
+        m_stats.maxCellLights = std::max(m_stats.maxCellLights, count);
+    }
+}
+
+void ClusteredLightGrid::Build(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights, bool simd)
+{
+    reset(desc, lights);
+    for (uint32_t index : m_order)
+    {
+        const LightClusterLight& light = lights[index];
+        gatherCells(m_columnPlanes, light.pos, light.radius, simd, m_columns);
+        if (m_columns.empty())
+            continue;
+        gatherCells(m_rowPlanes, light.pos, light.radius, simd, m_rows);
+        if (m_rows.empty())
+            continue;
+        gatherCells(m_slicePlanes, light.pos, light.radius, simd, m_slices);
+        for (uint32_t slice : m_slices)
+        {
+            for (uint32_t row : m_rows)
+            {
+                const uint32_t rowCluster = (slice * m_tileCountY + row) * m_tileCountX;
+                for (uint32_t column : m_columns)
+                    append(rowCluster + column, index, light.type);
+            }
+        }
+    }
+    finish();
+}
+
+void ClusteredLightGrid::BuildReference(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights)
+{
+    reset(desc, lights);
+
+    // The six planes of every cluster, from its eight corners: the corners of its tile unprojected to the depths of
+    // its slice.  The sides pass through the eye.
+    std::vector<float> clusterPlanes(size_t(GetClusterCount()) * 24);
+    const float eye[3] = {};
+    for (uint32_t slice = 0; slice < desc.sliceCount; ++slice)
+    {
+        const float nearDepth = desc.nearZ * std::pow(desc.farZ / desc.nearZ, float(slice) / float(desc.sliceCount));
+        const float farDepth = slice + 1 == desc.sliceCount ? desc.farZ :
+            desc.nearZ * std::pow(desc.farZ / desc.nearZ, float(slice + 1) / float(desc.sliceCount));
+        for (uint32_t row = 0; row < m_tileCountY; ++row)
+        {
+            const float top = 1.0f - 2.0f * float(row * desc.tileDim) / float(desc.viewportHeight);
+            const float bottom = 1.0f - 2.0f * float((row + 1) * desc.tileDim) / float(desc.viewportHeight);
+            for (uint32_t column = 0; column < m_tileCountX; ++column)
+            {
+                const float left = 2.0f * float(column * desc.tileDim) / float(desc.viewportWidth) - 1.0f;
+                const float right = 2.0f * float((column + 1) * desc.tileDim) / float(desc.viewportWidth) - 1.0f;
+
+                // Corner i is right when bit 0 is set, at the bottom when bit 1 is and far when bit 2 is.
+                float corners[8][3];
+                float center[3] = {};
+                for (int i = 0; i < 8; ++i)
+                {
+                    Unproject(desc, (i & 1) ? right : left, (i & 2) ? bottom : top, (i & 4) ? farDepth : nearDepth, corners[i]);
+                    for (int c = 0; c < 3; ++c)
+                        center[c] += corners[i][c] * 0.125f;
+                }
+
+                float* planes = &clusterPlanes[size_t((slice * m_tileCountY + row) * m_tileCountX + column) * 24];
+                GetPlane(eye, corners[4], corners[6], center, planes);
+                GetPlane(eye, corners[5], corners[7], center, planes + 4);
+                GetPlane(eye, corners[4], corners[5], center, planes + 8);
+                GetPlane(eye, corners[6], corners[7], center, planes + 12);
+                GetPlane(corners[0], corners[1], corners[2], center, planes + 16);
+                GetPlane(corners[4], corners[5], corners[6], center, planes + 20);
+            }
+        }
+    }
+
+    for (uint32_t index : m_order)
+    {
+        const LightClusterLight& light = lights[index];
+        for (uint32_t cluster = 0; cluster < GetClusterCount(); ++cluster)
+        {
+            const float* planes = &clusterPlanes[size_t(cluster) * 24];
+            bool overlapping = true;
+            for (int n = 0; n < 6; ++n)
+            {
+                const float* plane = planes + n * 4;
+                if (plane[0] * light.pos[0] + plane[1] * light.pos[1] + plane[2] * light.pos[2] + plane[3] < -light.radius)
+                    overlapping = false;
+            }
+            if (overlapping)
+                append(cluster, index, light.type);
+        }
+    }
+    finish();
+}
+
+bool ClusteredLightGrid::IsNearBoundary(const LightClusterDesc& desc, const LightClusterLight& light, float tolerance)
+{
+    const float* pos = light.pos;
+    const float margin = tolerance * (std::sqrt(pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2]) + light.radius);
+    const float eye[3] = {};
+    const uint32_t tileCountX = (desc.viewportWidth + desc.tileDim - 1) / desc.tileDim;
+    const uint32_t tileCountY = (desc.viewportHeight + desc.tileDim - 1) / desc.tileDim;
+
+    // The sides of the clusters between two tiles are planes through the eye and the tile edge, whichever the tiles'
+    // rows or slices.
+    for (uint32_t i = 0; i <= tileCountX + tileCountY; ++i)
+    {
+        float a[3], b[3], plane[4];
+        if (i <= tileCountX)
+        {
+            const float ndc = 2.0f * float(i * desc.tileDim) / float(desc.viewportWidth) - 1.0f;
+            Unproject(desc, ndc, -1.0f, 1.0f, a);
+            Unproject(desc, ndc, 1.0f, 1.0f, b);
+        }
+        else
+        {
+            const float ndc = 1.0f - 2.0f * float((i - tileCountX - 1) * desc.tileDim) / float(desc.viewportHeight);
+            Unproject(desc, -1.0f, ndc, 1.0f, a);
+            Unproject(desc, 1.0f, ndc, 1.0f, b);
+        }
+        GetPlane(eye, a, b, pos, plane);
+        const float distance = plane[0] * pos[0] + plane[1] * pos[1] + plane[2] * pos[2] + plane[3];
+        if (std::abs(distance - light.radius) <= margin)
+            return true;
+    }
+    for (uint32_t slice = 0; slice <= desc.sliceCount; ++slice)
+    {
+        const float depth = slice == desc.sliceCount ? desc.farZ : desc.nearZ * std::pow(desc.farZ / desc.nearZ, float(slice) / float(desc.sliceCount));
+        if (std::abs(std::abs(-pos[2] - depth) - light.radius) <= margin)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// The light types, in the order a cell lists them; see LightData::type.
+enum LightClusterType
+{
+    kLightClusterSphere,
+    kLightClusterCone,
+    kLightClusterConeShadowed,
+    kLightClusterTypeCount
+};
+
+// A view frustum cut into clusters: the screen tiles of the light grid, each cut into depth slices spaced
+// exponentially from nearZ to farZ.  View space is right handed and looks down -z.
+struct LightClusterDesc
+{
+    uint32_t viewportWidth;
+    uint32_t viewportHeight;
+    // Pixels per side of a tile, as LightGridDim.
+    uint32_t tileDim;
+    // One slice gives the 2D grid the light grid shaders read.
+    uint32_t sliceCount;
+    // Positive view space depths.
+    float nearZ;
+    float farZ;
+    // The projection's [0][0], [1][1], [0][2] and [1][2].
+    float projScaleX;
+    float projScaleY;
+    float projOffsetX;
+    float projOffsetY;
+    // Light indices a cell holds, MAX_LIGHTS in LightGrid.hlsli.
+    uint32_t cellCapacity;
+    // Words of the light bit mask per cell; lights past 32 times that have no bit.
+    uint32_t bitMaskWords;
+};
+
+struct LightClusterLight
+{
+    // View space.
+    float pos[3];
+    float radius;
+    uint32_t type;
+};
+
+struct LightClusterStats
+{
+    uint64_t indices;
+    uint32_t occupiedCells;
+    uint32_t maxCellLights;
+    // Indices that did not fit their cell, or the 255 of their type a cell counts.
+    uint64_t droppedIndices;
+};
+
+// Assigns lights to clusters on the CPU, in the layout FillLightGridCS writes: every cell is a count word with the
+// sphere, cone and shadowed cone lights in bits 0, 8 and 16, followed by their indices in that order, and cells are
+// 1 + cellCapacity words apart, (slice * tileCountY + y) * tileCountX + x.  Within a type, indices ascend.  A light
+// is in a cluster when its bounding sphere is not wholly outside one of the cluster's six planes, as in the shaders.
+class ClusteredLightGrid
+{
+public:
+    // The planes of the clusters are separable, so each light is tested against the boundaries of the tile columns,
+    // the tile rows and the slices on their own, four boundaries at a time with SSE unless simd is false, and added
+    // to every cluster of the cells it overlaps along all three.
+    void Build(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights, bool simd);
+
+    // Tests every light against the six planes of every cluster, the reference Build is checked against.  The planes
+    // are found from the cluster's corners, the tile corners unprojected to the slice depths, rather than from the
+    // boundaries Build uses.
+    void BuildReference(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights);
+
+    // Whether the light's sphere is within tolerance, relative to its distance from the eye, of touching a boundary
+    // between clusters.  Rounding decides whether Build and BuildReference count such a light in, so the checks
+    // leave them out.
+    static bool IsNearBoundary(const LightClusterDesc& desc, const LightClusterLight& light, float tolerance);
+
+    inline uint32_t GetTileCountX() const { return m_tileCountX; }
+    inline uint32_t GetTileCountY() const { return m_tileCountY; }
+    inline uint32_t GetClusterCount() const { return m_tileCountX * m_tileCountY * m_desc.sliceCount; }
+
+    inline const std::vector<uint32_t>& GetGrid() const { return m_grid; }
+    inline const std::vector<uint32_t>& GetBitMask() const { return m_bitMask; }
+    inline const LightClusterStats& GetStats() const { return m_stats; }
+
+private:
+    // The boundaries between the cells along one axis, the tile columns, the tile rows or the slices, each facing the
+    // next cell.  The planes are stored component by component and padded with zero planes for the SSE loads.
+    struct Boundaries
+    {
+        void Reset(uint32_t cells);
+        void Set(uint32_t i, float nx, float ny, float nz, float w);
+
+        uint32_t cellCount = 0;
+        std::vector<float> n[3];
+        std::vector<float> w;
+    };
+
+    void reset(const LightClusterDesc& desc, const std::vector<LightClusterLight>& lights);
+    // The cells along the axis the sphere overlaps: those between boundaries i and i + 1 the sphere is not wholly
+    // behind.  Four boundaries are tested at a time with SSE when simd is set.
+    void gatherCells(const Boundaries& boundaries, const float pos[3], float radius, bool simd, std::vector<uint32_t>& cells);
+    void append(uint32_t cluster, uint32_t light, uint32_t type);
+    void finish();
+
+    LightClusterDesc m_desc = {};
+    uint32_t m_tileCountX = 0;
+    uint32_t m_tileCountY = 0;
+    Boundaries m_columnPlanes;
+    Boundaries m_rowPlanes;
+    Boundaries m_slicePlanes;
+    // The lights by type, then index.
+    std::vector<uint32_t> m_order;
+    std::vector<float> m_distances;
+    std::vector<uint32_t> m_columns;
+    std::vector<uint32_t> m_rows;
+    std::vector<uint32_t> m_slices;
+    // The count word of every cell.
+    std::vector<uint32_t> m_counts;
+    std::vector<uint32_t> m_grid;
+    std::vector<uint32_t> m_bitMask;
+    LightClusterStats m_stats = {};
+};
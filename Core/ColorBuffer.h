@@ -58,6 +58,7 @@ public:
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV(void) const { return m_SRVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetRTV(void) const { return m_RTVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetUAV(void) const { return m_UAVHandle[0]; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetUAV(uint32_t MipLevel) const { ASSERT(MipLevel <= m_NumMipMaps); return m_UAVHandle[MipLevel]; }
 
     void SetClearColor( Color ClearColor ) { m_ClearColor = ClearColor; }
 
@@ -82,6 +82,11 @@ CommandContext& CommandContext::Begin( const std::wstring ID )
     return *NewContext;
 }
 
+CommandContext& CommandContext::BeginCopy( void )
+{
+    return *g_ContextManager.AllocateContext(D3D12_COMMAND_LIST_TYPE_COPY);
+}
+
 ComputeContext& ComputeContext::Begin(const std::wstring& ID, bool Async)
 {
     ComputeContext& NewContext = g_ContextManager.AllocateContext(
@@ -127,7 +132,8 @@ uint64_t CommandContext::Flush(bool WaitForCompletion)
 
 uint64_t CommandContext::Finish( bool WaitForCompletion )
 {
-    ASSERT(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT || m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+    ASSERT(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT || m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE ||
+        m_Type == D3D12_COMMAND_LIST_TYPE_COPY);
 
     FlushResourceBarriers();
 
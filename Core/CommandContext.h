@@ -96,6 +96,10 @@ public:
 
     static CommandContext& Begin(const std::wstring ID = L"");
 
+    // A context on the copy queue.  Copy lists can only record copies, and the resources they touch must be in
+    // the common state or promotable from it.
+    static CommandContext& BeginCopy(void);
+
     // Flush existing commands to the GPU but keep the context alive
     uint64_t Flush( bool WaitForCompletion = false );
 
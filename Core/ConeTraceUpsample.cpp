@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "ConeTraceUpsample.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // The Bayer index of a pixel of a power of two block; the finest bit of the position is the most significant
+    // digit, so consecutive indices alternate between the coarsest halves of the block.
+    uint32_t GetBayerIndex(uint32_t x, uint32_t y, uint32_t scale)
+    {
+        uint32_t index = 0;
+        for (uint32_t bit = 1; bit < scale; bit <<= 1)
+        {
+            const bool bx = (x & bit) != 0;
+            const bool by = (y & bit) != 0;
+            index = index * 4 + (bx ? (by ? 1 : 2) : (by ? 3 : 0));
+        }
+        return index;
+    }
+
+    inline float Saturate(float value)
+    {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+    // SampleLevel of a linear clamp sampler at uv, in pixels: pos / size.
+    float SampleBilinear(const std::vector<float>& image, uint32_t width, uint32_t height, float posX, float posY)
+    {
+        const float x = posX - 0.5f;
+        const float y = posY - 0.5f;
+        const float baseX = std::floor(x);
+        const float baseY = std::floor(y);
+        const float fx = x - baseX;
+        const float fy = y - baseY;
+        const int32_t x0 = std::min(std::max(int32_t(baseX), 0), int32_t(width) - 1);
+        const int32_t x1 = std::min(std::max(int32_t(baseX) + 1, 0), int32_t(width) - 1);
+        const int32_t y0 = std::min(std::max(int32_t(baseY), 0), int32_t(height) - 1);
+        const int32_t y1 = std::min(std::max(int32_t(baseY) + 1, 0), int32_t(height) - 1);
+        const float top = image[size_t(y0) * width + x0] * (1.0f - fx) + image[size_t(y0) * width + x1] * fx;
+        const float bottom = image[size_t(y1) * width + x0] * (1.0f - fx) + image[size_t(y1) * width + x1] * fx;
+        return top * (1.0f - fy) + bottom * fy;
+    }
+}
+
+void ConeTraceUpsample::GetTraceJitter(uint64_t frame, uint32_t scale, int32_t jitter[2])
+{
+    const uint32_t index = uint32_t(frame % (uint64_t(scale) * scale));
+    jitter[0] = 0;
+    jitter[1] = 0;
+    for (uint32_t y = 0; y < scale; ++y)
+    {
+        for (uint32_t x = 0; x < scale; ++x)
+        {
+            if (GetBayerIndex(x, y, scale) == index)
+            {
+                jitter[0] = int32_t(x);
+                jitter[1] = int32_t(y);
+                return;
+            }
+        }
+    }
+}
+
+float ConeTraceUpsample::GetUpsampleWeight(float bilinear, float sampleDepth, const float sampleNormal[3], float pixelDepth,
+    const float pixelNormal[3], float depthTolerance, float normalPower)
+{
+    const float depthWeight = Saturate(1.0f - std::abs(sampleDepth - pixelDepth) / (depthTolerance * std::max(pixelDepth, 1.0e-6f)));
+    const float cosine = sampleNormal[0] * pixelNormal[0] + sampleNormal[1] * pixelNormal[1] + sampleNormal[2] * pixelNormal[2];
+    const float normalWeight = std::pow(Saturate(cosine), normalPower);
+    return bilinear * depthWeight * normalWeight;
+}
+
+void ConeTraceUpsample::UpsampleVisibility(const ConeTraceImage& traced, const ConeTraceResolveDesc& desc, const std::vector<float>& depth,
+    const std::vector<float>& normal, std::vector<float>& visibility)
+{
+    visibility.resize(size_t(desc.width) * desc.height);
+    for (uint32_t y = 0; y < desc.height; ++y)
+    {
+        for (uint32_t x = 0; x < desc.width; ++x)
+        {
+            const size_t pixel = size_t(y) * desc.width + x;
+            // Texel t sampled pixel t * scale + jitter, so the pixel lies between the texels around this.
+            const float posX = float(int32_t(x) - desc.jitter[0]) / float(desc.scale);
+            const float posY = float(int32_t(y) - desc.jitter[1]) / float(desc.scale);
+            const int32_t baseX = int32_t(std::floor(posX));
+            const int32_t baseY = int32_t(std::floor(posY));
+            const float fx = posX - float(baseX);
+            const float fy = posY - float(baseY);
+
+            float sum = 0.0f, weightSum = 0.0f;
+            float closest = 1.0e30f, fallback = 1.0f;
+            for (int i = 0; i < 4; ++i)
+            {
+                const int32_t offsetX = i & 1;
+                const int32_t offsetY = i >> 1;
+                const int32_t texelX = std::min(std::max(baseX + offsetX, 0), int32_t(traced.width) - 1);
+                const int32_t texelY = std::min(std::max(baseY + offsetY, 0), int32_t(traced.height) - 1);
+                const size_t t = size_t(texelY) * traced.width + texelX;
+                const float bilinear = (offsetX ? fx : 1.0f - fx) * (offsetY ? fy : 1.0f - fy);
+                const float weight = GetUpsampleWeight(bilinear, traced.depth[t], &traced.normal[t * 3], depth[pixel], &normal[pixel * 3],
+                    desc.depthTolerance, desc.normalPower);
+                sum += weight * traced.visibility[t];
+                weightSum += weight;
+                const float distance = std::abs(traced.depth[t] - depth[pixel]);
+                if (distance < closest)
+                {
+                    closest = distance;
+                    fallback = traced.visibility[t];
+                }
+            }
+            visibility[pixel] = weightSum > kUpsampleMinWeight ? sum / weightSum : fallback;
+        }
+    }
+}
+
+void ConeTraceUpsample::ResolveVisibility(const ConeTraceResolveDesc& desc, const std::vector<float>& current, const std::vector<float>& depth,
+    const std::vector<float>& velocity, const std::vector<float>& prevDepth, const std::vector<float>& history,
+    std::vector<float>& visibility)
+{
+    visibility.resize(size_t(desc.width) * desc.height);
+    for (uint32_t y = 0; y < desc.height; ++y)
+    {
+        for (uint32_t x = 0; x < desc.width; ++x)
+        {
+            const size_t pixel = size_t(y) * desc.width + x;
+            const float prevX = float(x) + 0.5f + velocity[pixel * 3];
+            const float prevY = float(y) + 0.5f + velocity[pixel * 3 + 1];
+            float weight = desc.currentWeight;
+            if (prevX < 0.0f || prevY < 0.0f || prevX >= float(desc.width) || prevY >= float(desc.height))
+                weight = 1.0f;
+            else
+            {
+                const float expectedDepth = depth[pixel] + velocity[pixel * 3 + 2];
+                const float reprojectedDepth = prevDepth[size_t(prevY) * desc.width + size_t(prevX)];
+                if (std::abs(reprojectedDepth - expectedDepth) > desc.depthTolerance * expectedDepth)
+                    weight = 1.0f;
+            }
+            const float previous = SampleBilinear(history, desc.width, desc.height, prevX, prevY);
+            visibility[pixel] = previous + (current[pixel] - previous) * weight;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// The minimum weight of a pixel's taps before it falls back to the tap of the closest depth.  Mirrors
+// UPSAMPLE_MIN_WEIGHT in ConeTracing.hlsli.
+const float kUpsampleMinWeight = 1.0e-4f;
+
+// What the cone trace pass of the VCT sample traced: per texel, in rows, the visibility and the linear depth and
+// normal of the pixel it sampled.  normal holds x, y and z per texel.
+struct ConeTraceImage
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<float> visibility;
+    std::vector<float> depth;
+    std::vector<float> normal;
+};
+
+// The constants of ConeTraceConstants the upsample and the resolve read.
+struct ConeTraceResolveDesc
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t scale;
+    int32_t jitter[2];
+    float depthTolerance;
+    float normalPower;
+    // The weight of this frame against the history; 1 when there is no history.
+    float currentWeight;
+};
+
+// The upsample and temporal resolve of the cone trace pass, step for step as upsampleVisibility in ConeTracing.hlsli
+// and ConeTraceResolveCS do them.  Full resolution inputs are per pixel, in rows.
+namespace ConeTraceUpsample
+{
+    // The pixel of its scale x scale block a traced texel samples on the given frame.  The block is walked in Bayer
+    // order, so consecutive frames sample far apart and scale * scale frames cover the whole block.
+    void GetTraceJitter(uint64_t frame, uint32_t scale, int32_t jitter[2]);
+
+    // The weight of a traced sample in the upsample of a pixel: its bilinear weight, falling off to 0 as its linear
+    // depth strays from the pixel's by depthTolerance relative to the pixel's, and as its normal turns away.
+    float GetUpsampleWeight(float bilinear, float sampleDepth, const float sampleNormal[3], float pixelDepth,
+        const float pixelNormal[3], float depthTolerance, float normalPower);
+
+    // Weighs the four traced texels around each pixel with GetUpsampleWeight; a pixel whose weights sum to less than
+    // kUpsampleMinWeight takes the texel of the closest depth.
+    void UpsampleVisibility(const ConeTraceImage& traced, const ConeTraceResolveDesc& desc, const std::vector<float>& depth,
+        const std::vector<float>& normal, std::vector<float>& visibility);
+
+    // Blends the upsampled visibility into the history, sampled bilinearly where the camera velocity reprojects each
+    // pixel to.  velocity holds the x and y in pixels and the linear depth change per pixel.  History is dropped
+    // off screen and where last frame's linear depth does not match the reprojected one.
+    void ResolveVisibility(const ConeTraceResolveDesc& desc, const std::vector<float>& current, const std::vector<float>& depth,
+        const std::vector<float>& velocity, const std::vector<float>& prevDepth, const std::vector<float>& history,
+        std::vector<float>& visibility);
+}
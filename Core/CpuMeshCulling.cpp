@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "CpuMeshCulling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Row r of a matrix stored column by column.
+    inline void GetRow(const float m[16], int r, float row[4])
+    {
+        for (int c = 0; c < 4; ++c)
+            row[c] = m[c * 4 + r];
+    }
+}
+
+uint32_t CpuMeshCulling::PyramidExtent(uint32_t depthExtent)
+{
+    uint32_t extent = 1;
+    while (extent * 2 <= depthExtent)
+        extent *= 2;
+    return extent;
+}
+
+uint32_t CpuMeshCulling::PyramidMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t mips = 1;
+    for (uint32_t extent = std::max(width, height); extent > 1; extent >>= 1)
+        ++mips;
+    return std::min(mips, kMaxPyramidMips);
+}
+
+void CpuMeshCulling::BuildPyramid(const float* depth, uint32_t depthWidth, uint32_t depthHeight, std::vector<std::vector<float>>& mips)
+{
+    const uint32_t width = PyramidExtent(depthWidth);
+    const uint32_t height = PyramidExtent(depthHeight);
+    const uint32_t mipCount = PyramidMipCount(width, height);
+    mips.assign(mipCount, std::vector<float>());
+
+    mips[0].resize(size_t(width) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint32_t firstY = y * depthHeight / height;
+        const uint32_t lastY = std::min(((y + 1) * depthHeight + height - 1) / height, depthHeight) - 1;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint32_t firstX = x * depthWidth / width;
+            const uint32_t lastX = std::min(((x + 1) * depthWidth + width - 1) / width, depthWidth) - 1;
+            float farthest = 1.0f;
+            for (uint32_t sy = firstY; sy <= lastY; sy++)
+                for (uint32_t sx = firstX; sx <= lastX; sx++)
+                    farthest = std::min(farthest, depth[sy * depthWidth + sx]);
+            mips[0][y * width + x] = farthest;
+        }
+    }
+
+    for (uint32_t mip = 1; mip < mipCount; mip++)
+    {
+        const uint32_t srcWidth = std::max(width >> (mip - 1), 1u);
+        const uint32_t srcHeight = std::max(height >> (mip - 1), 1u);
+        const uint32_t dstWidth = std::max(width >> mip, 1u);
+        const uint32_t dstHeight = std::max(height >> mip, 1u);
+        const std::vector<float>& src = mips[mip - 1];
+        std::vector<float>& dst = mips[mip];
+        dst.resize(size_t(dstWidth) * dstHeight);
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            const uint32_t y0 = std::min(y * 2, srcHeight - 1), y1 = std::min(y * 2 + 1, srcHeight - 1);
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                const uint32_t x0 = std::min(x * 2, srcWidth - 1), x1 = std::min(x * 2 + 1, srcWidth - 1);
+                dst[y * dstWidth + x] = std::min(
+                    std::min(src[y0 * srcWidth + x0], src[y0 * srcWidth + x1]),
+                    std::min(src[y1 * srcWidth + x0], src[y1 * srcWidth + x1]));
+            }
+        }
+    }
+}
+
+bool CpuMeshCulling::IsOccluded(const std::vector<std::vector<float>>& mips, uint32_t width, uint32_t height, const float viewProj[16],
+    const float minBound[3], const float maxBound[3])
+{
+    float minU = 1.0f, minV = 1.0f, maxU = 0.0f, maxV = 0.0f, nearest = 0.0f;
+    for (uint32_t corner = 0; corner < 8; corner++)
+    {
+        const float position[4] = {
+            (corner & 1) ? maxBound[0] : minBound[0],
+            (corner & 2) ? maxBound[1] : minBound[1],
+            (corner & 4) ? maxBound[2] : minBound[2], 1.0f };
+        float clip[4] = {};
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                clip[r] += viewProj[c * 4 + r] * position[c];
+        // A corner behind the eye leaves the screen-space bounds undefined.
+        if (clip[3] <= 1e-5f)
+            return false;
+        const float u = clip[0] / clip[3] * 0.5f + 0.5f;
+        const float v = 0.5f - clip[1] / clip[3] * 0.5f;
+        minU = std::min(minU, u); maxU = std::max(maxU, u);
+        minV = std::min(minV, v); maxV = std::max(maxV, v);
+        nearest = std::max(nearest, clip[2] / clip[3]);
+    }
+    minU = std::min(std::max(minU, 0.0f), 1.0f); maxU = std::min(std::max(maxU, 0.0f), 1.0f);
+    minV = std::min(std::max(minV, 0.0f), 1.0f); maxV = std::min(std::max(maxV, 0.0f), 1.0f);
+
+    const uint32_t mipCount = static_cast<uint32_t>(mips.size());
+    const float extent = std::max((maxU - minU) * width, (maxV - minV) * height);
+    const uint32_t mip = std::min(static_cast<uint32_t>(std::max(std::ceil(std::log2(std::max(extent, 1.0f))), 0.0f)), mipCount - 1);
+    const uint32_t mipWidth = std::max(width >> mip, 1u);
+    const uint32_t mipHeight = std::max(height >> mip, 1u);
+    const uint32_t x0 = std::min(static_cast<uint32_t>(minU * mipWidth), mipWidth - 1);
+    const uint32_t x1 = std::min(static_cast<uint32_t>(maxU * mipWidth), mipWidth - 1);
+    const uint32_t y0 = std::min(static_cast<uint32_t>(minV * mipHeight), mipHeight - 1);
+    const uint32_t y1 = std::min(static_cast<uint32_t>(maxV * mipHeight), mipHeight - 1);
+    const std::vector<float>& level = mips[mip];
+    const float farthest = std::min(
+        std::min(level[y0 * mipWidth + x0], level[y0 * mipWidth + x1]),
+        std::min(level[y1 * mipWidth + x0], level[y1 * mipWidth + x1]));
+
+    return nearest < farthest;
+}
+
+void CpuMeshCulling::ExtractFrustumPlanes(const float viewProj[16], float planes[6][4])
+{
+    // A point is inside when -w <= x,y <= w and 0 <= z <= w.
+    float r0[4], r1[4], r2[4], r3[4];
+    GetRow(viewProj, 0, r0);
+    GetRow(viewProj, 1, r1);
+    GetRow(viewProj, 2, r2);
+    GetRow(viewProj, 3, r3);
+    for (int c = 0; c < 4; ++c)
+    {
+        planes[0][c] = r3[c] + r0[c];
+        planes[1][c] = r3[c] - r0[c];
+        planes[2][c] = r3[c] + r1[c];
+        planes[3][c] = r3[c] - r1[c];
+        planes[4][c] = r2[c];
+        planes[5][c] = r3[c] - r2[c];
+    }
+}
+
+bool CpuMeshCulling::IntersectFrustum(const float planes[6][4], const float minBound[3], const float maxBound[3])
+{
+    for (int i = 0; i < 6; i++)
+    {
+        const float* p = planes[i];
+        const float x = p[0] > 0.0f ? maxBound[0] : minBound[0];
+        const float y = p[1] > 0.0f ? maxBound[1] : minBound[1];
+        const float z = p[2] > 0.0f ? maxBound[2] : minBound[2];
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// The mesh culling of IndirectMeshBatch and the Hi-Z pyramid of HiZBuffer on the CPU, step for step as
+// MeshCullingCS, MeshOcclusionCullingCS, HiZInitCS and HiZDownsampleCS do them.  Matrices are column by column, as
+// Math::Matrix4 stores them, and transform column vectors.  IndirectMeshBatch and HiZBuffer take their frustum planes
+// and pyramid sizes from it.
+namespace CpuMeshCulling
+{
+    // Levels of the pyramid past the top are kept to the 12 mip UAVs of a ColorBuffer, enough for a 2048 pyramid.
+    const uint32_t kMaxPyramidMips = 12;
+
+    // The power of two at or below the depth buffer's extent, the size of the pyramid's top level.
+    uint32_t PyramidExtent(uint32_t depthExtent);
+
+    uint32_t PyramidMipCount(uint32_t width, uint32_t height);
+
+    // Reduces a reversed-Z depth buffer to the pyramid: a texel of the top level keeps the farthest (smallest) depth
+    // of every pixel it touches, and every level the farthest of the 2x2 texels below.
+    void BuildPyramid(const float* depth, uint32_t depthWidth, uint32_t depthHeight, std::vector<std::vector<float>>& mips);
+
+    // Whether the nearest depth of the box lies behind the farthest depth of the pyramid texels it covers, on the
+    // level where it covers at most 2x2.  Boxes with a corner behind the eye are never occluded.
+    bool IsOccluded(const std::vector<std::vector<float>>& mips, uint32_t width, uint32_t height, const float viewProj[16],
+        const float minBound[3], const float maxBound[3]);
+
+    // Left, right, bottom, top, near and far, as (a, b, c, d) with a point inside when a * x + b * y + c * z + d >= 0.
+    void ExtractFrustumPlanes(const float viewProj[16], float planes[6][4]);
+
+    // False when the box is wholly outside one of the planes.
+    bool IntersectFrustum(const float planes[6][4], const float minBound[3], const float maxBound[3]);
+}
@@ -0,0 +1,368 @@
+#include "pch.h"
+#include "CpuVoxelizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <emmintrin.h>
+#include <limits>
+#include <thread>
+
+namespace
+{
+    // Triangles a thread takes at a time.
+    const uint32_t kTriangleBatch = 256;
+
+    // The 13 axes of the separating axis test: the box's three, the triangle's normal, and the nine cross products
+    // of a triangle edge with a box axis.
+    const int kAxisCount = 13;
+
+    // The box of center c and half size h is not separated along axis a when lo <= dot(a, c) <= hi, with lo and hi the
+    // triangle's projection widened by the box's radius h * (|a.x| + |a.y| + |a.z|).  Only c varies from voxel to
+    // voxel, so the triangle's side of every test is worked out once.
+    struct TriangleAxes
+    {
+        float axis[3][kAxisCount];
+        float lo[kAxisCount];
+        float hi[kAxisCount];
+    };
+
+    inline float Dot(const float a[3], const float b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    inline void Cross(const float a[3], const float b[3], float out[3])
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    void BuildAxes(const float* const v[3], const float normal[3], float halfSize, TriangleAxes& axes)
+    {
+        float edges[3][3];
+        for (int i = 0; i < 3; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                edges[i][c] = v[(i + 1) % 3][c] - v[i][c];
+        }
+
+        float axisList[kAxisCount][3] = {};
+        for (int i = 0; i < 3; i++)
+            axisList[i][i] = 1.0f;
+        for (int c = 0; c < 3; c++)
+            axisList[3][c] = normal[c];
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+                Cross(edges[i], axisList[j], axisList[4 + i * 3 + j]);
+        }
+
+        for (int a = 0; a < kAxisCount; a++)
+        {
+            const float p0 = Dot(axisList[a], v[0]);
+            const float p1 = Dot(axisList[a], v[1]);
+            const float p2 = Dot(axisList[a], v[2]);
+            const float radius = halfSize * (std::fabs(axisList[a][0]) + std::fabs(axisList[a][1]) + std::fabs(axisList[a][2]));
+            axes.lo[a] = std::min(p0, std::min(p1, p2)) - radius;
+            axes.hi[a] = std::max(p0, std::max(p1, p2)) + radius;
+            for (int c = 0; c < 3; c++)
+                axes.axis[c][a] = axisList[a][c];
+        }
+    }
+
+    // The set bits of four voxels along axis k whose centers lie at centerK, with the other two coordinates' share
+    // of every axis' dot product already summed in base.
+    inline int TestRow(const TriangleAxes& axes, const float base[kAxisCount], int k, __m128 centerK)
+    {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int a = 0; a < kAxisCount; a++)
+        {
+            const __m128 projection = _mm_add_ps(_mm_set1_ps(base[a]), _mm_mul_ps(_mm_set1_ps(axes.axis[k][a]), centerK));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(projection, _mm_set1_ps(axes.lo[a])));
+            inside = _mm_and_ps(inside, _mm_cmple_ps(projection, _mm_set1_ps(axes.hi[a])));
+        }
+        return _mm_movemask_ps(inside);
+    }
+
+    // Sets voxels of a brick set, remembering the last brick since neighbouring voxels mostly share one.
+    class BrickWriter
+    {
+    public:
+        explicit BrickWriter(VoxelBrickSet& bricks) : m_bricks(bricks) {}
+
+        void Set(const int32_t voxel[3])
+        {
+            const int32_t bx = GetVoxelBrick(voxel[0]);
+            const int32_t by = GetVoxelBrick(voxel[1]);
+            const int32_t bz = GetVoxelBrick(voxel[2]);
+            if (m_brick == nullptr || m_brick->x != bx || m_brick->y != by || m_brick->z != bz)
+            {
+                const uint64_t key = PackVoxelBrick(bx, by, bz);
+                auto found = m_bricks.find(key);
+                if (found == m_bricks.end())
+                {
+                    VoxelCacheBrick brick = {};
+                    brick.x = bx;
+                    brick.y = by;
+                    brick.z = bz;
+                    found = m_bricks.emplace(key, brick).first;
+                }
+                m_brick = &found->second;
+            }
+            const uint32_t bit = GetVoxelBrickBit(voxel[0] - bx * kVoxelBrickSize, voxel[1] - by * kVoxelBrickSize, voxel[2] - bz * kVoxelBrickSize);
+            m_brick->bits[bit / 32] |= 1u << (bit % 32);
+        }
+
+    private:
+        VoxelBrickSet& m_bricks;
+        VoxelCacheBrick* m_brick = nullptr;
+    };
+
+    void VoxelizeTriangle(const float* const v[3], float voxelSize, bool simd, BrickWriter& writer)
+    {
+        float edge0[3], edge1[3], normal[3];
+        for (int c = 0; c < 3; c++)
+        {
+            edge0[c] = v[1][c] - v[0][c];
+            edge1[c] = v[2][c] - v[0][c];
+        }
+        Cross(edge0, edge1, normal);
+
+        // Voxels whose closed box touches the triangle's bounds; a bound on a voxel border takes the voxel below too.
+        int32_t minVoxel[3], maxVoxel[3];
+        for (int c = 0; c < 3; c++)
+        {
+            const float lo = std::min(v[0][c], std::min(v[1][c], v[2][c]));
+            const float hi = std::max(v[0][c], std::max(v[1][c], v[2][c]));
+            minVoxel[c] = int32_t(std::ceil(lo / voxelSize)) - 1;
+            maxVoxel[c] = int32_t(std::floor(hi / voxelSize));
+        }
+
+        // Columns run along the axis the triangle faces most, where the plane leaves only a few voxels to test.
+        int k = 0;
+        for (int c = 1; c < 3; c++)
+        {
+            if (std::fabs(normal[c]) > std::fabs(normal[k]))
+                k = c;
+        }
+        const int u = (k + 1) % 3;
+        const int w = (k + 2) % 3;
+        const float planeD = Dot(normal, v[0]);
+
+        const float halfSize = voxelSize * 0.5f;
+        TriangleAxes axes;
+        BuildAxes(v, normal, halfSize, axes);
+
+        int32_t voxel[3];
+        for (voxel[w] = minVoxel[w]; voxel[w] <= maxVoxel[w]; voxel[w]++)
+        {
+            for (voxel[u] = minVoxel[u]; voxel[u] <= maxVoxel[u]; voxel[u]++)
+            {
+                int32_t first = minVoxel[k];
+                int32_t last = maxVoxel[k];
+                if (normal[k] != 0.0f)
+                {
+                    // The plane's height along k over the column's corners.
+                    float lo = std::numeric_limits<float>::max();
+                    float hi = -std::numeric_limits<float>::max();
+                    for (int corner = 0; corner < 4; corner++)
+                    {
+                        const float cu = (voxel[u] + (corner & 1)) * voxelSize;
+                        const float cw = (voxel[w] + (corner >> 1)) * voxelSize;
+                        const float height = (planeD - normal[u] * cu - normal[w] * cw) / normal[k];
+                        lo = std::min(lo, height);
+                        hi = std::max(hi, height);
+                    }
+                    first = std::max(first, int32_t(std::ceil(lo / voxelSize)) - 1);
+                    last = std::min(last, int32_t(std::floor(hi / voxelSize)));
+                }
+
+                if (!simd)
+                {
+                    for (voxel[k] = first; voxel[k] <= last; voxel[k]++)
+                    {
+                        float center[3];
+                        for (int c = 0; c < 3; c++)
+                            center[c] = (voxel[c] + 0.5f) * voxelSize;
+                        if (CpuVoxelizer::TriangleOverlapsBox(v[0], v[1], v[2], center, halfSize))
+                            writer.Set(voxel);
+                    }
+                    continue;
+                }
+
+                float base[kAxisCount];
+                const float centerU = (voxel[u] + 0.5f) * voxelSize;
+                const float centerW = (voxel[w] + 0.5f) * voxelSize;
+                for (int a = 0; a < kAxisCount; a++)
+                    base[a] = axes.axis[u][a] * centerU + axes.axis[w][a] * centerW;
+                for (int32_t row = first; row <= last; row += 4)
+                {
+                    const __m128 index = _mm_add_ps(_mm_set1_ps(float(row)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+                    int mask = TestRow(axes, base, k, _mm_mul_ps(index, _mm_set1_ps(voxelSize)));
+                    for (int lane = 0; mask != 0; lane++, mask >>= 1)
+                    {
+                        voxel[k] = row + lane;
+                        if ((mask & 1) != 0 && voxel[k] <= last)
+                            writer.Set(voxel);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t CountBits(uint32_t word)
+    {
+        word = word - ((word >> 1) & 0x55555555);
+        word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+        return (((word + (word >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+    }
+}
+
+bool CpuVoxelizer::TriangleOverlapsBox(const float v0[3], const float v1[3], const float v2[3], const float center[3], float halfSize)
+{
+    // The triangle moved so the box is centered on the origin.
+    float v[3][3];
+    for (int c = 0; c < 3; c++)
+    {
+        v[0][c] = v0[c] - center[c];
+        v[1][c] = v1[c] - center[c];
+        v[2][c] = v2[c] - center[c];
+    }
+
+    // The box's axes: the triangle's bounds against the box.
+    for (int c = 0; c < 3; c++)
+    {
+        if (std::min(v[0][c], std::min(v[1][c], v[2][c])) > halfSize || std::max(v[0][c], std::max(v[1][c], v[2][c])) < -halfSize)
+            return false;
+    }
+
+    float edges[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            edges[i][c] = v[(i + 1) % 3][c] - v[i][c];
+    }
+
+    // The triangle's plane against the box's nearest and farthest corners.
+    float normal[3];
+    Cross(edges[0], edges[1], normal);
+    const float radius = halfSize * (std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]));
+    if (std::fabs(Dot(normal, v[0])) > radius)
+        return false;
+
+    // The edges crossed with the box's axes.
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            float boxAxis[3] = {};
+            boxAxis[j] = 1.0f;
+            float axis[3];
+            Cross(edges[i], boxAxis, axis);
+            const float p0 = Dot(axis, v[0]);
+            const float p1 = Dot(axis, v[1]);
+            const float p2 = Dot(axis, v[2]);
+            const float r = halfSize * (std::fabs(axis[0]) + std::fabs(axis[1]) + std::fabs(axis[2]));
+            if (std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r)
+                return false;
+        }
+    }
+    return true;
+}
+
+void CpuVoxelizer::Voxelize(const std::vector<float>& positions, const std::vector<uint32_t>& indices, float voxelSize,
+    uint32_t threadCount, bool simd, VoxelBrickSet& bricks)
+{
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    threadCount = std::max(1u, std::min(threadCount, (triangleCount + kTriangleBatch - 1) / kTriangleBatch));
+
+    std::atomic<uint32_t> nextTriangle(0);
+    std::vector<VoxelBrickSet> threadBricks(threadCount);
+    auto worker = [&](uint32_t thread)
+    {
+        BrickWriter writer(threadBricks[thread]);
+        for (;;)
+        {
+            const uint32_t first = nextTriangle.fetch_add(kTriangleBatch);
+            if (first >= triangleCount)
+                break;
+            const uint32_t last = std::min(first + kTriangleBatch, triangleCount);
+            for (uint32_t triangle = first; triangle < last; triangle++)
+            {
+                const float* v[3];
+                for (int i = 0; i < 3; i++)
+                    v[i] = &positions[size_t(indices[triangle * 3 + i]) * 3];
+                VoxelizeTriangle(v, voxelSize, simd, writer);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 1; thread < threadCount; thread++)
+        threads.emplace_back(worker, thread);
+    worker(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (const VoxelBrickSet& set : threadBricks)
+    {
+        for (const auto& entry : set)
+        {
+            auto found = bricks.find(entry.first);
+            if (found == bricks.end())
+            {
+                bricks.emplace(entry.first, entry.second);
+                continue;
+            }
+            for (uint32_t i = 0; i < kVoxelBrickWords; i++)
+                found->second.bits[i] |= entry.second.bits[i];
+        }
+    }
+}
+
+void CpuVoxelizer::Downsample(const VoxelBrickSet& fine, VoxelBrickSet& coarse)
+{
+    BrickWriter writer(coarse);
+    for (const auto& entry : fine)
+    {
+        const VoxelCacheBrick& brick = entry.second;
+        for (uint32_t bit = 0; bit < kVoxelBrickWords * 32; bit++)
+        {
+            if ((brick.bits[bit / 32] & (1u << (bit % 32))) == 0)
+                continue;
+            // Voxel coordinates halve rounding towards negative infinity, as brick ones do.
+            const int32_t voxel[3] = {
+                (brick.x * kVoxelBrickSize + int32_t(bit % kVoxelBrickSize)) >> 1,
+                (brick.y * kVoxelBrickSize + int32_t(bit / kVoxelBrickSize % kVoxelBrickSize)) >> 1,
+                (brick.z * kVoxelBrickSize + int32_t(bit / (kVoxelBrickSize * kVoxelBrickSize))) >> 1 };
+            writer.Set(voxel);
+        }
+    }
+}
+
+void CpuVoxelizer::AppendSorted(const VoxelBrickSet& bricks, std::vector<VoxelCacheBrick>& sorted)
+{
+    const size_t first = sorted.size();
+    for (const auto& entry : bricks)
+        sorted.push_back(entry.second);
+    std::sort(sorted.begin() + first, sorted.end(), [](const VoxelCacheBrick& a, const VoxelCacheBrick& b)
+    {
+        if (a.z != b.z)
+            return a.z < b.z;
+        if (a.y != b.y)
+            return a.y < b.y;
+        return a.x < b.x;
+    });
+}
+
+uint64_t CpuVoxelizer::CountVoxels(const VoxelBrickSet& bricks)
+{
+    uint64_t count = 0;
+    for (const auto& entry : bricks)
+    {
+        for (uint32_t i = 0; i < kVoxelBrickWords; i++)
+            count += CountBits(entry.second.bits[i]);
+    }
+    return count;
+}
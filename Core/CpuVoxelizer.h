@@ -0,0 +1,36 @@
+#pragma once
+
+#pragma  region HEADER
+#include "VoxelCache.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#pragma region
+
+// The occupied bricks of a level, keyed by PackVoxelBrick.
+typedef std::unordered_map<uint64_t, VoxelCacheBrick> VoxelBrickSet;
+
+// Conservative voxelization on the CPU: a voxel is set when its closed box overlaps a triangle, which is what the
+// GPU's conservative rasterization covers, give or take the rounding at voxel borders.  Voxels are laid out as in
+// VoxelCache.h.
+namespace CpuVoxelizer
+{
+    // The separating axis test of a triangle against the box of the given center and half size (Akenine-Moller).
+    // The scalar reference the SIMD path is checked against.
+    bool TriangleOverlapsBox(const float v0[3], const float v1[3], const float v2[3], const float center[3], float halfSize);
+
+    // Sets the voxels of the given size the indexed triangles overlap.  positions holds x, y and z per vertex.
+    // Triangles are shared among threadCount threads, each testing a row of four voxels at a time with SSE unless
+    // simd is false, in which case every voxel goes through TriangleOverlapsBox.
+    void Voxelize(const std::vector<float>& positions, const std::vector<uint32_t>& indices, float voxelSize,
+        uint32_t threadCount, bool simd, VoxelBrickSet& bricks);
+
+    // Builds the level of twice the voxel size: a voxel is set when one of the eight it covers is.  A box overlaps
+    // a triangle when one of its octants does, so this matches voxelizing at the coarser size.
+    void Downsample(const VoxelBrickSet& fine, VoxelBrickSet& coarse);
+
+    // Appends the bricks sorted by z, y and x, the order VoxelCache::Save expects within a level.
+    void AppendSorted(const VoxelBrickSet& bricks, std::vector<VoxelCacheBrick>& sorted);
+
+    uint64_t CountVoxels(const VoxelBrickSet& bricks);
+}
@@ -34,6 +34,8 @@ public:
         return m_GpuVirtualAddress + Offset;
     }
 
+    ID3D12Resource* GetResource(void) const { return m_pResource.Get(); }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> m_pResource;
     D3D12_GPU_VIRTUAL_ADDRESS m_GpuVirtualAddress;
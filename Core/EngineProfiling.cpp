@@ -325,6 +325,25 @@ public:
         m_EndTick = 0;
     }
 
+    NestedTimingTree* FindScope( const wstring& name )
+    {
+        for (auto node : m_Children)
+        {
+            if (node->m_Name == name)
+                return node;
+            NestedTimingTree* found = node->FindScope(name);
+            if (found != nullptr)
+                return found;
+        }
+        return nullptr;
+    }
+
+    static float GetGpuTime( const wstring& name )
+    {
+        NestedTimingTree* scope = sm_RootScope.FindScope(name);
+        return scope == nullptr ? 0.0f : scope->m_GpuTime.GetLast();
+    }
+
     void SumInclusiveTimes(float& cpuTime, float& gpuTime)
     {
         cpuTime = 0.0f;
@@ -453,6 +472,11 @@ namespace EngineProfiling
         return Paused;
     }
 
+    float GetGpuTime(const wstring& name)
+    {
+        return NestedTimingTree::GetGpuTime(name);
+    }
+
     void SetCameraPosition(float x, float y, float z)
     {
         camera_x = x;
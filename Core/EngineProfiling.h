@@ -30,6 +30,10 @@ namespace EngineProfiling
     void DisplayPerfGraph(GraphicsContext& Text);
     void Display(TextContext& Text, float x, float y, float w, float h);
     bool IsPaused();
+
+    // The GPU milliseconds of the last frame read back for the first timer block of that name, searched depth first.
+    // 0 until the block has run, and always in Release, where ScopedTimer does nothing.
+    float GetGpuTime(const std::wstring& name);
 }
 
 #ifdef RELEASE
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "FrameConstantRing.h"
+#include "GraphicsCore.h"
+
+void FrameConstantRing::Create(const std::wstring& name, U32 capacityBytes)
+{
+    m_buffer.Create(name, capacityBytes, 1);
+    m_cpuAddress = static_cast<uint8_t*>(m_buffer.Map());
+    m_capacity = capacityBytes;
+    m_allocated = 0;
+    m_blocks.clear();
+    m_blockIndices.clear();
+}
+
+void FrameConstantRing::Destroy()
+{
+    m_buffer.Destroy();
+    m_cpuAddress = nullptr;
+    m_capacity = m_allocated = 0;
+    m_blocks.clear();
+    m_blockIndices.clear();
+}
+
+FrameConstantRing::BlockHandle FrameConstantRing::RegisterBlock(const std::string& name, U32 size)
+{
+    ASSERT(m_blockIndices.find(name) == m_blockIndices.end(), "Constant block registered twice: %s", name.c_str());
+
+    Block block = {};
+    block.name = name;
+    block.size = size;
+    block.stride = static_cast<U32>(Math::AlignUp(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+    block.offset = m_allocated;
+    block.contents.resize(size);
+    m_allocated += block.stride * kCopyCount;
+    ASSERT(m_allocated <= m_capacity, "Frame constant ring is full");
+
+    const BlockHandle handle = static_cast<BlockHandle>(m_blocks.size());
+    m_blocks.push_back(std::move(block));
+    m_blockIndices.emplace(name, handle);
+    return handle;
+}
+
+FrameConstantRing::BlockHandle FrameConstantRing::FindBlock(const std::string& name) const
+{
+    const auto found = m_blockIndices.find(name);
+    ASSERT(found != m_blockIndices.end(), "Constant block not registered: %s", name.c_str());
+    return found->second;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS FrameConstantRing::Write(BlockHandle handle, const void* data)
+{
+    Block& block = m_blocks[handle];
+    if (!block.written || std::memcmp(block.contents.data(), data, block.size) != 0)
+    {
+        const U32 next = block.written ? (block.copy + 1) % kCopyCount : 0;
+        ASSERT((block.pendingCopies & (1u << next)) == 0, "Constant block %s rewritten too often in one frame", block.name.c_str());
+
+        // Only stalls when the GPU is more than kCopyCount writes behind.
+        Graphics::g_CommandManager.WaitForFence(block.fences[next]);
+        std::memcpy(m_cpuAddress + CopyOffset(block, next), data, block.size);
+        std::memcpy(block.contents.data(), data, block.size);
+        block.copy = next;
+        block.written = true;
+        m_frameBytes += block.size;
+        m_frameWrites++;
+    }
+    return GetGpuAddress(handle);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS FrameConstantRing::GetGpuAddress(BlockHandle handle)
+{
+    Block& block = m_blocks[handle];
+    ASSERT(block.written, "Constant block %s read before it was written", block.name.c_str());
+    block.pendingCopies |= 1u << block.copy;
+    return m_buffer.GetGpuPointer(CopyOffset(block, block.copy));
+}
+
+void FrameConstantRing::EndFrame(uint64_t fenceValue)
+{
+    for (Block& block : m_blocks)
+    {
+        for (U32 copy = 0; copy < kCopyCount; copy++)
+        {
+            if (block.pendingCopies & (1u << copy))
+                block.fences[copy] = fenceValue;
+        }
+        block.pendingCopies = 0;
+    }
+
+    m_lastFrameBytes = m_frameBytes;
+    m_lastFrameWrites = m_frameWrites;
+    m_frameBytes = 0;
+    m_frameWrites = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include "DynamicUploadBuffer.h"
+#include <unordered_map>
+#pragma region
+
+// Named constant blocks in a persistently mapped upload buffer.  Each block is written at most once per frame
+// and its GPU address is handed to every pass that needs it, instead of re-uploading the same struct through
+// the linear allocator per pass.  A block whose contents did not change keeps its previous copy, so static
+// constants cost no upload at all.
+class FrameConstantRing
+{
+public:
+    typedef U32 BlockHandle;
+
+    void Create(const std::wstring& name, U32 capacityBytes);
+
+    void Destroy();
+
+    // Reserves room for a block of up to size bytes.  Names must be unique.
+    BlockHandle RegisterBlock(const std::string& name, U32 size);
+
+    BlockHandle FindBlock(const std::string& name) const;
+
+    // Copies the data into the block unless it equals the last contents written, and returns their GPU address.
+    // A block can be rewritten a few times per frame, but passes that need distinct values should use separate blocks.
+    D3D12_GPU_VIRTUAL_ADDRESS Write(BlockHandle block, const void* data);
+
+    template <typename T>
+    D3D12_GPU_VIRTUAL_ADDRESS Write(BlockHandle block, const T& data)
+    {
+        ASSERT(sizeof(T) <= m_blocks[block].size);
+        return Write(block, static_cast<const void*>(&data));
+    }
+
+    // GPU address of the block's latest contents.
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(BlockHandle block);
+
+    // Tags every copy referenced this frame with the fence returned by Finish and resets the frame counters.
+    void EndFrame(uint64_t fenceValue);
+
+    // Counters of the last finished frame.
+    inline U32 GetBytesUploaded() const { return m_lastFrameBytes; }
+    inline U32 GetBlocksWritten() const { return m_lastFrameWrites; }
+    inline U32 GetBlockCount() const { return static_cast<U32>(m_blocks.size()); }
+
+private:
+    // Enough copies that a block rewritten every frame does not wait on the GPU.
+    static const U32 kCopyCount = 3;
+
+    struct Block
+    {
+        std::string name;
+        U32 size;
+        U32 stride;
+        U32 offset;
+        U32 copy;
+        U32 pendingCopies;
+        bool written;
+        uint64_t fences[kCopyCount];
+        std::vector<uint8_t> contents;
+    };
+
+    inline U32 CopyOffset(const Block& block, U32 copy) const { return block.offset + copy * block.stride; }
+
+    DynamicUploadBuffer m_buffer;
+    uint8_t* m_cpuAddress = nullptr;
+    U32 m_capacity = 0;
+    U32 m_allocated = 0;
+    std::vector<Block> m_blocks;
+    std::unordered_map<std::string, BlockHandle> m_blockIndices;
+    U32 m_frameBytes = 0;
+    U32 m_frameWrites = 0;
+    U32 m_lastFrameBytes = 0;
+    U32 m_lastFrameWrites = 0;
+};
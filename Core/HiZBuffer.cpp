@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "HiZBuffer.h"
+#include "CpuMeshCulling.h"
+#include "CommandContext.h"
+#include "DepthBuffer.h"
+#include "CompiledShaders/HiZInitCS.h"
+#include "CompiledShaders/HiZDownsampleCS.h"
+
+using namespace Math;
+
+namespace
+{
+    enum HiZParams :unsigned char
+    {
+        HiZConstants,
+        HiZSRVs,
+        HiZUAVs,
+        NumHiZParams,
+    };
+}
+
+void HiZBuffer::Create(U32 depthWidth, U32 depthHeight)
+{
+    if (!m_initialized)
+    {
+        m_rootSig.Reset(HiZParams::NumHiZParams, 0);
+        m_rootSig[HiZParams::HiZConstants].InitAsConstants(0, 4);
+        m_rootSig[HiZParams::HiZSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+        m_rootSig[HiZParams::HiZUAVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+        m_rootSig.Finalize(L"HiZ");
+        m_initPSO.SetRootSignature(m_rootSig);
+        m_initPSO.SetComputeShader(SHADER_ARGS(g_pHiZInitCS));
+        m_initPSO.Finalize();
+        m_downsamplePSO.SetRootSignature(m_rootSig);
+        m_downsamplePSO.SetComputeShader(SHADER_ARGS(g_pHiZDownsampleCS));
+        m_downsamplePSO.Finalize();
+        m_initialized = true;
+    }
+    if (m_mipCount != 0)
+        m_pyramid.Destroy();
+
+    m_depthWidth = depthWidth;
+    m_depthHeight = depthHeight;
+    m_width = CpuMeshCulling::PyramidExtent(depthWidth);
+    m_height = CpuMeshCulling::PyramidExtent(depthHeight);
+    m_mipCount = CpuMeshCulling::PyramidMipCount(m_width, m_height);
+    m_pyramid.Create(L"HiZ Pyramid", m_width, m_height, m_mipCount, DXGI_FORMAT_R32_FLOAT);
+    m_valid = false;
+}
+
+void HiZBuffer::Build(ComputeContext& context, DepthBuffer& depthBuffer, const Matrix4& viewProjMat)
+{
+    if (depthBuffer.GetWidth() != m_depthWidth || depthBuffer.GetHeight() != m_depthHeight)
+        Create(depthBuffer.GetWidth(), depthBuffer.GetHeight());
+
+    context.SetRootSignature(m_rootSig);
+    context.TransitionResource(depthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(m_pyramid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    context.SetDynamicDescriptor(HiZParams::HiZSRVs, 0, depthBuffer.GetDepthSRV());
+
+    // u0 is only read by the downsample pass; the top level is bound there too so the table stays fully populated.
+    U32 srcWidth = m_depthWidth, srcHeight = m_depthHeight;
+    for (U32 mip = 0; mip < m_mipCount; mip++)
+    {
+        const U32 dstWidth = std::max(m_width >> mip, 1u);
+        const U32 dstHeight = std::max(m_height >> mip, 1u);
+        D3D12_CPU_DESCRIPTOR_HANDLE uavs[2] = { m_pyramid.GetUAV(mip == 0 ? 0 : mip - 1), m_pyramid.GetUAV(mip) };
+
+        context.SetPipelineState(mip == 0 ? m_initPSO : m_downsamplePSO);
+        context.SetConstants(HiZParams::HiZConstants, srcWidth, srcHeight, dstWidth, dstHeight);
+        context.SetDynamicDescriptors(HiZParams::HiZUAVs, 0, 2, uavs);
+        context.Dispatch2D(dstWidth, dstHeight, 8, 8);
+        context.InsertUAVBarrier(m_pyramid);
+
+        srcWidth = dstWidth;
+        srcHeight = dstHeight;
+    }
+
+    context.TransitionResource(m_pyramid, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_viewProjMat = viewProjMat;
+    m_valid = true;
+}
+
+void HiZBuffer::Destroy()
+{
+    m_pyramid.Destroy();
+    m_depthWidth = m_depthHeight = 0;
+    m_width = m_height = 0;
+    m_mipCount = 0;
+    m_valid = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include "ColorBuffer.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#pragma region
+
+class ComputeContext;
+class DepthBuffer;
+
+// Hierarchical-Z pyramid of a reversed-Z depth buffer.  Every texel keeps the farthest (smallest) depth
+// of its footprint, so a box whose nearest depth lies behind it is guaranteed to be hidden.  CpuMeshCulling builds
+// the same pyramid on the CPU.
+class HiZBuffer
+{
+public:
+    // Downsamples the depth buffer into the pyramid.  viewProjMat is the transform the depth was rendered with,
+    // kept so the next frame can test against this pyramid.  The pyramid is left readable by compute shaders.
+    void Build(ComputeContext& context, DepthBuffer& depthBuffer, const Math::Matrix4& viewProjMat);
+
+    void Destroy();
+
+    // False until the first build and after a resize, when the pyramid holds no usable history.
+    inline bool IsValid() const { return m_valid; }
+    inline ColorBuffer& GetPyramid() { return m_pyramid; }
+    inline U32 GetWidth() const { return m_width; }
+    inline U32 GetHeight() const { return m_height; }
+    inline U32 GetMipCount() const { return m_mipCount; }
+    inline const Math::Matrix4& GetViewProjMatrix() const { return m_viewProjMat; }
+
+private:
+    void Create(U32 depthWidth, U32 depthHeight);
+
+    ColorBuffer m_pyramid;
+    RootSignature m_rootSig;
+    ComputePSO m_initPSO;
+    ComputePSO m_downsamplePSO;
+    Math::Matrix4 m_viewProjMat;
+    U32 m_depthWidth = 0;
+    U32 m_depthHeight = 0;
+    U32 m_width = 0;
+    U32 m_height = 0;
+    // 0 while there is no pyramid.
+    U32 m_mipCount = 0;
+    bool m_initialized = false;
+    bool m_valid = false;
+};
@@ -0,0 +1,267 @@
+#include "pch.h"
+#include "IndirectMeshBatch.h"
+#include "CommandContext.h"
+#include "GraphicsCore.h"
+#include "HiZBuffer.h"
+#include "CpuMeshCulling.h"
+#include "CompiledShaders/MeshCullingCS.h"
+#include "CompiledShaders/MeshOcclusionCullingCS.h"
+
+using namespace Math;
+
+namespace
+{
+    __declspec(align(16)) struct CullConstantBuffer
+    {
+        F32x4 frustumPlanes[6];
+        U32 meshCount;
+    };
+
+    __declspec(align(16)) struct OcclusionCullConstantBuffer
+    {
+        F32x4 frustumPlanes[6];
+        Matrix4 occlusionViewProj;
+        F32x2 pyramidSize;
+        U32 pyramidMipCount;
+        U32 meshCount;
+        U32 cullPhase;
+        U32 useOcclusion;
+    };
+
+    // Counter slots of one view in the statistics readback ring.
+    enum StatisticsCounter : unsigned char
+    {
+        FirstPhaseVisible,
+        OcclusionCandidates,
+        SecondPhaseVisible,
+        NumStatisticsCounters,
+    };
+}
+
+void IndirectMeshBatch::AddMesh(const BoundingBox& bbox, const IndirectMeshCommand& command)
+{
+    IndirectMeshBounds bounds{};
+    bounds.minBound = { bbox.min.GetX(), bbox.min.GetY(), bbox.min.GetZ() };
+    bounds.maxBound = { bbox.max.GetX(), bbox.max.GetY(), bbox.max.GetZ() };
+    m_bounds.push_back(bounds);
+    m_commands.push_back(command);
+}
+
+void IndirectMeshBatch::Finalize(const std::wstring& name, const RootSignature& drawRootSig, UINT perDrawConstantParam, U32 viewCount)
+{
+    ASSERT(m_commands.size() > 0 && viewCount > 0);
+    const U32 meshCount = GetMeshCount();
+    m_boundsBuffer.Create(name + L" bounds", meshCount, sizeof(IndirectMeshBounds), m_bounds.data());
+    m_commandBuffer.Create(name + L" commands", meshCount, sizeof(IndirectMeshCommand), m_commands.data());
+    m_viewCount = viewCount;
+    m_culledCommandBuffers.reset(new StructuredBuffer[viewCount]);
+    m_occlusionCandidateBuffers.reset(new StructuredBuffer[viewCount]);
+    m_disoccludedCommandBuffers.reset(new StructuredBuffer[viewCount]);
+    for (U32 i = 0; i < viewCount; i++)
+    {
+        m_culledCommandBuffers[i].Create(name + L" culled commands " + std::to_wstring(i), meshCount, sizeof(IndirectMeshCommand), nullptr);
+        m_occlusionCandidateBuffers[i].Create(name + L" occlusion candidates " + std::to_wstring(i), meshCount, sizeof(U32), nullptr);
+        m_disoccludedCommandBuffers[i].Create(name + L" disoccluded commands " + std::to_wstring(i), meshCount, sizeof(IndirectMeshCommand), nullptr);
+    }
+    m_statisticsReadback.Create(name + L" culling statistics", kStatisticsLatency * NumStatisticsCounters, sizeof(U32));
+
+    m_drawSignature[0].Constant(perDrawConstantParam, 0, 2);
+    m_drawSignature[1].VertexBufferView(0);
+    m_drawSignature[2].IndexBufferView();
+    m_drawSignature[3].DrawIndexed();
+    m_drawSignature.Finalize(&drawRootSig);
+
+    m_cullRootSig.Reset(MeshCullingParams::NumMeshCullingParams, 0);
+    m_cullRootSig[MeshCullingParams::CullConstants].InitAsConstantBuffer(0);
+    m_cullRootSig[MeshCullingParams::CullSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_cullRootSig[MeshCullingParams::CullUAVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_cullRootSig.Finalize(L"Mesh Culling");
+    m_cullPSO.SetRootSignature(m_cullRootSig);
+    m_cullPSO.SetComputeShader(SHADER_ARGS(g_pMeshCullingCS));
+    m_cullPSO.Finalize();
+
+    m_occlusionCullRootSig.Reset(MeshCullingParams::NumMeshCullingParams, 0);
+    m_occlusionCullRootSig[MeshCullingParams::CullConstants].InitAsConstantBuffer(0);
+    m_occlusionCullRootSig[MeshCullingParams::CullSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 3);
+    m_occlusionCullRootSig[MeshCullingParams::CullUAVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+    m_occlusionCullRootSig.Finalize(L"Mesh Occlusion Culling");
+    m_occlusionCullPSO.SetRootSignature(m_occlusionCullRootSig);
+    m_occlusionCullPSO.SetComputeShader(SHADER_ARGS(g_pMeshOcclusionCullingCS));
+    m_occlusionCullPSO.Finalize();
+}
+
+void IndirectMeshBatch::Cull(ComputeContext& context, U32 viewIndex, const Matrix4& viewProjMat)
+{
+    ASSERT(viewIndex < m_viewCount);
+    StructuredBuffer& culledCommands = m_culledCommandBuffers[viewIndex];
+    CullConstantBuffer cbv;
+    ExtractFrustumPlanes(viewProjMat, cbv.frustumPlanes);
+    cbv.meshCount = GetMeshCount();
+
+    context.SetRootSignature(m_cullRootSig);
+    context.SetPipelineState(m_cullPSO);
+    context.ResetCounter(culledCommands);
+    // Keeps the statistics of a frustum-only view consistent.
+    context.ResetCounter(m_occlusionCandidateBuffers[viewIndex]);
+    context.ResetCounter(m_disoccludedCommandBuffers[viewIndex]);
+    context.TransitionResource(m_boundsBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(m_commandBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(culledCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    D3D12_CPU_DESCRIPTOR_HANDLE srvs[2] = { m_boundsBuffer.GetSRV(), m_commandBuffer.GetSRV() };
+    context.SetDynamicDescriptors(MeshCullingParams::CullSRVs, 0, 2, srvs);
+    context.SetDynamicDescriptor(MeshCullingParams::CullUAVs, 0, culledCommands.GetUAV());
+    context.SetDynamicConstantBufferView(MeshCullingParams::CullConstants, sizeof(cbv), &cbv);
+    context.Dispatch1D(cbv.meshCount, 64);
+}
+
+void IndirectMeshBatch::Draw(GraphicsContext& context, U32 viewIndex)
+{
+    ASSERT(viewIndex < m_viewCount);
+    StructuredBuffer& culledCommands = m_culledCommandBuffers[viewIndex];
+    context.TransitionResource(culledCommands.GetCounterBuffer(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    context.TransitionResource(culledCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    context.ExecuteIndirect(m_drawSignature, culledCommands, 0, GetMeshCount(), &culledCommands.GetCounterBuffer());
+}
+
+void IndirectMeshBatch::CullOcclusionFirstPhase(ComputeContext& context, U32 viewIndex, const Matrix4& viewProjMat, HiZBuffer& previousPyramid)
+{
+    ASSERT(viewIndex < m_viewCount);
+    // Without history nothing can be rejected yet, and the second phase sees no candidates.
+    if (!previousPyramid.IsValid())
+    {
+        Cull(context, viewIndex, viewProjMat);
+        return;
+    }
+
+    StructuredBuffer& culledCommands = m_culledCommandBuffers[viewIndex];
+    StructuredBuffer& candidates = m_occlusionCandidateBuffers[viewIndex];
+    OcclusionCullConstantBuffer cbv;
+    ExtractFrustumPlanes(viewProjMat, cbv.frustumPlanes);
+    cbv.occlusionViewProj = previousPyramid.GetViewProjMatrix();
+    cbv.pyramidSize = { static_cast<F32>(previousPyramid.GetWidth()), static_cast<F32>(previousPyramid.GetHeight()) };
+    cbv.pyramidMipCount = previousPyramid.GetMipCount();
+    cbv.meshCount = GetMeshCount();
+    cbv.cullPhase = 0;
+    cbv.useOcclusion = 1;
+
+    context.SetRootSignature(m_occlusionCullRootSig);
+    context.SetPipelineState(m_occlusionCullPSO);
+    context.ResetCounter(culledCommands);
+    context.ResetCounter(candidates);
+    context.ResetCounter(m_disoccludedCommandBuffers[viewIndex]);
+    context.TransitionResource(m_boundsBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(m_commandBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(previousPyramid.GetPyramid(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(culledCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    context.TransitionResource(candidates, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    D3D12_CPU_DESCRIPTOR_HANDLE srvs[3] = { m_boundsBuffer.GetSRV(), m_commandBuffer.GetSRV(), previousPyramid.GetPyramid().GetSRV() };
+    D3D12_CPU_DESCRIPTOR_HANDLE uavs[3] = { culledCommands.GetUAV(), candidates.GetUAV(), candidates.GetCounterBuffer().GetUAV() };
+    context.SetDynamicDescriptors(MeshCullingParams::CullSRVs, 0, 3, srvs);
+    context.SetDynamicDescriptors(MeshCullingParams::CullUAVs, 0, 3, uavs);
+    context.SetDynamicConstantBufferView(MeshCullingParams::CullConstants, sizeof(cbv), &cbv);
+    context.Dispatch1D(cbv.meshCount, 64);
+}
+
+void IndirectMeshBatch::CullOcclusionSecondPhase(ComputeContext& context, U32 viewIndex, HiZBuffer& pyramid)
+{
+    ASSERT(viewIndex < m_viewCount && pyramid.IsValid());
+    StructuredBuffer& disoccludedCommands = m_disoccludedCommandBuffers[viewIndex];
+    StructuredBuffer& candidates = m_occlusionCandidateBuffers[viewIndex];
+    OcclusionCullConstantBuffer cbv = {};
+    cbv.occlusionViewProj = pyramid.GetViewProjMatrix();
+    cbv.pyramidSize = { static_cast<F32>(pyramid.GetWidth()), static_cast<F32>(pyramid.GetHeight()) };
+    cbv.pyramidMipCount = pyramid.GetMipCount();
+    cbv.meshCount = GetMeshCount();
+    cbv.cullPhase = 1;
+    cbv.useOcclusion = 1;
+
+    context.SetRootSignature(m_occlusionCullRootSig);
+    context.SetPipelineState(m_occlusionCullPSO);
+    context.TransitionResource(m_boundsBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(m_commandBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(pyramid.GetPyramid(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    context.TransitionResource(disoccludedCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    context.TransitionResource(candidates, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    context.TransitionResource(candidates.GetCounterBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    D3D12_CPU_DESCRIPTOR_HANDLE srvs[3] = { m_boundsBuffer.GetSRV(), m_commandBuffer.GetSRV(), pyramid.GetPyramid().GetSRV() };
+    D3D12_CPU_DESCRIPTOR_HANDLE uavs[3] = { disoccludedCommands.GetUAV(), candidates.GetUAV(), candidates.GetCounterBuffer().GetUAV() };
+    context.SetDynamicDescriptors(MeshCullingParams::CullSRVs, 0, 3, srvs);
+    context.SetDynamicDescriptors(MeshCullingParams::CullUAVs, 0, 3, uavs);
+    context.SetDynamicConstantBufferView(MeshCullingParams::CullConstants, sizeof(cbv), &cbv);
+    // The candidate count only exists on the GPU, so every mesh gets a thread and the surplus exits early.
+    context.Dispatch1D(cbv.meshCount, 64);
+}
+
+void IndirectMeshBatch::DrawDisoccluded(GraphicsContext& context, U32 viewIndex)
+{
+    ASSERT(viewIndex < m_viewCount);
+    StructuredBuffer& disoccludedCommands = m_disoccludedCommandBuffers[viewIndex];
+    context.TransitionResource(disoccludedCommands.GetCounterBuffer(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    context.TransitionResource(disoccludedCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    context.ExecuteIndirect(m_drawSignature, disoccludedCommands, 0, GetMeshCount(), &disoccludedCommands.GetCounterBuffer());
+}
+
+void IndirectMeshBatch::ResolveStatistics(CommandContext& context, U32 viewIndex)
+{
+    ASSERT(viewIndex < m_viewCount);
+    const U32 slot = m_statisticsSlot;
+    if (m_statisticsFences[slot] != 0)
+    {
+        // Skip a frame rather than stall when the GPU is more than kStatisticsLatency frames behind.
+        if (!Graphics::g_CommandManager.IsFenceComplete(m_statisticsFences[slot]))
+            return;
+
+        const U32* counters = static_cast<const U32*>(m_statisticsReadback.Map()) + slot * NumStatisticsCounters;
+        m_statistics.meshCount = GetMeshCount();
+        m_statistics.firstPhaseVisible = counters[StatisticsCounter::FirstPhaseVisible];
+        m_statistics.occlusionCandidates = counters[StatisticsCounter::OcclusionCandidates];
+        m_statistics.secondPhaseVisible = counters[StatisticsCounter::SecondPhaseVisible];
+        m_statisticsReadback.Unmap();
+    }
+
+    const size_t offset = slot * NumStatisticsCounters * sizeof(U32);
+    context.CopyCounter(m_statisticsReadback, offset + StatisticsCounter::FirstPhaseVisible * sizeof(U32), m_culledCommandBuffers[viewIndex]);
+    context.CopyCounter(m_statisticsReadback, offset + StatisticsCounter::OcclusionCandidates * sizeof(U32), m_occlusionCandidateBuffers[viewIndex]);
+    context.CopyCounter(m_statisticsReadback, offset + StatisticsCounter::SecondPhaseVisible * sizeof(U32), m_disoccludedCommandBuffers[viewIndex]);
+    m_statisticsPending = true;
+}
+
+void IndirectMeshBatch::FenceStatistics(uint64_t fenceValue)
+{
+    if (!m_statisticsPending)
+        return;
+    m_statisticsFences[m_statisticsSlot] = fenceValue;
+    m_statisticsSlot = (m_statisticsSlot + 1) % kStatisticsLatency;
+    m_statisticsPending = false;
+}
+
+void IndirectMeshBatch::Destroy()
+{
+    m_boundsBuffer.Destroy();
+    m_commandBuffer.Destroy();
+    for (U32 i = 0; i < m_viewCount; i++)
+    {
+        m_culledCommandBuffers[i].Destroy();
+        m_occlusionCandidateBuffers[i].Destroy();
+        m_disoccludedCommandBuffers[i].Destroy();
+    }
+    m_culledCommandBuffers.reset();
+    m_occlusionCandidateBuffers.reset();
+    m_disoccludedCommandBuffers.reset();
+    m_statisticsReadback.Destroy();
+    std::fill(std::begin(m_statisticsFences), std::end(m_statisticsFences), 0);
+    m_statisticsSlot = 0;
+    m_statisticsPending = false;
+    m_statistics = {};
+    m_viewCount = 0;
+    m_bounds.clear();
+    m_commands.clear();
+}
+
+void IndirectMeshBatch::ExtractFrustumPlanes(const Matrix4& viewProjMat, F32x4 planes[6])
+{
+    float clipPlanes[6][4];
+    CpuMeshCulling::ExtractFrustumPlanes(reinterpret_cast<const float*>(&viewProjMat), clipPlanes);
+    for (int i = 0; i < 6; i++)
+        planes[i] = { clipPlanes[i][0], clipPlanes[i][1], clipPlanes[i][2], clipPlanes[i][3] };
+}
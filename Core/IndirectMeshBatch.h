@@ -0,0 +1,122 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include "GpuBuffer.h"
+#include "ReadbackBuffer.h"
+#include "CommandSignature.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "Math/BoundingBox.hpp"
+#pragma region
+
+class CommandContext;
+class GraphicsContext;
+class ComputeContext;
+class HiZBuffer;
+
+enum MeshCullingParams :unsigned char
+{
+    CullConstants,
+    CullSRVs,
+    CullUAVs,
+    NumMeshCullingParams,
+};
+
+// One ExecuteIndirect record: per-draw root constants, mesh buffers and draw arguments.
+// Packed to 4 bytes so the layout matches the command signature stride and the HLSL struct.
+#pragma pack(push, 4)
+struct IndirectMeshCommand
+{
+    U32 baseVertex;
+    U32 materialIdx;
+    D3D12_VERTEX_BUFFER_VIEW vertexBuffer;
+    D3D12_INDEX_BUFFER_VIEW indexBuffer;
+    D3D12_DRAW_INDEXED_ARGUMENTS drawArguments;
+};
+#pragma pack(pop)
+
+struct IndirectMeshBounds
+{
+    F32x3 minBound;
+    F32 _;
+    F32x3 maxBound;
+    F32 __;
+};
+
+// Counters of one culled view, read back a few frames late.
+struct IndirectMeshCullingStats
+{
+    U32 meshCount;
+    U32 firstPhaseVisible;
+    U32 occlusionCandidates;
+    U32 secondPhaseVisible;
+
+    inline U32 FrustumCulled() const { return meshCount - firstPhaseVisible - occlusionCandidates; }
+    inline U32 OcclusionCulled() const { return occlusionCandidates - secondPhaseVisible; }
+    inline F32 CulledPercentage() const
+    {
+        return meshCount == 0 ? 0.0f : 100.0f * (meshCount - firstPhaseVisible - secondPhaseVisible) / meshCount;
+    }
+};
+
+// Uploads the bounds and draw arguments of a static mesh set once, then culls them per view on the GPU
+// and submits every surviving mesh with a single ExecuteIndirect.
+class IndirectMeshBatch
+{
+public:
+    void AddMesh(const Math::BoundingBox& bbox, const IndirectMeshCommand& command);
+
+    // perDrawConstantParam is the root parameter of drawRootSig receiving (baseVertex, materialIdx).
+    void Finalize(const std::wstring& name, const RootSignature& drawRootSig, UINT perDrawConstantParam, U32 viewCount);
+
+    void Cull(ComputeContext& context, U32 viewIndex, const Math::Matrix4& viewProjMat);
+
+    void Draw(GraphicsContext& context, U32 viewIndex);
+
+    // Two-phase Hi-Z occlusion culling.  The first phase replaces Cull: meshes hidden by the previous frame's
+    // pyramid are set aside as candidates instead of drawn.  Once the pyramid of the first phase's depth is built,
+    // the second phase re-tests the candidates and DrawDisoccluded submits the ones that became visible.
+    void CullOcclusionFirstPhase(ComputeContext& context, U32 viewIndex, const Math::Matrix4& viewProjMat, HiZBuffer& previousPyramid);
+
+    void CullOcclusionSecondPhase(ComputeContext& context, U32 viewIndex, HiZBuffer& pyramid);
+
+    void DrawDisoccluded(GraphicsContext& context, U32 viewIndex);
+
+    // Copies the counters of a view to a readback ring; GetStatistics reports them once the frame's fence passes.
+    void ResolveStatistics(CommandContext& context, U32 viewIndex);
+
+    // Tags the counters resolved this frame with the fence returned by Finish.
+    void FenceStatistics(uint64_t fenceValue);
+
+    inline const IndirectMeshCullingStats& GetStatistics() const { return m_statistics; }
+
+    void Destroy();
+
+    inline U32 GetMeshCount() const { return static_cast<U32>(m_commands.size()); }
+
+    // The planes the culling shaders test against, from CpuMeshCulling::ExtractFrustumPlanes.
+    static void ExtractFrustumPlanes(const Math::Matrix4& viewProjMat, F32x4 planes[6]);
+
+private:
+    static const U32 kStatisticsLatency = 3;
+
+    std::vector<IndirectMeshBounds> m_bounds;
+    std::vector<IndirectMeshCommand> m_commands;
+    StructuredBuffer m_boundsBuffer;
+    StructuredBuffer m_commandBuffer;
+    std::unique_ptr<StructuredBuffer[]> m_culledCommandBuffers;
+    std::unique_ptr<StructuredBuffer[]> m_occlusionCandidateBuffers;
+    std::unique_ptr<StructuredBuffer[]> m_disoccludedCommandBuffers;
+    U32 m_viewCount = 0;
+    CommandSignature m_drawSignature{ 4 };
+    RootSignature m_cullRootSig;
+    ComputePSO m_cullPSO;
+    RootSignature m_occlusionCullRootSig;
+    ComputePSO m_occlusionCullPSO;
+    ReadbackBuffer m_statisticsReadback;
+    uint64_t m_statisticsFences[kStatisticsLatency] = {};
+    U32 m_statisticsSlot = 0;
+    bool m_statisticsPending = false;
+    IndirectMeshCullingStats m_statistics = {};
+};
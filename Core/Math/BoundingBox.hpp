@@ -28,4 +28,15 @@ namespace Math
             return Scalar(XMVector3Length(max - min));
         }
 	};
+
+    // Smallest axis-aligned box holding the transformed box.
+    [[nodiscard]]
+    inline BoundingBox TransformBoundingBox(const BoundingBox& box, const AffineTransform& xform) noexcept
+    {
+        const Vector3 center = (box.min + box.max) * 0.5f;
+        const Vector3 extent = (box.max - box.min) * 0.5f;
+        const Vector3 newCenter = xform * center;
+        const Vector3 newExtent = Abs(xform.GetX()) * extent.GetX() + Abs(xform.GetY()) * extent.GetY() + Abs(xform.GetZ()) * extent.GetZ();
+        return BoundingBox(newCenter - newExtent, newCenter + newExtent);
+    }
 }
@@ -0,0 +1,45 @@
+#include "pch.h"
+#include "RegionCulling.h"
+
+RegionOverlap ClassifyBox(const float regionMin[3], const float regionMax[3], const float boxMin[3], const float boxMax[3])
+{
+    bool inside = true;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (boxMin[axis] > regionMax[axis] || boxMax[axis] < regionMin[axis])
+            return RegionOverlap::Outside;
+        inside &= boxMin[axis] >= regionMin[axis] && boxMax[axis] <= regionMax[axis];
+    }
+    return inside ? RegionOverlap::Inside : RegionOverlap::Intersects;
+}
+
+void MeshBoundsSoA::Clear()
+{
+    m_minX.clear(); m_minY.clear(); m_minZ.clear();
+    m_maxX.clear(); m_maxY.clear(); m_maxZ.clear();
+    m_meshes.clear();
+}
+
+void MeshBoundsSoA::Add(const float minBound[3], const float maxBound[3], uint32_t model, uint32_t mesh, uint32_t triangleCount)
+{
+    m_minX.push_back(minBound[0]);
+    m_minY.push_back(minBound[1]);
+    m_minZ.push_back(minBound[2]);
+    m_maxX.push_back(maxBound[0]);
+    m_maxY.push_back(maxBound[1]);
+    m_maxZ.push_back(maxBound[2]);
+    m_meshes.push_back(MeshRef{ model, mesh, triangleCount });
+}
+
+void MeshBoundsSoA::Cull(const float regionMin[3], const float regionMax[3], std::vector<uint32_t>& visible) const
+{
+    // The Outside test of ClassifyBox, without branches so the loop vectorizes.
+    const uint32_t count = GetMeshCount();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const bool outside = (m_minX[i] > regionMax[0]) | (m_minY[i] > regionMax[1]) | (m_minZ[i] > regionMax[2]) |
+            (m_maxX[i] < regionMin[0]) | (m_maxY[i] < regionMin[1]) | (m_maxZ[i] < regionMin[2]);
+        if (!outside)
+            visible.push_back(i);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// The culling of voxelization draws against the box of a clipmap region, in world coordinates.  It has no device
+// dependency, so Tools/CoreTests checks that MeshBoundsSoA::Cull keeps exactly the meshes ClassifyBox does not find
+// outside.
+enum class RegionOverlap
+{
+    Outside,
+    Intersects,
+    Inside
+};
+
+// Classifies an axis-aligned box against a region box.  Boxes that only touch the region count as intersecting,
+// since conservative rasterization still covers the boundary voxels.
+RegionOverlap ClassifyBox(const float regionMin[3], const float regionMax[3], const float boxMin[3], const float boxMax[3]);
+
+// World space bounds of every mesh of the scene, stored one array per axis so a region is tested against all of them
+// in straight loops.  Built once; every clipmap level and revoxelization region culls against it.
+class MeshBoundsSoA
+{
+public:
+    struct MeshRef
+    {
+        uint32_t model;
+        uint32_t mesh;
+        uint32_t triangleCount;
+    };
+
+    void Clear();
+
+    void Add(const float minBound[3], const float maxBound[3], uint32_t model, uint32_t mesh, uint32_t triangleCount);
+
+    // Appends the indices of the meshes that are not outside the region.
+    void Cull(const float regionMin[3], const float regionMax[3], std::vector<uint32_t>& visible) const;
+
+    uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+
+    const MeshRef& GetMesh(uint32_t index) const { return m_meshes[index]; }
+
+    void GetBounds(uint32_t index, float minBound[3], float maxBound[3]) const
+    {
+        minBound[0] = m_minX[index]; minBound[1] = m_minY[index]; minBound[2] = m_minZ[index];
+        maxBound[0] = m_maxX[index]; maxBound[1] = m_maxY[index]; maxBound[2] = m_maxZ[index];
+    }
+
+private:
+    std::vector<float> m_minX, m_minY, m_minZ;
+    std::vector<float> m_maxX, m_maxY, m_maxZ;
+    std::vector<MeshRef> m_meshes;
+};
@@ -118,6 +118,14 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
             HashCode = Utility::HashState( RootParam.DescriptorTable.pDescriptorRanges,
                 RootParam.DescriptorTable.NumDescriptorRanges, HashCode );
 
+            // Unbounded tables point into a persistent heap with SetDescriptorTable and are never staged by the
+            // dynamic descriptor heap, which has to size its cache for every table it tracks.
+            bool Unbounded = false;
+            for (UINT TableRange = 0; TableRange < RootParam.DescriptorTable.NumDescriptorRanges; ++TableRange)
+                Unbounded |= RootParam.DescriptorTable.pDescriptorRanges[TableRange].NumDescriptors == UINT_MAX;
+            if (Unbounded)
+                continue;
+
             // We keep track of sampler descriptor tables separately from CBV_SRV_UAV descriptor tables
             if (RootParam.DescriptorTable.pDescriptorRanges->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
                 m_SamplerTableBitMap |= (1 << Param);
@@ -0,0 +1,17 @@
+cbuffer HiZConstants : register(b0)
+{
+    uint2 SrcSize;
+    uint2 DstSize;
+};
+
+Texture2D<float> SceneDepth : register(t0);
+
+RWTexture2D<float> SrcMip : register(u0);
+
+RWTexture2D<float> DstMip : register(u1);
+
+#define HiZ_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 4), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))"
@@ -0,0 +1,19 @@
+#include "HiZCommon.hlsli"
+
+[RootSignature(HiZ_RootSig)]
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (any(DTid.xy >= DstSize))
+        return;
+
+    // Clamping handles levels where one axis has already reached a single texel.
+    uint2 first = min(DTid.xy * 2, SrcSize - 1);
+    uint2 last = min(DTid.xy * 2 + 1, SrcSize - 1);
+
+    float farthest = min(
+        min(SrcMip[first], SrcMip[uint2(last.x, first.y)]),
+        min(SrcMip[uint2(first.x, last.y)], SrcMip[last]));
+
+    DstMip[DTid.xy] = farthest;
+}
@@ -0,0 +1,22 @@
+#include "HiZCommon.hlsli"
+
+// The pyramid top level is the power of two at or below the depth buffer, so a texel covers between one and
+// three depth pixels per axis.  Every pixel it touches is reduced to keep the result conservative.
+[RootSignature(HiZ_RootSig)]
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (any(DTid.xy >= DstSize))
+        return;
+
+    uint2 first = DTid.xy * SrcSize / DstSize;
+    uint2 last = min(((DTid.xy + 1) * SrcSize + DstSize - 1) / DstSize, SrcSize) - 1;
+
+    // Reversed Z: the farthest depth is the smallest.
+    float farthest = 1.0;
+    for (uint y = first.y; y <= last.y; y++)
+        for (uint x = first.x; x <= last.x; x++)
+            farthest = min(farthest, SceneDepth[uint2(x, y)]);
+
+    DstMip[DTid.xy] = farthest;
+}
@@ -0,0 +1,33 @@
+#include "MeshCullingCommon.hlsli"
+
+#define THREAD_SIZE_X 64
+
+cbuffer CullConstants : register(b0)
+{
+    float4 frustumPlanes[6];
+    uint meshCount;
+};
+
+StructuredBuffer<MeshBounds> MeshBoundsBuffer : register(t0);
+
+StructuredBuffer<IndirectMeshCommand> InputCommands : register(t1);
+
+AppendStructuredBuffer<IndirectMeshCommand> OutputCommands : register(u0);
+
+#define MeshCulling_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 2))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+[RootSignature(MeshCulling_RootSig)]
+[numthreads(THREAD_SIZE_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint index = DTid.x;
+    if (index >= meshCount)
+        return;
+
+    if (IntersectFrustum(frustumPlanes, MeshBoundsBuffer[index]))
+        OutputCommands.Append(InputCommands[index]);
+}
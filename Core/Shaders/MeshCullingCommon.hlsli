@@ -0,0 +1,34 @@
+struct MeshBounds
+{
+    float3 minBound;
+    float _;
+    float3 maxBound;
+    float __;
+};
+
+// Matches IndirectMeshCommand (root constants, VBV, IBV, DrawIndexed arguments).
+struct IndirectMeshCommand
+{
+    uint2 perDrawConstants;
+    uint4 vertexBufferView;
+    uint4 indexBufferView;
+    uint4 drawArguments;
+    uint startInstanceLocation;
+};
+
+// Mirrors CpuMeshCulling::IntersectFrustum.
+bool IntersectFrustum(float4 frustumPlanes[6], MeshBounds bounds)
+{
+    [unroll]
+    for (uint i = 0; i < 6; i++)
+    {
+        float4 plane = frustumPlanes[i];
+        float3 farCorner = float3(
+            plane.x > 0.0 ? bounds.maxBound.x : bounds.minBound.x,
+            plane.y > 0.0 ? bounds.maxBound.y : bounds.minBound.y,
+            plane.z > 0.0 ? bounds.maxBound.z : bounds.minBound.z);
+        if (dot(plane.xyz, farCorner) + plane.w < 0.0)
+            return false;
+    }
+    return true;
+}
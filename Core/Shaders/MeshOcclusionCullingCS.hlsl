@@ -0,0 +1,105 @@
+#include "MeshCullingCommon.hlsli"
+
+#define THREAD_SIZE_X 64
+
+cbuffer CullConstants : register(b0)
+{
+    float4 frustumPlanes[6];
+    float4x4 occlusionViewProj;
+    float2 pyramidSize;
+    uint pyramidMipCount;
+    uint meshCount;
+    uint cullPhase;
+    uint useOcclusion;
+};
+
+StructuredBuffer<MeshBounds> MeshBoundsBuffer : register(t0);
+
+StructuredBuffer<IndirectMeshCommand> InputCommands : register(t1);
+
+Texture2D<float> HiZPyramid : register(t2);
+
+AppendStructuredBuffer<IndirectMeshCommand> OutputCommands : register(u0);
+
+// Meshes rejected by the first phase, re-tested by the second once the current pyramid exists.
+RWStructuredBuffer<uint> OcclusionCandidates : register(u1);
+
+RWByteAddressBuffer OcclusionCandidateCount : register(u2);
+
+#define MeshOcclusionCulling_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 3))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 3))"
+
+// Mirrors CpuMeshCulling::IsOccluded.  Depth is reversed, so the box is hidden when its nearest (largest)
+// depth is below the farthest (smallest) depth stored in the pyramid texels it covers.
+bool IsOccluded(MeshBounds bounds)
+{
+    float2 minUV = 1.0;
+    float2 maxUV = 0.0;
+    float nearest = 0.0;
+    [unroll]
+    for (uint corner = 0; corner < 8; corner++)
+    {
+        float3 position = float3(
+            (corner & 1) ? bounds.maxBound.x : bounds.minBound.x,
+            (corner & 2) ? bounds.maxBound.y : bounds.minBound.y,
+            (corner & 4) ? bounds.maxBound.z : bounds.minBound.z);
+        float4 clip = mul(occlusionViewProj, float4(position, 1.0));
+        // A corner behind the eye leaves the screen-space bounds undefined.
+        if (clip.w <= 1e-5)
+            return false;
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv = float2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5);
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        nearest = max(nearest, ndc.z);
+    }
+    minUV = saturate(minUV);
+    maxUV = saturate(maxUV);
+
+    // Pick the level where the box covers at most 2x2 texels.
+    float2 extent = (maxUV - minUV) * pyramidSize;
+    uint mip = min((uint)max(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0), pyramidMipCount - 1);
+    uint2 mipSize = max((uint2)pyramidSize >> mip, 1);
+    uint2 first = min((uint2)(minUV * mipSize), mipSize - 1);
+    uint2 last = min((uint2)(maxUV * mipSize), mipSize - 1);
+    float farthest = min(
+        min(HiZPyramid.Load(int3(first, mip)), HiZPyramid.Load(int3(last.x, first.y, mip))),
+        min(HiZPyramid.Load(int3(first.x, last.y, mip)), HiZPyramid.Load(int3(last, mip))));
+
+    return nearest < farthest;
+}
+
+[RootSignature(MeshOcclusionCulling_RootSig)]
+[numthreads(THREAD_SIZE_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (cullPhase == 0)
+    {
+        // Phase 1: frustum test, then the previous frame's pyramid.
+        uint index = DTid.x;
+        if (index >= meshCount)
+            return;
+
+        MeshBounds bounds = MeshBoundsBuffer[index];
+        if (!IntersectFrustum(frustumPlanes, bounds))
+            return;
+
+        if (useOcclusion != 0 && IsOccluded(bounds))
+            OcclusionCandidates[OcclusionCandidates.IncrementCounter()] = index;
+        else
+            OutputCommands.Append(InputCommands[index]);
+    }
+    else
+    {
+        // Phase 2: the candidates against the pyramid built from this frame's first phase.
+        if (DTid.x >= OcclusionCandidateCount.Load(0))
+            return;
+
+        uint index = OcclusionCandidates[DTid.x];
+        if (!IsOccluded(MeshBoundsBuffer[index]))
+            OutputCommands.Append(InputCommands[index]);
+    }
+}
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "TileArchive.h"
+
+namespace
+{
+    // An entry ReadTile can cut the interior out of without reading past the tile: whole blocks, at least the border
+    // on each side, and stored data covering every block.
+    bool IsValidEntry(const TileArchiveEntry& entry, const TileArchiveHeader& header, uint64_t fileSize)
+    {
+        const uint32_t blockSize = GetTileCodecBlockSize(entry.codec);
+        if (entry.codec != header.codec || entry.width % blockSize != 0 || entry.height % blockSize != 0 ||
+            entry.width < 2 * header.border || entry.height < 2 * header.border)
+            return false;
+        const uint64_t encodedBytes = uint64_t(entry.width / blockSize) * (entry.height / blockSize) * GetTileCodecBlockBytes(entry.codec);
+        return entry.size >= encodedBytes && entry.offset <= fileSize && entry.size <= fileSize - entry.offset;
+    }
+}
+
+bool TileArchive::Open(const std::wstring& path)
+{
+    Close();
+
+    HANDLE file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        Utility::Printf(L"Couldn't open tile archive %s\n", path.c_str());
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || uint64_t(fileSize.QuadPart) < sizeof(TileArchiveHeader))
+    {
+        Close();
+        return false;
+    }
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+        m_base = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_base == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    const TileArchiveHeader& header = GetHeader();
+    const uint64_t indexEnd = sizeof(TileArchiveHeader) + uint64_t(header.tileCount) * sizeof(TileArchiveEntry);
+    if (header.magic != kTileArchiveMagic || header.version != kTileArchiveVersion || indexEnd > uint64_t(fileSize.QuadPart) ||
+        header.codec > kTileCodecBC7 || header.border % GetTileCodecBlockSize(header.codec) != 0 || header.tileWidth == 0 || header.tileHeight == 0 ||
+        header.mipCount > 32)
+    {
+        Utility::Printf(L"%s is not a version %u tile archive\n", path.c_str(), kTileArchiveVersion);
+        Close();
+        return false;
+    }
+    m_entries = reinterpret_cast<const TileArchiveEntry*>(m_base + sizeof(TileArchiveHeader));
+
+    // The index is dense, so a tile is found by arithmetic instead of a search.
+    uint32_t entryCount = 0;
+    for (uint32_t mip = 0; mip < header.mipCount; mip++)
+    {
+        const uint32_t width = std::max(header.width >> mip, 1u);
+        const uint32_t height = std::max(header.height >> mip, 1u);
+        m_mipFirstEntry.push_back(entryCount);
+        m_mipTilesX.push_back((width + header.tileWidth - 1) / header.tileWidth);
+        m_mipTilesY.push_back((height + header.tileHeight - 1) / header.tileHeight);
+        entryCount += m_mipTilesX.back() * m_mipTilesY.back();
+    }
+    // Entries are checked here so ReadTile can trust them; a truncated or corrupt archive is rejected as a whole.
+    bool valid = entryCount == header.tileCount;
+    for (uint32_t mip = 0; valid && mip < header.mipCount; mip++)
+    {
+        for (uint32_t i = 0; valid && i < m_mipTilesX[mip] * m_mipTilesY[mip]; i++)
+        {
+            const TileArchiveEntry& entry = m_entries[m_mipFirstEntry[mip] + i];
+            valid = entry.mip == mip && entry.x == i % m_mipTilesX[mip] && entry.y == i / m_mipTilesX[mip] &&
+                IsValidEntry(entry, header, uint64_t(fileSize.QuadPart));
+        }
+    }
+    if (!valid)
+    {
+        Utility::Printf(L"Tile archive %s is corrupt\n", path.c_str());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void TileArchive::Close()
+{
+    if (m_base != nullptr)
+        UnmapViewOfFile(m_base);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != nullptr)
+        CloseHandle(m_file);
+    m_base = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_entries = nullptr;
+    m_mipFirstEntry.clear();
+    m_mipTilesX.clear();
+    m_mipTilesY.clear();
+}
+
+const TileArchiveEntry* TileArchive::FindTile(uint32_t mip, uint32_t x, uint32_t y) const
+{
+    if (mip >= m_mipFirstEntry.size() || x >= m_mipTilesX[mip] || y >= m_mipTilesY[mip])
+        return nullptr;
+    const TileArchiveEntry* entry = &m_entries[m_mipFirstEntry[mip] + y * m_mipTilesX[mip] + x];
+    ASSERT(entry->mip == mip && entry->x == x && entry->y == y, "Tile archive index is out of order");
+    return entry;
+}
+
+bool TileArchive::ReadTile(uint32_t mip, uint32_t x, uint32_t y, std::vector<uint8_t>& data) const
+{
+    const TileArchiveEntry* entry = FindTile(mip, x, y);
+    if (entry == nullptr)
+        return false;
+    ASSERT(entry->codec <= kTileCodecBC7, "Unsupported tile codec %u", entry->codec);
+
+    // The baker keeps the border a whole number of blocks, so the interior is cut on block boundaries.
+    const uint32_t blockSize = GetTileCodecBlockSize(entry->codec);
+    const uint32_t blockBytes = GetTileCodecBlockBytes(entry->codec);
+    const uint32_t borderBlocks = GetHeader().border / blockSize;
+    const uint32_t storedPitch = entry->width / blockSize * blockBytes;
+    const uint32_t rowBytes = (entry->width / blockSize - 2 * borderBlocks) * blockBytes;
+    const uint32_t rows = entry->height / blockSize - 2 * borderBlocks;
+    const uint8_t* source = GetTileData(*entry) + size_t(borderBlocks) * storedPitch + borderBlocks * blockBytes;
+    const size_t start = data.size();
+    data.resize(start + size_t(rowBytes) * rows);
+    for (uint32_t row = 0; row < rows; row++)
+        std::memcpy(&data[start + size_t(row) * rowBytes], source + size_t(row) * storedPitch, rowBytes);
+    return true;
+}
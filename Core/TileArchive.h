@@ -0,0 +1,100 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <string>
+#include <vector>
+#pragma region
+
+// A tile archive (.vta) holds every tile of a virtual texture in one file: a TileArchiveHeader, then the
+// TileArchiveEntry index sorted by mip, y and x, then the tiles.  Each tile starts on a kTileArchiveAlignment
+// boundary, so it can be mapped or read on its own.  Tools/TileBaker writes the format.
+static const uint32_t kTileArchiveMagic = 0x31415456;    // "VTA1"
+static const uint32_t kTileArchiveVersion = 2;
+static const uint32_t kTileArchiveAlignment = 64 * 1024;
+
+enum TileCodec : uint16_t
+{
+    kTileCodecRGBA8,
+    kTileCodecBC1,
+    kTileCodecBC3,
+    kTileCodecBC7,
+};
+
+// Width and height in texels of the smallest unit a codec stores: a texel or a 4x4 block.
+inline uint32_t GetTileCodecBlockSize(uint32_t codec) { return codec == kTileCodecRGBA8 ? 1 : 4; }
+inline uint32_t GetTileCodecBlockBytes(uint32_t codec)
+{
+    switch (codec)
+    {
+    case kTileCodecRGBA8: return 4;
+    case kTileCodecBC1: return 8;
+    default: return 16;
+    }
+}
+
+struct TileArchiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // Size of mip 0 in texels.
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    // Texels of a tile inside its border.  Mips smaller than a tile are stored as a single smaller tile, rounded up
+    // to whole blocks.
+    uint32_t tileWidth;
+    uint32_t tileHeight;
+    // Texels copied from the neighbouring tiles (clamped at the texture edge) on each side of a stored tile, so a
+    // tile can be filtered on its own.
+    uint32_t border;
+    uint32_t tileCount;
+    // TileCodec shared by every tile.
+    uint32_t codec;
+};
+
+struct TileArchiveEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint16_t mip;
+    uint16_t codec;
+    uint16_t x;
+    uint16_t y;
+    // Stored size in texels, border included.  Always a whole number of blocks.
+    uint16_t width;
+    uint16_t height;
+};
+
+// Read-only view of a tile archive.  The file is memory mapped, so tiles can be read from several threads at once
+// and only the pages of the tiles that are read are brought in.
+class TileArchive
+{
+public:
+    ~TileArchive() { Close(); }
+
+    bool Open(const std::wstring& path);
+    void Close();
+
+    inline bool IsOpen() const { return m_base != nullptr; }
+    inline const TileArchiveHeader& GetHeader() const { return *reinterpret_cast<const TileArchiveHeader*>(m_base); }
+
+    // Returns nullptr if the archive has no such tile.
+    const TileArchiveEntry* FindTile(uint32_t mip, uint32_t x, uint32_t y) const;
+
+    // The tile as stored, border included; valid until Close.
+    inline const uint8_t* GetTileData(const TileArchiveEntry& entry) const { return m_base + entry.offset; }
+
+    // Appends the texels (or, for block codecs, the blocks) inside the tile's border to data, rows of blocks tightly
+    // packed.  Returns false if the tile is missing.
+    bool ReadTile(uint32_t mip, uint32_t x, uint32_t y, std::vector<uint8_t>& data) const;
+
+private:
+    const TileArchiveEntry* m_entries = nullptr;
+    std::vector<uint32_t> m_mipFirstEntry;
+    std::vector<uint32_t> m_mipTilesX;
+    std::vector<uint32_t> m_mipTilesY;
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+    const uint8_t* m_base = nullptr;
+};
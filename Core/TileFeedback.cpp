@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "TileFeedback.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include <fstream>
+
+namespace
+{
+    struct CaptureHeader
+    {
+        uint32_t magic;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+    };
+
+    const uint32_t kCaptureMagic = 0x32424654;    // "TFB2"
+}
+
+void TileFeedbackAggregator::Reset(const std::vector<uint32_t>& pagesX, const std::vector<uint32_t>& pagesY)
+{
+    ASSERT(pagesX.size() == pagesY.size());
+    m_mipPagesX = pagesX;
+    m_mipPagesY = pagesY;
+    m_mipFirstPage.resize(pagesX.size());
+    uint32_t pageCount = 0;
+    for (size_t mip = 0; mip < pagesX.size(); mip++)
+    {
+        m_mipFirstPage[mip] = pageCount;
+        pageCount += pagesX[mip] * pagesY[mip];
+    }
+    m_coverage.assign(pageCount + 1, 0);
+    m_seenPages.clear();
+    m_samples = 0;
+}
+
+void TileFeedbackAggregator::Clear()
+{
+    for (uint32_t page : m_seenPages)
+        m_coverage[page] = 0;
+    m_seenPages.clear();
+    m_samples = 0;
+}
+
+void TileFeedbackAggregator::Accumulate(const uint32_t* texels, uint32_t width, uint32_t height, uint32_t rowPitch, bool simd)
+{
+    if (width == 0)
+        return;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        // Neighbouring texels mostly sample the same page, so each row is counted in runs and a run costs one
+        // histogram update.  Four texels at a time are compared against the texel of the current run.
+        const uint32_t* row = texels + size_t(y) * rowPitch;
+        uint32_t runTexel = row[0];
+        uint32_t runLength = 0;
+        uint32_t x = 0;
+        for (; simd && x + 4 <= width; x += 4)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(block, _mm_set1_epi32(static_cast<int>(runTexel)))) == 0xFFFF)
+            {
+                runLength += 4;
+                continue;
+            }
+            for (uint32_t i = x; i < x + 4; i++)
+            {
+                if (row[i] != runTexel)
+                {
+                    AddRun(runTexel, runLength);
+                    runTexel = row[i];
+                    runLength = 0;
+                }
+                runLength++;
+            }
+        }
+        for (; x < width; x++)
+        {
+            if (row[x] != runTexel)
+            {
+                AddRun(runTexel, runLength);
+                runTexel = row[x];
+                runLength = 0;
+            }
+            runLength++;
+        }
+        AddRun(runTexel, runLength);
+    }
+}
+
+void TileFeedbackAggregator::AddRun(uint32_t texel, uint32_t count)
+{
+    if (count == 0 || (texel & TILE_FEEDBACK_VALID_BIT) == 0)
+        return;
+
+    const uint32_t mip = (texel >> TILE_FEEDBACK_MIP_SHIFT) & TILE_FEEDBACK_MIP_MASK;
+    uint32_t page = GetPackedPage();
+    if (mip < m_mipFirstPage.size())
+    {
+        const uint32_t x = texel & TILE_FEEDBACK_COORD_MASK;
+        const uint32_t y = (texel >> TILE_FEEDBACK_Y_SHIFT) & TILE_FEEDBACK_COORD_MASK;
+        if (x >= m_mipPagesX[mip] || y >= m_mipPagesY[mip])
+            return;
+        page = m_mipFirstPage[mip] + y * m_mipPagesX[mip] + x;
+    }
+
+    if (m_coverage[page] == 0)
+        m_seenPages.push_back(page);
+    m_coverage[page] += count;
+    m_samples += count;
+}
+
+void TileFeedbackAggregator::BuildRequests(std::vector<TileFeedbackRequest>& requests) const
+{
+    const size_t first = requests.size();
+    for (uint32_t page : m_seenPages)
+    {
+        // The packed page sorts as the mip after the last standard one.
+        const uint32_t mipLevel = static_cast<uint32_t>(std::upper_bound(m_mipFirstPage.begin(), m_mipFirstPage.end(), page) - m_mipFirstPage.begin()) - 1;
+        requests.push_back(TileFeedbackRequest{ page, m_coverage[page], page == GetPackedPage() ? static_cast<uint32_t>(m_mipFirstPage.size()) : mipLevel });
+    }
+    std::sort(requests.begin() + first, requests.end(), [](const TileFeedbackRequest& a, const TileFeedbackRequest& b)
+    {
+        if (a.mipLevel != b.mipLevel)
+            return a.mipLevel > b.mipLevel;
+        if (a.coverage != b.coverage)
+            return a.coverage > b.coverage;
+        return a.page < b.page;
+    });
+}
+
+bool SaveTileFeedbackCapture(const std::wstring& path, const uint32_t* texels, uint32_t width, uint32_t height, uint32_t rowPitch,
+    const std::vector<uint32_t>& pagesX, const std::vector<uint32_t>& pagesY)
+{
+    ASSERT(pagesX.size() == pagesY.size());
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    const CaptureHeader header = { kCaptureMagic, width, height, static_cast<uint32_t>(pagesX.size()) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(pagesX.data()), pagesX.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(pagesY.data()), pagesY.size() * sizeof(uint32_t));
+    for (uint32_t y = 0; y < height; y++)
+        file.write(reinterpret_cast<const char*>(texels + size_t(y) * rowPitch), width * sizeof(uint32_t));
+    return file.good();
+}
+
+bool LoadTileFeedbackCapture(const std::wstring& path, std::vector<uint32_t>& texels, uint32_t& width, uint32_t& height,
+    std::vector<uint32_t>& pagesX, std::vector<uint32_t>& pagesY)
+{
+    std::ifstream file(path, std::ios::binary);
+    CaptureHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kCaptureMagic || header.mipCount > TILE_FEEDBACK_MIP_MASK + 1)
+        return false;
+    pagesX.resize(header.mipCount);
+    pagesY.resize(header.mipCount);
+    texels.resize(size_t(header.width) * header.height);
+    if (!file.read(reinterpret_cast<char*>(pagesX.data()), pagesX.size() * sizeof(uint32_t)) ||
+        !file.read(reinterpret_cast<char*>(pagesY.data()), pagesY.size() * sizeof(uint32_t)) ||
+        !file.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(uint32_t)))
+        return false;
+    width = header.width;
+    height = header.height;
+    return true;
+}
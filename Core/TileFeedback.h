@@ -0,0 +1,65 @@
+#pragma once
+
+#pragma  region HEADER
+#include "hlsl.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#pragma region
+
+struct TileFeedbackRequest
+{
+    uint32_t page;
+    // Feedback texels that sampled the page.
+    uint32_t coverage;
+    uint32_t mipLevel;
+};
+
+// Builds a per-page coverage histogram from the screen-space feedback buffer.  Pages are numbered the way the
+// tiled texture lays them out: the standard mips row by row, then one page for all the packed mips.
+class TileFeedbackAggregator
+{
+public:
+    static inline uint32_t Pack(uint32_t mipLevel, uint32_t pageX, uint32_t pageY)
+    {
+        return TILE_FEEDBACK_VALID_BIT | (mipLevel << TILE_FEEDBACK_MIP_SHIFT) | (pageY << TILE_FEEDBACK_Y_SHIFT) | pageX;
+    }
+
+    // pagesX and pagesY hold the page grid of each standard mip.
+    void Reset(const std::vector<uint32_t>& pagesX, const std::vector<uint32_t>& pagesY);
+
+    // Drops the histogram gathered so far.
+    void Clear();
+
+    // Adds the texels of a feedback buffer whose rows are rowPitch texels apart.  Runs of equal texels are found four
+    // texels at a time with SSE2 unless simd is false.
+    void Accumulate(const uint32_t* texels, uint32_t width, uint32_t height, uint32_t rowPitch, bool simd);
+
+    // Appends the pages seen since the last Clear, coarse mips first and then by descending coverage.  Coarse
+    // pages come first because they are the fallback of every finer page they contain.
+    void BuildRequests(std::vector<TileFeedbackRequest>& requests) const;
+
+    inline uint32_t GetPageCount() const { return static_cast<uint32_t>(m_coverage.size()); }
+    inline uint32_t GetPackedPage() const { return GetPageCount() - 1; }
+    inline uint32_t GetSeenPageCount() const { return static_cast<uint32_t>(m_seenPages.size()); }
+    inline uint64_t GetSampleCount() const { return m_samples; }
+    inline const std::vector<uint32_t>& GetMipPagesX() const { return m_mipPagesX; }
+    inline const std::vector<uint32_t>& GetMipPagesY() const { return m_mipPagesY; }
+
+private:
+    void AddRun(uint32_t texel, uint32_t count);
+
+    std::vector<uint32_t> m_mipPagesX;
+    std::vector<uint32_t> m_mipPagesY;
+    std::vector<uint32_t> m_mipFirstPage;
+    std::vector<uint32_t> m_coverage;
+    std::vector<uint32_t> m_seenPages;
+    uint64_t m_samples = 0;
+};
+
+// Captures are the raw feedback texels behind a small header with the page grid of each mip, for replaying the
+// aggregation offline; Tools/TileFeedbackBench times it on them.
+bool SaveTileFeedbackCapture(const std::wstring& path, const uint32_t* texels, uint32_t width, uint32_t height, uint32_t rowPitch,
+    const std::vector<uint32_t>& pagesX, const std::vector<uint32_t>& pagesY);
+bool LoadTileFeedbackCapture(const std::wstring& path, std::vector<uint32_t>& texels, uint32_t& width, uint32_t& height,
+    std::vector<uint32_t>& pagesX, std::vector<uint32_t>& pagesY);
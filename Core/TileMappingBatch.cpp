@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "TileMappingBatch.h"
+#include <algorithm>
+
+void TileMappingBatch::Map(const D3D12_TILED_RESOURCE_COORDINATE& tile, U32 heapOffset)
+{
+    ASSERT(heapOffset != kUnmapped);
+    m_tiles.push_back(Tile{ tile.Subresource, tile.X, tile.Y, heapOffset });
+}
+
+void TileMappingBatch::Unmap(const D3D12_TILED_RESOURCE_COORDINATE& tile)
+{
+    m_tiles.push_back(Tile{ tile.Subresource, tile.X, tile.Y, kUnmapped });
+}
+
+void TileMappingBatch::MapRegion(const D3D12_TILED_RESOURCE_COORDINATE& start, const D3D12_TILE_REGION_SIZE& regionSize, U32 heapOffset)
+{
+    m_regions.push_back(Region{ start, regionSize, heapOffset });
+}
+
+void TileMappingBatch::BeginRegion()
+{
+    if (m_calls.empty() || m_calls.back().regionCount == m_maxRegionsPerCall)
+        m_calls.push_back(TileMappingCall{ (U32)m_regionSizes.size(), 0, (U32)m_rangeFlags.size(), 0 });
+    m_calls.back().regionCount++;
+}
+
+void TileMappingBatch::AddRange(U32 heapOffset, U32 tileCount)
+{
+    // Ranges are consumed across region boundaries, so a range can span the end of one box and the start of the
+    // next, but not the end of a call.
+    TileMappingCall& call = m_calls.back();
+    const D3D12_TILE_RANGE_FLAGS flags = heapOffset == kUnmapped ? D3D12_TILE_RANGE_FLAG_NULL : D3D12_TILE_RANGE_FLAG_NONE;
+    if (call.rangeCount > 0 && m_rangeFlags.back() == flags &&
+        (flags == D3D12_TILE_RANGE_FLAG_NULL || m_heapRangeStartOffsets.back() + m_rangeTileCounts.back() == heapOffset))
+    {
+        m_rangeTileCounts.back() += tileCount;
+        return;
+    }
+    m_rangeFlags.push_back(flags);
+    m_heapRangeStartOffsets.push_back(flags == D3D12_TILE_RANGE_FLAG_NULL ? 0 : heapOffset);
+    m_rangeTileCounts.push_back(tileCount);
+    call.rangeCount++;
+}
+
+void TileMappingBatch::Build()
+{
+    m_stats = {};
+    m_startCoordinates.clear();
+    m_regionSizes.clear();
+    m_rangeFlags.clear();
+    m_heapRangeStartOffsets.clear();
+    m_rangeTileCounts.clear();
+    m_calls.clear();
+    if (IsEmpty())
+        return;
+
+    // Row-major order within each mip; the stable sort keeps the latest change to a tile last among its duplicates.
+    std::stable_sort(m_tiles.begin(), m_tiles.end(), [](const Tile& a, const Tile& b)
+    {
+        if (a.subresource != b.subresource)
+            return a.subresource < b.subresource;
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    size_t count = 0;
+    for (size_t i = 0; i < m_tiles.size(); i++)
+    {
+        const Tile& tile = m_tiles[i];
+        if (count > 0 && m_tiles[count - 1].subresource == tile.subresource && m_tiles[count - 1].x == tile.x && m_tiles[count - 1].y == tile.y)
+            count--;
+        m_tiles[count++] = tile;
+    }
+    m_tiles.resize(count);
+
+    // Split each row into runs of neighbouring tiles that are all mapped or all unmapped, and stack a run onto the
+    // box whose bottom row it continues.  Boxes that end above the previous row can't grow any more.
+    m_runs.clear();
+    m_boxes.clear();
+    size_t openBoxes = 0;
+    for (U32 first = 0; first < (U32)m_tiles.size(); )
+    {
+        const Tile& head = m_tiles[first];
+        const bool mapped = head.heapOffset != kUnmapped;
+        U32 width = 1;
+        while (first + width < (U32)m_tiles.size())
+        {
+            const Tile& next = m_tiles[first + width];
+            if (next.subresource != head.subresource || next.y != head.y || next.x != head.x + width || (next.heapOffset != kUnmapped) != mapped)
+                break;
+            width++;
+        }
+
+        const U32 run = (U32)m_runs.size();
+        m_runs.push_back(Run{ first, width, kNoRun });
+        bool stacked = false;
+        for (size_t b = openBoxes; b < m_boxes.size(); b++)
+        {
+            Box& box = m_boxes[b];
+            if (box.subresource != head.subresource || box.y + box.height < head.y)
+            {
+                if (b == openBoxes)
+                    openBoxes++;
+                continue;
+            }
+            if (box.y + box.height == head.y && box.x == head.x && box.width == width && box.mapped == mapped)
+            {
+                m_runs[box.lastRun].nextRun = run;
+                box.lastRun = run;
+                box.height++;
+                stacked = true;
+                break;
+            }
+        }
+        if (!stacked)
+            m_boxes.push_back(Box{ head.subresource, head.x, head.y, width, 1, mapped, run, run });
+        first += width;
+    }
+
+    // A box's tiles are enumerated row by row, which is the order its runs were stacked in.
+    for (const Box& box : m_boxes)
+    {
+        BeginRegion();
+        m_startCoordinates.push_back(CD3DX12_TILED_RESOURCE_COORDINATE(box.x, box.y, 0, box.subresource));
+        D3D12_TILE_REGION_SIZE size;
+        size.NumTiles = box.width * box.height;
+        size.UseBox = TRUE;
+        size.Width = box.width;
+        size.Height = (UINT16)box.height;
+        size.Depth = 1;
+        m_regionSizes.push_back(size);
+        for (U32 run = box.firstRun; run != kNoRun; run = m_runs[run].nextRun)
+        {
+            for (U32 i = 0; i < m_runs[run].width; i++)
+                AddRange(m_tiles[m_runs[run].firstTile + i].heapOffset, 1);
+        }
+    }
+    for (const Region& region : m_regions)
+    {
+        BeginRegion();
+        m_startCoordinates.push_back(region.start);
+        m_regionSizes.push_back(region.size);
+        AddRange(region.heapOffset, region.size.NumTiles);
+    }
+
+    m_stats.calls = (U32)m_calls.size();
+    m_stats.regions = (U32)m_regionSizes.size();
+    m_stats.ranges = (U32)m_rangeFlags.size();
+    m_stats.tiles = (U32)m_tiles.size();
+    for (const Region& region : m_regions)
+        m_stats.tiles += region.size.NumTiles;
+
+    m_tiles.clear();
+    m_regions.clear();
+}
+
+void TileMappingBatch::Flush(ID3D12CommandQueue* queue, ID3D12Resource* resource, ID3D12Heap* heap)
+{
+    Build();
+    for (const TileMappingCall& call : m_calls)
+    {
+        queue->UpdateTileMappings(
+            resource,
+            call.regionCount,
+            &m_startCoordinates[call.firstRegion],
+            &m_regionSizes[call.firstRegion],
+            heap,
+            call.rangeCount,
+            &m_rangeFlags[call.firstRange],
+            &m_heapRangeStartOffsets[call.firstRange],
+            &m_rangeTileCounts[call.firstRange],
+            D3D12_TILE_MAPPING_FLAG_NONE);
+    }
+}
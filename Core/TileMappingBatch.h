@@ -0,0 +1,119 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include <algorithm>
+#include <vector>
+#pragma region
+
+// Page table changes issued by one Flush.
+struct TileMappingStats
+{
+    U32 calls;
+    U32 regions;
+    U32 ranges;
+    U32 tiles;
+};
+
+// One UpdateTileMappings call: its regions and ranges in the arrays TileMappingBatch::Build fills.
+struct TileMappingCall
+{
+    U32 firstRegion;
+    U32 regionCount;
+    U32 firstRange;
+    U32 rangeCount;
+};
+
+// Collects a frame's page table changes of a reserved resource and issues them as UpdateTileMappings calls, a single
+// one unless the changes come to more regions than a call takes.  Neighbouring standard tiles of a mip are merged
+// into box regions, and tiles bound to consecutive heap tiles, or unbound, into single ranges, so the size of a call
+// follows the shape of the change rather than its tile count.
+class TileMappingBatch
+{
+public:
+    static constexpr U32 kDefaultMaxRegionsPerCall = 4096;
+
+    // Binds one standard tile to a heap tile.  A later change to the same tile replaces an earlier one.
+    void Map(const D3D12_TILED_RESOURCE_COORDINATE& tile, U32 heapOffset);
+    // Unbinds one standard tile.
+    void Unmap(const D3D12_TILED_RESOURCE_COORDINATE& tile);
+    // Binds the region's NumTiles tiles to consecutive heap tiles from heapOffset, as it is; for the packed mips.
+    void MapRegion(const D3D12_TILED_RESOURCE_COORDINATE& start, const D3D12_TILE_REGION_SIZE& regionSize, U32 heapOffset);
+
+    inline bool IsEmpty() const { return m_tiles.empty() && m_regions.empty(); }
+
+    // A call is issued whenever the regions reach this many, so the arrays of a call stay bounded.
+    inline void SetMaxRegionsPerCall(U32 regions) { m_maxRegionsPerCall = std::max(regions, 1u); }
+
+    // Coalesces the changes into the regions and ranges of the calls below and empties the batch.
+    void Build();
+
+    // Builds the changes and issues the calls on the queue.  Nothing is issued for an empty batch.
+    void Flush(ID3D12CommandQueue* queue, ID3D12Resource* resource, ID3D12Heap* heap);
+
+    // Of the last Build or Flush.
+    inline const TileMappingStats& GetStats() const { return m_stats; }
+    inline const std::vector<TileMappingCall>& GetCalls() const { return m_calls; }
+    inline const std::vector<D3D12_TILED_RESOURCE_COORDINATE>& GetStartCoordinates() const { return m_startCoordinates; }
+    inline const std::vector<D3D12_TILE_REGION_SIZE>& GetRegionSizes() const { return m_regionSizes; }
+    inline const std::vector<D3D12_TILE_RANGE_FLAGS>& GetRangeFlags() const { return m_rangeFlags; }
+    inline const std::vector<U32>& GetHeapRangeStartOffsets() const { return m_heapRangeStartOffsets; }
+    inline const std::vector<U32>& GetRangeTileCounts() const { return m_rangeTileCounts; }
+
+private:
+    static constexpr U32 kUnmapped = ~0u;
+    static constexpr U32 kNoRun = ~0u;
+
+    struct Tile
+    {
+        U32 subresource;
+        U32 x;
+        U32 y;
+        U32 heapOffset;
+    };
+
+    struct Region
+    {
+        D3D12_TILED_RESOURCE_COORDINATE start;
+        D3D12_TILE_REGION_SIZE size;
+        U32 heapOffset;
+    };
+
+    // A row of neighbouring tiles; rows of the same width stacked on top of each other form a box.
+    struct Run
+    {
+        U32 firstTile;
+        U32 width;
+        U32 nextRun;
+    };
+
+    struct Box
+    {
+        U32 subresource;
+        U32 x;
+        U32 y;
+        U32 width;
+        U32 height;
+        bool mapped;
+        U32 firstRun;
+        U32 lastRun;
+    };
+
+    // Starts a call when the current one is full; regions are added after it.
+    void BeginRegion();
+    void AddRange(U32 heapOffset, U32 tileCount);
+
+    std::vector<Tile> m_tiles;
+    std::vector<Region> m_regions;
+    // Scratch space of Flush, kept to avoid reallocating every frame.
+    std::vector<Run> m_runs;
+    std::vector<Box> m_boxes;
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE> m_startCoordinates;
+    std::vector<D3D12_TILE_REGION_SIZE> m_regionSizes;
+    std::vector<D3D12_TILE_RANGE_FLAGS> m_rangeFlags;
+    std::vector<U32> m_heapRangeStartOffsets;
+    std::vector<U32> m_rangeTileCounts;
+    std::vector<TileMappingCall> m_calls;
+    U32 m_maxRegionsPerCall = kDefaultMaxRegionsPerCall;
+    TileMappingStats m_stats = {};
+};
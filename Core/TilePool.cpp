@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "TilePool.h"
+
+void TilePool::Reset(uint32_t slotCount, uint32_t pageCount, Policy policy)
+{
+    m_policy = policy;
+    m_slots.assign(slotCount, Slot{ kInvalid, kInvalid, kInvalid, 0, false });
+    m_freeSlots.resize(slotCount);
+    // Hand out the low slots first.
+    for (uint32_t i = 0; i < slotCount; i++)
+        m_freeSlots[i] = slotCount - 1 - i;
+    m_pageSlots.assign(pageCount, kInvalid);
+    m_head = m_tail = kInvalid;
+    m_evictions = 0;
+    m_overflows = 0;
+}
+
+bool TilePool::Touch(uint32_t page, uint64_t frame)
+{
+    const uint32_t slot = m_pageSlots[page];
+    if (slot == kInvalid)
+        return false;
+    m_slots[slot].lastFrame = frame;
+    m_slots[slot].referenced = true;
+    if (m_policy == kLeastRecentlyUsed && slot != m_head)
+    {
+        Unlink(slot);
+        PushFront(slot);
+    }
+    return true;
+}
+
+uint32_t TilePool::Allocate(uint32_t page, uint64_t frame, uint32_t& evictedPage)
+{
+    ASSERT(m_pageSlots[page] == kInvalid, "Page %u already has a tile slot", page);
+    evictedPage = kInvalid;
+
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = FindVictim(frame);
+        if (slot == kInvalid)
+        {
+            m_overflows++;
+            return kInvalid;
+        }
+        evictedPage = m_slots[slot].page;
+        m_pageSlots[evictedPage] = kInvalid;
+        Unlink(slot);
+        m_evictions++;
+    }
+
+    m_slots[slot].page = page;
+    m_slots[slot].lastFrame = frame;
+    m_slots[slot].referenced = false;
+    m_pageSlots[page] = slot;
+    PushFront(slot);
+    return slot;
+}
+
+void TilePool::Free(uint32_t page)
+{
+    const uint32_t slot = m_pageSlots[page];
+    if (slot == kInvalid)
+        return;
+    Unlink(slot);
+    m_slots[slot].page = kInvalid;
+    m_pageSlots[page] = kInvalid;
+    m_freeSlots.push_back(slot);
+}
+
+uint32_t TilePool::FindVictim(uint64_t frame)
+{
+    // Least recently used order puts every page used within the delay ahead of the tail, so only the tail is a
+    // candidate.
+    // The other policies walk from the oldest allocation towards the newest; passing the whole list twice is enough
+    // to clear every reference bit on the way.
+    uint32_t slot = m_tail;
+    for (size_t step = 0; slot != kInvalid && step < 2 * m_slots.size(); step++)
+    {
+        Slot& s = m_slots[slot];
+        const bool secondChance = m_policy == kSecondChance && s.referenced;
+        if (s.lastFrame + m_evictionDelay <= frame && !secondChance)
+            return slot;
+        if (m_policy == kLeastRecentlyUsed)
+            break;
+
+        const uint32_t newer = s.prev;
+        if (secondChance)
+        {
+            s.referenced = false;
+            Unlink(slot);
+            PushFront(slot);
+        }
+        slot = newer != kInvalid ? newer : m_tail;
+    }
+    return kInvalid;
+}
+
+void TilePool::Unlink(uint32_t slot)
+{
+    Slot& s = m_slots[slot];
+    if (s.prev != kInvalid)
+        m_slots[s.prev].next = s.next;
+    else
+        m_head = s.next;
+    if (s.next != kInvalid)
+        m_slots[s.next].prev = s.prev;
+    else
+        m_tail = s.prev;
+    s.prev = s.next = kInvalid;
+}
+
+void TilePool::PushFront(uint32_t slot)
+{
+    Slot& s = m_slots[slot];
+    s.prev = kInvalid;
+    s.next = m_head;
+    if (m_head != kInvalid)
+        m_slots[m_head].prev = slot;
+    m_head = slot;
+    if (m_tail == kInvalid)
+        m_tail = slot;
+}
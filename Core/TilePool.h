@@ -0,0 +1,79 @@
+#pragma once
+
+#pragma  region HEADER
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// Fixed-capacity pool of physical tile slots for a virtual texture.  Virtual pages are given a slot on demand,
+// and when every slot is taken the eviction policy picks a page to make room.  The pool only does the bookkeeping;
+// the owner maps and unmaps the tiles.
+class TilePool
+{
+public:
+    static constexpr uint32_t kInvalid = ~0u;
+
+    enum Policy : uint32_t
+    {
+        // Evicts the page used longest ago.
+        kLeastRecentlyUsed,
+        // Evicts the oldest allocation, but a page used since it was last passed over gets another round (CLOCK).
+        kSecondChance,
+        // Evicts the oldest allocation however recently it was used.
+        kFirstIn,
+        kPolicyCount
+    };
+
+    void Reset(uint32_t slotCount, uint32_t pageCount, Policy policy = kLeastRecentlyUsed);
+
+    // Marks a resident page as used in the given frame.  Returns false if the page has no slot.
+    bool Touch(uint32_t page, uint64_t frame);
+
+    // Gives the page a slot, evicting a page when the pool is full.  Pages used within the eviction delay are never
+    // evicted, so kInvalid is returned when those frames alone need more tiles than the pool holds.
+    uint32_t Allocate(uint32_t page, uint64_t frame, uint32_t& evictedPage);
+
+    // Returns the page's slot to the free list.
+    void Free(uint32_t page);
+
+    // Pages stay resident for at least this many frames after their last use, so a page that drops out of view for
+    // a frame or two is not unmapped and loaded again.  1, the default, only protects the current frame.
+    inline void SetEvictionDelay(uint32_t frames) { m_evictionDelay = std::max(frames, 1u); }
+
+    inline Policy GetPolicy() const { return m_policy; }
+    inline uint32_t GetEvictionDelay() const { return m_evictionDelay; }
+    inline uint32_t GetSlot(uint32_t page) const { return m_pageSlots[page]; }
+    inline bool IsResident(uint32_t page) const { return m_pageSlots[page] != kInvalid; }
+    inline uint32_t GetCapacity() const { return static_cast<uint32_t>(m_slots.size()); }
+    inline uint32_t GetResidentCount() const { return GetCapacity() - static_cast<uint32_t>(m_freeSlots.size()); }
+    inline uint64_t GetEvictionCount() const { return m_evictions; }
+    inline uint64_t GetOverflowCount() const { return m_overflows; }
+
+private:
+    // Resident slots form an intrusive list from m_head to m_tail.  Under kLeastRecentlyUsed it runs from the most
+    // to the least recently used page, under the other policies from the newest to the oldest allocation.
+    struct Slot
+    {
+        uint32_t page;
+        uint32_t prev;
+        uint32_t next;
+        uint64_t lastFrame;
+        bool referenced;
+    };
+
+    // Returns the slot to evict, or kInvalid if every resident page was used within the eviction delay.
+    uint32_t FindVictim(uint64_t frame);
+    void Unlink(uint32_t slot);
+    void PushFront(uint32_t slot);
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<uint32_t> m_pageSlots;
+    Policy m_policy = kLeastRecentlyUsed;
+    uint32_t m_evictionDelay = 1;
+    uint32_t m_head = kInvalid;
+    uint32_t m_tail = kInvalid;
+    uint64_t m_evictions = 0;
+    uint64_t m_overflows = 0;
+};
@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "TileResidency.h"
+#include <algorithm>
+
+void TileResidency::Reset(uint32_t pageCount, uint32_t slotCount, TilePool::Policy policy)
+{
+    ASSERT(pageCount > 0);
+    // The packed page is not part of the pool.
+    m_pool.Reset(slotCount, pageCount - 1, policy);
+    m_pageFlags.assign(pageCount, 0);
+    m_prefetchQueue.clear();
+    m_packedResident = false;
+    m_stats = {};
+}
+
+void TileResidency::Update(uint64_t frame, const std::vector<TileFeedbackRequest>& demanded, const std::vector<TileFeedbackRequest>& predicted,
+    uint32_t requestBudget, uint32_t prefetchBudget, std::vector<TileLoad>& loads, std::vector<uint32_t>& cancelled)
+{
+    m_stats.frames++;
+    m_stats.feedbackFrames++;
+    for (const TileFeedbackRequest& seen : demanded)
+    {
+        m_stats.feedbackSamples += seen.coverage;
+        if (!IsResident(seen.page))
+            m_stats.missedSamples += seen.coverage;
+        m_pageFlags[seen.page] |= kPageDemanded;
+    }
+    for (const TileFeedbackRequest& seen : predicted)
+        m_pageFlags[seen.page] |= kPagePredicted;
+
+    // Queued prefetches are dropped once the newest prediction stops seeing their page, and when the current view
+    // needs the page, so it is loaded again below at demand priority.
+    size_t kept = 0;
+    for (uint32_t page : m_prefetchQueue)
+    {
+        uint8_t& flags = m_pageFlags[page];
+        if ((flags & kPagePrefetchQueued) == 0)
+            continue;
+        if ((flags & (kPageDemanded | kPagePredicted)) == kPagePredicted)
+        {
+            m_prefetchQueue[kept++] = page;
+            continue;
+        }
+        flags &= ~(kPageQueued | kPagePrefetchQueued);
+        cancelled.push_back(page);
+        m_stats.cancelledPrefetches++;
+    }
+    m_prefetchQueue.resize(kept);
+
+    // Loads keep the feedback order: coarse mips first, then the pages covering the most pixels.
+    auto load = [&](const TileFeedbackRequest& seen, bool prefetch)
+    {
+        const uint32_t priority = (prefetch ? 0 : kDemandPriority) | (seen.mipLevel << 24) | std::min<uint32_t>(seen.coverage, 0xFFFFFF);
+        loads.push_back(TileLoad{ seen.page, priority, prefetch });
+        m_pageFlags[seen.page] |= prefetch ? kPageQueued | kPagePrefetchQueued : kPageQueued;
+    };
+
+    // The packed mips are the fallback of every page, so they are loaded first whether or not they were seen.
+    const uint32_t packedPage = GetPackedPage();
+    if (!m_packedResident && (m_pageFlags[packedPage] & kPageQueued) == 0)
+    {
+        loads.push_back(TileLoad{ packedPage, ~0u, false });
+        m_pageFlags[packedPage] |= kPageQueued;
+        m_stats.loads++;
+    }
+
+    uint32_t requests = 0;
+    for (const TileFeedbackRequest& seen : demanded)
+    {
+        const uint32_t page = seen.page;
+        if (page == packedPage ? m_packedResident : m_pool.Touch(page, frame))
+            continue;
+        // Every seen page is still touched, but only the most needed ones are loaded each frame.
+        if ((m_pageFlags[page] & kPageQueued) != 0 || requests == requestBudget)
+            continue;
+        load(seen, false);
+        requests++;
+    }
+    m_stats.loads += requests;
+
+    // Predicted pages are not touched, so a prediction that does not come true ages out of the pool.
+    uint32_t prefetches = 0;
+    for (const TileFeedbackRequest& seen : predicted)
+    {
+        if (prefetches == prefetchBudget)
+            break;
+        if (IsResident(seen.page) || (m_pageFlags[seen.page] & kPageQueued) != 0)
+            continue;
+        load(seen, true);
+        m_prefetchQueue.push_back(seen.page);
+        prefetches++;
+    }
+    m_stats.prefetchLoads += prefetches;
+
+    for (const TileFeedbackRequest& seen : demanded)
+        m_pageFlags[seen.page] &= ~kPageDemanded;
+    for (const TileFeedbackRequest& seen : predicted)
+        m_pageFlags[seen.page] &= ~kPagePredicted;
+}
+
+bool TileResidency::Place(uint32_t page, uint64_t frame, std::vector<TileMapping>& mappings)
+{
+    m_pageFlags[page] &= ~(kPageQueued | kPagePrefetchQueued);
+    if (IsResident(page))
+        return false;
+
+    if (page == GetPackedPage())
+    {
+        m_packedResident = true;
+        mappings.push_back(TileMapping{ page, TilePool::kInvalid, true });
+        m_stats.uploads++;
+        return true;
+    }
+
+    uint32_t evicted;
+    const uint32_t slot = m_pool.Allocate(page, frame, evicted);
+    if (slot == TilePool::kInvalid)
+    {
+        m_stats.droppedUploads++;
+        return false;
+    }
+    if (evicted != TilePool::kInvalid)
+    {
+        mappings.push_back(TileMapping{ evicted, TilePool::kInvalid, false });
+        m_stats.evictions++;
+    }
+    mappings.push_back(TileMapping{ page, slot, true });
+    m_stats.uploads++;
+    m_stats.peakResident = std::max(m_stats.peakResident, m_pool.GetResidentCount());
+    return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#pragma  region HEADER
+#include "TileFeedback.h"
+#include "TilePool.h"
+#include <cstdint>
+#include <vector>
+#pragma region
+
+// A tile the streamer should load.  Higher priorities are loaded first.
+struct TileLoad
+{
+    uint32_t page;
+    uint32_t priority;
+    bool prefetch;
+};
+
+// A page table change.  Standard pages are mapped to a pool slot; the packed page has tiles of its own outside the
+// pool, so its slot is TilePool::kInvalid.
+struct TileMapping
+{
+    uint32_t page;
+    uint32_t slot;
+    bool mapped;
+};
+
+struct TileResidencyStats
+{
+    uint64_t frames;
+    // Frames that had feedback to act on.
+    uint64_t feedbackFrames;
+    // Feedback samples, and those whose page was not resident when the feedback was read.
+    uint64_t feedbackSamples;
+    uint64_t missedSamples;
+    uint64_t loads;
+    uint64_t prefetchLoads;
+    // Queued prefetches dropped because the newest prediction no longer saw their page or the current view needed
+    // it first.
+    uint64_t cancelledPrefetches;
+    // Tiles placed, and tiles dropped because every slot held a page used within the eviction delay.
+    uint64_t uploads;
+    uint64_t droppedUploads;
+    uint64_t evictions;
+    uint32_t peakResident;
+};
+
+// The streaming policy of a virtual texture without the device: it turns each frame's feedback into tile loads
+// and cancellations, and each loaded tile into page table changes, which the owner carries out.  TiledTexture
+// drives it with D3D12, and Tools/TileTraceReplay drives it from a recorded trace to compare budgets and policies.
+//
+// Pages are numbered the way TileFeedbackAggregator numbers them, with the packed page last.
+class TileResidency
+{
+public:
+    // Set on demand loads, so every page the current view misses is loaded before any prefetch.
+    static constexpr uint32_t kDemandPriority = 1u << 31;
+
+    void Reset(uint32_t pageCount, uint32_t slotCount, TilePool::Policy policy);
+
+    // Acts on a frame's feedback: demanded holds the pages the current view sampled, predicted those a view
+    // extrapolated ahead of it sampled, both in TileFeedbackAggregator::BuildRequests order.  Resident demanded pages
+    // are marked used.  Appends at most requestBudget demand loads and prefetchBudget prefetch loads, and the
+    // queued prefetches to cancel.
+    void Update(uint64_t frame, const std::vector<TileFeedbackRequest>& demanded, const std::vector<TileFeedbackRequest>& predicted,
+        uint32_t requestBudget, uint32_t prefetchBudget, std::vector<TileLoad>& loads, std::vector<uint32_t>& cancelled);
+
+    // See TilePool::SetEvictionDelay.
+    inline void SetEvictionDelay(uint32_t frames) { m_pool.SetEvictionDelay(frames); }
+
+    // Counts a frame without feedback.
+    void SkipFrame() { m_stats.frames++; }
+
+    // Makes a loaded tile resident, appending the mapping changes it takes: an evicted page's unmap, then the
+    // page's map.  Returns false, changing nothing, when every slot holds a page used within the eviction delay;
+    // the page is asked for again while it stays visible.
+    bool Place(uint32_t page, uint64_t frame, std::vector<TileMapping>& mappings);
+
+    inline bool IsResident(uint32_t page) const { return page == GetPackedPage() ? m_packedResident : m_pool.IsResident(page); }
+    inline uint32_t GetPageCount() const { return static_cast<uint32_t>(m_pageFlags.size()); }
+    inline uint32_t GetPackedPage() const { return GetPageCount() - 1; }
+    inline const TilePool& GetPool() const { return m_pool; }
+    inline const TileResidencyStats& GetStats() const { return m_stats; }
+
+private:
+    enum PageFlags : uint8_t
+    {
+        kPageQueued = 0x1,
+        kPagePrefetchQueued = 0x2,
+        // Only set while Update runs.
+        kPageDemanded = 0x4,
+        kPagePredicted = 0x8,
+    };
+
+    TilePool m_pool;
+    std::vector<uint8_t> m_pageFlags;
+    // Pages queued as prefetches, so they can be revisited without scanning every page.
+    std::vector<uint32_t> m_prefetchQueue;
+    bool m_packedResident = false;
+    TileResidencyStats m_stats = {};
+};
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "TileStreamer.h"
+
+void TileStreamer::Start(LoadFunction load, U32 workerCount, U32 stagingCapacity)
+{
+    Stop();
+    ASSERT(workerCount > 0 && stagingCapacity > 0);
+
+    m_load = std::move(load);
+    m_stagingCapacity = stagingCapacity;
+    m_stop = false;
+    for (U32 i = 0; i < workerCount; i++)
+        m_workers.emplace_back(&TileStreamer::WorkerMain, this);
+}
+
+void TileStreamer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    m_queue = std::priority_queue<QueuedRequest>();
+    m_pending.clear();
+    m_staged.clear();
+    m_loadingCount = 0;
+}
+
+bool TileStreamer::Request(const TileRequest& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending.insert(request.page).second)
+            return false;
+        m_queue.push(QueuedRequest{ request, m_sequence++ });
+    }
+    m_workAvailable.notify_one();
+    return true;
+}
+
+U32 TileStreamer::Cancel(const std::function<bool(const TileRequest&)>& isStale)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<QueuedRequest> kept;
+    kept.reserve(m_queue.size());
+    U32 cancelled = 0;
+    for (; !m_queue.empty(); m_queue.pop())
+    {
+        const QueuedRequest& queued = m_queue.top();
+        if (isStale(queued.request))
+        {
+            m_pending.erase(queued.request.page);
+            cancelled++;
+        }
+        else
+        {
+            kept.push_back(queued);
+        }
+    }
+    m_queue = std::priority_queue<QueuedRequest>(kept.begin(), kept.end());
+    return cancelled;
+}
+
+U32 TileStreamer::Collect(U32 maxTiles, std::vector<LoadedTile>& tiles)
+{
+    U32 count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        count = std::min<U32>(maxTiles, (U32)m_staged.size());
+        for (U32 i = 0; i < count; i++)
+        {
+            m_pending.erase(m_staged[i].request.page);
+            tiles.push_back(std::move(m_staged[i]));
+        }
+        m_staged.erase(m_staged.begin(), m_staged.begin() + count);
+    }
+    if (count > 0)
+        m_workAvailable.notify_all();
+    return count;
+}
+
+U32 TileStreamer::GetQueuedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (U32)m_queue.size();
+}
+
+U32 TileStreamer::GetStagedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (U32)m_staged.size();
+}
+
+void TileStreamer::WorkerMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        // A worker only starts a tile it has a staging slot for.
+        m_workAvailable.wait(lock, [this] {
+            return m_stop || (!m_queue.empty() && m_staged.size() + m_loadingCount < m_stagingCapacity);
+        });
+        if (m_stop)
+            return;
+
+        const TileRequest request = m_queue.top().request;
+        m_queue.pop();
+        m_loadingCount++;
+
+        lock.unlock();
+        LoadedTile tile{ request, m_load(request) };
+        lock.lock();
+
+        m_loadingCount--;
+        m_staged.push_back(std::move(tile));
+    }
+}
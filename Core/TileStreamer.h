@@ -0,0 +1,91 @@
+#pragma once
+
+#pragma  region HEADER
+#include "pch.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#pragma region
+
+struct TileRequest
+{
+    U32 page;
+    // Higher priorities are loaded first.
+    U32 priority;
+    U32 offsetX;
+    U32 offsetY;
+    U32 mipLevel;
+    // SystemTime tick of the request, carried through to measure upload latency.
+    int64_t requestTick;
+    // Frame whose feedback asked for the page.
+    uint64_t feedbackFrame;
+    // Asked for by the predicted view rather than the current one.
+    bool prefetch;
+};
+
+struct LoadedTile
+{
+    TileRequest request;
+    std::vector<UINT8> data;
+};
+
+// Worker pool that reads and decodes virtual texture tiles off the render thread.  Requests are served by priority,
+// and finished tiles wait in a bounded set of staging slots until the render thread collects them.
+class TileStreamer
+{
+public:
+    typedef std::function<std::vector<UINT8>(const TileRequest&)> LoadFunction;
+
+    ~TileStreamer() { Stop(); }
+
+    void Start(LoadFunction load, U32 workerCount, U32 stagingCapacity);
+
+    // Joins the workers and drops every queued or staged tile.
+    void Stop();
+
+    // Queues the page unless it is already queued, loading or staged.  Returns true if it was queued.
+    bool Request(const TileRequest& request);
+
+    // Drops the queued requests isStale returns true for, so their pages can be requested again.  Tiles already
+    // loading or staged are kept.  Returns the number dropped.
+    U32 Cancel(const std::function<bool(const TileRequest&)>& isStale);
+
+    // Moves up to maxTiles staged tiles into tiles and frees their staging slots.
+    U32 Collect(U32 maxTiles, std::vector<LoadedTile>& tiles);
+
+    U32 GetQueuedCount() const;
+    U32 GetStagedCount() const;
+
+private:
+    struct QueuedRequest
+    {
+        TileRequest request;
+        uint64_t sequence;
+
+        // Ties go to the oldest request.
+        bool operator<(const QueuedRequest& other) const
+        {
+            if (request.priority != other.request.priority)
+                return request.priority < other.request.priority;
+            return sequence > other.sequence;
+        }
+    };
+
+    void WorkerMain();
+
+    LoadFunction m_load;
+    std::vector<std::thread> m_workers;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::priority_queue<QueuedRequest> m_queue;
+    // Pages that are queued, loading or staged.
+    std::unordered_set<U32> m_pending;
+    std::vector<LoadedTile> m_staged;
+    U32 m_stagingCapacity = 0;
+    U32 m_loadingCount = 0;
+    uint64_t m_sequence = 0;
+    bool m_stop = false;
+};
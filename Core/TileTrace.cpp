@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "TileTrace.h"
+
+namespace
+{
+    struct TileTraceFrameHeader
+    {
+        uint32_t hasFeedback;
+        uint32_t demandedCount;
+        uint32_t predictedCount;
+    };
+
+    const uint32_t kTileTraceMagic = 0x31545254;    // "TRT1"
+    const uint32_t kTileTraceVersion = 2;
+}
+
+bool TileTraceRecorder::Open(const std::wstring& path, const TileTraceHeader& header)
+{
+    Close();
+    m_file.open(path, std::ios::binary);
+    if (!m_file)
+        return false;
+    TileTraceHeader written = header;
+    written.magic = kTileTraceMagic;
+    written.version = kTileTraceVersion;
+    written.frameCount = 0;
+    m_file.write(reinterpret_cast<const char*>(&written), sizeof(written));
+    m_frameCount = 0;
+    return m_file.good();
+}
+
+void TileTraceRecorder::WriteFrame(bool hasFeedback, const std::vector<TileFeedbackRequest>& demanded, const std::vector<TileFeedbackRequest>& predicted)
+{
+    const TileTraceFrameHeader frame = { hasFeedback ? 1u : 0u, static_cast<uint32_t>(demanded.size()), static_cast<uint32_t>(predicted.size()) };
+    m_file.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    m_file.write(reinterpret_cast<const char*>(demanded.data()), demanded.size() * sizeof(TileFeedbackRequest));
+    m_file.write(reinterpret_cast<const char*>(predicted.data()), predicted.size() * sizeof(TileFeedbackRequest));
+    m_frameCount++;
+}
+
+void TileTraceRecorder::Close()
+{
+    if (!m_file.is_open())
+        return;
+    m_file.seekp(offsetof(TileTraceHeader, frameCount));
+    m_file.write(reinterpret_cast<const char*>(&m_frameCount), sizeof(m_frameCount));
+    m_file.close();
+}
+
+bool LoadTileTrace(const std::wstring& path, TileTraceHeader& header, std::vector<TileTraceFrame>& frames)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kTileTraceMagic || header.version != kTileTraceVersion || header.pageCount == 0)
+        return false;
+
+    frames.resize(header.frameCount);
+    for (TileTraceFrame& frame : frames)
+    {
+        TileTraceFrameHeader frameHeader;
+        if (!file.read(reinterpret_cast<char*>(&frameHeader), sizeof(frameHeader)))
+            return false;
+        frame.hasFeedback = frameHeader.hasFeedback != 0;
+        frame.demanded.resize(frameHeader.demandedCount);
+        frame.predicted.resize(frameHeader.predictedCount);
+        if (!file.read(reinterpret_cast<char*>(frame.demanded.data()), frame.demanded.size() * sizeof(TileFeedbackRequest)) ||
+            !file.read(reinterpret_cast<char*>(frame.predicted.data()), frame.predicted.size() * sizeof(TileFeedbackRequest)))
+            return false;
+        for (const std::vector<TileFeedbackRequest>* requests : { &frame.demanded, &frame.predicted })
+            for (const TileFeedbackRequest& request : *requests)
+                if (request.page >= header.pageCount)
+                    return false;
+    }
+    return true;
+}
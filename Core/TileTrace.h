@@ -0,0 +1,53 @@
+#pragma once
+
+#pragma  region HEADER
+#include "TileFeedback.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#pragma region
+
+// A tile trace is the feedback a TiledTexture acted on, frame by frame, so TileResidency can be replayed without a
+// device against other pool sizes, budgets and policies (see Tools/TileTraceReplay).
+struct TileTraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageCount;
+    // The pool and per-frame budgets of the recording, the replay's defaults.
+    uint32_t slotCount;
+    uint32_t requestBudget;
+    uint32_t prefetchBudget;
+    uint32_t uploadBudget;
+    uint32_t evictionDelay;
+    uint32_t frameCount;
+};
+
+struct TileTraceFrame
+{
+    // False for frames whose feedback was still in flight, which only age the pool.
+    bool hasFeedback;
+    std::vector<TileFeedbackRequest> demanded;
+    std::vector<TileFeedbackRequest> predicted;
+};
+
+class TileTraceRecorder
+{
+public:
+    ~TileTraceRecorder() { Close(); }
+
+    // header.magic, version and frameCount are filled in.
+    bool Open(const std::wstring& path, const TileTraceHeader& header);
+    void WriteFrame(bool hasFeedback, const std::vector<TileFeedbackRequest>& demanded, const std::vector<TileFeedbackRequest>& predicted);
+    // Patches the frame count into the header.
+    void Close();
+
+    inline bool IsOpen() const { return m_file.is_open(); }
+
+private:
+    std::ofstream m_file;
+    uint32_t m_frameCount = 0;
+};
+
+bool LoadTileTrace(const std::wstring& path, TileTraceHeader& header, std::vector<TileTraceFrame>& frames);
@@ -2,13 +2,24 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "TiledTexture.h"
-#include "CompiledShaders/FillPage.h"
-#include "FileUtility.h"
+#include "BufferManager.h"
+#include "SystemTime.h"
+#include <algorithm>
 #include <map>
 #include <thread>
 
 using namespace Graphics;
 
+IntVar TileUploadsPerFrame("Graphics/Virtual Texture/Tile Uploads Per Frame", 64, 1, 1024, 16);
+IntVar TileRequestsPerFrame("Graphics/Virtual Texture/Tile Requests Per Frame", 128, 1, 4096, 16);
+BoolVar CaptureTileFeedback("Graphics/Virtual Texture/Capture Feedback", false);
+BoolVar EnableTilePrefetch("Graphics/Virtual Texture/Prefetch", true);
+IntVar TilePrefetchRequestsPerFrame("Graphics/Virtual Texture/Prefetch Requests Per Frame", 32, 0, 4096, 16);
+
+// Feedback trails the view by a few frames, so a page that just left it is kept a little longer than that.
+IntVar TileEvictionDelay("Graphics/Virtual Texture/Eviction Delay Frames", 4, 1, 600, 1);
+BoolVar RecordTileTrace("Graphics/Virtual Texture/Record Trace", false);
+
 static std::vector<UINT8> GenerateTextureTestData(const U32 totalWidth, const U32 totalHeight, const  U32 pixelInPytes, const U32 offsetX, const  U32 offsetY, const U32 W, const U32 H, const  U32 mip_level, const U32 mipCount)
 {
     U32 dataSize = W * H* pixelInPytes;
@@ -52,31 +63,70 @@ static std::vector<UINT8> GenerateTextureTestData(const U32 totalWidth, const U3
     return data;
 }
 
-static std::vector<UINT8> GenerateTextureFromImage(const std::wstring& folder, const U32 offsetX, const  U32 offsetY, const U32 W, const U32 H, const  U32 mip_level, const U32 pixelInPytes, const U32 mipCount)
+UINT BytesPerPixel(DXGI_FORMAT Format);
+
+// Block compressed formats are stored and copied in 4x4 blocks; every other format in single texels.
+static void GetBlockInfo(DXGI_FORMAT Format, U32& blockSize, U32& blockBytes)
 {
-    const U32 dataSize = W * H * pixelInPytes;
-    std::vector<UINT8> data(dataSize);
-    const U32 tile_x = offsetX / W;
-    const U32 tile_y = offsetY / H;
-    U32 fillIndex = 0;
-    for (U32 count = 0; count < mipCount; count++)
+    switch (Format)
     {
-        const std::wstring file_name = L"Tiles_MIP" + std::to_wstring(mip_level + count) + L"_Y" + std::to_wstring(tile_y) + L"_X" + std::to_wstring(tile_x) + L".tga";
-        std::shared_ptr<std::vector<UINT8>> ba = Utility::ReadFileSync(folder + L"/" + file_name);
-        fillIndex = Utility::FillFlatData(fillIndex, ba, data);
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        blockSize = 4;
+        blockBytes = 8;
+        break;
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        blockSize = 4;
+        blockBytes = 16;
+        break;
+    default:
+        blockSize = 1;
+        blockBytes = BytesPerPixel(Format);
+        break;
     }
-    return data;
 }
 
-UINT BytesPerPixel(DXGI_FORMAT Format);
-void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMAT Format)
+// The tile archive codec that holds texels of the given format, or ~0u if there is none.
+static U32 GetTileCodec(DXGI_FORMAT Format)
+{
+    switch (Format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        return kTileCodecRGBA8;
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        return kTileCodecBC1;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        return kTileCodecBC3;
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return kTileCodecBC7;
+    default:
+        return ~0u;
+    }
+}
+
+void TiledTexture::Create(const std::wstring& archivePath, U32 Width, U32 Height, DXGI_FORMAT Format, U32 PoolSizeInBytes)
 {
     Destroy();
-    m_folder_path = std::move(folder);
-    m_use_test_texture = m_folder_path == L"";
+    m_use_test_texture = archivePath.empty() || !m_archive.Open(archivePath);
     m_resTexWidth = Width;
     m_resTexHeight = Height;
-    m_resTexPixelInBytes = BytesPerPixel(Format);
+    GetBlockInfo(Format, m_blockSize, m_blockBytes);
+    ASSERT(!m_use_test_texture || m_blockSize == 1, "The test texture can't be block compressed");
     m_activeMip = 0;
     U32 mipLevels = 0;
     for (U32 w = m_resTexWidth, h = m_resTexHeight; w > 0 && h > 0; w >>= 1, h >>= 1)
@@ -96,7 +146,9 @@ void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMA
     reservedTextureDesc.SampleDesc.Quality = 0;
     reservedTextureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
     reservedTextureDesc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
-    m_UsageState = D3D12_RESOURCE_STATE_COPY_DEST;
+    // Tiles are written on the copy queue and sampled on the graphics queue.  The texture stays in the common
+    // state, is promoted on each queue, and decays back between command lists, so no barriers are recorded.
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
     ASSERT_SUCCEEDED(g_Device->CreateReservedResource(
         &reservedTextureDesc,
         m_UsageState,
@@ -119,13 +171,23 @@ void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMA
     m_TileShape = {};
     g_Device->GetResourceTiling(m_pResource.Get(), &numTiles, &m_packedMipInfo, &m_TileShape, &subresourceCount, 0, &tilings[0]);
     
+    if (!m_use_test_texture)
+    {
+        const TileArchiveHeader& header = m_archive.GetHeader();
+        ASSERT(header.width == m_resTexWidth && header.height == m_resTexHeight && header.mipCount >= m_MipLevels,
+            "Tile archive is %ux%u with %u mips", header.width, header.height, header.mipCount);
+        ASSERT(header.codec == GetTileCodec(Format), "Tile archive codec %u doesn't hold the texture's format", header.codec);
+        ASSERT(header.tileWidth == m_TileShape.WidthInTexels && header.tileHeight == m_TileShape.HeightInTexels,
+            "Tile archive tiles are %ux%u, the texture's are %ux%u", header.tileWidth, header.tileHeight, m_TileShape.WidthInTexels, m_TileShape.HeightInTexels);
+    }
+
     U32x3 imageGranularity;
     imageGranularity[0] = m_TileShape.WidthInTexels;
     imageGranularity[1] = m_TileShape.HeightInTexels;
     imageGranularity[2] = m_TileShape.DepthInTexels;
 
     m_pages.resize(0);
-    size_t heapOffset = 0;
+    std::vector<U32> mipPagesX, mipPagesY;
     for (U32 mipLevel = 0; mipLevel < m_packedMipInfo.NumStandardMips; mipLevel++)
     {
         U32x3 extent;
@@ -134,6 +196,8 @@ void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMA
         extent[2] = std::max<U32>(1 >> mipLevel, 1u);
 
         U32x3 sparseBindCounts = DivideByMultiple(extent, imageGranularity);
+        mipPagesX.push_back(sparseBindCounts[0]);
+        mipPagesY.push_back(sparseBindCounts[1]);
         U32x3 lastBlockExtend;
         lastBlockExtend[0] = extent[0] % imageGranularity[0] ? extent[0] % imageGranularity[0] : imageGranularity[0];
         lastBlockExtend[1] = extent[1] % imageGranularity[1] ? extent[1] % imageGranularity[1] : imageGranularity[1];
@@ -157,7 +221,6 @@ void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMA
                 page.mipLevel = mipLevel;
                 page.start_corordinate = start_coordinate;
                 page.is_packed = false;
-                heapOffset += D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
                 m_pages.emplace_back(std::move(page));
             }
         }
@@ -171,201 +234,384 @@ void TiledTexture::Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMA
     page.regionSize.Depth = 0;
     page.is_packed = true;
     page.start_corordinate = CD3DX12_TILED_RESOURCE_COORDINATE(0, 0, 0, m_packedMipInfo.NumStandardMips);;
-    heapOffset += D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
     m_pages.emplace_back(std::move(page));
-    m_visibilityBuffer.Create(L"visibilityBuffer", (U32)m_pages.size(), sizeof(int), nullptr);
-    m_prevVisBuffer.Create(L"preVisBuffer", (U32)m_pages.size(), sizeof(int), nullptr);
-    m_alivePagesBuffer.Create(L"aliveBuffer", (U32)m_pages.size(), sizeof(int), nullptr);
-    m_removedPagesBuffer.Create(L"removedPageBuffer", (U32)m_pages.size(), sizeof(int), nullptr);
-    m_alivePagesReadBackBuffer.Create(L"alivePagesReadBackBuffer", (U32)m_pages.size(), sizeof(int));
-    m_removedPagesReadBackBuffer.Create(L"removedPagesReadbackBuffer", (U32)m_pages.size(), sizeof(int));
-    m_alivePagesCounterReadBackBuffer.Create(L"alivePagesCounterReadBackBuffer", 1, sizeof(int));
-    m_removedPagesCounterReadBackBuffer.Create(L"removedPagesCounterReadBackBuffer", 1, sizeof(int));
-    m_alivePagesCounterBuffer.Create(L"alivePageBufferCounter", 1, sizeof(int));
-    m_removedPagesCounterBuffer.Create(L"removedPageBufferCounter", 1, sizeof(int));
-    m_cpu_pages_allocator = std::make_unique<PageAllocator>(m_TileShape.WidthInTexels*m_TileShape.HeightInTexels*m_resTexPixelInBytes);
-
-    CD3DX12_HEAP_DESC pageheapDesc(heapOffset, D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+
+    // The packed mips are the fallback for every page, so they stay resident outside the pool.
+    const U32 standardPageCount = (U32)m_pages.size() - 1;
+    const U32 poolTileCount = std::min<U32>(standardPageCount, PoolSizeInBytes / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES);
+    m_packedTileCount = m_packedMipInfo.NumTilesForPackedMips;
+    m_residency.Reset((U32)m_pages.size(), poolTileCount, TilePool::kLeastRecentlyUsed);
+    m_frameIndex = 0;
+    const size_t heapSize = size_t(m_packedTileCount + poolTileCount) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
+    const U32 feedbackWidth = std::max(g_SceneColorBuffer.GetWidth() >> TILE_FEEDBACK_DOWNSCALE_LOG2, 1u);
+    m_feedbackViewHeight = std::max(g_SceneColorBuffer.GetHeight() >> TILE_FEEDBACK_DOWNSCALE_LOG2, 1u);
+    m_feedbackBuffer.Create(L"Tile Feedback", feedbackWidth, 2 * m_feedbackViewHeight, 1, kFeedbackFormat);
+    m_feedbackDepth.Create(L"Tile Feedback Depth", feedbackWidth, 2 * m_feedbackViewHeight, kFeedbackDepthFormat);
+    UINT64 feedbackBytes = 0;
+    const D3D12_RESOURCE_DESC feedbackDesc = m_feedbackBuffer.GetResource()->GetDesc();
+    g_Device->GetCopyableFootprints(&feedbackDesc, 0, 1, 0, &m_feedbackFootprint, nullptr, nullptr, &feedbackBytes);
+    for (FeedbackReadback& feedback : m_feedback)
+    {
+        feedback.texels.Create(L"Tile Feedback Readback", (U32)(feedbackBytes / sizeof(U32)), sizeof(U32));
+        feedback.state = kFeedbackFree;
+        feedback.fenceValue = 0;
+        feedback.frameIndex = 0;
+    }
+    m_recordedFeedback = kFeedbackReadbackCount;
+    m_feedbackAggregator.Reset(mipPagesX, mipPagesY);
+    m_prefetchAggregator.Reset(mipPagesX, mipPagesY);
+
+    // One upload segment holds a frame's worth of tiles plus the packed mips.
+    UINT64 packedBytes = 0;
+    m_packedFootprints.resize(m_packedMipInfo.NumPackedMips);
+    m_packedRowCounts.resize(m_packedMipInfo.NumPackedMips);
+    m_packedRowBytes.resize(m_packedMipInfo.NumPackedMips);
+    if (m_packedMipInfo.NumPackedMips > 0)
+        g_Device->GetCopyableFootprints(&reservedTextureDesc, m_packedMipInfo.NumStandardMips, m_packedMipInfo.NumPackedMips, 0, m_packedFootprints.data(),
+            m_packedRowCounts.data(), m_packedRowBytes.data(), &packedBytes);
+    m_packedBytes = (U32)packedBytes;
+    m_tileRowPitch = m_TileShape.WidthInTexels / m_blockSize * m_blockBytes;
+    const U32 tileBytes = (U32)Math::AlignUp(m_tileRowPitch * (m_TileShape.HeightInTexels / m_blockSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    m_uploadSegmentSize = (U32)Math::AlignUp(kMaxUploadsPerFrame * tileBytes + packedBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    m_uploadBuffer.Create(L"Tile Upload Ring", kUploadSegmentCount, m_uploadSegmentSize);
+    m_uploadData = static_cast<UINT8*>(m_uploadBuffer.Map());
+    m_uploadSegment = 0;
+    for (uint64_t& fence : m_uploadFences)
+        fence = 0;
+    m_uploadStats = {};
+
+    CD3DX12_HEAP_DESC pageheapDesc(heapSize, D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
     ASSERT_SUCCEEDED(g_Device->CreateHeap(&pageheapDesc, IID_PPV_ARGS(&m_page_heaps)));
 
-    m_rootSig.Reset(TiledComputerParams::NumComputeParams, 0);
-    m_rootSig[TiledComputerParams::PageCountInfo].InitAsConstants(0, 4, D3D12_SHADER_VISIBILITY_ALL);
-    m_rootSig[TiledComputerParams::Buffers].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 6);
-    m_rootSig.Finalize(L"FillPage");
-    m_computePSO.SetRootSignature(m_rootSig);
-    m_computePSO.SetComputeShader(SHADER_ARGS(g_pFillPage));
-    m_computePSO.Finalize();
-    m_computePSO.GetPipelineStateObject()->SetName(L"Fill Page PSO");
+    // Until a page's tile arrives the shader keeps falling back to the coarser mips that are mapped.
+    m_streamer.Start([this](const TileRequest& request)
+    {
+        return GenerateTextureData(request.offsetX, request.offsetY, m_TileShape.WidthInTexels, m_TileShape.HeightInTexels, request.mipLevel);
+    }, std::max(1u, std::thread::hardware_concurrency() / 2), kStagedTileCount);
 }
 
-void TiledTexture::UpdateVisibilityBuffer(ComputeContext& computeContext)
+void TiledTexture::BeginFeedback(GraphicsContext& gfxContext)
 {
-    computeContext.SetRootSignature(m_rootSig);
-    computeContext.SetPipelineState(m_computePSO);
-    computeContext.FillBuffer(m_alivePagesCounterBuffer, 0, 0, sizeof(U32));
-    computeContext.FillBuffer(m_removedPagesCounterBuffer, 0, 0, sizeof(U32));
-    computeContext.TransitionResource(m_visibilityBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    computeContext.TransitionResource(m_prevVisBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    computeContext.TransitionResource(m_alivePagesBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    computeContext.TransitionResource(m_removedPagesBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    computeContext.TransitionResource(m_alivePagesCounterBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    computeContext.TransitionResource(m_removedPagesCounterBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    D3D12_CPU_DESCRIPTOR_HANDLE handles[6] = { m_prevVisBuffer.GetUAV(),m_visibilityBuffer.GetUAV(),m_alivePagesBuffer.GetUAV(),m_alivePagesCounterBuffer.GetUAV(),m_removedPagesBuffer.GetUAV(),m_removedPagesCounterBuffer.GetUAV() };
-    computeContext.SetDynamicDescriptors(TiledComputerParams::Buffers, 0, 6, handles);
-    computeContext.SetConstants(TiledComputerParams::PageCountInfo, (U32)m_pages.size(), 0, 0, 0);
-    computeContext.Dispatch3D(m_pages.size(), 1, 1, 1024, 1, 1);
-    computeContext.CopyBuffer(m_alivePagesCounterReadBackBuffer, m_alivePagesCounterBuffer);
-    computeContext.CopyBuffer(m_removedPagesCounterReadBackBuffer, m_removedPagesCounterBuffer);
-    computeContext.CopyBuffer(m_alivePagesReadBackBuffer, m_alivePagesBuffer);
-    computeContext.CopyBuffer(m_removedPagesReadBackBuffer, m_removedPagesBuffer);
+    ASSERT(m_recordedFeedback == kFeedbackReadbackCount, "TiledTexture::EndFrame was not called after the last EndFeedback");
+    gfxContext.TransitionResource(m_feedbackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    gfxContext.TransitionResource(m_feedbackDepth, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+    gfxContext.ClearColor(m_feedbackBuffer);
+    gfxContext.ClearDepth(m_feedbackDepth);
+    gfxContext.SetRenderTarget(m_feedbackBuffer.GetRTV(), m_feedbackDepth.GetDSV());
+    gfxContext.SetViewportAndScissor(0, 0, m_feedbackBuffer.GetWidth(), m_feedbackViewHeight);
 }
 
+bool TiledTexture::BeginPrefetchFeedback(GraphicsContext& gfxContext)
+{
+    if (!EnableTilePrefetch)
+        return false;
+    gfxContext.SetViewportAndScissor(0, m_feedbackViewHeight, m_feedbackBuffer.GetWidth(), m_feedbackViewHeight);
+    return true;
+}
 
-void TiledTexture::AddPages(GraphicsContext& gContext)
+void TiledTexture::EndFeedback(GraphicsContext& gfxContext)
 {
-    int active_page_count = *static_cast<int*>(m_alivePagesCounterReadBackBuffer.Map());
-    m_alivePagesCounterReadBackBuffer.Unmap();
-    if (active_page_count == 0)
+    for (U32 i = 0; i < kFeedbackReadbackCount; i++)
+    {
+        FeedbackReadback& feedback = m_feedback[i];
+        if (feedback.state != kFeedbackFree)
+            continue;
+        gfxContext.TransitionResource(m_feedbackBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+        gfxContext.GetCommandList()->CopyTextureRegion(
+            &CD3DX12_TEXTURE_COPY_LOCATION(feedback.texels.GetResource(), m_feedbackFootprint), 0, 0, 0,
+            &CD3DX12_TEXTURE_COPY_LOCATION(m_feedbackBuffer.GetResource(), 0), nullptr);
+        feedback.state = kFeedbackRecorded;
+        feedback.frameIndex = m_frameIndex;
+        m_recordedFeedback = i;
+        break;
+    }
+}
+
+void TiledTexture::EndFrame(uint64_t fenceValue)
+{
+    if (m_recordedFeedback == kFeedbackReadbackCount)
         return;
-    std::vector<U32> active_pages;
-    active_pages.resize(active_page_count);
-    memcpy(active_pages.data(), m_alivePagesReadBackBuffer.Map(), active_page_count * sizeof(int));
-    m_alivePagesReadBackBuffer.Unmap();
-    std::vector<D3D12_TILED_RESOURCE_COORDINATE> startCoordinates;
-    std::vector<D3D12_TILE_REGION_SIZE> regionSizes;
-    std::vector<U32> heapRangeStartOffsets;
-    std::vector<D3D12_TILE_RANGE_FLAGS> rangeFlags;
-    std::vector<U32> rangeTileCounts;
-
-    // for each (U32 i in active_pages)
+    FeedbackReadback& feedback = m_feedback[m_recordedFeedback];
+    feedback.state = kFeedbackInFlight;
+    feedback.fenceValue = fenceValue;
+    m_recordedFeedback = kFeedbackReadbackCount;
+}
+
 
+bool TiledTexture::RequestPages()
+{
+    // Take the newest feedback the GPU has finished; older finished ones are superseded and freed with it.
+    FeedbackReadback* newest = nullptr;
+    for (FeedbackReadback& feedback : m_feedback)
+    {
+        if (feedback.state != kFeedbackInFlight || !g_CommandManager.IsFenceComplete(feedback.fenceValue))
+            continue;
+        if (newest != nullptr && newest->frameIndex > feedback.frameIndex)
+        {
+            feedback.state = kFeedbackFree;
+            continue;
+        }
+        if (newest != nullptr)
+            newest->state = kFeedbackFree;
+        newest = &feedback;
+    }
+    if (newest == nullptr)
+    {
+        m_residency.SkipFrame();
+        return false;
+    }
+    newest->state = kFeedbackFree;
+    const uint64_t feedbackFrame = newest->frameIndex;
+    m_uploadStats.feedbackLatencyFrames = (U32)(m_frameIndex - feedbackFrame);
+
+    const int64_t aggregateStart = SystemTime::GetCurrentTick();
+    const U32 rowPitch = m_feedbackFootprint.Footprint.RowPitch / sizeof(U32);
+    const U32* texels = static_cast<const U32*>(newest->texels.Map());
+    const U32* predictedTexels = texels + size_t(m_feedbackViewHeight) * rowPitch;
+    m_feedbackAggregator.Clear();
+    m_feedbackAggregator.Accumulate(texels, m_feedbackBuffer.GetWidth(), m_feedbackViewHeight, rowPitch, true);
+    m_prefetchAggregator.Clear();
+    m_prefetchAggregator.Accumulate(predictedTexels, m_feedbackBuffer.GetWidth(), m_feedbackViewHeight, rowPitch, true);
+    if (CaptureTileFeedback)
+    {
+        SaveTileFeedbackCapture(L"TileFeedback.bin", texels, m_feedbackBuffer.GetWidth(), m_feedbackViewHeight, rowPitch,
+            m_feedbackAggregator.GetMipPagesX(), m_feedbackAggregator.GetMipPagesY());
+        CaptureTileFeedback = false;
+    }
+    newest->texels.Unmap();
+    m_feedbackRequests.clear();
+    m_feedbackAggregator.BuildRequests(m_feedbackRequests);
+    m_prefetchRequests.clear();
+    m_prefetchAggregator.BuildRequests(m_prefetchRequests);
+    m_uploadStats.feedbackAggregateMs = (float)(SystemTime::TimeBetweenTicks(aggregateStart, SystemTime::GetCurrentTick()) * 1000.0);
+    m_uploadStats.feedbackPages = m_feedbackAggregator.GetSeenPageCount();
+    m_uploadStats.feedbackRequests = 0;
+    m_uploadStats.prefetchRequests = 0;
+
+    m_tileLoads.clear();
+    m_cancelledPages.clear();
+    const U32 prefetchBudget = EnableTilePrefetch ? static_cast<U32>(TilePrefetchRequestsPerFrame) : 0;
+    m_residency.SetEvictionDelay(static_cast<U32>(TileEvictionDelay));
+    m_residency.Update(m_frameIndex, m_feedbackRequests, m_prefetchRequests, static_cast<U32>(TileRequestsPerFrame), prefetchBudget,
+        m_tileLoads, m_cancelledPages);
+
+    // Cancelled prefetches a worker already started still arrive, and are placed like any other tile.
+    if (!m_cancelledPages.empty())
+    {
+        std::sort(m_cancelledPages.begin(), m_cancelledPages.end());
+        m_streamer.Cancel([this](const TileRequest& request)
+        {
+            return request.prefetch && std::binary_search(m_cancelledPages.begin(), m_cancelledPages.end(), request.page);
+        });
+    }
+
+    const int64_t requestTick = SystemTime::GetCurrentTick();
+    for (const TileLoad& load : m_tileLoads)
+    {
+        const PageInfo& page = m_pages[load.page];
+        TileRequest request;
+        request.page = load.page;
+        request.priority = load.priority;
+        request.offsetX = page.start_corordinate.X * m_TileShape.WidthInTexels;
+        request.offsetY = page.start_corordinate.Y * m_TileShape.HeightInTexels;
+        request.mipLevel = page.mipLevel;
+        request.requestTick = requestTick;
+        request.feedbackFrame = feedbackFrame;
+        request.prefetch = load.prefetch;
+        if (m_streamer.Request(request))
+            (load.prefetch ? m_uploadStats.prefetchRequests : m_uploadStats.feedbackRequests)++;
+    }
+    return true;
+}
+
+void TiledTexture::AddPages()
+{
+    RetireUploads();
+    m_uploadStats.tilesLastFrame = 0;
+    m_uploadStats.residentLatencyFrames = 0;
+    m_uploadStats.mappings = {};
+
+    // The copy queue last read this segment kUploadSegmentCount frames ago, so this rarely waits.
+    m_uploadSegment = (m_uploadSegment + 1) % kUploadSegmentCount;
+    g_CommandManager.WaitForFence(m_uploadFences[m_uploadSegment]);
+
+    std::vector<LoadedTile> loaded_tiles;
+    const U32 budget = std::min<U32>(static_cast<U32>(TileUploadsPerFrame), kMaxUploadsPerFrame);
+    if (m_streamer.Collect(budget, loaded_tiles) == 0)
+        return;
     const U32 tile_width = m_TileShape.WidthInTexels;
     const U32 tile_height = m_TileShape.HeightInTexels;
-    for (int i : active_pages)
+    const D3D12_RESOURCE_DESC Desc = m_pResource->GetDesc();
+    const U32 segmentStart = m_uploadSegment * m_uploadSegmentSize;
+    U32 segmentOffset = 0;
+    UploadBatch batch;
+    CommandContext& copyContext = CommandContext::BeginCopy();
+    for (LoadedTile& tile : loaded_tiles)
     {
-        PageInfo& page = m_pages[i];
-        if (page.m_mem)
+        const U32 i = tile.request.page;
+        const PageInfo& page = m_pages[i];
+
+        // Every slot may hold a page used this frame; the page is requested again while it stays visible.
+        m_tileMappings.clear();
+        if (!m_residency.Place(i, m_frameIndex, m_tileMappings))
             continue;
-        const U32 width = m_resTexWidth >> page.mipLevel;
-        const U32 height = m_resTexHeight >> page.mipLevel;
-        std::vector<UINT8> data = GenerateTextureData(page.start_corordinate.X * tile_width, page.start_corordinate.Y * tile_height, tile_width, tile_height, page.mipLevel);
-        page.LoadData(std::move(data),*m_cpu_pages_allocator);
-        startCoordinates.push_back(page.start_corordinate);
-        regionSizes.push_back(page.regionSize);
-        heapRangeStartOffsets.push_back(i);
-        rangeTileCounts.push_back(1);
-        rangeFlags.push_back(D3D12_TILE_RANGE_FLAG_NONE);
+
+        // An evicted page's slot is remapped below, so the page must read as unmapped again.
+        for (const TileMapping& mapping : m_tileMappings)
+        {
+            const PageInfo& mapped = m_pages[mapping.page];
+            if (mapped.is_packed)
+                m_mappingBatch.MapRegion(mapped.start_corordinate, mapped.regionSize, 0);
+            else if (mapping.mapped)
+                m_mappingBatch.Map(mapped.start_corordinate, m_packedTileCount + mapping.slot);
+            else
+                m_mappingBatch.Unmap(mapped.start_corordinate);
+        }
+
+        // Every tile of the frame is staged in the same segment and copied by a single command list.  The packed
+        // mips take the footprints GetCopyableFootprints lays out below, m_packedBytes in all.
+        const U32 stagingOffset = segmentStart + segmentOffset;
+        const U32 stagedBytes = page.is_packed ? m_packedBytes : (U32)tile.data.size();
+        ASSERT(tile.data.size() == stagedBytes);
+        ASSERT(segmentOffset + stagedBytes <= m_uploadSegmentSize);
+        memcpy(m_uploadData + stagingOffset, tile.data.data(), stagedBytes);
+        segmentOffset += (U32)Math::AlignUp(stagedBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        batch.requestTicks.push_back(tile.request.requestTick);
+        m_uploadStats.residentLatencyFrames = std::max(m_uploadStats.residentLatencyFrames, (U32)(m_frameIndex - tile.request.feedbackFrame));
+
         if (page.is_packed)
         {
-            D3D12_RESOURCE_DESC         Desc = m_pResource->GetDesc();
             D3D12_TEXTURE_COPY_LOCATION Dst = {};
             Dst.pResource = m_pResource.Get();
             Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
             D3D12_TEXTURE_COPY_LOCATION Src = {};
-            Src.pResource = page.m_mem->Buffer.GetResource();
+            Src.pResource = m_uploadBuffer.GetResource();
             std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layout(m_packedMipInfo.NumPackedMips);
-            g_Device->GetCopyableFootprints(&Desc, page.start_corordinate.Subresource, m_packedMipInfo.NumPackedMips, 0, &layout[0], nullptr, nullptr, nullptr);
+            g_Device->GetCopyableFootprints(&Desc, page.start_corordinate.Subresource, m_packedMipInfo.NumPackedMips, stagingOffset, &layout[0], nullptr, nullptr, nullptr);
 
             for (U32 sub_index = 0; sub_index < m_packedMipInfo.NumPackedMips; sub_index++)
             {
                 Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
                 Src.PlacedFootprint = layout[sub_index];
                 Dst.SubresourceIndex = sub_index + page.start_corordinate.Subresource;
-                gContext.GetCommandList()->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
+                copyContext.GetCommandList()->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
             }
         }
         else
         {
-            D3D12_RESOURCE_DESC         Desc = m_pResource->GetDesc();
             D3D12_TEXTURE_COPY_LOCATION Dst = {};
             Dst.pResource = m_pResource.Get();
             Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
             Dst.SubresourceIndex = page.start_corordinate.Subresource;
             D3D12_TEXTURE_COPY_LOCATION Src = {};
-            Src.pResource = page.m_mem->Buffer.GetResource();
+            Src.pResource = m_uploadBuffer.GetResource();
             Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-            Src.PlacedFootprint = D3D12_PLACED_SUBRESOURCE_FOOTPRINT{ 0,
+            Src.PlacedFootprint = D3D12_PLACED_SUBRESOURCE_FOOTPRINT{ stagingOffset,
                                     { Desc.Format,
-                                        tile_width, tile_height, 1, tile_width *m_resTexPixelInBytes } };//BitsPerPixels
-            gContext.GetCommandList()->CopyTextureRegion(&Dst, page.start_corordinate.X * tile_width, page.start_corordinate.Y * tile_height, 0, &Src, NULL);
+                                        tile_width, tile_height, 1, m_tileRowPitch } };
+            copyContext.GetCommandList()->CopyTextureRegion(&Dst, page.start_corordinate.X * tile_width, page.start_corordinate.Y * tile_height, 0, &Src, NULL);
         }
     }
-    if (regionSizes.size())
-    {
-        Graphics::g_CommandManager.GetCommandQueue()->UpdateTileMappings(
-            m_pResource.Get(),
-            (U32)startCoordinates.size(),
-            startCoordinates.data(),
-            regionSizes.data(),
-            m_page_heaps.Get(),
-            (U32)regionSizes.size(),
-            rangeFlags.data(),
-            heapRangeStartOffsets.data(),
-            rangeTileCounts.data(),
-            D3D12_TILE_MAPPING_FLAG_NONE);
-    }
+
+    // The copy queue first waits for the frames already submitted, which may still sample the evicted tiles.  The
+    // mappings then change ahead of the copies that write through them, and the graphics queue waits for the copies
+    // before anything submitted after this frame's tiles samples them.
+    CommandQueue& copyQueue = g_CommandManager.GetCopyQueue();
+    copyQueue.StallForProducer(g_CommandManager.GetGraphicsQueue());
+    m_mappingBatch.Flush(copyQueue.GetCommandQueue(), m_pResource.Get(), m_page_heaps.Get());
+    m_uploadStats.mappings = m_mappingBatch.GetStats();
+    const uint64_t fenceValue = copyContext.Finish();
+    g_CommandManager.GetGraphicsQueue().StallForFence(fenceValue);
+
+    m_uploadFences[m_uploadSegment] = fenceValue;
+    m_uploadStats.tilesLastFrame = (U32)batch.requestTicks.size();
+    m_uploadStats.tilesUploaded += batch.requestTicks.size();
+    batch.fenceValue = fenceValue;
+    m_uploadBatches.push_back(std::move(batch));
 }
 
-void TiledTexture::RemovePages()
+void TiledTexture::RetireUploads()
 {
-    int removed_page_count = *static_cast<int*>(m_removedPagesCounterReadBackBuffer.Map());
-    m_removedPagesCounterReadBackBuffer.Unmap();
-    if (removed_page_count == 0)
-        return;
-    std::vector<U32> removed_pages;
-    removed_pages.resize(removed_page_count);
-    memcpy(removed_pages.data(), m_removedPagesReadBackBuffer.Map(), removed_page_count * sizeof(int));
-    m_removedPagesReadBackBuffer.Unmap();
-    std::vector<D3D12_TILED_RESOURCE_COORDINATE> startCoordinates;
-    std::vector<D3D12_TILE_REGION_SIZE> regionSizes;
-    std::vector<U32> heapRangeStartOffsets;
-    std::vector<D3D12_TILE_RANGE_FLAGS> rangeFlags;
-    std::vector<U32> rangeTileCounts;
-    for (int i : removed_pages)
+    // Completion is only noticed here, so the latencies include up to a frame of polling delay.
+    const int64_t now = SystemTime::GetCurrentTick();
+    while (!m_uploadBatches.empty() && g_CommandManager.IsFenceComplete(m_uploadBatches.front().fenceValue))
     {
-        PageInfo& page = m_pages[i];
-        if (page.m_mem==nullptr)
-            continue;
-        page.m_mem->Destroy();
-        page.m_mem = nullptr;
-        
-        startCoordinates.push_back(page.start_corordinate);
-        regionSizes.push_back(page.regionSize);
-        heapRangeStartOffsets.push_back(i);
-        rangeTileCounts.push_back(1);
-        rangeFlags.push_back(D3D12_TILE_RANGE_FLAG_NULL);
+        for (int64_t requestTick : m_uploadBatches.front().requestTicks)
+        {
+            const double milliseconds = SystemTime::TimeBetweenTicks(requestTick, now) * 1000.0;
+            U32 bucket = 0;
+            while (bucket + 1 < TileUploadStats::kLatencyBuckets && milliseconds >= double(1u << bucket))
+                bucket++;
+            m_uploadStats.latencyHistogram[bucket]++;
+        }
+        m_uploadBatches.pop_front();
     }
-    if(regionSizes.size())
-        Graphics::g_CommandManager.GetCommandQueue()->UpdateTileMappings(
-        m_pResource.Get(),
-        (U32)startCoordinates.size(),
-        startCoordinates.data(),
-        regionSizes.data(),
-        m_page_heaps.Get(),
-        (U32)regionSizes.size(),
-        rangeFlags.data(),
-        heapRangeStartOffsets.data(),
-        rangeTileCounts.data(),
-        D3D12_TILE_MAPPING_FLAG_NONE);
 }
 
 void TiledTexture::Update(GraphicsContext& gfxContext)
 {
     ScopedTimer _prof4(L"Pages Update", gfxContext);
-    UpdateVisibilityBuffer(gfxContext.GetComputeContext());
+    const bool hasFeedback = RequestPages();
+    AddPages();
+
+    // The trace holds what RequestPages acted on, for replaying the residency policy offline.
+    if (RecordTileTrace && !m_trace.IsOpen())
     {
-        gfxContext.TransitionResource(*this, D3D12_RESOURCE_STATE_COPY_DEST, true);
-        AddPages(gfxContext);
-        RemovePages();
-        gfxContext.TransitionResource(*this, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        TileTraceHeader header = {};
+        header.pageCount = m_residency.GetPageCount();
+        header.slotCount = m_residency.GetPool().GetCapacity();
+        header.requestBudget = static_cast<U32>(TileRequestsPerFrame);
+        header.prefetchBudget = EnableTilePrefetch ? static_cast<U32>(TilePrefetchRequestsPerFrame) : 0;
+        header.uploadBudget = std::min<U32>(static_cast<U32>(TileUploadsPerFrame), kMaxUploadsPerFrame);
+        header.evictionDelay = static_cast<U32>(TileEvictionDelay);
+        if (!m_trace.Open(L"TileTrace.bin", header))
+            RecordTileTrace = false;
     }
+    else if (!RecordTileTrace && m_trace.IsOpen())
+    {
+        m_trace.Close();
+    }
+    if (m_trace.IsOpen())
+    {
+        if (hasFeedback)
+            m_trace.WriteFrame(true, m_feedbackRequests, m_prefetchRequests);
+        else
+            m_trace.WriteFrame(false, std::vector<TileFeedbackRequest>(), std::vector<TileFeedbackRequest>());
+    }
+    m_frameIndex++;
 }
 
 std::vector<UINT8> TiledTexture::GenerateTextureData(U32 offsetX, U32 offsetY, U32 W, U32 H, U32 currentMip)
 {
-    if(m_use_test_texture)
-        return GenerateTextureTestData(m_resTexWidth,m_resTexHeight,m_resTexPixelInBytes,offsetX, offsetY, W, H, currentMip, currentMip < m_packedMipInfo.NumStandardMips? 1: m_packedMipInfo.NumPackedMips);
-    else
-        return GenerateTextureFromImage(m_folder_path, offsetX, offsetY, W, H, currentMip, m_resTexPixelInBytes, currentMip < m_packedMipInfo.NumStandardMips ? 1 : m_packedMipInfo.NumPackedMips);
+    std::vector<UINT8> data;
+    if (currentMip < m_packedMipInfo.NumStandardMips)
+    {
+        if (m_use_test_texture)
+            return GenerateTextureTestData(m_resTexWidth, m_resTexHeight, m_blockBytes, offsetX, offsetY, W, H, currentMip, 1);
+        if (!m_archive.ReadTile(currentMip, offsetX / W, offsetY / H, data))
+            data.assign(m_tileRowPitch * (H / m_blockSize), 0);
+        return data;
+    }
+
+    // The packed mips are laid out the way AddPages copies them, one footprint per mip.  A footprint's rows are rows
+    // of blocks for block compressed formats.
+    data.assign(m_packedBytes, 0);
+    std::vector<UINT8> mipData;
+    for (U32 i = 0; i < m_packedMipInfo.NumPackedMips; i++)
+    {
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = m_packedFootprints[i];
+        const U32 rowBytes = (U32)m_packedRowBytes[i];
+        mipData.clear();
+        if (m_use_test_texture)
+            mipData = GenerateTextureTestData(m_resTexWidth, m_resTexHeight, m_blockBytes, 0, 0, layout.Footprint.Width, layout.Footprint.Height, currentMip + i, 1);
+        else if (!m_archive.ReadTile(currentMip + i, 0, 0, mipData))
+            continue;
+        if (mipData.size() < size_t(rowBytes) * m_packedRowCounts[i])
+            continue;
+        for (U32 row = 0; row < m_packedRowCounts[i]; row++)
+            memcpy(&data[layout.Offset + row * layout.Footprint.RowPitch], &mipData[row * rowBytes], rowBytes);
+    }
+    return data;
 }
 
@@ -3,27 +3,54 @@
 
 #pragma  region HEADER
 #include "pch.h"
-#include "GpuBuffer.h"
+#include "ColorBuffer.h"
+#include "DepthBuffer.h"
 #include "ReadbackBuffer.h"
+#include "DynamicUploadBuffer.h"
 #include "PageInfo.h"
-#include "PipelineState.h"
-#include "RootSignature.h"
+#include "TileArchive.h"
+#include "TileFeedback.h"
+#include "TileMappingBatch.h"
+#include "TileResidency.h"
+#include "TileStreamer.h"
+#include "TileTrace.h"
 #include "Utility.h"
+#include <deque>
 #pragma region 
 
 
 
-enum TiledComputerParams :unsigned char
+struct TileUploadStats
 {
-    PageCountInfo,
-    Buffers,
-    NumComputeParams,
+    static const U32 kLatencyBuckets = 10;
+
+    U32 tilesLastFrame;
+    uint64_t tilesUploaded;
+    // Time from a tile's request until its copy completed on the GPU.  Bucket i counts the tiles that took less
+    // than 2^i ms; the last bucket counts everything slower.
+    U32 latencyHistogram[kLatencyBuckets];
+    // Age in frames of the feedback consumed this frame, and the largest number of frames between a page showing
+    // up in feedback and its tile being submitted, among this frame's uploads.
+    U32 feedbackLatencyFrames;
+    U32 residentLatencyFrames;
+    // Pages the consumed feedback saw, how many of them were requested, and the CPU time spent aggregating it.
+    U32 feedbackPages;
+    U32 feedbackRequests;
+    float feedbackAggregateMs;
+    // This frame's page table changes, batched into a single UpdateTileMappings call.
+    TileMappingStats mappings;
+    // Pages the predicted view's feedback queued this frame.  Hit rates and cancellations since Create are in the
+    // residency stats.
+    U32 prefetchRequests;
 };
 
 class TiledTexture : public GpuResource
 {
 public:
-    void Create(std::wstring folder, U32 Width, U32 Height, DXGI_FORMAT Format);
+    // Physical memory is a pool of PoolSizeInBytes worth of 64 KB tiles, plus the packed mips, however large the
+    // virtual texture is.  Pages beyond the pool evict the least recently seen ones.  Tiles are streamed from the
+    // tile archive at archivePath (see Tools/TileBaker), or generated as a checkerboard when it is empty.
+    void Create(const std::wstring& archivePath, U32 Width, U32 Height, DXGI_FORMAT Format, U32 PoolSizeInBytes = 64 * 1024 * 1024);
     void Update(GraphicsContext& gfxContext);
     void LevelUp()
     {
@@ -71,46 +98,71 @@ public:
         return static_cast<UINT>(m_resTexHeight);
     }
 
-    void UpdateVisibilityBuffer(ComputeContext& context);
+    inline const TilePool& GetTilePool() const
+    {
+        return m_residency.GetPool();
+    }
+
+    inline const TileResidency& GetResidency() const
+    {
+        return m_residency;
+    }
+
+    inline const TileStreamer& GetStreamer() const
+    {
+        return m_streamer;
+    }
+
+    inline const TileUploadStats& GetUploadStats() const
+    {
+        return m_uploadStats;
+    }
+
+    // The feedback pass renders the scene into a low resolution target of this format, writing the mip and page
+    // each pixel samples (see TILE_FEEDBACK_* in hlsl.hpp).  The target holds two views: the current camera, whose
+    // pages are requested on demand, and a camera extrapolated ahead of it, whose pages are prefetched at a lower
+    // priority.
+    static const DXGI_FORMAT kFeedbackFormat = DXGI_FORMAT_R32_UINT;
+    static const DXGI_FORMAT kFeedbackDepthFormat = DXGI_FORMAT_D32_FLOAT;
+
+    // Clears the feedback target and binds the current view's half with its own depth buffer and viewport.
+    void BeginFeedback(GraphicsContext& gfxContext);
+    // Binds the predicted view's half.  Returns false, binding nothing, when prefetching is off.
+    bool BeginPrefetchFeedback(GraphicsContext& gfxContext);
+    // Copies the feedback into a free readback; the frame's feedback is dropped when every readback is in flight.
+    void EndFeedback(GraphicsContext& gfxContext);
+
+    // Call with the fence of the context that recorded the feedback once it is finished; it tags the readback.
+    void EndFrame(uint64_t fenceValue);
+
     virtual void Destroy() override
     {
+        m_streamer.Stop();
         GpuResource::Destroy();
         m_hCpuDescriptorHandle.ptr = 0;
-        m_removedPagesReadBackBuffer.Destroy();
-        m_visibilityBuffer.Destroy();
-        m_prevVisBuffer.Destroy();
-        m_alivePagesBuffer.Destroy();
-        m_removedPagesBuffer.Destroy();
-        m_alivePagesCounterBuffer.Destroy();
-        m_removedPagesCounterBuffer.Destroy();
-        m_alivePagesReadBackBuffer.Destroy();
-        m_alivePagesCounterReadBackBuffer.Destroy();
-        m_removedPagesCounterReadBackBuffer.Destroy();
-        if(m_page_heaps)
-            m_page_heaps->Release();
-        for (PageInfo& page : m_pages)
-        {
-            if (page.m_mem)
-                page.m_mem->Destroy();
-        }
+        m_feedbackBuffer.Destroy();
+        m_feedbackDepth.Destroy();
+        for (FeedbackReadback& feedback : m_feedback)
+            feedback.texels.Destroy();
+        m_uploadBuffer.Destroy();
+        m_uploadBatches.clear();
+        m_page_heaps.Reset();
         m_pages.clear();
+        m_archive.Close();
     }
 
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV() const { return m_hCpuDescriptorHandle; }
 
-    const D3D12_CPU_DESCRIPTOR_HANDLE& GetVisibilityUAV() const { return m_visibilityBuffer.GetUAV(); }
-
-    const D3D12_CPU_DESCRIPTOR_HANDLE& GetVisibilitySRV()  const { return m_visibilityBuffer.GetSRV(); }
-
-    const D3D12_CPU_DESCRIPTOR_HANDLE& GetPrevVisibUAV() const { return m_prevVisBuffer.GetUAV(); }
-
-    const D3D12_CPU_DESCRIPTOR_HANDLE& GetPrevVisibSRV()  const { return m_prevVisBuffer.GetSRV(); }
-
     bool operator!() { return m_hCpuDescriptorHandle.ptr == 0; }
 
 protected:
-    void RemovePages();
-    void AddPages(GraphicsContext& gContext);
+    // Aggregates the newest feedback the GPU finished and queues the loads m_residency asks for, cancelling the
+    // prefetches it drops.  Returns false when no feedback had finished.
+    bool RequestPages();
+    // Uploads and maps the tiles the streamer finished, within the per-frame upload budget.
+    void AddPages();
+    // Adds the upload batches the GPU finished to the latency histogram.
+    void RetireUploads();
 private:
 
     struct MipInfo
@@ -122,28 +174,83 @@ private:
         D3D12_TILE_REGION_SIZE regionSize;
     };
 
+    // Decoded tiles waiting for upload; bounds the memory the streaming workers can run ahead with.
+    static const U32 kStagedTileCount = 256;
+    // Each frame's tiles go to one segment of the upload ring, so a segment is reused kUploadSegmentCount frames later.
+    static const U32 kUploadSegmentCount = 3;
+    static const U32 kMaxUploadsPerFrame = 128;
+
+    // Feedback is read back through a ring, so the CPU reads the newest finished copy instead of waiting for the GPU.
+    static const U32 kFeedbackReadbackCount = 3;
+
+    enum FeedbackState { kFeedbackFree, kFeedbackRecorded, kFeedbackInFlight };
+
+    struct FeedbackReadback
+    {
+        ReadbackBuffer texels;
+        FeedbackState state;
+        uint64_t fenceValue;
+        uint64_t frameIndex;
+    };
+
+    struct UploadBatch
+    {
+        uint64_t fenceValue;
+        std::vector<int64_t> requestTicks;
+    };
+
     std::vector<UINT8> GenerateTextureData(UINT offsetX, UINT offsetY, UINT width, UINT height, UINT mip_level);
     std::vector<PageInfo> m_pages;
-    std::wstring m_folder_path;
+    TileArchive m_archive;
     bool m_use_test_texture;
-    U32 m_resTexPixelInBytes;
+    // Texels on a side of the format's smallest stored unit (4 for block compressed formats, else 1), its size in
+    // bytes, and the upload row pitch of a standard tile.
+    U32 m_blockSize;
+    U32 m_blockBytes;
+    U32 m_tileRowPitch;
     U32 m_resTexWidth, m_resTexHeight;
     U32 m_activeMip,m_MipLevels;
     Microsoft::WRL::ComPtr<ID3D12Heap> m_page_heaps;
     D3D12_PACKED_MIP_INFO m_packedMipInfo;
+    // Upload layout of the packed mips, relative to the start of the packed page's data.
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> m_packedFootprints;
+    std::vector<UINT> m_packedRowCounts;
+    std::vector<UINT64> m_packedRowBytes;
+    U32 m_packedBytes;
     D3D12_TILE_SHAPE m_TileShape;
     D3D12_CPU_DESCRIPTOR_HANDLE m_hCpuDescriptorHandle;
-    StructuredBuffer m_visibilityBuffer;
-    StructuredBuffer m_prevVisBuffer;
-    StructuredBuffer m_alivePagesBuffer;
-    StructuredBuffer m_removedPagesBuffer;
-    ByteAddressBuffer m_alivePagesCounterBuffer;
-    ByteAddressBuffer m_removedPagesCounterBuffer;
-    ReadbackBuffer m_alivePagesReadBackBuffer;
-    ReadbackBuffer m_removedPagesReadBackBuffer;
-    ReadbackBuffer m_alivePagesCounterReadBackBuffer;
-    ReadbackBuffer m_removedPagesCounterReadBackBuffer;
-    ComputePSO m_computePSO;
-    RootSignature m_rootSig;
-    std::unique_ptr<PageAllocator> m_cpu_pages_allocator;
+    // The current view's feedback fills the top m_feedbackViewHeight rows, the predicted view's the rows below.
+    ColorBuffer m_feedbackBuffer;
+    DepthBuffer m_feedbackDepth;
+    U32 m_feedbackViewHeight;
+    // Row layout of the feedback in each readback.
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT m_feedbackFootprint;
+    FeedbackReadback m_feedback[kFeedbackReadbackCount];
+    // Readback written by this frame's EndFeedback, tagged by EndFrame; kFeedbackReadbackCount if every one was busy.
+    U32 m_recordedFeedback;
+    TileFeedbackAggregator m_feedbackAggregator;
+    std::vector<TileFeedbackRequest> m_feedbackRequests;
+    TileFeedbackAggregator m_prefetchAggregator;
+    std::vector<TileFeedbackRequest> m_prefetchRequests;
+    std::vector<TileLoad> m_tileLoads;
+    // Sorted, so the streamer can look pages up while it cancels.
+    std::vector<U32> m_cancelledPages;
+    std::vector<TileMapping> m_tileMappings;
+    TileMappingBatch m_mappingBatch;
+    DynamicUploadBuffer m_uploadBuffer;
+    UINT8* m_uploadData;
+    U32 m_uploadSegmentSize;
+    U32 m_uploadSegment;
+    uint64_t m_uploadFences[kUploadSegmentCount];
+    std::deque<UploadBatch> m_uploadBatches;
+    TileUploadStats m_uploadStats;
+    // Heap tiles [0, m_packedTileCount) permanently hold the packed mips; the residency's pool hands out the tiles
+    // after them.
+    TileResidency m_residency;
+    U32 m_packedTileCount;
+    uint64_t m_frameIndex;
+    // Open while RecordTileTrace is set.
+    TileTraceRecorder m_trace;
+    // Declared last so its workers are joined before the members they read are destroyed.
+    TileStreamer m_streamer;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "VoxelCache.h"
+#include <fstream>
+
+namespace
+{
+    std::string GetFileName(const std::string& path)
+    {
+        const size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? path : path.substr(separator + 1);
+    }
+}
+
+bool VoxelCache::Load(const std::wstring& path)
+{
+    Close();
+
+    std::ifstream file(path, std::ios::binary);
+    VoxelCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kVoxelCacheMagic)
+        return false;
+    if (header.version != kVoxelCacheVersion)
+    {
+        Utility::Printf(L"%s is not a version %u voxel cache\n", path.c_str(), kVoxelCacheVersion);
+        return false;
+    }
+
+    std::vector<char> names(size_t(header.modelCount) * kVoxelCacheNameLength);
+    m_levels.resize(header.levelCount);
+    m_bricks.resize(header.brickCount);
+    if (!file.read(names.data(), names.size()) ||
+        !file.read(reinterpret_cast<char*>(m_levels.data()), m_levels.size() * sizeof(VoxelCacheLevel)) ||
+        !file.read(reinterpret_cast<char*>(m_bricks.data()), m_bricks.size() * sizeof(VoxelCacheBrick)))
+    {
+        Utility::Printf(L"Voxel cache %s is truncated\n", path.c_str());
+        Close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.modelCount; i++)
+    {
+        const char* name = &names[size_t(i) * kVoxelCacheNameLength];
+        m_modelNames.emplace_back(name, strnlen(name, kVoxelCacheNameLength));
+    }
+
+    m_brickIndex.resize(header.levelCount);
+    for (uint32_t level = 0; level < header.levelCount; level++)
+    {
+        const VoxelCacheLevel& info = m_levels[level];
+        if (uint64_t(info.firstBrick) + info.brickCount > header.brickCount)
+        {
+            Utility::Printf(L"Voxel cache %s is corrupt\n", path.c_str());
+            Close();
+            return false;
+        }
+        m_brickIndex[level].reserve(info.brickCount);
+        for (uint32_t i = info.firstBrick; i < info.firstBrick + info.brickCount; i++)
+            m_brickIndex[level].emplace(PackVoxelBrick(m_bricks[i].x, m_bricks[i].y, m_bricks[i].z), i);
+    }
+    m_header = header;
+    return true;
+}
+
+void VoxelCache::Close()
+{
+    m_header = {};
+    m_modelNames.clear();
+    m_levels.clear();
+    m_bricks.clear();
+    m_brickIndex.clear();
+}
+
+bool VoxelCache::Save(const std::wstring& path, const VoxelCacheHeader& header, const std::vector<std::string>& modelNames,
+    const std::vector<VoxelCacheLevel>& levels, const std::vector<VoxelCacheBrick>& bricks)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    VoxelCacheHeader written = header;
+    written.magic = kVoxelCacheMagic;
+    written.version = kVoxelCacheVersion;
+    written.modelCount = static_cast<uint32_t>(modelNames.size());
+    written.levelCount = static_cast<uint32_t>(levels.size());
+    written.brickCount = static_cast<uint32_t>(bricks.size());
+    file.write(reinterpret_cast<const char*>(&written), sizeof(written));
+
+    for (const std::string& name : modelNames)
+    {
+        char buffer[kVoxelCacheNameLength] = {};
+        strncpy_s(buffer, name.c_str(), _TRUNCATE);
+        file.write(buffer, sizeof(buffer));
+    }
+    file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(VoxelCacheLevel));
+    file.write(reinterpret_cast<const char*>(bricks.data()), bricks.size() * sizeof(VoxelCacheBrick));
+    return file.good();
+}
+
+const VoxelCacheBrick* VoxelCache::FindBrick(uint32_t level, int32_t x, int32_t y, int32_t z) const
+{
+    const std::unordered_map<uint64_t, uint32_t>& index = m_brickIndex[level];
+    const auto found = index.find(PackVoxelBrick(x, y, z));
+    return found != index.end() ? &m_bricks[found->second] : nullptr;
+}
+
+bool VoxelCache::IsVoxelSet(uint32_t level, int32_t x, int32_t y, int32_t z) const
+{
+    const VoxelCacheBrick* brick = FindBrick(level, GetVoxelBrick(x), GetVoxelBrick(y), GetVoxelBrick(z));
+    if (brick == nullptr)
+        return false;
+    const uint32_t bit = GetVoxelBrickBit(x - brick->x * kVoxelBrickSize, y - brick->y * kVoxelBrickSize, z - brick->z * kVoxelBrickSize);
+    return (brick->bits[bit / 32] & (1u << (bit % 32))) != 0;
+}
+
+bool VoxelCache::HasModel(const std::string& filename) const
+{
+    const std::string name = GetFileName(filename);
+    for (const std::string& model : m_modelNames)
+    {
+        if (_stricmp(GetFileName(model).c_str(), name.c_str()) == 0)
+            return true;
+    }
+    return false;
+}
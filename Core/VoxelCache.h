@@ -0,0 +1,101 @@
+#pragma once
+
+#pragma  region HEADER
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#pragma region
+
+// A voxel cache (.vxc) holds the voxelization of static models for every level of a clipmap: a VoxelCacheHeader, the
+// names of the baked models, a VoxelCacheLevel per level, then the occupied bricks of all levels, level by level.
+// Voxel (x, y, z) of a level covers [x, x + 1) * voxelSize on each axis, so voxels line up with the world origin as
+// the clipmap's do, and brick (x, y, z) holds voxels [8x, 8x + 8).  Tools/VoxelBaker writes the format.
+static const uint32_t kVoxelCacheMagic = 0x31435856;    // "VXC1"
+static const uint32_t kVoxelCacheVersion = 1;
+static const uint32_t kVoxelCacheNameLength = 128;
+
+static const int32_t kVoxelBrickSize = 8;
+static const uint32_t kVoxelBrickWords = kVoxelBrickSize * kVoxelBrickSize * kVoxelBrickSize / 32;
+
+struct VoxelCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // Voxels along each axis of a clipmap level, and the levels; a level has twice the voxel size of the one before.
+    uint32_t resolution;
+    uint32_t levelCount;
+    uint32_t modelCount;
+    uint32_t brickCount;
+    // World extent of level 0, resolution voxels.
+    float level0Extent;
+    uint32_t reserved;
+};
+
+struct VoxelCacheLevel
+{
+    float voxelSize;
+    uint32_t firstBrick;
+    uint32_t brickCount;
+    uint32_t reserved;
+};
+
+// Bit (z * 8 + y) * 8 + x of the words is voxel (x, y, z) of the brick.
+struct VoxelCacheBrick
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+    uint32_t bits[kVoxelBrickWords];
+};
+
+inline uint32_t GetVoxelBrickBit(int32_t x, int32_t y, int32_t z)
+{
+    return uint32_t((z * kVoxelBrickSize + y) * kVoxelBrickSize + x);
+}
+
+// A key for brick coordinates; 21 bits per coordinate covers a million bricks either side of the origin.
+inline uint64_t PackVoxelBrick(int32_t x, int32_t y, int32_t z)
+{
+    const uint64_t mask = (1u << 21) - 1;
+    return (uint64_t(x) & mask) | ((uint64_t(y) & mask) << 21) | ((uint64_t(z) & mask) << 42);
+}
+
+// Voxel coordinates to the brick holding them, rounding towards negative infinity.
+inline int32_t GetVoxelBrick(int32_t voxel)
+{
+    return voxel >= 0 ? voxel / kVoxelBrickSize : -((kVoxelBrickSize - 1 - voxel) / kVoxelBrickSize);
+}
+
+class VoxelCache
+{
+public:
+    bool Load(const std::wstring& path);
+    void Close();
+
+    // Bricks are sorted by level, then z, y and x.
+    static bool Save(const std::wstring& path, const VoxelCacheHeader& header, const std::vector<std::string>& modelNames,
+        const std::vector<VoxelCacheLevel>& levels, const std::vector<VoxelCacheBrick>& bricks);
+
+    inline bool IsOpen() const { return m_header.magic == kVoxelCacheMagic; }
+    inline const VoxelCacheHeader& GetHeader() const { return m_header; }
+    inline const VoxelCacheLevel& GetLevel(uint32_t level) const { return m_levels[level]; }
+    inline const std::vector<std::string>& GetModelNames() const { return m_modelNames; }
+    inline const VoxelCacheBrick& GetBrick(uint32_t index) const { return m_bricks[index]; }
+
+    // Returns nullptr when the brick holds no voxel.
+    const VoxelCacheBrick* FindBrick(uint32_t level, int32_t x, int32_t y, int32_t z) const;
+
+    bool IsVoxelSet(uint32_t level, int32_t x, int32_t y, int32_t z) const;
+
+    // Whether a model of the given file name, directories aside, was baked in.
+    bool HasModel(const std::string& filename) const;
+
+private:
+    VoxelCacheHeader m_header = {};
+    std::vector<std::string> m_modelNames;
+    std::vector<VoxelCacheLevel> m_levels;
+    std::vector<VoxelCacheBrick> m_bricks;
+    // Per level, brick coordinates to the brick's index.
+    std::vector<std::unordered_map<uint64_t, uint32_t>> m_brickIndex;
+};
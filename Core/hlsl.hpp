@@ -21,9 +21,19 @@ cbuffer name : register(CONCAT_B(slot))
 #define SLOT_CBUFFER_LIGHT          1
 #define SLOT_CBUFFER_WORLD          2
 #define SLOT_CBUFFER_SHADOW_LIGHT   3
+#define SLOT_CBUFFER_MODEL          4
 
 #define SAMPLER_TEXTURE             0
 #define SAMPLER_SHADOWMAP           1
 #define SAMPLER_NUM                 2
 
+// Virtual texture feedback is rendered at 1/2^TILE_FEEDBACK_DOWNSCALE_LOG2 of the screen resolution.  Each texel
+// packs the mip and page coordinates it samples; a cleared texel (0) saw no virtual texture.
+#define TILE_FEEDBACK_DOWNSCALE_LOG2    3
+#define TILE_FEEDBACK_VALID_BIT         0x80000000
+#define TILE_FEEDBACK_MIP_SHIFT         26
+#define TILE_FEEDBACK_MIP_MASK          0x1F
+#define TILE_FEEDBACK_Y_SHIFT           13
+#define TILE_FEEDBACK_COORD_MASK        0x1FFF
+
 #endif
\ No newline at end of file
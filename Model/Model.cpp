@@ -96,3 +96,33 @@ void Model::ComputeAllBoundingBoxes()
     }
     ComputeGlobalBoundingBox(m_Header.boundingBox);
 }
+
+void Model::ComputeClusters()
+{
+    m_clusters.clear();
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const Mesh *mesh = m_pMesh.get() + meshIndex;
+        const uint16_t *indices = (const uint16_t*)(m_pIndexData.get() + mesh->indexDataByteOffset);
+        const uint8_t *positions = m_pVertexData.get() + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+        const unsigned int triangleCount = mesh->indexCount / 3;
+
+        for (unsigned int first = 0; first < triangleCount; first += kClusterTriangles)
+        {
+            Cluster cluster;
+            cluster.mesh = meshIndex;
+            cluster.triangleCount = std::min(kClusterTriangles, triangleCount - first);
+            cluster.boundingBox.min = Scalar(FLT_MAX);
+            cluster.boundingBox.max = Scalar(-FLT_MAX);
+            for (unsigned int i = first * 3; i < (first + cluster.triangleCount) * 3; i++)
+            {
+                const float *p = (const float*)(positions + indices[i] * mesh->vertexStride);
+                Vector3 pos(*(p + 0), *(p + 1), *(p + 2));
+
+                cluster.boundingBox.min = Min(cluster.boundingBox.min, pos);
+                cluster.boundingBox.max = Max(cluster.boundingBox.max, pos);
+            }
+            m_clusters.push_back(cluster);
+        }
+    }
+}
@@ -181,6 +181,17 @@ public:
     ByteAddressBuffer m_IndexBuffer;
     uint32_t m_VertexStride;
 
+    // Bounds of runs of kClusterTriangles consecutive triangles of a mesh, gathered before the CPU copy of the
+    // geometry is released.  Much tighter than the mesh bounds when testing small boxes for geometry.
+    static const uint32_t kClusterTriangles = 64;
+    struct Cluster
+    {
+        BoundingBox boundingBox;
+        uint32_t mesh;
+        uint32_t triangleCount;
+    };
+    std::vector<Cluster> m_clusters;
+
     // optimized for depth-only rendering
 	std::unique_ptr< unsigned char[]> m_pVertexDataDepth;
 	std::unique_ptr< unsigned char[]> m_pIndexDataDepth;
@@ -219,6 +230,7 @@ protected:
     void ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) const;
     void ComputeGlobalBoundingBox(BoundingBox &bbox) const;
     void ComputeAllBoundingBoxes();
+    void ComputeClusters();
 
     void ReleaseTextures();
     void LoadTextures();
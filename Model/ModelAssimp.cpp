@@ -96,6 +96,7 @@ void AssimpModel::LoadAsDXModel()
 	m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexData.get());
 	m_VertexBufferDepth.Create(L"VertexBufferDepth", m_Header.vertexDataByteSizeDepth / m_VertexStrideDepth, m_VertexStrideDepth, m_pVertexDataDepth.get());
 	m_IndexBufferDepth.Create(L"IndexBufferDepth", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexDataDepth.get());
+	ComputeClusters();
 	m_pVertexData = nullptr;
 	m_pIndexData = nullptr;
 	m_pVertexDataDepth = nullptr;
@@ -30,6 +30,9 @@ public:
     virtual bool Load(const char* filename) override;
     bool Save(const char* filename) const;
 
+    // The file the model was loaded from.
+    inline const std::string& GetFileName() const { return model_name; }
+
 private:
 	std::string model_name;
     bool LoadAssimp(const char *filename);
@@ -180,6 +180,7 @@ bool Model::LoadH3D(const char *filename)
 
     m_VertexBufferDepth.Create(L"VertexBufferDepth", m_Header.vertexDataByteSizeDepth / m_VertexStrideDepth, m_VertexStrideDepth, m_pVertexDataDepth.get());
     m_IndexBufferDepth.Create(L"IndexBufferDepth", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexDataDepth.get());
+	ComputeClusters();
 	m_pVertexData = nullptr;
 	m_pIndexData = nullptr;
 	m_pVertexDataDepth = nullptr;
@@ -21,6 +21,8 @@ namespace SceneView
 {
 
 	IntVar LightGridDim("World/Light Grid Dim", 16, kMinLightGridDim, 32, 8);
+	// Assigns the lights to the tiles on the CPU and uploads the grid, for GPUs the compute shader is too slow on.
+	BoolVar CpuLightGrid("World/CPU Light Grid", false);
 
 	void Lighting::InitializeResources(void)
 	{
@@ -194,7 +196,7 @@ namespace SceneView
 
 		// todo: assumes max resolution of 1920x1080
 		uint32_t lightGridCells = Math::DivideByMultiple(1920, kMinLightGridDim) * Math::DivideByMultiple(1080, kMinLightGridDim);
-		uint32_t lightGridSizeBytes = lightGridCells * (4 + MaxLights * 4);
+		uint32_t lightGridSizeBytes = lightGridCells * (4 + LightGridTileCapacity * 4);
 		m_LightGrid.Create(L"m_LightGrid", lightGridSizeBytes, 1, nullptr);
 
 		uint32_t lightGridBitMaskSizeBytes = lightGridCells * 4 * 4;
@@ -219,6 +221,12 @@ namespace SceneView
 
 		ComputeContext& Context = gfxContext.GetComputeContext();
 
+		if (CpuLightGrid)
+		{
+			FillLightGridCpu(Context, camera);
+			return;
+		}
+
 		Context.SetRootSignature(m_FillLightRootSig);
 
 		switch ((int)LightGridDim)
@@ -274,4 +282,44 @@ namespace SceneView
 		Context.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 		Context.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 	}
+
+	void Lighting::FillLightGridCpu(ComputeContext& Context, const Camera& camera)
+	{
+		// The shaders read one tile per LightGridDim pixels, so the clusters are a single slice over the camera's
+		// depth range.  Without the depth bounds of each tile, more lights land in a tile than with the compute shader.
+		const Matrix4& viewMatrix = camera.GetViewMatrix();
+		m_CpuLights.resize(MaxLights);
+		for (uint32_t n = 0; n < MaxLights; n++)
+		{
+			const Vector3 pos = Vector3(viewMatrix * Vector3(m_LightData[n].pos[0], m_LightData[n].pos[1], m_LightData[n].pos[2]));
+			m_CpuLights[n].pos[0] = pos.GetX();
+			m_CpuLights[n].pos[1] = pos.GetY();
+			m_CpuLights[n].pos[2] = pos.GetZ();
+			m_CpuLights[n].radius = sqrt(m_LightData[n].radiusSq);
+			m_CpuLights[n].type = m_LightData[n].type;
+		}
+
+		const Matrix4& projMatrix = camera.GetProjMatrix();
+		LightClusterDesc desc = {};
+		desc.viewportWidth = g_SceneColorBuffer.GetWidth();
+		desc.viewportHeight = g_SceneColorBuffer.GetHeight();
+		desc.tileDim = (uint32_t)(int)LightGridDim;
+		desc.sliceCount = 1;
+		desc.nearZ = camera.GetNearClip();
+		desc.farZ = camera.GetFarClip();
+		desc.projScaleX = projMatrix.GetX().GetX();
+		desc.projScaleY = projMatrix.GetY().GetY();
+		desc.projOffsetX = projMatrix.GetZ().GetX();
+		desc.projOffsetY = projMatrix.GetZ().GetY();
+		desc.cellCapacity = LightGridTileCapacity;
+		desc.bitMaskWords = 4;
+		m_CpuLightGrid.Build(desc, m_CpuLights, true);
+
+		const std::vector<uint32_t>& grid = m_CpuLightGrid.GetGrid();
+		const std::vector<uint32_t>& bitMask = m_CpuLightGrid.GetBitMask();
+		Context.WriteBuffer(m_LightGrid, 0, grid.data(), grid.size() * sizeof(uint32_t));
+		Context.WriteBuffer(m_LightGridBitMask, 0, bitMask.data(), bitMask.size() * sizeof(uint32_t));
+		Context.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		Context.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "CommandContext.h"
 #include "Camera.h"
 #include "BufferManager.h"
+#include "ClusteredLightGrid.h"
 
 class StructuredBuffer;
 class ByteAddressBuffer;
@@ -30,6 +31,9 @@ namespace SceneView
 
 	enum { MaxLights = 128 };
 
+	// Light indices a light grid tile holds; keep in sync with MAX_LIGHTS in LightGrid.hlsli
+	enum { LightGridTileCapacity = 256 };
+
 	enum { shadowDim = 512 };
 
 	struct LightData
@@ -66,6 +70,10 @@ namespace SceneView
 		ShadowBuffer m_LightShadowTempBuffer;
 		Math::Matrix4 m_LightShadowMatrix[MaxLights];
 
+		ClusteredLightGrid m_CpuLightGrid;
+		std::vector<LightClusterLight> m_CpuLights;
+
+		void FillLightGridCpu(ComputeContext& Context, const Math::Camera& camera);
 
 	public:
 		[[nodiscard]]
@@ -34,6 +34,9 @@
 #include "ShadowCamera.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
+#include "IndirectMeshBatch.h"
+#include "HiZBuffer.h"
+#include "FrameConstantRing.h"
 
 // To enable wave intrinsics, uncomment this macro and #define DXIL in Core/GraphcisCore.cpp.
 // Run CompileSM6Test.bat to compile the relevant shaders with DXC.
@@ -64,11 +67,12 @@ enum RootParams
 {
 	CameraParam,
 	LightingParam,
-	MaterialsSRVs,
+	MaterialTextures,
 	LightingSRVs,
 	PerModelConstant,
 	GBufferSRVs,
 	WorldParam,
+	MaterialTable,
 	NumPassRootParams,
 };
 
@@ -83,6 +87,7 @@ public:
 
     virtual void Update( float deltaT ) override;
     virtual void RenderScene( void ) override;
+    virtual void RenderUI( GraphicsContext& gfxContext ) override;
 
  
 
@@ -90,10 +95,20 @@ private:
 
     void RenderLightShadows(GraphicsContext& gfxContext);
 
+    void CreateIndirectBatches();
+
+    void PlaceBenchmarkInstances(uint32_t InstanceCount);
+
     void UpdateGpuWorld(GraphicsContext& gfxContext);
 
+    // Writes the camera constants of every view once; the passes rendering a view share them.
+    void UpdateViewConstants();
+
     enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0 };
-    void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll);
+    enum eCullView { kMainView, kSunShadowView, kLightShadowView, kNumCullViews };
+    enum eCullMode { kNoCulling, kGpuCulled, kGpuDisoccluded };
+    void RenderObjects( GraphicsContext& Context, eCullView View, eObjectFilter Filter = kAll, eCullMode Cull = kNoCulling );
+    void CullObjects( ComputeContext& Context );
     void CreateParticleEffects();
   
 
@@ -125,6 +140,27 @@ private:
 
     Vector3 m_SunDirection;
     ShadowCamera m_SunShadow;
+
+    uint32_t m_LightShadowIndex = 0;
+
+    // Instancing benchmark: the scene bounds before any copies were placed, the number of copies,
+    // and the submission cost of the last frame.
+    BoundingBox m_SceneBounds;
+    uint32_t m_BenchmarkInstanceCount = 0;
+    uint32_t m_DrawCallCount = 0;
+    int64_t m_RenderObjectsTicks = 0;
+
+    // Depth-only opaque draws need no per-material descriptors, so they go through GPU culling and ExecuteIndirect.
+    IndirectMeshBatch m_OpaqueBatch;
+
+    // Farthest depth of the opaque Z prepass, tested against by the main view's occlusion culling.
+    HiZBuffer m_HiZ;
+
+    // Per-frame constants, written once and bound by address in every pass that reads them.
+    FrameConstantRing m_FrameConstants;
+    FrameConstantRing::BlockHandle m_CameraBlocks[kNumCullViews];
+    FrameConstantRing::BlockHandle m_WorldBlock;
+    FrameConstantRing::BlockHandle m_LightingBlock;
 };
 
 CREATE_APPLICATION( ModelViewer )
@@ -142,10 +178,50 @@ NumVar ShadowDimY("Application/Lighting/Shadow Dim Y", 3000, 1000, 10000, 100 );
 NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 1000, 10000, 100 );
 
 BoolVar ShowWaveTileCounts("Application/Forward+/Show Wave Tile Counts", false);
+BoolVar EnableGPUCulling("Application/GPU Culling", true);
+BoolVar EnableOcclusionCulling("Application/Occlusion Culling", true);
+BoolVar ShowCullingStats("Application/Show Culling Stats", true);
+BoolVar EnableInstancing("Application/Instancing/Enable", true);
+IntVar BenchmarkInstances("Application/Instancing/Benchmark Instances", 0, 0, 16384, 256);
+BoolVar ShowInstancingStats("Application/Instancing/Show Stats", true);
 #ifdef _WAVE_OP
 BoolVar EnableWaveOps("Application/Forward+/Enable Wave Ops", true);
 #endif
 
+__declspec(align(16))struct CameraBufferConstant
+{
+    Matrix4 modelToProjection;
+} cameraConstant;
+
+__declspec(align(16))struct WorldBufferConstants
+{
+    Matrix4 projection_to_camera;
+    Matrix4 camera_to_world;
+    Matrix4 projection_to_world;
+    Matrix4 model_to_shadow;
+    XMFLOAT4 invViewport;
+    XMFLOAT3 cameraPos;
+    float scene_length;
+} worldConstant;
+
+__declspec(align(16)) struct
+{
+    Vector3 sunDirection;
+    Vector3 sunLight;
+    Vector3 ambientLight;
+    float ShadowTexelSize[4];
+
+    float InvTileDim[4];
+    uint32_t TileCount[4];
+    uint32_t FirstLightIndex[4];
+    uint32_t FrameIndexMod2;
+} lightingConstants;
+
+__declspec(align(16)) struct
+{
+    Vector3 wireFrameColor;
+}psWireFrameColorConstants;
+
 void ModelViewer::Startup( void )
 {
 	freopen("stdout.txt","w+",stdout);
@@ -157,11 +233,14 @@ void ModelViewer::Startup( void )
     m_RootSig.InitStaticSampler(1, SamplerShadowDesc, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::CameraParam].InitAsConstantBuffer(SLOT_CBUFFER_CAMERA, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig[RootParams::LightingParam].InitAsConstantBuffer(SLOT_CBUFFER_LIGHT, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[RootParams::MaterialsSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6, D3D12_SHADER_VISIBILITY_PIXEL);
+    // Every descriptor table lives in the world's bindless heap; the texture table covers all model textures.
+    m_RootSig[RootParams::MaterialTextures].InitAsDescriptorTable(1, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_RootSig[RootParams::MaterialTextures].SetTableRange(0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, UINT_MAX, 1);
     m_RootSig[RootParams::LightingSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 6, D3D12_SHADER_VISIBILITY_PIXEL);
 	m_RootSig[RootParams::GBufferSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 32, 4, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[RootParams::PerModelConstant].InitAsConstants(1, 2, D3D12_SHADER_VISIBILITY_VERTEX);
+    m_RootSig[RootParams::PerModelConstant].InitAsConstants(SLOT_CBUFFER_MODEL, 2, D3D12_SHADER_VISIBILITY_ALL);
 	m_RootSig[RootParams::WorldParam].InitAsConstantBuffer(SLOT_CBUFFER_WORLD, D3D12_SHADER_VISIBILITY_ALL);
+    m_RootSig[RootParams::MaterialTable].InitAsBufferSRV(0, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig.Finalize(L"ModelViewer", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     DXGI_FORMAT ColorFormat = g_SceneColorBuffer.GetFormat();
@@ -173,7 +252,10 @@ void ModelViewer::Startup( void )
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "INSTANCE_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
     };
     gsl::span<const D3D12_INPUT_ELEMENT_DESC> input_element_decs = gsl::make_span(vertElem);
 
@@ -260,6 +342,15 @@ void ModelViewer::Startup( void )
 
     TextureManager::Initialize(L"Textures/");
 	m_world.Create();
+    m_SceneBounds = m_world.GetBoundingBox();
+    CreateIndirectBatches();
+
+    m_FrameConstants.Create(L"Frame Constants", 64 * 1024);
+    m_CameraBlocks[kMainView] = m_FrameConstants.RegisterBlock("Camera/Main", sizeof(cameraConstant));
+    m_CameraBlocks[kSunShadowView] = m_FrameConstants.RegisterBlock("Camera/SunShadow", sizeof(cameraConstant));
+    m_CameraBlocks[kLightShadowView] = m_FrameConstants.RegisterBlock("Camera/LightShadow", sizeof(cameraConstant));
+    m_WorldBlock = m_FrameConstants.RegisterBlock("World", sizeof(worldConstant));
+    m_LightingBlock = m_FrameConstants.RegisterBlock("Lighting", sizeof(lightingConstants));
 
     // The caller of this function can override which materials are considered cutouts
     
@@ -281,8 +372,43 @@ void ModelViewer::Startup( void )
     m_ExtraTextures[5] = lighting->GetLightGridBitMask().GetSRV();
 }
 
+void ModelViewer::CreateIndirectBatches()
+{
+    m_world.ForEachInstanced([&](Model& model, const SceneView::ModelInstances& instances)
+    {
+        const uint32_t VertexStride = model.m_VertexStride;
+        for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+        {
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+            if (model.MaterialIsCutout(mesh.materialIndex))
+                continue;
+
+            // Every instance gets its own command and bounds, so scattered placements are culled one by one
+            // rather than by the box enclosing them all.
+            IndirectMeshCommand command;
+            command.baseVertex = mesh.vertexDataByteOffset / VertexStride;
+            command.materialIdx = instances.firstMaterial + mesh.materialIndex;
+            command.vertexBuffer = model.m_VertexBuffer.VertexBufferView();
+            command.indexBuffer = model.m_IndexBuffer.IndexBufferView();
+            command.drawArguments.IndexCountPerInstance = mesh.indexCount;
+            command.drawArguments.InstanceCount = 1;
+            command.drawArguments.StartIndexLocation = mesh.indexDataByteOffset / sizeof(uint16_t);
+            command.drawArguments.BaseVertexLocation = command.baseVertex;
+            for (uint32_t instance = 0; instance < instances.transforms.size(); instance++)
+            {
+                command.drawArguments.StartInstanceLocation = instances.firstInstance + instance;
+                m_OpaqueBatch.AddMesh(TransformBoundingBox(mesh.boundingBox, instances.transforms[instance]), command);
+            }
+        }
+    });
+    m_OpaqueBatch.Finalize(L"Opaque Meshes", m_RootSig, RootParams::PerModelConstant, kNumCullViews);
+}
+
 void ModelViewer::Cleanup( void )
 {
+    m_OpaqueBatch.Destroy();
+    m_HiZ.Destroy();
+    m_FrameConstants.Destroy();
     m_world.Clear();
 }
 
@@ -302,6 +428,9 @@ void ModelViewer::Update( float deltaT )
 
 	m_world.Update(deltaT);
 
+    if (static_cast<uint32_t>(BenchmarkInstances) != m_BenchmarkInstanceCount)
+        PlaceBenchmarkInstances(BenchmarkInstances);
+
     float costheta = cosf(m_SunOrientation);
     float sintheta = sinf(m_SunOrientation);
     float cosphi = cosf(m_SunInclination * 3.14159f * 0.5f);
@@ -329,41 +458,6 @@ void ModelViewer::Update( float deltaT )
     m_MainScissor.bottom = (LONG)g_SceneColorBuffer.GetHeight();
 }
 
-__declspec(align(16))struct CameraBufferConstant
-{
-    Matrix4 modelToProjection;
-} cameraConstant;
-
-__declspec(align(16))struct WorldBufferConstants
-{
-    Matrix4 projection_to_camera;
-    Matrix4 camera_to_world;
-    Matrix4 projection_to_world;
-    Matrix4 model_to_shadow;
-    XMFLOAT4 invViewport;
-    XMFLOAT3 cameraPos;
-    float scene_length;
-} worldConstant;
-
-__declspec(align(16)) struct
-{
-    Vector3 sunDirection;
-    Vector3 sunLight;
-    Vector3 ambientLight;
-    float ShadowTexelSize[4];
-
-    float InvTileDim[4];
-    uint32_t TileCount[4];
-    uint32_t FirstLightIndex[4];
-    uint32_t FrameIndexMod2;
-} lightingConstants;
-
-__declspec(align(16)) struct
-{
-    Vector3 wireFrameColor;
-}psWireFrameColorConstants;
-
-
 void ModelViewer::UpdateGpuWorld(GraphicsContext& gfxContext)
 {
     const Camera& cam = m_world.GetMainCamera();
@@ -377,28 +471,102 @@ void ModelViewer::UpdateGpuWorld(GraphicsContext& gfxContext)
     XMStoreFloat3(&worldConstant.cameraPos, cam.GetPosition());
     XMStoreFloat4(&worldConstant.invViewport, { 1.0f / m_MainViewport.Width,1.0f / m_MainViewport.Height,0.0f,0.0f });
     worldConstant.scene_length = m_world.GetBoundingBox().Length();
-    gfxContext.SetDynamicConstantBufferView(RootParams::WorldParam, sizeof(worldConstant), &worldConstant);
+    gfxContext.SetConstantBuffer(RootParams::WorldParam, m_FrameConstants.Write(m_WorldBlock, worldConstant));
+}
 
+void ModelViewer::UpdateViewConstants()
+{
+    cameraConstant.modelToProjection = m_world.GetMainCamera().GetViewProjMatrix();
+    m_FrameConstants.Write(m_CameraBlocks[kMainView], cameraConstant);
+    cameraConstant.modelToProjection = m_SunShadow.GetViewProjMatrix();
+    m_FrameConstants.Write(m_CameraBlocks[kSunShadowView], cameraConstant);
+    if (m_LightShadowIndex < SceneView::MaxLights)
+    {
+        cameraConstant.modelToProjection = SceneView::World::Get()->GetLighting()->LightShadowMatrix(m_LightShadowIndex);
+        m_FrameConstants.Write(m_CameraBlocks[kLightShadowView], cameraConstant);
+    }
+}
 
+void ModelViewer::CullObjects(ComputeContext& Context)
+{
+    ScopedTimer _prof(L"GPU Culling", Context);
 
-    
+    if (EnableOcclusionCulling)
+        m_OpaqueBatch.CullOcclusionFirstPhase(Context, kMainView, m_world.GetMainCamera().GetViewProjMatrix(), m_HiZ);
+    else
+        m_OpaqueBatch.Cull(Context, kMainView, m_world.GetMainCamera().GetViewProjMatrix());
+    m_OpaqueBatch.Cull(Context, kSunShadowView, m_SunShadow.GetViewProjMatrix());
+    if (m_LightShadowIndex < SceneView::MaxLights)
+        m_OpaqueBatch.Cull(Context, kLightShadowView, SceneView::World::Get()->GetLighting()->LightShadowMatrix(m_LightShadowIndex));
 }
 
-void ModelViewer::RenderObjects(GraphicsContext& gfxContext, const Matrix4& viewProjMat, eObjectFilter Filter)
+void ModelViewer::PlaceBenchmarkInstances(uint32_t InstanceCount)
 {
+    // The instance buffer and the indirect batch are rebuilt, so nothing may still reference them.
+    Graphics::g_CommandManager.IdleGPU();
+
+    const uint32_t modelIndex = m_world.FindModel("Models/box.obj");
+    if (modelIndex == SceneView::World::kInvalidModel)
+    {
+        Utility::Print("Instancing benchmark: Models/box.obj is not loaded\n");
+        m_BenchmarkInstanceCount = InstanceCount;
+        return;
+    }
+    const Model& model = m_world.m_models[modelIndex];
+    const Vector3 size = model.GetBoundingBox().max - model.GetBoundingBox().min;
+    const float spacing = 1.5f * Max(Max(size.GetX(), size.GetY()), size.GetZ());
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(InstanceCount))));
+
+    // The original placement stays first; the copies form a square grid above the scene.
+    std::vector<AffineTransform> transforms(1, AffineTransform(kIdentity));
+    const Vector3 origin((m_SceneBounds.min.GetX() + m_SceneBounds.max.GetX()) * 0.5f - side * spacing * 0.5f,
+        m_SceneBounds.max.GetY() + spacing, (m_SceneBounds.min.GetZ() + m_SceneBounds.max.GetZ()) * 0.5f - side * spacing * 0.5f);
+    for (uint32_t i = 0; i < InstanceCount; i++)
+        transforms.emplace_back(origin + Vector3(static_cast<float>(i % side), 0.0f, static_cast<float>(i / side)) * spacing);
+
+    m_world.SetModelInstances(modelIndex, transforms);
+    m_world.UpdateInstances();
+    m_OpaqueBatch.Destroy();
+    CreateIndirectBatches();
+    m_BenchmarkInstanceCount = InstanceCount;
+}
 
-	cameraConstant.modelToProjection = viewProjMat;
+void ModelViewer::RenderObjects(GraphicsContext& gfxContext, eCullView View, eObjectFilter Filter, eCullMode Cull)
+{
+    const int64_t startTick = SystemTime::GetCurrentTick();
 
-	gfxContext.SetDynamicConstantBufferView(RootParams::CameraParam, sizeof(cameraConstant), &cameraConstant);
+	// The view's camera constants were written once by UpdateViewConstants; every pass of the view reuses them.
+	gfxContext.SetRootSignature(m_RootSig);
+	gfxContext.SetConstantBuffer(RootParams::CameraParam, m_FrameConstants.GetGpuAddress(m_CameraBlocks[View]));
 
-	uint32_t materialIdx = 0xFFFFFFFFul;
-	m_world.ForEach([&](Model &model)
+	// Materials are selected by the per-draw material index alone, so no descriptors are copied per draw.
+	// The heap is rebound in case a compute pass switched to the dynamic descriptor heap since the last call.
+	BindlessTextureHeap& textureHeap = m_world.GetTextureHeap();
+	textureHeap.Bind(gfxContext);
+	gfxContext.SetDescriptorTable(RootParams::MaterialTextures, textureHeap.GetTextureTable());
+	gfxContext.SetBufferSRV(RootParams::MaterialTable, m_world.GetMaterialBuffer());
+
+	if (EnableGPUCulling && Cull != kNoCulling && Filter == kOpaque)
+	{
+		gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		gfxContext.SetVertexBuffer(1, m_world.GetInstanceBuffer().VertexBufferView());
+		if (Cull == kGpuDisoccluded)
+			m_OpaqueBatch.DrawDisoccluded(gfxContext, View);
+		else
+			m_OpaqueBatch.Draw(gfxContext, View);
+		++m_DrawCallCount;
+		m_RenderObjectsTicks += SystemTime::GetCurrentTick() - startTick;
+		return;
+	}
+
+	m_world.ForEachInstanced([&](Model &model, const SceneView::ModelInstances& instances)
 	{
 		uint32_t VertexStride = model.m_VertexStride;
-		gfxContext.SetRootSignature(m_RootSig);
+		uint32_t instanceCount = static_cast<uint32_t>(instances.transforms.size());
 		gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		gfxContext.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
 		gfxContext.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
+		gfxContext.SetVertexBuffer(1, m_world.GetInstanceBuffer().VertexBufferView());
 
 		for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
 		{
@@ -408,37 +576,42 @@ void ModelViewer::RenderObjects(GraphicsContext& gfxContext, const Matrix4& view
 			uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
 			uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
 
-			if (mesh.materialIndex != materialIdx)
-			{
-				if (model.MaterialIsCutout(mesh.materialIndex) && !(Filter & kCutout) ||
-					!model.MaterialIsCutout(mesh.materialIndex) && !(Filter & kOpaque))
-					continue;
-
-				materialIdx = mesh.materialIndex;
-				gfxContext.SetDynamicDescriptors(RootParams::MaterialsSRVs, 0, 6, model.GetSRVs(materialIdx));
-			}
+			if (model.MaterialIsCutout(mesh.materialIndex) && !(Filter & kCutout) ||
+				!model.MaterialIsCutout(mesh.materialIndex) && !(Filter & kOpaque))
+				continue;
 
-			gfxContext.SetConstants(RootParams::PerModelConstant, baseVertex, materialIdx);
+			gfxContext.SetConstants(RootParams::PerModelConstant, baseVertex, instances.firstMaterial + mesh.materialIndex);
 
-			gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
+			if (EnableInstancing)
+			{
+				gfxContext.DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, instances.firstInstance);
+				++m_DrawCallCount;
+			}
+			else
+			{
+				for (uint32_t instance = 0; instance < instanceCount; instance++)
+					gfxContext.DrawIndexedInstanced(indexCount, 1, startIndex, baseVertex, instances.firstInstance + instance);
+				m_DrawCallCount += instanceCount;
+			}
 		}
 	});
+	m_RenderObjectsTicks += SystemTime::GetCurrentTick() - startTick;
 }
 
 void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
 {
     ScopedTimer _prof(L"RenderLightShadows", gfxContext);
 
-    static uint32_t LightIndex = 0;
+    const uint32_t LightIndex = m_LightShadowIndex;
     if (LightIndex >= SceneView::MaxLights)
         return;
 	auto light = SceneView::World::Get()->GetLighting();
 	light->GetLightShadowTempBuffer().BeginRendering(gfxContext);
     {
         gfxContext.SetPipelineState(m_ShadowPSO);
-        RenderObjects(gfxContext, light->LightShadowMatrix(LightIndex), kOpaque);
+        RenderObjects(gfxContext, kLightShadowView, kOpaque, kGpuCulled);
         gfxContext.SetPipelineState(m_CutoutShadowPSO);
-        RenderObjects(gfxContext, light->LightShadowMatrix(LightIndex), kCutout);
+        RenderObjects(gfxContext, kLightShadowView, kCutout);
     }
 	light->GetLightShadowTempBuffer().EndRendering(gfxContext);
 
@@ -449,7 +622,7 @@ void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
 
     gfxContext.TransitionResource(light->GetLightShadowArray(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-    ++LightIndex;
+    ++m_LightShadowIndex;
 }
 
 void ModelViewer::RenderScene( void )
@@ -474,10 +647,19 @@ void ModelViewer::RenderScene( void )
 
     GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
 
-
+    m_DrawCallCount = 0;
+    m_RenderObjectsTicks = 0;
+    m_world.GetTextureHeap().BeginFrame();
 
     ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
 
+    // All views are culled up front so the compute pipeline is not interleaved with the graphics passes.
+    m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+        (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
+    UpdateViewConstants();
+    if (EnableGPUCulling)
+        CullObjects(gfxContext.GetComputeContext());
+
     uint32_t FrameIndex = TemporalEffects::GetFrameIndexMod2();
 
    
@@ -514,8 +696,6 @@ void ModelViewer::RenderScene( void )
     {
         ScopedTimer _prof(L"Z PrePass", gfxContext);
 
-        gfxContext.SetDynamicConstantBufferView(RootParams::CameraParam, sizeof(lightingConstants), &lightingConstants);
-		
         {
             ScopedTimer _prof1(L"Opaque", gfxContext);
             gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
@@ -528,14 +708,34 @@ void ModelViewer::RenderScene( void )
 #endif
             gfxContext.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
             gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-            RenderObjects(gfxContext, camViewProjMat, kOpaque );
+            RenderObjects(gfxContext, kMainView, kOpaque, kGpuCulled);
         }
 
         {
             ScopedTimer _prof2(L"Cutout", gfxContext);
             gfxContext.SetPipelineState(m_CutoutDepthPSO);
-            RenderObjects(gfxContext, camViewProjMat, kCutout );
+            RenderObjects(gfxContext, kMainView, kCutout);
+        }
+
+        if (EnableGPUCulling && EnableOcclusionCulling)
+        {
+            ScopedTimer _prof3(L"Disoccluded", gfxContext);
+            ComputeContext& cullContext = gfxContext.GetComputeContext();
+            m_HiZ.Build(cullContext, g_SceneDepthBuffer, camViewProjMat);
+            m_OpaqueBatch.CullOcclusionSecondPhase(cullContext, kMainView, m_HiZ);
+
+            // The cutout PSO is the cached graphics state, so the depth PSO is really rebound after the dispatches.
+            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+#ifdef _WAVE_OP
+            gfxContext.SetPipelineState(EnableWaveOps ? m_DepthWaveOpsPSO : m_DepthPSO );
+#else
+            gfxContext.SetPipelineState(m_DepthPSO);
+#endif
+            RenderObjects(gfxContext, kMainView, kOpaque, kGpuDisoccluded);
         }
+
+        if (EnableGPUCulling)
+            m_OpaqueBatch.ResolveStatistics(gfxContext, kMainView);
     }
 
     SSAO::Render(gfxContext, m_world.GetMainCamera());
@@ -553,14 +753,11 @@ void ModelViewer::RenderScene( void )
         {
             ScopedTimer _prof3(L"Render Shadow Map", gfxContext);
 
-            m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
-                (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
-
             g_ShadowBuffer.BeginRendering(gfxContext);
             gfxContext.SetPipelineState(m_ShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kOpaque);
+            RenderObjects(gfxContext, kSunShadowView, kOpaque, kGpuCulled);
             gfxContext.SetPipelineState(m_CutoutShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kCutout);
+            RenderObjects(gfxContext, kSunShadowView, kCutout);
             g_ShadowBuffer.EndRendering(gfxContext);
         }
 
@@ -578,8 +775,11 @@ void ModelViewer::RenderScene( void )
 
             gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-            gfxContext.SetDynamicDescriptors(RootParams::LightingSRVs, 0, _countof(m_ExtraTextures), m_ExtraTextures);
-            gfxContext.SetDynamicConstantBufferView(RootParams::LightingParam, sizeof(lightingConstants), &lightingConstants);
+            // Pass-level tables share the bindless heap with the material textures, so they are staged there too.
+            m_world.GetTextureHeap().Bind(gfxContext);
+            gfxContext.SetDescriptorTable(RootParams::LightingSRVs,
+                m_world.GetTextureHeap().AddFrameDescriptors(_countof(m_ExtraTextures), m_ExtraTextures));
+            gfxContext.SetConstantBuffer(RootParams::LightingParam, m_FrameConstants.Write(m_LightingBlock, lightingConstants));
 			if (g_LightingModel == LightingType::kDeferred)
 			{
 				gfxContext.TransitionResource(g_GBufferColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
@@ -594,7 +794,7 @@ void ModelViewer::RenderScene( void )
 				D3D12_CPU_DESCRIPTOR_HANDLE RTVs[] = { g_GBufferColorBuffer.GetRTV(),g_GBufferNormalBuffer.GetRTV(),g_GBufferMaterialBuffer.GetRTV() };
 				gfxContext.SetRenderTargets(3, RTVs, g_SceneDepthBuffer.GetDSV_DepthReadOnly());
 				gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-				RenderObjects(gfxContext, camViewProjMat, kOpaque);
+				RenderObjects(gfxContext, kMainView, kOpaque);
 
 
 				gfxContext.TransitionResource(g_GBufferColorBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
@@ -602,7 +802,7 @@ void ModelViewer::RenderScene( void )
 				gfxContext.TransitionResource(g_GBufferMaterialBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 				gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 				D3D12_CPU_DESCRIPTOR_HANDLE GBuffers[4] = { g_GBufferColorBuffer.GetSRV(),g_GBufferNormalBuffer.GetSRV(),g_GBufferMaterialBuffer.GetSRV(),g_SceneDepthBuffer.GetDepthSRV() };
-				gfxContext.SetDynamicDescriptors(RootParams::GBufferSRVs, 0, _countof(GBuffers), GBuffers);
+				gfxContext.SetDescriptorTable(RootParams::GBufferSRVs, m_world.GetTextureHeap().AddFrameDescriptors(_countof(GBuffers), GBuffers));
 				gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
 				gfxContext.ClearColor(g_SceneColorBuffer);
 				gfxContext.SetPipelineState(m_DefferedShadingPSO);
@@ -629,12 +829,12 @@ void ModelViewer::RenderScene( void )
 				gfxContext.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV_DepthReadOnly());
 				gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
 
-				RenderObjects(gfxContext, camViewProjMat, kOpaque);
+				RenderObjects(gfxContext, kMainView, kOpaque);
 
 				if (!ShowWaveTileCounts)
 				{
 					gfxContext.SetPipelineState(m_CutoutModelPSO);
-					RenderObjects(gfxContext, camViewProjMat, kCutout);
+					RenderObjects(gfxContext, kMainView, kCutout);
 				}
 				
 			}
@@ -660,7 +860,34 @@ void ModelViewer::RenderScene( void )
     else
         MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
 
-    gfxContext.Finish();
+    const uint64_t fenceValue = gfxContext.Finish();
+    m_OpaqueBatch.FenceStatistics(fenceValue);
+    m_world.GetTextureHeap().EndFrame(fenceValue);
+    m_FrameConstants.EndFrame(fenceValue);
+}
+
+void ModelViewer::RenderUI( GraphicsContext& gfxContext )
+{
+    TextContext Text(gfxContext);
+    Text.Begin();
+    Text.ResetCursor(10.0f, 980.0f);
+    if (ShowInstancingStats)
+    {
+        Text.DrawFormattedString("Instances: %u (benchmark %u)  Draw calls: %u  RenderObjects CPU: %.3f ms\n",
+            m_world.GetInstanceCount(), m_BenchmarkInstanceCount, m_DrawCallCount,
+            1000.0 * SystemTime::TicksToSeconds(m_RenderObjectsTicks));
+        Text.DrawFormattedString("Bindless textures: %u  Descriptors copied this frame: %u\n",
+            m_world.GetTextureHeap().GetTextureCount(), m_world.GetTextureHeap().GetFrameDescriptorCount());
+        Text.DrawFormattedString("Frame constants uploaded: %u bytes (%u of %u blocks rewritten)\n",
+            m_FrameConstants.GetBytesUploaded(), m_FrameConstants.GetBlocksWritten(), m_FrameConstants.GetBlockCount());
+    }
+    if (EnableGPUCulling && ShowCullingStats)
+    {
+        const IndirectMeshCullingStats& stats = m_OpaqueBatch.GetStatistics();
+        Text.DrawFormattedString("Opaque mesh instances culled: %.1f%% (frustum %u, occlusion %u, disoccluded %u of %u)\n",
+            stats.CulledPercentage(), stats.FrustumCulled(), stats.OcclusionCulled(), stats.secondPhaseVisible, stats.meshCount);
+    }
+    Text.End();
 }
 
 void ModelViewer::CreateParticleEffects()
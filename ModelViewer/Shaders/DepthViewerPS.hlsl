@@ -12,6 +12,7 @@
 //
 
 #include "ModelViewerRS.hlsli"
+#include "Materials.hlsli"
 
 struct VSOutput
 {
@@ -19,12 +20,12 @@ struct VSOutput
     float2 uv : TexCoord0;
 };
 
-Texture2D<float4>    texDiffuse        : register(t0);
 SamplerState        sampler0        : register(s0);
 
 [RootSignature(ModelViewer_RootSig)]
 void main(VSOutput vsOutput)
 {
-    if (texDiffuse.Sample(sampler0, vsOutput.uv).a < 0.5)
+    MaterialConstants material = materials[materialId];
+    if (bindlessTextures[material.diffuseTexture].Sample(sampler0, vsOutput.uv).a < 0.5)
         discard;
 }
@@ -22,6 +22,10 @@ struct VSInput
     float3 normal : NORMAL;
     float3 tangent : TANGENT;
     float3 bitangent : BITANGENT;
+    // Rows of the instance's affine transform, from the per-instance stream.
+    float4 instanceRow0 : INSTANCE_TRANSFORM0;
+    float4 instanceRow1 : INSTANCE_TRANSFORM1;
+    float4 instanceRow2 : INSTANCE_TRANSFORM2;
 };
 
 struct VSOutput
@@ -34,7 +38,9 @@ struct VSOutput
 VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
-    vsOutput.pos = mul(modelToProjection, float4(vsInput.position, 1.0));
+    float3x4 instanceToWorld = float3x4(vsInput.instanceRow0, vsInput.instanceRow1, vsInput.instanceRow2);
+    float3 worldPos = mul(instanceToWorld, float4(vsInput.position, 1.0));
+    vsOutput.pos = mul(modelToProjection, float4(worldPos, 1.0));
     vsOutput.uv = vsInput.texcoord0;
     return vsOutput;
 }
@@ -34,12 +34,7 @@ struct VSOutput
     sample float3 bitangent : Bitangent;
 };
 
-Texture2D<float3> texDiffuse        : register(t0);
-Texture2D<float3> texSpecular        : register(t1);
-//Texture2D<float4> texEmissive        : register(t2);
-Texture2D<float3> texNormal            : register(t3);
-//Texture2D<float4> texLightmap        : register(t4);
-//Texture2D<float4> texReflection    : register(t5);
+#include "Materials.hlsli"
 Texture2D<float> texSSAO            : register(t64);
 Texture2D<float> texShadow            : register(t65);
 
@@ -334,17 +329,18 @@ float2 EncodeUnitVector_CryEngine(float3 u)
 OMInputDeferred main(VSOutput vsOutput) 
 {
 	OMInputDeferred output;
-    float3 diffuseAlbedo = texDiffuse.Sample(sampler0, vsOutput.uv);
+    MaterialConstants material = materials[materialId];
+    float3 diffuseAlbedo = bindlessTextures[material.diffuseTexture].Sample(sampler0, vsOutput.uv).rgb;
     float gloss = 128.0;
     float3 normal;
     {
-        normal = texNormal.Sample(sampler0, vsOutput.uv) * 2.0 - 1.0;
+        normal = bindlessTextures[material.normalTexture].Sample(sampler0, vsOutput.uv).rgb * 2.0 - 1.0;
         AntiAliasSpecular(normal, gloss);
         float3x3 tbn = float3x3(normalize(vsOutput.tangent), normalize(vsOutput.bitangent), normalize(vsOutput.normal));
         normal = normalize(mul(normal, tbn));
     }
 
-    float specularMask = texSpecular.Sample(sampler0, vsOutput.uv).g;
+    float specularMask = bindlessTextures[material.specularTexture].Sample(sampler0, vsOutput.uv).g;
 
 	output.base_color = float4(diffuseAlbedo, 1.0f);
 	output.n.xy = EncodeUnitVector_CryEngine(normal);
@@ -0,0 +1,37 @@
+#ifndef MATERIALS_HLSLI
+#define MATERIALS_HLSLI
+
+#include "../../Core/hlsl.hpp"
+
+// Bindless materials.  Every model texture lives in one persistent descriptor table, and the material table
+// says which of them a material uses.  materialId is the per-draw root constant.
+
+// Mirrors SceneView::MaterialConstants.
+struct MaterialConstants
+{
+    uint diffuseTexture;
+    uint specularTexture;
+    uint emissiveTexture;
+    uint normalTexture;
+    uint lightmapTexture;
+    uint reflectionTexture;
+    uint flags;
+    float opacity;
+    float3 diffuse;
+    float shininess;
+    float3 specular;
+    float specularStrength;
+    float3 emissive;
+    float _;
+};
+
+CBUFFER(ModelConstant, SLOT_CBUFFER_MODEL)
+{
+    uint basevertex;
+    uint materialId;
+};
+
+StructuredBuffer<MaterialConstants> materials : register(t0);
+Texture2D<float4> bindlessTextures[] : register(t0, space1);
+
+#endif
@@ -33,12 +33,7 @@ struct VSOutput
     sample float3 bitangent : Bitangent;
 };
 
-Texture2D<float3> texDiffuse        : register(t0);
-Texture2D<float3> texSpecular        : register(t1);
-//Texture2D<float4> texEmissive        : register(t2);
-Texture2D<float3> texNormal            : register(t3);
-//Texture2D<float4> texLightmap        : register(t4);
-//Texture2D<float4> texReflection    : register(t5);
+#include "Materials.hlsli"
 #include "Lighting.hlsli"
 
 
@@ -97,7 +92,8 @@ float2 EncodeUnitVector_CryEngine(float3 u)
 float3 main(VSOutput vsOutput) : SV_Target0
 {
     uint2 pixelPos = vsOutput.position.xy;
-    float3 diffuseAlbedo = texDiffuse.Sample(sampler0, vsOutput.uv);
+    MaterialConstants material = materials[materialId];
+    float3 diffuseAlbedo = bindlessTextures[material.diffuseTexture].Sample(sampler0, vsOutput.uv).rgb;
     float3 colorSum = 0;
     {
         float ao = texSSAO[pixelPos];
@@ -107,13 +103,13 @@ float3 main(VSOutput vsOutput) : SV_Target0
     float gloss = 128.0;
     float3 normal;
     {
-        normal = texNormal.Sample(sampler0, vsOutput.uv) * 2.0 - 1.0;
+        normal = bindlessTextures[material.normalTexture].Sample(sampler0, vsOutput.uv).rgb * 2.0 - 1.0;
         AntiAliasSpecular(normal, gloss);
         float3x3 tbn = float3x3(normalize(vsOutput.tangent), normalize(vsOutput.bitangent), normalize(vsOutput.normal));
         normal = normalize(mul(normal, tbn));
     }
     float3 specularAlbedo = float3( 0.56, 0.56, 0.56 );
-    float specularMask = texSpecular.Sample(sampler0, vsOutput.uv).g;
+    float specularMask = bindlessTextures[material.specularTexture].Sample(sampler0, vsOutput.uv).g;
     float3 viewDir = normalize(vsOutput.viewDir);
     colorSum += ApplyDirectionalLight( diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, vsOutput.shadowCoord );
 
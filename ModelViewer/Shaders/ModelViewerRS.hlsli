@@ -20,10 +20,11 @@
     ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_LIGHT, SHADER_VISIBILITY_PIXEL) ", "  \
     ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_WORLD, SHADER_VISIBILITY_VERTEX) ", " \
 	ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_WORLD, SHADER_VISIBILITY_PIXEL) ", " \
-    "DescriptorTable(SRV(t0, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
+    "DescriptorTable(SRV(t0, space = 1, numDescriptors = unbounded), visibility = SHADER_VISIBILITY_PIXEL)," \
     "DescriptorTable(SRV(t64, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
 	"DescriptorTable(SRV(t32, numDescriptors = 4), visibility = SHADER_VISIBILITY_PIXEL)," \
-    "RootConstants(b1, num32BitConstants = 2, visibility = SHADER_VISIBILITY_VERTEX), " \
+    "RootConstants(" STR(CONCAT_B(SLOT_CBUFFER_MODEL)) ", num32BitConstants = 2), " \
+    "SRV(t0, visibility = SHADER_VISIBILITY_PIXEL), " \
     "StaticSampler(s0, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s1, visibility = SHADER_VISIBILITY_PIXEL," \
         "addressU = TEXTURE_ADDRESS_CLAMP," \
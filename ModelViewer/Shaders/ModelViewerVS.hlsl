@@ -13,12 +13,7 @@
 //
 #include "ModelViewerRS.hlsli"
 #include "../../Core/Shaders/Buffers.hlsli"
-
-cbuffer modelInfo: register(b1)
-{
-	uint basevertex;
-	uint materialId;
-};
+#include "Materials.hlsli"
 
 struct VSInput
 {
@@ -27,6 +22,10 @@ struct VSInput
     float3 normal : NORMAL;
     float3 tangent : TANGENT;
     float3 bitangent : BITANGENT;
+    // Rows of the instance's affine transform, from the per-instance stream.
+    float4 instanceRow0 : INSTANCE_TRANSFORM0;
+    float4 instanceRow1 : INSTANCE_TRANSFORM1;
+    float4 instanceRow2 : INSTANCE_TRANSFORM2;
 };
 
 struct VSOutput
@@ -46,15 +45,20 @@ VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
 
-    vsOutput.position = mul(modelToProjection, float4(vsInput.position, 1.0));
-    vsOutput.worldPos = vsInput.position;
+    float3x4 instanceToWorld = float3x4(vsInput.instanceRow0, vsInput.instanceRow1, vsInput.instanceRow2);
+    float3 worldPos = mul(instanceToWorld, float4(vsInput.position, 1.0));
+
+    vsOutput.position = mul(modelToProjection, float4(worldPos, 1.0));
+    vsOutput.worldPos = worldPos;
     vsOutput.texCoord = vsInput.texcoord0;
-    vsOutput.viewDir = vsInput.position - g_viewer_pos;
-    vsOutput.shadowCoord = mul(g_model_to_shadow, float4(vsInput.position, 1.0)).xyz;
+    vsOutput.viewDir = worldPos - g_viewer_pos;
+    vsOutput.shadowCoord = mul(g_model_to_shadow, float4(worldPos, 1.0)).xyz;
 
-    vsOutput.normal = vsInput.normal;
-    vsOutput.tangent = vsInput.tangent;
-    vsOutput.bitangent = vsInput.bitangent;
+    // Instances are placed with rotation and uniform scale, so the basis also transforms the frame.
+    // The pixel shaders renormalize it.
+    vsOutput.normal = mul((float3x3)instanceToWorld, vsInput.normal);
+    vsOutput.tangent = mul((float3x3)instanceToWorld, vsInput.tangent);
+    vsOutput.bitangent = mul((float3x3)instanceToWorld, vsInput.bitangent);
 
     return vsOutput;
 }
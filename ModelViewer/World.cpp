@@ -9,18 +9,65 @@ namespace SceneView
 	World::World()
 	:m_models(), 
 	m_CameraController (std::make_unique <CameraController>(m_Camera, Vector3(kYUnitVector))),
-	m_lighting(std::make_unique <Lighting>())
+	m_lighting(std::make_unique <Lighting>()),
+	m_textureHeap(4096, 64)
 	{
 		s_world = this;
 	}
 
-	void World::AddModel(const std::string& filename)
+	U32 World::AddModel(const std::string& filename, const AffineTransform& transform)
 	{
+		const auto found = m_modelIndices.find(filename);
+		if (found != m_modelIndices.end())
+		{
+			m_instances[found->second].transforms.push_back(transform);
+			return found->second;
+		}
+
 		AssimpModel model;;
 		ASSERT(model.Load(filename.c_str()), "Failed to load model:" );
 		model.PrintInfo();
 		m_models.emplace_back(std::move(model));
 
+		const U32 modelIndex = static_cast<U32>(m_models.size() - 1);
+		m_modelIndices.emplace(filename, modelIndex);
+		m_instances.emplace_back();
+		m_instances.back().transforms.push_back(transform);
+		return modelIndex;
+	}
+
+	U32 World::FindModel(const std::string& filename) const
+	{
+		const auto found = m_modelIndices.find(filename);
+		return found == m_modelIndices.end() ? kInvalidModel : found->second;
+	}
+
+	void World::SetModelInstances(U32 modelIndex, const std::vector<AffineTransform>& transforms)
+	{
+		ASSERT(modelIndex < m_instances.size());
+		m_instances[modelIndex].transforms = transforms;
+	}
+
+	void World::UpdateInstances()
+	{
+		std::vector<InstanceTransform> instanceTransforms;
+		for (ModelInstances& instances : m_instances)
+		{
+			instances.firstInstance = static_cast<U32>(instanceTransforms.size());
+			for (const AffineTransform& transform : instances.transforms)
+			{
+				const Vector3 x = transform.GetX(), y = transform.GetY(), z = transform.GetZ(), w = transform.GetTranslation();
+				InstanceTransform instance;
+				instance.rows[0] = { x.GetX(), y.GetX(), z.GetX(), w.GetX() };
+				instance.rows[1] = { x.GetY(), y.GetY(), z.GetY(), w.GetY() };
+				instance.rows[2] = { x.GetZ(), y.GetZ(), z.GetZ(), w.GetZ() };
+				instanceTransforms.push_back(instance);
+			}
+		}
+
+		m_instanceBuffer.Destroy();
+		m_instanceBuffer.Create(L"Model Instances", static_cast<U32>(instanceTransforms.size()), sizeof(InstanceTransform), instanceTransforms.data());
+		CaculateBoundingBox();
 	}
 
 	void World::Create()
@@ -34,7 +81,8 @@ namespace SceneView
 #else
 		AddModel("Models/sponza.h3d");
 #endif
-		CaculateBoundingBox();
+		UpdateInstances();
+		CreateMaterials();
 		//lights 
 		m_lighting->InitializeResources();
 		m_lighting->CreateRandomLights(GetBoundingBox().min, GetBoundingBox().max);
@@ -56,13 +104,51 @@ namespace SceneView
 	void World::Clear()
 	{
 		m_lighting->Shutdown();
+		m_instanceBuffer.Destroy();
+		m_materialBuffer.Destroy();
+		m_textureHeap.Destroy();
+	}
+
+	void World::CreateMaterials()
+	{
+		m_textureHeap.Create(L"Bindless Textures");
+
+		std::vector<MaterialConstants> materials;
+		for (size_t modelIndex = 0; modelIndex < m_models.size(); modelIndex++)
+		{
+			const Model& model = m_models[modelIndex];
+			m_instances[modelIndex].firstMaterial = static_cast<U32>(materials.size());
+			for (U32 materialIdx = 0; materialIdx < model.m_Header.materialCount; materialIdx++)
+			{
+				const Model::Material& source = model.m_pMaterial[materialIdx];
+				const D3D12_CPU_DESCRIPTOR_HANDLE* srvs = model.GetSRVs(materialIdx);
+				MaterialConstants material = {};
+				for (U32 slot = 0; slot < _countof(material.textureIndices); slot++)
+					material.textureIndices[slot] = m_textureHeap.AddTexture(srvs[slot]);
+				material.flags = model.MaterialIsCutout(materialIdx) ? kMaterialCutout : 0;
+				material.opacity = source.opacity;
+				material.diffuse = { source.diffuse.GetX(), source.diffuse.GetY(), source.diffuse.GetZ() };
+				material.shininess = source.shininess;
+				material.specular = { source.specular.GetX(), source.specular.GetY(), source.specular.GetZ() };
+				material.specularStrength = source.specularStrength;
+				material.emissive = { source.emissive.GetX(), source.emissive.GetY(), source.emissive.GetZ() };
+				materials.push_back(material);
+			}
+		}
+
+		m_materialBuffer.Create(L"Material Table", static_cast<U32>(materials.size()), sizeof(MaterialConstants), materials.data());
 	}
 
 	void World::CaculateBoundingBox()
 	{
-		ForEach([&](Model& model) {
-			m_boundingbox.min = Min(m_boundingbox.min, model.GetBoundingBox().min);
-			m_boundingbox.max = Max(m_boundingbox.max, model.GetBoundingBox().max);
+		m_boundingbox = BoundingBox();
+		ForEachInstanced([&](Model& model, const ModelInstances& instances) {
+			for (const AffineTransform& transform : instances.transforms)
+			{
+				const BoundingBox box = TransformBoundingBox(model.GetBoundingBox(), transform);
+				m_boundingbox.min = Min(m_boundingbox.min, box.min);
+				m_boundingbox.max = Max(m_boundingbox.max, box.max);
+			}
 		});
 	}
 }
\ No newline at end of file
@@ -5,12 +5,49 @@
 #include "CameraController.h"
 #include "Camera.h"
 #include "Light.hpp"
+#include "BindlessTextureHeap.h"
+#include <unordered_map>
 
 using namespace Math;
 using namespace GameCore;
 
 namespace SceneView
 {
+	// Rows of an AffineTransform, streamed per instance to the vertex shaders.
+	struct InstanceTransform
+	{
+		F32x4 rows[3];
+	};
+
+	// Placements of one model asset.  Its instances occupy a contiguous range of the instance buffer,
+	// and its materials a contiguous range of the material table starting at firstMaterial.
+	struct ModelInstances
+	{
+		std::vector<AffineTransform> transforms;
+		U32 firstInstance = 0;
+		U32 firstMaterial = 0;
+	};
+
+	// One entry of the material table; mirrors MaterialConstants in Shaders/Materials.hlsli.
+	// textureIndices index the bindless texture table, in the slot order of Model::GetSRVs.
+	struct MaterialConstants
+	{
+		U32 textureIndices[6];
+		U32 flags;
+		F32 opacity;
+		F32x3 diffuse;
+		F32 shininess;
+		F32x3 specular;
+		F32 specularStrength;
+		F32x3 emissive;
+		F32 _;
+	};
+
+	enum MaterialFlags : U32
+	{
+		kMaterialCutout = 0x1,
+	};
+
 	class World final
 	{
 	public:
@@ -22,7 +59,19 @@ namespace SceneView
 
 		World();
 
-		void AddModel(const std::string& filename);
+		// Loads each file once; adding a file again places another instance of the same asset.
+		U32 AddModel(const std::string& filename, const AffineTransform& transform = AffineTransform(kIdentity));
+
+		// Replaces every placement of a model.  UpdateInstances must be called before the next frame.
+		void SetModelInstances(U32 modelIndex, const std::vector<AffineTransform>& transforms);
+
+		// Uploads the instance transforms and recomputes the world bounds.  The GPU must not be using the old buffer.
+		void UpdateInstances();
+
+		static constexpr U32 kInvalidModel = ~0u;
+
+		// The index AddModel returned for the file, or kInvalidModel if it was never added.
+		U32 FindModel(const std::string& filename) const;
 
 		void Create();
 
@@ -41,6 +90,14 @@ namespace SceneView
 
 		inline Camera& GetMainCamera() noexcept { return m_Camera; }
 
+		inline const StructuredBuffer& GetInstanceBuffer() const noexcept { return m_instanceBuffer; }
+
+		inline U32 GetInstanceCount() const noexcept { return m_instanceBuffer.GetElementCount(); }
+
+		inline const StructuredBuffer& GetMaterialBuffer() const noexcept { return m_materialBuffer; }
+
+		inline BindlessTextureHeap& GetTextureHeap() noexcept { return m_textureHeap; }
+
         [[nodiscard]]
 		NotNull<Lighting*> GetLighting() noexcept { return NotNull<Lighting*>(m_lighting.get()); }
 
@@ -55,10 +112,22 @@ namespace SceneView
 			}
 		}
 
+		template<typename ActionT >
+		void ForEachInstanced(ActionT&& action)
+		{
+			for (size_t i = 0; i < m_models.size(); i++)
+			{
+				action(m_models[i], static_cast<const ModelInstances&>(m_instances[i]));
+			}
+		}
+
 	private:
 
 		void CaculateBoundingBox();
 
+		// Adds every model texture to the bindless table once and uploads the material table.
+		void CreateMaterials();
+
 		Camera m_Camera;
 
 		const std::unique_ptr<Lighting> m_lighting;
@@ -67,6 +136,16 @@ namespace SceneView
 
 		BoundingBox m_boundingbox;
 
+		std::vector<ModelInstances> m_instances;
+
+		std::unordered_map<std::string, U32> m_modelIndices;
+
+		StructuredBuffer m_instanceBuffer;
+
+		BindlessTextureHeap m_textureHeap;
+
+		StructuredBuffer m_materialBuffer;
+
 		static World* s_world;
 	};
 }
@@ -0,0 +1,239 @@
+//
+// Replays a clipmap trace (see Core/ClipmapTrace.h) through the clipmap planner without a device, and reports how
+// many voxels each set of steps has revoxelized per frame, the frames that revoxelize the most and how many regions
+// the frames plan.  Every level is planned every frame, as with Voxel/Schedule/Enable off.  Record a trace with
+// Voxel/Record Camera Path.
+//
+
+#include "../../Core/ClipmapPlanner.h"
+#include "../../Core/ClipmapTrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+vector<vector<uint32_t>> g_minChanges;
+uint32_t g_peakCount = 5;
+bool g_histogram = true;
+
+// A single step applies to every level.
+void AddMinChanges( const char* list )
+{
+    vector<uint32_t> minChange;
+    for (const char* step = list; *step != '\0'; )
+    {
+        char* end;
+        const unsigned long voxels = strtoul(step, &end, 10);
+        if (end == step || voxels == 0 || (*end != ',' && *end != '\0'))
+            throw runtime_error("Invalid step");
+        minChange.push_back((uint32_t)voxels);
+        step = *end == ',' ? end + 1 : end;
+    }
+    g_minChanges.push_back(minChange);
+}
+
+struct ReplayFrame
+{
+    uint64_t voxels;
+    uint32_t regions;
+    uint32_t frame;
+};
+
+struct ReplayResult
+{
+    vector<ReplayFrame> frames;
+    vector<uint64_t> levelVoxels;
+    uint64_t voxels;
+    uint32_t regions;
+    uint32_t updatedFrames;
+};
+
+// The regions are placed on the boxes of the first frame, as Voxelization::Init places them, and follow the boxes
+// of every frame from there.
+ReplayResult Replay( const ClipmapTraceHeader& header, const vector<ClipmapTraceBox>& boxes, const vector<uint32_t>& minChange )
+{
+    const uint32_t levelCount = header.levelCount;
+    const int32_t halfExtent = int32_t(header.resolution / 2);
+    vector<ClipmapBox> regions(levelCount);
+    vector<float> voxelSizes(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        ClipmapBox& region = regions[level];
+        voxelSizes[level] = header.voxelSize * float(1u << level);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            region.minPos[axis] = -halfExtent;
+            region.extent[axis] = int32_t(header.resolution);
+        }
+        if (!boxes.empty())
+        {
+            int32_t delta[3];
+            ClipmapPlanner::ComputeDelta(region, voxelSizes[level], boxes[level].min, int32_t(minChange[level]), delta);
+            for (int axis = 0; axis < 3; ++axis)
+                region.minPos[axis] += delta[axis];
+        }
+    }
+
+    ReplayResult result = {};
+    result.levelVoxels.resize(levelCount, 0);
+    vector<ClipmapBox> slabs;
+    for (uint32_t frame = 0; frame < header.frameCount; ++frame)
+    {
+        ReplayFrame replayed = { 0, 0, frame };
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            slabs.clear();
+            const ClipmapTraceBox& box = boxes[size_t(frame) * levelCount + level];
+            replayed.regions += ClipmapPlanner::Move(regions[level], voxelSizes[level], box.min, int32_t(minChange[level]), slabs);
+            for (const ClipmapBox& slab : slabs)
+            {
+                const uint64_t voxels = ClipmapPlanner::CountVoxels(slab);
+                result.levelVoxels[level] += voxels;
+                replayed.voxels += voxels;
+            }
+        }
+        result.voxels += replayed.voxels;
+        result.regions += replayed.regions;
+        if (replayed.regions > 0)
+            result.updatedFrames++;
+        result.frames.push_back(replayed);
+    }
+    return result;
+}
+
+string FormatSteps( const vector<uint32_t>& minChange, uint32_t levelCount )
+{
+    string steps;
+    for (uint32_t level = 0; level < levelCount; ++level)
+        steps += (level ? "," : "") + to_string(minChange[level]);
+    return steps;
+}
+
+int main( int argc, const char** argv )
+{
+    string traceFile = "";
+
+    try
+    {
+        if (argc < 2)
+            throw runtime_error("No trace specified");
+        traceFile = argv[1];
+
+        for (int arg = 2; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (strcmp("-nohistogram", argv[arg]) == 0)
+                g_histogram = false;
+            else if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-minchange", argv[arg]) == 0)
+                AddMinChanges(argv[++arg]);
+            else if (strcmp("-peaks", argv[arg]) == 0)
+                g_peakCount = (uint32_t)atoi(argv[++arg]);
+            else
+                throw runtime_error("Invalid option");
+        }
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s <trace.bin> [options]*\n\n"
+            "Options:\n\n"
+            "-minchange <integer>[,<integer>]*\n\tSteps in voxels the clip regions move by, one per level or one for all.\n"
+            "\tRepeat to compare several.\n\tDefaults to the steps of the recording.\n"
+            "-peaks <integer>\n\tFrames that revoxelize the most to list per set of steps.\n\tDefaults to 5.\n"
+            "-nohistogram\n\tSkips the distribution of regions per frame.\n"
+            "\n\nExample:  %s ClipmapTrace.bin -minchange 2,2,2,2,2,1 -minchange 4 -minchange 8,4,2,2,1,1\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    ClipmapTraceHeader header;
+    vector<ClipmapTraceBox> boxes;
+    if (!LoadClipmapTrace(wstring(traceFile.begin(), traceFile.end()), header, boxes))
+    {
+        printf("Error: Unable to read trace %s\n", traceFile.c_str());
+        return 1;
+    }
+
+    if (g_minChanges.empty())
+        g_minChanges.push_back(vector<uint32_t>(header.minChange, header.minChange + header.levelCount));
+    for (vector<uint32_t>& minChange : g_minChanges)
+    {
+        if (minChange.size() == 1)
+            minChange.resize(header.levelCount, minChange[0]);
+        else if (minChange.size() != header.levelCount)
+        {
+            printf("Error: The trace has %u levels, steps were given for %u\n", header.levelCount, (uint32_t)minChange.size());
+            return 1;
+        }
+    }
+
+    const uint64_t levelVoxels = uint64_t(header.resolution) * header.resolution * header.resolution;
+    printf("%s: %u frames, %u levels of %u^3 voxels, level 0 voxels of %g\n\n", traceFile.c_str(), header.frameCount,
+        header.levelCount, header.resolution, header.voxelSize);
+    printf("%-24s %14s %14s %11s %15s %14s %12s\n", "Steps", "Voxels/frame", "Peak voxels", "% of level", "Updated frames", "Regions/frame", "Max regions");
+
+    vector<ReplayResult> results;
+    for (const vector<uint32_t>& minChange : g_minChanges)
+    {
+        results.push_back(Replay(header, boxes, minChange));
+        const ReplayResult& result = results.back();
+        const double frames = max(double(header.frameCount), 1.0);
+        uint64_t peakVoxels = 0;
+        uint32_t maxRegions = 0;
+        for (const ReplayFrame& frame : result.frames)
+        {
+            peakVoxels = max(peakVoxels, frame.voxels);
+            maxRegions = max(maxRegions, frame.regions);
+        }
+        printf("%-24s %14.0f %14llu %10.2f%% %15u %14.2f %12u\n", FormatSteps(minChange, header.levelCount).c_str(),
+            double(result.voxels) / frames, (unsigned long long)peakVoxels, 100.0 * double(peakVoxels) / double(levelVoxels),
+            result.updatedFrames, double(result.regions) / frames, maxRegions);
+    }
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const ReplayResult& result = results[i];
+        const double frames = max(double(header.frameCount), 1.0);
+        printf("\nSteps %s\n", FormatSteps(g_minChanges[i], header.levelCount).c_str());
+
+        printf("  Voxels/frame per level:");
+        for (uint64_t voxels : result.levelVoxels)
+            printf(" %.0f", double(voxels) / frames);
+        printf("\n");
+
+        vector<ReplayFrame> peaks = result.frames;
+        const size_t peakCount = min<size_t>(g_peakCount, peaks.size());
+        partial_sort(peaks.begin(), peaks.begin() + peakCount, peaks.end(), []( const ReplayFrame& a, const ReplayFrame& b )
+        {
+            return a.voxels != b.voxels ? a.voxels > b.voxels : a.frame < b.frame;
+        });
+        for (size_t peak = 0; peak < peakCount && peaks[peak].voxels > 0; ++peak)
+            printf("  Peak frame %6u: %12llu voxels in %u regions\n", peaks[peak].frame, (unsigned long long)peaks[peak].voxels, peaks[peak].regions);
+
+        if (!g_histogram)
+            continue;
+        vector<uint32_t> histogram;
+        for (const ReplayFrame& frame : result.frames)
+        {
+            if (frame.regions >= histogram.size())
+                histogram.resize(frame.regions + 1, 0);
+            histogram[frame.regions]++;
+        }
+        printf("  Regions  Frames\n");
+        for (size_t regions = 0; regions < histogram.size(); ++regions)
+        {
+            if (histogram[regions] > 0)
+                printf("  %7u  %6u  %6.2f%%\n", (uint32_t)regions, histogram[regions], 100.0 * double(histogram[regions]) / frames);
+        }
+    }
+    return 0;
+}
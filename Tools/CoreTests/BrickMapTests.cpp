@@ -0,0 +1,227 @@
+//
+// The slot allocator and the brick map of BrickMap: slot reuse, the indirection of a scrolling clipmap against one
+// built from scratch, and growing the atlas when it is full.
+//
+
+#include "CoreTests.h"
+#include "../../Core/BrickMap.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    void TestAllocator()
+    {
+        BrickAllocator allocator;
+        allocator.Reset(4);
+        bool lowFirst = true;
+        for (uint32_t slot = 0; slot < 4; ++slot)
+            lowFirst &= allocator.Allocate() == slot;
+        CHECK(lowFirst);
+        CHECK(allocator.Allocate() == INVALID_BRICK);
+        CHECK(allocator.GetAllocatedCount() == 4);
+
+        // Freed slots are handed out again, the last freed first.
+        allocator.Free(2);
+        allocator.Free(0);
+        CHECK(allocator.GetAllocatedCount() == 2);
+        CHECK(allocator.Allocate() == 0);
+        CHECK(allocator.Allocate() == 2);
+
+        // Growing keeps the slots taken and adds the new ones, low first.
+        allocator.Free(1);
+        allocator.Grow(6);
+        CHECK(allocator.GetCapacity() == 6);
+        CHECK(allocator.Allocate() == 1);
+        CHECK(allocator.Allocate() == 4);
+        CHECK(allocator.Allocate() == 5);
+        CHECK(allocator.Allocate() == INVALID_BRICK);
+        CHECK(allocator.GetAllocatedCount() == 6);
+    }
+
+    // The bricks of the level that should have a slot: those holding a voxel of the clip region inside the voxel
+    // range of a box, with the margin BrickMap gives it.
+    vector<bool> ReferenceOccupancy( const BrickMap& map, int32_t resolution, const ClipmapBox& clipRegion, float voxelSize,
+        const MeshBoundsSoA& boxes )
+    {
+        const int32_t bricksPerAxis = map.GetBricksPerAxis();
+        vector<bool> occupied(size_t(bricksPerAxis) * bricksPerAxis * bricksPerAxis);
+        for (uint32_t i = 0; i < boxes.GetMeshCount(); ++i)
+        {
+            float minBound[3], maxBound[3];
+            boxes.GetBounds(i, minBound, maxBound);
+            int32_t minPos[3], maxPos[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                minPos[axis] = max(int32_t(floor(minBound[axis] / voxelSize)) - 1, clipRegion.minPos[axis]);
+                maxPos[axis] = min(int32_t(floor(maxBound[axis] / voxelSize)) + 2, clipRegion.minPos[axis] + clipRegion.extent[axis]);
+            }
+            for (int32_t z = minPos[2]; z < maxPos[2]; ++z)
+                for (int32_t y = minPos[1]; y < maxPos[1]; ++y)
+                    for (int32_t x = minPos[0]; x < maxPos[0]; ++x)
+                    {
+                        const int32_t brick[3] = { (x & (resolution - 1)) / BRICK_SIZE, (y & (resolution - 1)) / BRICK_SIZE,
+                            (z & (resolution - 1)) / BRICK_SIZE };
+                        occupied[(brick[2] * bricksPerAxis + brick[1]) * bricksPerAxis + brick[0]] = true;
+                    }
+        }
+        return occupied;
+    }
+
+    // Whether the level's bricks have a slot exactly where the reference wants one, every slot inside the atlas and
+    // none given twice.
+    bool MatchesReference( const BrickMap& map, uint32_t levelCount, const vector<vector<bool>>& reference )
+    {
+        const vector<uint32_t>& indirection = map.GetIndirection();
+        const size_t levelBricks = indirection.size() / levelCount;
+        vector<bool> taken(map.GetStats().capacity);
+        uint32_t slots = 0;
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            for (size_t brick = 0; brick < levelBricks; ++brick)
+            {
+                const uint32_t slot = indirection[level * levelBricks + brick];
+                if ((slot != INVALID_BRICK) != reference[level][brick])
+                    return false;
+                if (slot == INVALID_BRICK)
+                    continue;
+                if (slot >= taken.size() || taken[slot])
+                    return false;
+                taken[slot] = true;
+                slots++;
+            }
+        }
+        return slots == map.GetStats().allocated;
+    }
+
+    void TestIndirection()
+    {
+        // A box of world [0.5, 1.5] in a level of voxel size 1 covers voxels -1 to 2 with the margin, so it wraps
+        // onto the last and the first brick of every axis.
+        const int32_t resolution = 32;
+        BrickMap map;
+        map.Reset(2, resolution, BRICK_ATLAS_LAYER);
+        MeshBoundsSoA boxes;
+        const float minBound[3] = { 0.5f, 0.5f, 0.5f }, maxBound[3] = { 1.5f, 1.5f, 1.5f };
+        boxes.Add(minBound, maxBound, 0, 0, 12);
+        ClipmapBox clipRegion = { { -16, -16, -16 }, { resolution, resolution, resolution } };
+        map.BeginFrame();
+        map.UpdateRegion(0, clipRegion, 1.0f, clipRegion, { &boxes });
+        CHECK(map.IsDirty());
+        CHECK(map.GetStats().newBricks == 8 && map.GetNewBricks().size() == 8 && map.GetStats().allocated == 8);
+        const int32_t inside[3] = { 1, 1, 1 }, wrapped[3] = { 31, 0, 31 }, empty[3] = { 9, 1, 1 };
+        CHECK(map.GetSlot(0, inside) != INVALID_BRICK);
+        CHECK(map.GetSlot(0, wrapped) != INVALID_BRICK);
+        CHECK(map.GetSlot(0, empty) == INVALID_BRICK);
+        // The other level is untouched.
+        CHECK(map.GetSlot(1, inside) == INVALID_BRICK);
+
+        // Scrolling the box out of the clip region frees its bricks.
+        map.BeginFrame();
+        const ClipmapBox slab = { { 16, -16, -16 }, { 24, resolution, resolution } };
+        clipRegion.minPos[0] = 8;
+        map.UpdateRegion(0, clipRegion, 1.0f, slab, { &boxes });
+        CHECK(map.GetStats().freedBricks == 8 && map.GetStats().allocated == 0 && map.GetNewBricks().empty());
+        CHECK(map.GetSlot(0, inside) == INVALID_BRICK && map.GetSlot(0, wrapped) == INVALID_BRICK);
+    }
+
+    // Clip regions follow a random camera through random boxes; after every frame's slabs the indirection has to
+    // match one built from scratch for the new clip regions.
+    void TestScrolling( mt19937& random )
+    {
+        const int32_t resolution = 64;
+        const uint32_t levelCount = 2;
+        const float voxelSizes[levelCount] = { 0.5f, 1.0f };
+        uniform_real_distribution<float> position(-60.0f, 60.0f), size(0.0f, 6.0f), step(-12.0f, 12.0f);
+        MeshBoundsSoA boxes;
+        for (uint32_t i = 0; i < 60; ++i)
+        {
+            const float minBound[3] = { position(random), position(random) * 0.25f, position(random) };
+            const float maxBound[3] = { minBound[0] + size(random), minBound[1] + size(random), minBound[2] + size(random) };
+            boxes.Add(minBound, maxBound, i, 0, 12);
+        }
+
+        BrickMap map;
+        map.Reset(levelCount, resolution, 4 * BRICK_ATLAS_LAYER);
+        ClipmapBox clipRegions[levelCount];
+        float camera[3] = { 0.0f, 0.0f, 0.0f };
+        bool matched = true;
+        for (uint32_t frame = 0; frame < 60; ++frame)
+        {
+            map.BeginFrame();
+            vector<vector<bool>> reference;
+            for (uint32_t level = 0; level < levelCount; ++level)
+            {
+                float boxMin[3];
+                for (int axis = 0; axis < 3; ++axis)
+                    boxMin[axis] = camera[axis] - resolution / 2 * voxelSizes[level];
+                vector<ClipmapBox> slabs;
+                if (frame == 0)
+                {
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        clipRegions[level].minPos[axis] = int32_t(floor(boxMin[axis] / voxelSizes[level]));
+                        clipRegions[level].extent[axis] = resolution;
+                    }
+                    slabs.push_back(clipRegions[level]);
+                }
+                else
+                    ClipmapPlanner::Move(clipRegions[level], voxelSizes[level], boxMin, 2, slabs);
+                for (const ClipmapBox& slab : slabs)
+                    map.UpdateRegion(level, clipRegions[level], voxelSizes[level], slab, { &boxes });
+                reference.push_back(ReferenceOccupancy(map, resolution, clipRegions[level], voxelSizes[level], boxes));
+            }
+            matched &= MatchesReference(map, levelCount, reference);
+            for (int axis = 0; axis < 3; ++axis)
+                camera[axis] += step(random) * (axis == 1 ? 0.25f : 1.0f);
+        }
+        CHECK(matched);
+        CHECK(map.GetStats().totalOverflows == 0);
+    }
+
+    // A box over every brick of three levels needs more slots than the atlas starts with.
+    void TestOverflow()
+    {
+        const int32_t resolution = 64;
+        BrickMap map;
+        map.Reset(3, resolution, BRICK_ATLAS_LAYER);
+        MeshBoundsSoA boxes;
+        const float minBound[3] = { -200.0f, -200.0f, -200.0f }, maxBound[3] = { 200.0f, 200.0f, 200.0f };
+        boxes.Add(minBound, maxBound, 0, 0, 12);
+        const ClipmapBox clipRegion = { { -32, -32, -32 }, { resolution, resolution, resolution } };
+
+        map.BeginFrame();
+        map.UpdateRegion(0, clipRegion, 1.0f, clipRegion, { &boxes });
+        // 512 bricks in a level: the atlas grows by whole layers instead of dropping any.
+        CHECK(map.GetStats().overflows == 1);
+        CHECK(map.GetStats().capacity == 2 * BRICK_ATLAS_LAYER);
+        CHECK(map.GetStats().allocated == 512 && map.GetNewBricks().size() == 512);
+
+        map.UpdateRegion(1, clipRegion, 2.0f, clipRegion, { &boxes });
+        map.UpdateRegion(2, clipRegion, 4.0f, clipRegion, { &boxes });
+        // A slot for every brick is the most it needs, the dense layout.
+        CHECK(map.GetStats().capacity == 6 * BRICK_ATLAS_LAYER);
+        CHECK(map.GetStats().allocated == 1536);
+        vector<vector<bool>> reference(3, vector<bool>(512, true));
+        CHECK(MatchesReference(map, 3, reference));
+        CHECK(map.GetStats().totalOverflows == map.GetStats().overflows);
+
+        // The next frame starts a new count, and the grown atlas stays.
+        map.BeginFrame();
+        CHECK(map.GetStats().overflows == 0 && map.GetStats().totalOverflows > 0);
+        CHECK(map.GetStats().capacity == 6 * BRICK_ATLAS_LAYER);
+    }
+}
+
+void TestBrickMap()
+{
+    mt19937 random(8807);
+    TestAllocator();
+    TestIndirection();
+    TestScrolling(random);
+    TestOverflow();
+}
@@ -0,0 +1,142 @@
+//
+// The mapping of ClipmapClear from the threads of a clear dispatch to image coordinates, on regions that wrap around
+// the image of their level.
+//
+
+#include "CoreTests.h"
+#include "../../Core/ClipmapClear.h"
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const int32_t kResolution = 16;
+    const uint32_t kLevels = 3;
+
+    // The voxel of an image coordinate, as the shader finds it, for every thread of the dispatch.
+    void GetDispatchCoords( const vector<ClipmapClearRegion>& regions, uint32_t voxel, uint32_t& level, int32_t imageCoords[3] )
+    {
+        const ClipmapClearRegion& region = regions[ClipmapClear::FindRegion(regions, voxel)];
+        level = static_cast<uint32_t>(region.clipmapLevel);
+        ClipmapClear::GetImageCoords(region, voxel, kResolution, imageCoords);
+    }
+
+    uint32_t GetImageIndex( uint32_t level, const int32_t imageCoords[3] )
+    {
+        return ((level * kResolution + imageCoords[2]) * kResolution + imageCoords[1]) * kResolution + imageCoords[0];
+    }
+
+    int32_t Wrap( int32_t position )
+    {
+        return (position % kResolution + kResolution) % kResolution;
+    }
+
+    // A region straddling the image's far side on x and starting below zero on z.
+    void TestWrappedRegion()
+    {
+        vector<ClipmapClearRegion> regions;
+        ClipmapClear::AppendRegion(regions, ClipmapBox{ { 13, 2, -2 }, { 6, 1, 4 } }, 1, kResolution);
+        CHECK(regions[0].imageMin[0] == 13 && regions[0].imageMin[1] == 2 && regions[0].imageMin[2] == 14);
+        CHECK(ClipmapClear::CountVoxels(regions) == 24);
+
+        const int32_t expectedX[6] = { 13, 14, 15, 0, 1, 2 };
+        const int32_t expectedZ[4] = { 14, 15, 0, 1 };
+        for (uint32_t voxel = 0; voxel < 24; ++voxel)
+        {
+            uint32_t level;
+            int32_t imageCoords[3];
+            GetDispatchCoords(regions, voxel, level, imageCoords);
+            CHECK(level == 1);
+            CHECK(imageCoords[0] == expectedX[voxel % 6] && imageCoords[1] == 2 && imageCoords[2] == expectedZ[voxel / 6]);
+        }
+
+        // Regions a whole number of images away clear the same voxels.
+        vector<ClipmapClearRegion> shifted;
+        ClipmapClear::AppendRegion(shifted, ClipmapBox{ { 13 - 3 * kResolution, 2 + kResolution, -2 + 5 * kResolution }, { 6, 1, 4 } }, 1, kResolution);
+        CHECK(shifted[0].imageMin[0] == 13 && shifted[0].imageMin[1] == 2 && shifted[0].imageMin[2] == 14);
+    }
+
+    // Clip regions of several levels follow a random camera; each frame the slabs they move into, wrapped around the
+    // image, must be cleared exactly once per voxel, and no other voxel.
+    void TestMovingClipmap( mt19937& random )
+    {
+        uniform_real_distribution<float> step(-9.0f, 9.0f);
+        ClipmapBox clipRegions[kLevels];
+        float voxelSizes[kLevels];
+        float camera[3] = { 3.0f, -5.0f, 11.0f };
+        for (uint32_t level = 0; level < kLevels; ++level)
+        {
+            voxelSizes[level] = float(1 << level);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                clipRegions[level].minPos[axis] = int32_t(camera[axis] / voxelSizes[level]) - kResolution / 2;
+                clipRegions[level].extent[axis] = kResolution;
+            }
+        }
+
+        vector<uint32_t> cleared(kLevels * kResolution * kResolution * kResolution);
+        vector<uint32_t> expected(cleared.size());
+        uint32_t wrappedRegions = 0;
+        for (uint32_t frame = 1; frame <= 40; ++frame)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                camera[axis] += step(random);
+
+            vector<ClipmapClearRegion> regions;
+            for (uint32_t level = 0; level < kLevels; ++level)
+            {
+                float boxMin[3];
+                for (int axis = 0; axis < 3; ++axis)
+                    boxMin[axis] = camera[axis] - kResolution / 2 * voxelSizes[level];
+                vector<ClipmapBox> slabs;
+                ClipmapPlanner::Move(clipRegions[level], voxelSizes[level], boxMin, 1, slabs);
+                for (const ClipmapBox& slab : slabs)
+                {
+                    ClipmapClear::AppendRegion(regions, slab, level, kResolution);
+                    for (int32_t z = 0; z < slab.extent[2]; ++z)
+                        for (int32_t y = 0; y < slab.extent[1]; ++y)
+                            for (int32_t x = 0; x < slab.extent[0]; ++x)
+                            {
+                                const int32_t imageCoords[3] = { Wrap(slab.minPos[0] + x), Wrap(slab.minPos[1] + y), Wrap(slab.minPos[2] + z) };
+                                expected[GetImageIndex(level, imageCoords)] = frame;
+                            }
+                    for (int axis = 0; axis < 3; ++axis)
+                        wrappedRegions += Wrap(slab.minPos[axis]) + slab.extent[axis] > kResolution ? 1 : 0;
+                }
+            }
+
+            bool inImage = true, clearedOnce = true;
+            const uint32_t voxelCount = ClipmapClear::CountVoxels(regions);
+            for (uint32_t voxel = 0; voxel < voxelCount; ++voxel)
+            {
+                uint32_t level;
+                int32_t imageCoords[3];
+                GetDispatchCoords(regions, voxel, level, imageCoords);
+                for (int axis = 0; axis < 3; ++axis)
+                    inImage &= imageCoords[axis] >= 0 && imageCoords[axis] < kResolution;
+                if (!inImage)
+                    break;
+                uint32_t& mark = cleared[GetImageIndex(level, imageCoords)];
+                clearedOnce &= mark != frame;
+                mark = frame;
+            }
+            CHECK(inImage);
+            CHECK(clearedOnce);
+            bool clearedExpected = true;
+            for (size_t i = 0; i < cleared.size(); ++i)
+                clearedExpected &= (cleared[i] == frame) == (expected[i] == frame);
+            CHECK(clearedExpected);
+        }
+        // The camera path wraps regions around the image, so the checks above cover the seam.
+        CHECK(wrappedRegions > 0);
+    }
+}
+
+void TestClipmapClear()
+{
+    mt19937 random(5113);
+    TestWrappedRegion();
+    TestMovingClipmap(random);
+}
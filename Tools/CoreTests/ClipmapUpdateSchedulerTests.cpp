@@ -0,0 +1,146 @@
+//
+// The level scheduling of ClipmapUpdateScheduler: the cadence of the levels, the budget cutoff and overdue levels,
+// and the throughput estimate, which pairs every GPU time with its own frame's voxels and skips idle frames.
+//
+
+#include "CoreTests.h"
+#include "../../Core/ClipmapUpdateScheduler.h"
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t kLevelCount = 5;
+
+    // The throughput the next Schedule estimates with.
+    float GetVoxelsPerMs( ClipmapUpdateScheduler& scheduler, uint64_t frame )
+    {
+        scheduler.Schedule(frame, vector<uint64_t>(kLevelCount, 0), 1, 1.0f, 8);
+        return scheduler.GetStats().voxelsPerMs;
+    }
+
+    // Level k falls due every 2^k frames with a shift of 1, and no two coarser levels on the same frame.  With every
+    // level cheap, the levels updated are the ones due.
+    void TestCadence()
+    {
+        ClipmapUpdateScheduler scheduler;
+        scheduler.Reset(kLevelCount);
+        const vector<uint64_t> levelVoxels(kLevelCount, 1);
+        uint32_t dueCounts[kLevelCount] = {};
+        uint64_t lastDue[kLevelCount] = {};
+        bool evenlySpaced = true, apart = true, updatedWhenDue = true;
+        const uint64_t frameCount = 64;
+        for (uint64_t frame = 0; frame < frameCount; ++frame)
+        {
+            uint32_t due = 0, coarseDue = 0;
+            for (uint32_t level = 0; level < kLevelCount; ++level)
+            {
+                if (!ClipmapUpdateScheduler::IsDue(level, frame, 1))
+                    continue;
+                due |= 1u << level;
+                coarseDue += level > 0;
+                evenlySpaced &= dueCounts[level] == 0 || frame - lastDue[level] == 1ull << level;
+                dueCounts[level]++;
+                lastDue[level] = frame;
+            }
+            apart &= coarseDue <= 1;
+            updatedWhenDue &= scheduler.Schedule(frame, levelVoxels, 1, 1.0f, 8) == due;
+        }
+        CHECK(evenlySpaced && apart && updatedWhenDue);
+        bool counted = true;
+        for (uint32_t level = 0; level < kLevelCount; ++level)
+            counted &= dueCounts[level] == frameCount >> level;
+        CHECK(counted);
+
+        // A shift of 0 updates every level every frame.
+        CHECK(ClipmapUpdateScheduler::IsDue(kLevelCount - 1, 7, 0));
+        CHECK(scheduler.Schedule(frameCount, levelVoxels, 0, 1.0f, 8) == (1u << kLevelCount) - 1);
+    }
+
+    // With a shift of 3 only level 0 falls due in the first frames: level 1 at frame 3, level 2 at frame 31.
+    void TestBudget()
+    {
+        ClipmapUpdateScheduler scheduler;
+        scheduler.Reset(4);
+        // 1000 voxels per millisecond.
+        scheduler.RecordVoxels(0, 1000);
+        scheduler.Measure(0, 1.0f);
+
+        for (uint32_t level = 0; level < 4; ++level)
+            scheduler.Request(level, 1);
+        const vector<uint64_t> levelVoxels = { 600, 300, 200, 500 };
+
+        // Finest first while the estimate fits: 0.6 and 0.9 ms, then 1.1 ms is over.
+        CHECK(scheduler.Schedule(1, levelVoxels, 3, 1.0f, 8) == 0x3);
+        CHECK(scheduler.GetStats().deferredLevels == 0xc && scheduler.GetStats().maxWait == 0);
+        CHECK(fabs(scheduler.GetStats().estimatedMs - 0.9f) < 1e-4f && scheduler.GetStats().scheduledVoxels == 900);
+        CHECK(fabs(scheduler.GetStats().voxelsPerMs - 1000.0f) < 1e-2f);
+
+        // Level 1 is done; levels 2 and 3 still wait behind level 0.
+        CHECK(scheduler.Schedule(2, levelVoxels, 3, 1.0f, 8) == 0x5);
+        CHECK(scheduler.GetStats().deferredLevels == 0x8 && scheduler.GetStats().maxWait == 1);
+
+        // The first level in line is taken whatever the budget.
+        CHECK(scheduler.Schedule(3, levelVoxels, 3, 0.1f, 8) == 0x1);
+        CHECK(scheduler.GetStats().deferredLevels == 0xa && scheduler.GetStats().maxWait == 2);
+
+        // Overdue levels go first, longest waiting first: level 3, pending since frame 1, before level 1 from frame 3.
+        CHECK(scheduler.Schedule(4, levelVoxels, 3, 0.6f, 3) == 0x8);
+        CHECK(scheduler.GetStats().deferredLevels == 0x3);
+        CHECK(scheduler.Schedule(5, levelVoxels, 3, 0.6f, 2) == 0x2);
+
+        // A pending level with nothing to do stops being pending without being counted.
+        scheduler.Request(2, 6);
+        CHECK(scheduler.Schedule(6, { 100, 0, 0, 0 }, 3, 1.0f, 8) == 0x1);
+        CHECK(scheduler.Schedule(7, levelVoxels, 3, 1.0f, 8) == 0x1 && scheduler.GetStats().deferredLevels == 0);
+    }
+
+    void TestMeasurements()
+    {
+        ClipmapUpdateScheduler scheduler;
+        scheduler.Reset(kLevelCount);
+        const float initial = GetVoxelsPerMs(scheduler, 0);
+        CHECK(initial > 0.0f);
+
+        // Idle frames, times without a measurement and frames never recorded leave the estimate alone.
+        scheduler.RecordVoxels(1, 0);
+        scheduler.Measure(1, 3.0f);
+        CHECK(scheduler.GetStats().measuredMs == 3.0f);
+        scheduler.RecordVoxels(2, 5000);
+        scheduler.Measure(2, 0.0f);
+        scheduler.Measure(3, 1.0f);
+        CHECK(GetVoxelsPerMs(scheduler, 4) == initial);
+
+        // Each time is paired with the voxels of its own frame, not the last frame's.
+        scheduler.RecordVoxels(5, 2000);
+        scheduler.RecordVoxels(6, 0);
+        scheduler.RecordVoxels(7, 4000);
+        scheduler.Measure(5, 2.0f);
+        CHECK(fabs(GetVoxelsPerMs(scheduler, 8) - 1000.0f) < 1e-2f);
+        scheduler.Measure(6, 5.0f);
+        CHECK(fabs(GetVoxelsPerMs(scheduler, 9) - 1000.0f) < 1e-2f);
+        // The averages move a tenth of the way: 2200 voxels in 2 ms.
+        scheduler.Measure(7, 2.0f);
+        CHECK(fabs(GetVoxelsPerMs(scheduler, 10) - 1100.0f) < 1e-2f);
+
+        // Frame 7's count is gone once kFrameHistory more frames are recorded.
+        for (uint64_t frame = 8; frame < 8 + ClipmapUpdateScheduler::kFrameHistory; ++frame)
+            scheduler.RecordVoxels(frame, 100);
+        scheduler.Measure(7, 0.01f);
+        CHECK(fabs(GetVoxelsPerMs(scheduler, 12) - 1100.0f) < 1e-2f);
+
+        scheduler.Reset(kLevelCount);
+        CHECK(GetVoxelsPerMs(scheduler, 0) == initial);
+        scheduler.Measure(11, 1.0f);
+        CHECK(GetVoxelsPerMs(scheduler, 1) == initial);
+    }
+}
+
+void TestClipmapUpdateScheduler()
+{
+    TestCadence();
+    TestBudget();
+    TestMeasurements();
+}
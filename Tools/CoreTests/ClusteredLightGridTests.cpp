@@ -0,0 +1,138 @@
+//
+// The clustered light assignment of ClusteredLightGrid: a light in one cluster only, and the separable Build, scalar
+// and SSE, cell by cell against the reference that tests every cluster's own planes, on an off-center projection
+// with partial edge tiles and with cells overflowing.
+//
+
+#include "CoreTests.h"
+#include "../../Core/ClusteredLightGrid.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // 100x60 pixels in 16 pixel tiles, so the last column and row are partial, and 4 slices from 1 to 100.
+    LightClusterDesc CreateDesc( uint32_t sliceCount, uint32_t cellCapacity )
+    {
+        LightClusterDesc desc = {};
+        desc.viewportWidth = 100;
+        desc.viewportHeight = 60;
+        desc.tileDim = 16;
+        desc.sliceCount = sliceCount;
+        desc.nearZ = 1.0f;
+        desc.farZ = 100.0f;
+        desc.projScaleX = 1.2f;
+        desc.projScaleY = 2.0f;
+        desc.projOffsetX = 0.1f;
+        desc.projOffsetY = -0.2f;
+        desc.cellCapacity = cellCapacity;
+        desc.bitMaskWords = 2;
+        return desc;
+    }
+
+    // Lights through the frustum and a little past it, none of them nearly touching a cluster boundary.
+    vector<LightClusterLight> CreateLights( mt19937& random, const LightClusterDesc& desc, uint32_t count )
+    {
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        vector<LightClusterLight> lights;
+        while (lights.size() < count)
+        {
+            LightClusterLight light;
+            const float depth = desc.nearZ * 0.5f + desc.farZ * 1.1f * unit(random) * unit(random);
+            light.pos[0] = ((unit(random) * 2.4f - 1.2f) - desc.projOffsetX) * depth / desc.projScaleX;
+            light.pos[1] = ((unit(random) * 2.4f - 1.2f) - desc.projOffsetY) * depth / desc.projScaleY;
+            light.pos[2] = -depth;
+            light.radius = 0.2f + 4.0f * unit(random);
+            light.type = uint32_t(random() % kLightClusterTypeCount);
+            if (!ClusteredLightGrid::IsNearBoundary(desc, light, 1e-4f))
+                lights.push_back(light);
+        }
+        return lights;
+    }
+
+    bool SameCells( const ClusteredLightGrid& grid, const ClusteredLightGrid& reference, const LightClusterDesc& desc )
+    {
+        const uint32_t cellWords = 1 + desc.cellCapacity;
+        for (uint32_t cluster = 0; cluster < reference.GetClusterCount(); ++cluster)
+        {
+            const uint32_t* cell = &grid.GetGrid()[size_t(cluster) * cellWords];
+            const uint32_t* expected = &reference.GetGrid()[size_t(cluster) * cellWords];
+            const uint32_t count = (expected[0] & 0xff) + ((expected[0] >> 8) & 0xff) + ((expected[0] >> 16) & 0xff);
+            if (memcmp(cell, expected, (1 + count) * sizeof(uint32_t)) != 0)
+                return false;
+        }
+        return grid.GetBitMask() == reference.GetBitMask();
+    }
+
+    bool SameStats( const LightClusterStats& a, const LightClusterStats& b )
+    {
+        return a.indices == b.indices && a.occupiedCells == b.occupiedCells && a.maxCellLights == b.maxCellLights &&
+            a.droppedIndices == b.droppedIndices;
+    }
+
+    // A small light at the center of the cluster of column 2, row 1 and slice 2 is in that cluster alone.
+    void TestSingleCluster()
+    {
+        const LightClusterDesc desc = CreateDesc(4, 8);
+        // Slice 2 spans depths 10 to 31.6.
+        const float depth = 18.0f;
+        const float ndcX = 2.0f * 40.0f / 100.0f - 1.0f;
+        const float ndcY = 1.0f - 2.0f * 24.0f / 60.0f;
+        LightClusterLight light = {};
+        light.pos[0] = (ndcX + desc.projOffsetX) * depth / desc.projScaleX;
+        light.pos[1] = (ndcY + desc.projOffsetY) * depth / desc.projScaleY;
+        light.pos[2] = -depth;
+        light.radius = 0.1f;
+        light.type = kLightClusterCone;
+        const vector<LightClusterLight> lights(1, light);
+
+        ClusteredLightGrid reference;
+        reference.BuildReference(desc, lights);
+        CHECK(reference.GetTileCountX() == 7 && reference.GetTileCountY() == 4);
+        const uint32_t cluster = (2 * 4 + 1) * 7 + 2;
+        const uint32_t cellWords = 1 + desc.cellCapacity;
+        CHECK(reference.GetGrid()[cluster * cellWords] == 1u << 8);
+        CHECK(reference.GetGrid()[cluster * cellWords + 1] == 0);
+        CHECK(reference.GetBitMask()[cluster * desc.bitMaskWords] == 1);
+        CHECK(reference.GetStats().indices == 1 && reference.GetStats().occupiedCells == 1);
+
+        for (int simd = 0; simd < 2; ++simd)
+        {
+            ClusteredLightGrid grid;
+            grid.Build(desc, lights, simd != 0);
+            CHECK(SameCells(grid, reference, desc));
+        }
+    }
+
+    // Build against the reference, scalar and SSE, for random lights.  A capacity of 8 overflows the crowded cells,
+    // so the same indices must be dropped too.
+    void TestAgainstReference( mt19937& random, uint32_t sliceCount, uint32_t cellCapacity )
+    {
+        const LightClusterDesc desc = CreateDesc(sliceCount, cellCapacity);
+        const vector<LightClusterLight> lights = CreateLights(random, desc, 200);
+        ClusteredLightGrid reference;
+        reference.BuildReference(desc, lights);
+        CHECK(reference.GetStats().occupiedCells > 0);
+
+        for (int simd = 0; simd < 2; ++simd)
+        {
+            ClusteredLightGrid grid;
+            grid.Build(desc, lights, simd != 0);
+            CHECK(SameCells(grid, reference, desc));
+            CHECK(SameStats(grid.GetStats(), reference.GetStats()));
+        }
+    }
+}
+
+void TestClusteredLightGrid()
+{
+    mt19937 random(3313);
+    TestSingleCluster();
+    TestAgainstReference(random, 4, 256);
+    TestAgainstReference(random, 1, 256);
+    TestAgainstReference(random, 4, 8);
+}
@@ -0,0 +1,245 @@
+//
+// The cone trace upsample and resolve of ConeTraceUpsample: the depth and normal weights, texels hit exactly and
+// across a depth edge, the closest depth fallback, the jitter covering its block over the period, and the temporal
+// blend converging on a static view and dropping history off screen and where the depth does not match.
+//
+
+#include "CoreTests.h"
+#include "../../Core/ConeTraceUpsample.h"
+#include <cmath>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const float kUp[3] = { 0.0f, 1.0f, 0.0f };
+
+    bool Near( float a, float b )
+    {
+        return fabs(a - b) < 1e-5f;
+    }
+
+    ConeTraceResolveDesc CreateDesc( uint32_t width, uint32_t height, uint32_t scale )
+    {
+        ConeTraceResolveDesc desc = {};
+        desc.width = width;
+        desc.height = height;
+        desc.scale = scale;
+        desc.depthTolerance = 0.1f;
+        desc.normalPower = 2.0f;
+        desc.currentWeight = 1.0f;
+        return desc;
+    }
+
+    // Texels facing up at the given depth, with visibility i / 10 for texel i.
+    ConeTraceImage CreateTraced( uint32_t width, uint32_t height, float depth )
+    {
+        ConeTraceImage traced;
+        traced.width = width;
+        traced.height = height;
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            traced.visibility.push_back(float(i) / 10.0f);
+            traced.depth.push_back(depth);
+            traced.normal.insert(traced.normal.end(), kUp, kUp + 3);
+        }
+        return traced;
+    }
+
+    vector<float> CreateNormals( uint32_t pixelCount )
+    {
+        vector<float> normals;
+        for (uint32_t i = 0; i < pixelCount; ++i)
+            normals.insert(normals.end(), kUp, kUp + 3);
+        return normals;
+    }
+
+    void TestWeights()
+    {
+        const float tilted[3] = { sqrt(0.75f), 0.5f, 0.0f };
+        const float side[3] = { 1.0f, 0.0f, 0.0f };
+        CHECK(Near(ConeTraceUpsample::GetUpsampleWeight(0.25f, 10.0f, kUp, 10.0f, kUp, 0.1f, 2.0f), 0.25f));
+        // The depth weight falls off linearly to 0 at the tolerance, relative to the pixel's depth.
+        CHECK(Near(ConeTraceUpsample::GetUpsampleWeight(1.0f, 10.5f, kUp, 10.0f, kUp, 0.1f, 2.0f), 0.5f));
+        CHECK(Near(ConeTraceUpsample::GetUpsampleWeight(1.0f, 9.5f, kUp, 10.0f, kUp, 0.1f, 2.0f), 0.5f));
+        CHECK(ConeTraceUpsample::GetUpsampleWeight(1.0f, 11.0f, kUp, 10.0f, kUp, 0.1f, 2.0f) == 0.0f);
+        CHECK(ConeTraceUpsample::GetUpsampleWeight(1.0f, 20.0f, kUp, 10.0f, kUp, 0.1f, 2.0f) == 0.0f);
+        // The normal weight is the cosine to the power: 60 degrees apart gives 0.5^2, and facing away nothing.
+        CHECK(Near(ConeTraceUpsample::GetUpsampleWeight(1.0f, 10.0f, tilted, 10.0f, kUp, 0.1f, 2.0f), 0.25f));
+        CHECK(Near(ConeTraceUpsample::GetUpsampleWeight(1.0f, 10.0f, tilted, 10.0f, kUp, 0.1f, 0.0f), 1.0f));
+        CHECK(ConeTraceUpsample::GetUpsampleWeight(1.0f, 10.0f, side, 10.0f, kUp, 0.1f, 2.0f) == 0.0f);
+    }
+
+    void TestUpsample()
+    {
+        // Half resolution, 3x2 texels for 6x4 pixels, with texel t sampling pixel 2t + (1, 0).
+        ConeTraceResolveDesc desc = CreateDesc(6, 4, 2);
+        desc.jitter[0] = 1;
+        const ConeTraceImage traced = CreateTraced(3, 2, 10.0f);
+        vector<float> depth(6 * 4, 10.0f);
+        const vector<float> normals = CreateNormals(6 * 4);
+        vector<float> visibility;
+        ConeTraceUpsample::UpsampleVisibility(traced, desc, depth, normals, visibility);
+        CHECK(visibility.size() == 6 * 4);
+
+        // The pixels traced take their texel's value; those between texels the bilinear blend, clamped at the edges.
+        CHECK(Near(visibility[1], 0.0f) && Near(visibility[3], 0.1f) && Near(visibility[2 * 6 + 5], 0.5f));
+        CHECK(Near(visibility[2], 0.05f) && Near(visibility[6 + 1], 0.15f) && Near(visibility[6 + 2], 0.2f));
+        CHECK(Near(visibility[0], 0.0f) && Near(visibility[3 * 6 + 5], 0.5f));
+
+        // Across a depth edge a pixel only takes the texels of its own surface.
+        ConeTraceImage edge = traced;
+        edge.depth[1] = 40.0f;
+        edge.depth[4] = 40.0f;
+        ConeTraceUpsample::UpsampleVisibility(edge, desc, depth, normals, visibility);
+        CHECK(Near(visibility[2], 0.0f) && Near(visibility[6 + 2], 0.15f));
+        depth[2] = 40.0f;
+        ConeTraceUpsample::UpsampleVisibility(edge, desc, depth, normals, visibility);
+        CHECK(Near(visibility[2], 0.1f));
+
+        // With every weight 0 the pixel takes the texel of the closest depth.
+        ConeTraceImage far = traced;
+        far.depth = { 30.0f, 50.0f, 30.0f, 30.0f, 25.0f, 30.0f };
+        depth.assign(6 * 4, 10.0f);
+        ConeTraceUpsample::UpsampleVisibility(far, desc, depth, normals, visibility);
+        CHECK(Near(visibility[6 + 2], 0.4f));
+        // As with facing away.
+        vector<float> away = normals;
+        away[(6 + 2) * 3 + 1] = -1.0f;
+        ConeTraceUpsample::UpsampleVisibility(traced, desc, depth, away, visibility);
+        CHECK(Near(visibility[6 + 2], 0.0f));
+    }
+
+    // Every period of scale * scale frames, wherever it starts, samples each pixel of the block once, and the frames
+    // after one another sample pixels of different halves of the block.
+    void TestJitter()
+    {
+        for (uint32_t scale = 1; scale <= 4; scale *= 2)
+        {
+            const uint32_t period = scale * scale;
+            bool covered = true, apart = true;
+            for (uint64_t start = 0; start < 2 * period; ++start)
+            {
+                set<int32_t> pixels;
+                int32_t previous[2] = {};
+                for (uint64_t frame = start; frame < start + period; ++frame)
+                {
+                    int32_t jitter[2];
+                    ConeTraceUpsample::GetTraceJitter(frame, scale, jitter);
+                    covered &= jitter[0] >= 0 && jitter[0] < int32_t(scale) && jitter[1] >= 0 && jitter[1] < int32_t(scale);
+                    pixels.insert(jitter[1] * int32_t(scale) + jitter[0]);
+                    if (scale > 1 && frame > start)
+                        apart &= jitter[0] / int32_t(scale / 2) != previous[0] / int32_t(scale / 2) ||
+                            jitter[1] / int32_t(scale / 2) != previous[1] / int32_t(scale / 2);
+                    previous[0] = jitter[0];
+                    previous[1] = jitter[1];
+                }
+                covered &= pixels.size() == period;
+            }
+            CHECK(covered);
+            CHECK(apart);
+        }
+
+        // At half resolution the walk is the 2x2 Bayer matrix, stepping along the diagonals.
+        const int32_t expected[4][2] = { { 0, 0 }, { 1, 1 }, { 1, 0 }, { 0, 1 } };
+        bool bayer = true;
+        for (uint64_t frame = 0; frame < 4; ++frame)
+        {
+            int32_t jitter[2];
+            ConeTraceUpsample::GetTraceJitter(frame, 2, jitter);
+            bayer &= jitter[0] == expected[frame][0] && jitter[1] == expected[frame][1];
+        }
+        CHECK(bayer);
+    }
+
+    void TestResolve()
+    {
+        const uint32_t width = 5, height = 4, pixelCount = width * height;
+        ConeTraceResolveDesc desc = CreateDesc(width, height, 1);
+        desc.currentWeight = 0.25f;
+        vector<float> depth(pixelCount, 10.0f);
+        vector<float> velocity(pixelCount * 3, 0.0f);
+        vector<float> history(pixelCount, 1.0f), current(pixelCount, 0.2f), visibility;
+
+        // A static view blends a quarter of the way each frame and converges on what is traced.
+        ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, depth, history, visibility);
+        CHECK(Near(visibility[7], 0.8f));
+        for (int frame = 0; frame < 60; ++frame)
+        {
+            history = visibility;
+            ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, depth, history, visibility);
+        }
+        CHECK(Near(visibility[7], 0.2f) && Near(visibility[0], 0.2f));
+
+        // A pixel moved one pixel right reads the history of the pixel left of it, and the history is sampled
+        // bilinearly in between, across columns and across rows.
+        for (uint32_t i = 0; i < pixelCount; ++i)
+            history[i] = float(i % width) + 10.0f * float(i / width);
+        current.assign(pixelCount, 0.0f);
+        velocity[7 * 3] = -1.0f;
+        velocity[8 * 3] = -0.5f;
+        velocity[16 * 3 + 1] = -0.5f;
+        ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, depth, history, visibility);
+        CHECK(Near(visibility[7], 0.75f * 11.0f) && Near(visibility[8], 0.75f * 12.5f) && Near(visibility[9], 0.75f * 14.0f));
+        CHECK(Near(visibility[16], 0.75f * 26.0f));
+
+        // History is dropped off screen, where last frame's depth does not match, and not where the depth change
+        // the velocity carries explains it.
+        velocity[9 * 3] = 1.0f;
+        velocity[14 * 3] = 0.5f;
+        vector<float> prevDepth = depth;
+        prevDepth[6] = 20.0f;
+        prevDepth[11] = 12.0f;
+        velocity[11 * 3 + 2] = 2.0f;
+        ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, prevDepth, history, visibility);
+        CHECK(visibility[9] == 0.0f && visibility[14] == 0.0f && visibility[7] == 0.0f && visibility[6] == 0.0f);
+        CHECK(Near(visibility[11], 0.75f * 21.0f) && Near(visibility[12], 0.75f * 22.0f));
+
+        // Without history the frame is taken as it is.
+        desc.currentWeight = 1.0f;
+        ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, prevDepth, history, visibility);
+        CHECK(visibility[12] == 0.0f);
+    }
+
+    // The jittered trace of a static view, upsampled and resolved frame after frame: with the pixels of a block all
+    // alike, every frame's upsample is exact and the history holds it.
+    void TestTemporalTrace()
+    {
+        const uint32_t width = 8, height = 8, scale = 2;
+        ConeTraceResolveDesc desc = CreateDesc(width, height, scale);
+        const vector<float> depth(width * height, 10.0f);
+        const vector<float> normals = CreateNormals(width * height);
+        const vector<float> velocity(width * height * 3, 0.0f);
+        vector<float> truth(width * height);
+        for (uint32_t y = 0; y < height; ++y)
+            for (uint32_t x = 0; x < width; ++x)
+                truth[y * width + x] = (x < 4) == (y < 4) ? 0.25f : 0.75f;
+
+        vector<float> history(width * height, 1.0f), current, visibility;
+        for (uint64_t frame = 0; frame < 40; ++frame)
+        {
+            ConeTraceUpsample::GetTraceJitter(frame, scale, desc.jitter);
+            ConeTraceImage traced = CreateTraced(width / scale, height / scale, 10.0f);
+            for (uint32_t ty = 0; ty < traced.height; ++ty)
+                for (uint32_t tx = 0; tx < traced.width; ++tx)
+                    traced.visibility[ty * traced.width + tx] = truth[(ty * scale + desc.jitter[1]) * width + tx * scale + desc.jitter[0]];
+            ConeTraceUpsample::UpsampleVisibility(traced, desc, depth, normals, current);
+            desc.currentWeight = frame == 0 ? 1.0f : 0.25f;
+            ConeTraceUpsample::ResolveVisibility(desc, current, depth, velocity, depth, history, visibility);
+            history = visibility;
+        }
+        // Away from the quadrant borders, where the upsample blends across, the visibility is the truth.
+        CHECK(Near(visibility[1 * width + 1], 0.25f) && Near(visibility[1 * width + 6], 0.75f) && Near(visibility[6 * width + 6], 0.25f));
+    }
+}
+
+void TestConeTraceUpsample()
+{
+    TestWeights();
+    TestUpsample();
+    TestJitter();
+    TestResolve();
+    TestTemporalTrace();
+}
@@ -0,0 +1,93 @@
+//
+// Checks the device-free Core helpers, the CPU references of the GPU passes among them, without a device.  Runs every
+// test, or those named on the command line, and exits with 1 when a check fails.
+//
+
+#include "CoreTests.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+struct CoreTest
+{
+    const char* name;
+    void (*run)();
+};
+
+const CoreTest g_tests[] =
+{
+    { "MeshCulling", TestMeshCulling },
+    { "RegionCulling", TestRegionCulling },
+    { "ClipmapClear", TestClipmapClear },
+    { "BrickMap", TestBrickMap },
+    { "ClusteredLightGrid", TestClusteredLightGrid },
+    { "TilePool", TestTilePool },
+    { "TileResidency", TestTileResidency },
+    { "TileFeedback", TestTileFeedback },
+    { "TileMappingBatch", TestTileMappingBatch },
+    { "CpuVoxelizer", TestCpuVoxelizer },
+    { "ClipmapUpdateScheduler", TestClipmapUpdateScheduler },
+    { "ConeTraceUpsample", TestConeTraceUpsample },
+};
+
+uint32_t g_failedChecks = 0;
+
+bool CheckCondition( bool passed, const char* condition, const char* file, int line )
+{
+    if (!passed)
+    {
+        printf("  %s(%d): CHECK(%s) failed\n", file, line, condition);
+        g_failedChecks++;
+    }
+    return passed;
+}
+
+int main( int argc, const char** argv )
+{
+    bool selected[sizeof(g_tests) / sizeof(g_tests[0])] = {};
+
+    try
+    {
+        for (int arg = 1; arg < argc; ++arg)
+        {
+            bool found = false;
+            for (size_t test = 0; test < sizeof(g_tests) / sizeof(g_tests[0]); ++test)
+            {
+                if (strcmp(g_tests[test].name, argv[arg]) == 0)
+                    selected[test] = found = true;
+            }
+            if (!found)
+                throw runtime_error("Invalid test");
+        }
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s [test]*\n\n"
+            "Tests:\n\n", e.what(), argv[0]);
+        for (const CoreTest& test : g_tests)
+            printf("%s\n", test.name);
+        printf("\n\nExample:  %s %s\n\n", argv[0], g_tests[0].name);
+        return 1;
+    }
+
+    uint32_t failedTests = 0;
+    for (size_t test = 0; test < sizeof(g_tests) / sizeof(g_tests[0]); ++test)
+    {
+        if (argc > 1 && !selected[test])
+            continue;
+        printf("%s\n", g_tests[test].name);
+        const uint32_t failedChecks = g_failedChecks;
+        g_tests[test].run();
+        if (g_failedChecks != failedChecks)
+        {
+            printf("  %u checks failed\n", g_failedChecks - failedChecks);
+            failedTests++;
+        }
+    }
+    printf("\n%s\n", failedTests == 0 ? "All tests passed" : "Some tests failed");
+    return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts a failed check and prints where it failed.  A test keeps going after a failure so a run lists them all.
+#define CHECK(condition) CheckCondition((condition), #condition, __FILE__, __LINE__)
+
+bool CheckCondition( bool passed, const char* condition, const char* file, int line );
+
+// The tests, one per device-free Core helper; CoreTests.cpp lists them.
+void TestMeshCulling();
+void TestRegionCulling();
+void TestClipmapClear();
+void TestBrickMap();
+void TestClusteredLightGrid();
+void TestTilePool();
+void TestTileResidency();
+void TestTileFeedback();
+void TestTileMappingBatch();
+void TestCpuVoxelizer();
+void TestClipmapUpdateScheduler();
+void TestConeTraceUpsample();
@@ -0,0 +1,147 @@
+//
+// The conservative voxelization of CpuVoxelizer: the separating axis test on known cases, axis-aligned quads that
+// fill known slabs, and the SSE and scalar paths on random triangles against TriangleOverlapsBox for every voxel.
+//
+
+#include "CoreTests.h"
+#include "../../Core/CpuVoxelizer.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    bool IsSet( const VoxelBrickSet& bricks, int32_t x, int32_t y, int32_t z )
+    {
+        const int32_t bx = GetVoxelBrick(x), by = GetVoxelBrick(y), bz = GetVoxelBrick(z);
+        const auto found = bricks.find(PackVoxelBrick(bx, by, bz));
+        if (found == bricks.end())
+            return false;
+        const uint32_t bit = GetVoxelBrickBit(x - bx * kVoxelBrickSize, y - by * kVoxelBrickSize, z - bz * kVoxelBrickSize);
+        return (found->second.bits[bit / 32] & (1u << (bit % 32))) != 0;
+    }
+
+    // Two triangles of the quad from (x0, y0) to (x1, y1) at height z.
+    void AddQuad( vector<float>& positions, vector<uint32_t>& indices, float x0, float y0, float x1, float y1, float z )
+    {
+        const uint32_t first = uint32_t(positions.size() / 3);
+        const float corners[] = { x0, y0, z, x1, y0, z, x1, y1, z, x0, y1, z };
+        positions.insert(positions.end(), begin(corners), end(corners));
+        const uint32_t quad[] = { 0, 1, 2, 0, 2, 3 };
+        for (uint32_t index : quad)
+            indices.push_back(first + index);
+    }
+
+    void TestTriangleOverlapsBox()
+    {
+        const float center[3] = { 0.0f, 0.0f, 0.0f };
+        const float a[3] = { -2.0f, -2.0f, 0.5f }, b[3] = { 2.0f, -2.0f, 0.5f }, c[3] = { 0.0f, 2.0f, 0.5f };
+        CHECK(CpuVoxelizer::TriangleOverlapsBox(a, b, c, center, 1.0f));
+        // Touching the box's face counts, as the boxes are closed.
+        CHECK(CpuVoxelizer::TriangleOverlapsBox(a, b, c, center, 0.5f));
+        CHECK(!CpuVoxelizer::TriangleOverlapsBox(a, b, c, center, 0.49f));
+
+        // The bounds and the plane overlap the box, but the triangle lies past the corner (1, 1) beyond its long edge,
+        // which only the edge axes separate.
+        const float d[3] = { 2.0f, 0.6f, 0.0f }, e[3] = { 0.6f, 2.0f, 0.0f }, f[3] = { 2.0f, 2.0f, 0.0f };
+        CHECK(!CpuVoxelizer::TriangleOverlapsBox(d, e, f, center, 1.0f));
+        CHECK(CpuVoxelizer::TriangleOverlapsBox(d, e, f, center, 1.4f));
+
+        // A tilted triangle whose bounds hold the box but whose plane passes by its corner.
+        const float g[3] = { 3.0f, -3.0f, 1.0f }, h[3] = { -3.0f, 3.0f, 1.0f }, i[3] = { 3.0f, 3.0f, -5.0f };
+        CHECK(!CpuVoxelizer::TriangleOverlapsBox(g, h, i, center, 0.3f));
+        CHECK(CpuVoxelizer::TriangleOverlapsBox(g, h, i, center, 0.5f));
+    }
+
+    // An 8x8 quad inside the slab of voxels z = -1 fills that slab and nothing else; on the border between two slabs
+    // it fills both.  The quad crosses the origin, so the bricks either side of it are rounded down alike.
+    void TestQuads()
+    {
+        for (int simd = 0; simd < 2; ++simd)
+        {
+            for (uint32_t threadCount = 1; threadCount <= 2; ++threadCount)
+            {
+                vector<float> positions;
+                vector<uint32_t> indices;
+                AddQuad(positions, indices, -3.75f, -3.75f, 3.75f, 3.75f, -0.5f);
+                VoxelBrickSet bricks;
+                CpuVoxelizer::Voxelize(positions, indices, 1.0f, threadCount, simd != 0, bricks);
+                CHECK(CpuVoxelizer::CountVoxels(bricks) == 64 && bricks.size() == 4);
+                bool filled = true;
+                for (int32_t y = -4; y < 4; ++y)
+                    for (int32_t x = -4; x < 4; ++x)
+                        filled &= IsSet(bricks, x, y, -1);
+                CHECK(filled);
+
+                // The coarser level of the slab is the 4x4 voxels at z = -1, as coordinates halve rounding down.
+                VoxelBrickSet coarse;
+                CpuVoxelizer::Downsample(bricks, coarse);
+                CHECK(CpuVoxelizer::CountVoxels(coarse) == 16 && IsSet(coarse, -2, -2, -1) && IsSet(coarse, 1, 1, -1));
+
+                bricks.clear();
+                positions.clear();
+                indices.clear();
+                AddQuad(positions, indices, 0.25f, 0.25f, 3.75f, 1.75f, 2.0f);
+                CpuVoxelizer::Voxelize(positions, indices, 1.0f, threadCount, simd != 0, bricks);
+                CHECK(CpuVoxelizer::CountVoxels(bricks) == 2 * 4 * 2 && IsSet(bricks, 3, 1, 1) && IsSet(bricks, 0, 0, 2));
+            }
+        }
+    }
+
+    // The SSE path against the scalar one, voxel for voxel, and both against TriangleOverlapsBox for every voxel
+    // around random triangles.  Rounding may settle voxels the triangle only grazes either way, so a voxel set must
+    // overlap a slightly larger box, and a voxel left clear must miss a slightly smaller one.
+    void TestAgainstOverlap( mt19937& random )
+    {
+        uniform_real_distribution<float> coordinate(-6.0f, 6.0f);
+        const float voxelSize = 0.75f;
+        vector<float> positions;
+        vector<uint32_t> indices;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            // Long thin and axis-aligned triangles are the edge cases of the column bounds.
+            for (int c = 0; c < 3; ++c)
+                positions.push_back(coordinate(random));
+            indices.push_back(i);
+        }
+        if (random() % 4 == 0)
+            positions[5] = positions[8] = positions[2];
+
+        VoxelBrickSet bricks[2];
+        for (int simd = 0; simd < 2; ++simd)
+            CpuVoxelizer::Voxelize(positions, indices, voxelSize, 1, simd != 0, bricks[simd]);
+
+        bool conservative = true, agree = true;
+        const float halfSize = voxelSize * 0.5f;
+        for (int32_t z = -10; z < 10; ++z)
+        {
+            for (int32_t y = -10; y < 10; ++y)
+            {
+                for (int32_t x = -10; x < 10; ++x)
+                {
+                    const float center[3] = { (x + 0.5f) * voxelSize, (y + 0.5f) * voxelSize, (z + 0.5f) * voxelSize };
+                    const bool inner = CpuVoxelizer::TriangleOverlapsBox(&positions[0], &positions[3], &positions[6], center, halfSize * 0.999f);
+                    const bool outer = CpuVoxelizer::TriangleOverlapsBox(&positions[0], &positions[3], &positions[6], center, halfSize * 1.001f);
+                    const bool set[2] = { IsSet(bricks[0], x, y, z), IsSet(bricks[1], x, y, z) };
+                    agree &= set[0] == set[1];
+                    for (int simd = 0; simd < 2; ++simd)
+                        conservative &= (!set[simd] || outer) && (set[simd] || !inner);
+                }
+            }
+        }
+        CHECK(agree && CpuVoxelizer::CountVoxels(bricks[0]) == CpuVoxelizer::CountVoxels(bricks[1]));
+        CHECK(conservative);
+        CHECK(CpuVoxelizer::CountVoxels(bricks[0]) > 0);
+    }
+}
+
+void TestCpuVoxelizer()
+{
+    mt19937 random(6421);
+    TestTriangleOverlapsBox();
+    TestQuads();
+    for (int i = 0; i < 50; ++i)
+        TestAgainstOverlap(random);
+}
@@ -0,0 +1,259 @@
+//
+// The Hi-Z pyramid, occlusion test and frustum culling of CpuMeshCulling on synthetic depth and boxes.
+//
+
+#include "CoreTests.h"
+#include "../../Core/CpuMeshCulling.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const float kNearZ = 1.0f;
+    const float kFarZ = 100.0f;
+
+    // A right handed, reversed-Z perspective of a 90 degree field of view, looking down -z from the origin.
+    void MakeViewProj( float viewProj[16] )
+    {
+        fill(viewProj, viewProj + 16, 0.0f);
+        viewProj[0] = 1.0f;
+        viewProj[5] = 1.0f;
+        viewProj[10] = kNearZ / (kFarZ - kNearZ);
+        viewProj[11] = -1.0f;
+        viewProj[14] = kNearZ * kFarZ / (kFarZ - kNearZ);
+    }
+
+    void Transform( const float viewProj[16], const float position[3], float clip[4] )
+    {
+        for (int r = 0; r < 4; ++r)
+            clip[r] = viewProj[r] * position[0] + viewProj[4 + r] * position[1] + viewProj[8 + r] * position[2] + viewProj[12 + r];
+    }
+
+    float DepthAt( float distance )
+    {
+        return kNearZ / (kFarZ - kNearZ) * (kFarZ / distance - 1.0f);
+    }
+
+    // Walls at random distances over random rectangles of the screen, in front of a far background.
+    vector<float> CreateDepth( uint32_t width, uint32_t height, mt19937& random )
+    {
+        vector<float> depth(size_t(width) * height, 0.0f);
+        uniform_int_distribution<uint32_t> column(0, width - 1), row(0, height - 1);
+        uniform_real_distribution<float> distance(2.0f, 60.0f);
+        for (int wall = 0; wall < 12; ++wall)
+        {
+            uint32_t x0 = column(random), x1 = column(random), y0 = row(random), y1 = row(random);
+            if (x0 > x1) swap(x0, x1);
+            if (y0 > y1) swap(y0, y1);
+            const float wallDepth = DepthAt(distance(random));
+            for (uint32_t y = y0; y <= y1; ++y)
+                for (uint32_t x = x0; x <= x1; ++x)
+                    depth[y * width + x] = max(depth[y * width + x], wallDepth);
+        }
+        return depth;
+    }
+
+    // Every level against the farthest depth of the pixels under the texel, worked out from the footprint.
+    void TestPyramid( uint32_t depthWidth, uint32_t depthHeight, mt19937& random )
+    {
+        const vector<float> depth = CreateDepth(depthWidth, depthHeight, random);
+        vector<vector<float>> mips;
+        CpuMeshCulling::BuildPyramid(depth.data(), depthWidth, depthHeight, mips);
+
+        const uint32_t width = CpuMeshCulling::PyramidExtent(depthWidth);
+        const uint32_t height = CpuMeshCulling::PyramidExtent(depthHeight);
+        CHECK(width <= depthWidth && width * 2 > depthWidth);
+        CHECK(height <= depthHeight && height * 2 > depthHeight);
+        CHECK(mips.size() == CpuMeshCulling::PyramidMipCount(width, height));
+        CHECK(max(width, height) >> (mips.size() - 1) <= 1 || mips.size() == CpuMeshCulling::kMaxPyramidMips);
+
+        uint32_t mismatches = 0;
+        for (uint32_t mip = 0; mip < mips.size(); ++mip)
+        {
+            const uint32_t mipWidth = max(width >> mip, 1u);
+            const uint32_t mipHeight = max(height >> mip, 1u);
+            if (!CHECK(mips[mip].size() == size_t(mipWidth) * mipHeight))
+                continue;
+            for (uint32_t y = 0; y < mipHeight; ++y)
+            {
+                for (uint32_t x = 0; x < mipWidth; ++x)
+                {
+                    // The top level texels under the texel, and the depth pixels their area overlaps.
+                    const uint32_t topX0 = x << mip, topX1 = min((x + 1) << mip, width);
+                    const uint32_t topY0 = y << mip, topY1 = min((y + 1) << mip, height);
+                    float farthest = 1.0f;
+                    for (uint32_t sy = 0; sy < depthHeight; ++sy)
+                    {
+                        if (uint64_t(sy + 1) * height <= uint64_t(topY0) * depthHeight || uint64_t(sy) * height >= uint64_t(topY1) * depthHeight)
+                            continue;
+                        for (uint32_t sx = 0; sx < depthWidth; ++sx)
+                        {
+                            if (uint64_t(sx + 1) * width <= uint64_t(topX0) * depthWidth || uint64_t(sx) * width >= uint64_t(topX1) * depthWidth)
+                                continue;
+                            farthest = min(farthest, depth[sy * depthWidth + sx]);
+                        }
+                    }
+                    mismatches += mips[mip][y * mipWidth + x] == farthest ? 0 : 1;
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    // The screen rectangle and nearest depth of a box in front of the eye.
+    bool Project( const float viewProj[16], const float minBound[3], const float maxBound[3], float rect[4], float& nearest )
+    {
+        rect[0] = rect[1] = 1.0f;
+        rect[2] = rect[3] = 0.0f;
+        nearest = 0.0f;
+        for (uint32_t corner = 0; corner < 8; ++corner)
+        {
+            const float position[3] = {
+                (corner & 1) ? maxBound[0] : minBound[0],
+                (corner & 2) ? maxBound[1] : minBound[1],
+                (corner & 4) ? maxBound[2] : minBound[2] };
+            float clip[4];
+            Transform(viewProj, position, clip);
+            if (clip[3] <= 0.0f)
+                return false;
+            const float u = clip[0] / clip[3] * 0.5f + 0.5f, v = 0.5f - clip[1] / clip[3] * 0.5f;
+            rect[0] = min(rect[0], u); rect[1] = min(rect[1], v);
+            rect[2] = max(rect[2], u); rect[3] = max(rect[3], v);
+            nearest = max(nearest, clip[2] / clip[3]);
+        }
+        for (int i = 0; i < 4; ++i)
+            rect[i] = min(max(rect[i], 0.0f), 1.0f);
+        return true;
+    }
+
+    void TestOcclusion( mt19937& random )
+    {
+        const uint32_t width = 128, height = 128;
+        float viewProj[16];
+        MakeViewProj(viewProj);
+
+        // A wall at a distance of 10 over the left half of the screen.
+        vector<float> depth(size_t(width) * height, 0.0f);
+        for (uint32_t y = 0; y < height; ++y)
+            for (uint32_t x = 0; x < width / 2; ++x)
+                depth[y * width + x] = DepthAt(10.0f);
+        vector<vector<float>> mips;
+        CpuMeshCulling::BuildPyramid(depth.data(), width, height, mips);
+
+        const float behindWall[2][3] = { { -20.0f, -5.0f, -30.0f }, { -5.0f, 5.0f, -20.0f } };
+        const float beforeWall[2][3] = { { -4.0f, -1.0f, -6.0f }, { -2.0f, 1.0f, -5.0f } };
+        const float behindSky[2][3] = { { 5.0f, -5.0f, -30.0f }, { 20.0f, 5.0f, -20.0f } };
+        const float pastWallEdge[2][3] = { { -10.0f, -5.0f, -30.0f }, { 5.0f, 5.0f, -20.0f } };
+        const float aroundEye[2][3] = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+        CHECK(CpuMeshCulling::IsOccluded(mips, width, height, viewProj, behindWall[0], behindWall[1]));
+        CHECK(!CpuMeshCulling::IsOccluded(mips, width, height, viewProj, beforeWall[0], beforeWall[1]));
+        CHECK(!CpuMeshCulling::IsOccluded(mips, width, height, viewProj, behindSky[0], behindSky[1]));
+        CHECK(!CpuMeshCulling::IsOccluded(mips, width, height, viewProj, pastWallEdge[0], pastWallEdge[1]));
+        CHECK(!CpuMeshCulling::IsOccluded(mips, width, height, viewProj, aroundEye[0], aroundEye[1]));
+
+        // On random walls an occluded box has to be behind every pixel of its screen rectangle.
+        const vector<float> walls = CreateDepth(width, height, random);
+        CpuMeshCulling::BuildPyramid(walls.data(), width, height, mips);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        uint32_t occluded = 0, unsound = 0;
+        for (int box = 0; box < 2000; ++box)
+        {
+            const float distance = 3.0f + 90.0f * unit(random);
+            const float center[3] = { (unit(random) * 2.0f - 1.0f) * distance, (unit(random) * 2.0f - 1.0f) * distance, -distance };
+            const float size = 0.2f + 8.0f * unit(random);
+            const float minBound[3] = { center[0] - size, center[1] - size, center[2] - size };
+            const float maxBound[3] = { center[0] + size, center[1] + size, center[2] + size };
+            if (!CpuMeshCulling::IsOccluded(mips, width, height, viewProj, minBound, maxBound))
+                continue;
+            occluded++;
+            float rect[4], nearest;
+            if (!Project(viewProj, minBound, maxBound, rect, nearest))
+            {
+                unsound++;
+                continue;
+            }
+            const uint32_t x0 = min(uint32_t(rect[0] * width), width - 1), x1 = min(uint32_t(rect[2] * width), width - 1);
+            const uint32_t y0 = min(uint32_t(rect[1] * height), height - 1), y1 = min(uint32_t(rect[3] * height), height - 1);
+            bool hidden = true;
+            for (uint32_t y = y0; y <= y1; ++y)
+                for (uint32_t x = x0; x <= x1; ++x)
+                    hidden = hidden && nearest < walls[y * width + x];
+            unsound += hidden ? 0 : 1;
+        }
+        CHECK(occluded > 0);
+        CHECK(unsound == 0);
+    }
+
+    void TestFrustum( mt19937& random )
+    {
+        float viewProj[16], planes[6][4];
+        MakeViewProj(viewProj);
+        CpuMeshCulling::ExtractFrustumPlanes(viewProj, planes);
+
+        // The planes have to agree with the clip space test, for points either side of every plane.
+        uniform_real_distribution<float> coordinate(-120.0f, 120.0f);
+        uint32_t disagreements = 0;
+        for (int point = 0; point < 10000; ++point)
+        {
+            const float position[3] = { coordinate(random), coordinate(random), coordinate(random) };
+            float clip[4];
+            Transform(viewProj, position, clip);
+            const bool inside = -clip[3] <= clip[0] && clip[0] <= clip[3] && -clip[3] <= clip[1] && clip[1] <= clip[3] &&
+                0.0f <= clip[2] && clip[2] <= clip[3];
+            bool insidePlanes = true;
+            for (int i = 0; i < 6; ++i)
+                insidePlanes = insidePlanes && planes[i][0] * position[0] + planes[i][1] * position[1] + planes[i][2] * position[2] + planes[i][3] >= 0.0f;
+            disagreements += inside == insidePlanes ? 0 : 1;
+        }
+        CHECK(disagreements == 0);
+
+        const float inside[2][3] = { { -1.0f, -1.0f, -11.0f }, { 1.0f, 1.0f, -9.0f } };
+        const float leftOfView[2][3] = { { -40.0f, -1.0f, -11.0f }, { -20.0f, 1.0f, -9.0f } };
+        const float pastFar[2][3] = { { -1.0f, -1.0f, -130.0f }, { 1.0f, 1.0f, -110.0f } };
+        const float behindEye[2][3] = { { -1.0f, -1.0f, 5.0f }, { 1.0f, 1.0f, 8.0f } };
+        const float acrossNear[2][3] = { { -1.0f, -1.0f, -2.0f }, { 1.0f, 1.0f, 2.0f } };
+        CHECK(CpuMeshCulling::IntersectFrustum(planes, inside[0], inside[1]));
+        CHECK(!CpuMeshCulling::IntersectFrustum(planes, leftOfView[0], leftOfView[1]));
+        CHECK(!CpuMeshCulling::IntersectFrustum(planes, pastFar[0], pastFar[1]));
+        CHECK(!CpuMeshCulling::IntersectFrustum(planes, behindEye[0], behindEye[1]));
+        CHECK(CpuMeshCulling::IntersectFrustum(planes, acrossNear[0], acrossNear[1]));
+
+        // A box with a point in the frustum is never culled.
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        uint32_t culledVisible = 0;
+        for (int box = 0; box < 2000; ++box)
+        {
+            const float minBound[3] = { coordinate(random), coordinate(random), coordinate(random) };
+            const float maxBound[3] = { minBound[0] + 30.0f * unit(random), minBound[1] + 30.0f * unit(random), minBound[2] + 30.0f * unit(random) };
+            if (CpuMeshCulling::IntersectFrustum(planes, minBound, maxBound))
+                continue;
+            for (int sample = 0; sample < 125; ++sample)
+            {
+                const float t[3] = { (sample % 5) / 4.0f, (sample / 5 % 5) / 4.0f, (sample / 25) / 4.0f };
+                float position[3], clip[4];
+                for (int axis = 0; axis < 3; ++axis)
+                    position[axis] = minBound[axis] + (maxBound[axis] - minBound[axis]) * t[axis];
+                Transform(viewProj, position, clip);
+                if (-clip[3] <= clip[0] && clip[0] <= clip[3] && -clip[3] <= clip[1] && clip[1] <= clip[3] && 0.0f <= clip[2] && clip[2] <= clip[3])
+                {
+                    culledVisible++;
+                    break;
+                }
+            }
+        }
+        CHECK(culledVisible == 0);
+    }
+}
+
+void TestMeshCulling()
+{
+    mt19937 random(4721);
+    TestPyramid(128, 64, random);
+    TestPyramid(200, 75, random);
+    TestPyramid(33, 1, random);
+    TestOcclusion(random);
+    TestFrustum(random);
+}
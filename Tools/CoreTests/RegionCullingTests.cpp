@@ -0,0 +1,103 @@
+//
+// ClassifyBox and MeshBoundsSoA::Cull on boxes inside, outside, straddling and touching a region, and on random boxes.
+//
+
+#include "CoreTests.h"
+#include "../../Core/RegionCulling.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const float kRegionMin[3] = { -8.0f, 0.0f, 16.0f };
+    const float kRegionMax[3] = { 8.0f, 4.0f, 48.0f };
+
+    struct Box
+    {
+        float minBound[3];
+        float maxBound[3];
+        RegionOverlap expected;
+    };
+
+    // Whether Cull keeps exactly the boxes ClassifyBox does not find outside, in order.
+    bool CullAgrees( const vector<Box>& boxes )
+    {
+        MeshBoundsSoA meshBounds;
+        vector<uint32_t> expected;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            meshBounds.Add(boxes[i].minBound, boxes[i].maxBound, i, i + 1, 3 * i);
+            if (ClassifyBox(kRegionMin, kRegionMax, boxes[i].minBound, boxes[i].maxBound) != RegionOverlap::Outside)
+                expected.push_back(i);
+        }
+        vector<uint32_t> visible(1, ~0u);
+        meshBounds.Cull(kRegionMin, kRegionMax, visible);
+        // Cull appends to what the list already holds.
+        return visible.size() == expected.size() + 1 && visible[0] == ~0u && equal(expected.begin(), expected.end(), visible.begin() + 1);
+    }
+
+    void TestCases()
+    {
+        const vector<Box> boxes =
+        {
+            { { -1.0f, 1.0f, 20.0f }, { 1.0f, 2.0f, 30.0f }, RegionOverlap::Inside },
+            { { -8.0f, 0.0f, 16.0f }, { 8.0f, 4.0f, 48.0f }, RegionOverlap::Inside },
+            { { -20.0f, -20.0f, 0.0f }, { 20.0f, 20.0f, 60.0f }, RegionOverlap::Intersects },
+            { { 6.0f, 1.0f, 20.0f }, { 10.0f, 2.0f, 30.0f }, RegionOverlap::Intersects },
+            { { -1.0f, -3.0f, 20.0f }, { 1.0f, 0.5f, 30.0f }, RegionOverlap::Intersects },
+            { { -1.0f, 1.0f, 40.0f }, { 1.0f, 2.0f, 50.0f }, RegionOverlap::Intersects },
+            // Touching a face still counts; conservative rasterization covers the boundary voxels.
+            { { 8.0f, 1.0f, 20.0f }, { 9.0f, 2.0f, 30.0f }, RegionOverlap::Intersects },
+            { { -1.0f, -2.0f, 20.0f }, { 1.0f, 0.0f, 30.0f }, RegionOverlap::Intersects },
+            { { 8.5f, 1.0f, 20.0f }, { 9.0f, 2.0f, 30.0f }, RegionOverlap::Outside },
+            { { -9.0f, 1.0f, 20.0f }, { -8.5f, 2.0f, 30.0f }, RegionOverlap::Outside },
+            { { -1.0f, 4.5f, 20.0f }, { 1.0f, 5.0f, 30.0f }, RegionOverlap::Outside },
+            { { -1.0f, 1.0f, 0.0f }, { 1.0f, 2.0f, 15.0f }, RegionOverlap::Outside },
+            // Overlapping the region on two axes is not enough.
+            { { -1.0f, 1.0f, 49.0f }, { 1.0f, 2.0f, 60.0f }, RegionOverlap::Outside },
+        };
+        for (const Box& box : boxes)
+            CHECK(ClassifyBox(kRegionMin, kRegionMax, box.minBound, box.maxBound) == box.expected);
+        CHECK(CullAgrees(boxes));
+
+        MeshBoundsSoA meshBounds;
+        meshBounds.Add(boxes[3].minBound, boxes[3].maxBound, 7, 2, 120);
+        float minBound[3], maxBound[3];
+        meshBounds.GetBounds(0, minBound, maxBound);
+        CHECK(equal(minBound, minBound + 3, boxes[3].minBound) && equal(maxBound, maxBound + 3, boxes[3].maxBound));
+        CHECK(meshBounds.GetMesh(0).model == 7 && meshBounds.GetMesh(0).mesh == 2 && meshBounds.GetMesh(0).triangleCount == 120);
+        meshBounds.Clear();
+        CHECK(meshBounds.GetMeshCount() == 0);
+    }
+
+    // Random boxes around the region, snapped to a coarse grid so many of them touch its faces exactly.
+    void TestRandom( mt19937& random )
+    {
+        uniform_int_distribution<int> coordinate(-16, 64);
+        uniform_int_distribution<int> size(0, 24);
+        vector<Box> boxes(2000);
+        uint32_t counts[3] = {};
+        for (Box& box : boxes)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                box.minBound[axis] = float(coordinate(random)) * 0.5f;
+                box.maxBound[axis] = box.minBound[axis] + float(size(random)) * 0.5f;
+            }
+            counts[uint32_t(ClassifyBox(kRegionMin, kRegionMax, box.minBound, box.maxBound))]++;
+        }
+        // The boxes cover every case, so the agreement means something.
+        CHECK(counts[0] > 0 && counts[1] > 0 && counts[2] > 0);
+        CHECK(CullAgrees(boxes));
+    }
+}
+
+void TestRegionCulling()
+{
+    mt19937 random(1931);
+    TestCases();
+    TestRandom(random);
+}
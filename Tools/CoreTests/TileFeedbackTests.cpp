@@ -0,0 +1,154 @@
+//
+// The feedback aggregation of TileFeedbackAggregator: the SSE2 and scalar paths against a per-texel histogram, and
+// the order of the requests the streamer loads in, coarse mips first and then by descending coverage.
+//
+
+#include "CoreTests.h"
+#include "../../Core/TileFeedback.h"
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Mips of 4x4, 2x2 and 1x1 pages, pages 0 to 20, and the packed page 21 for mip 3 and up.
+    const vector<uint32_t> kPagesX = { 4, 2, 1 };
+    const vector<uint32_t> kPagesY = { 4, 2, 1 };
+    const uint32_t kPackedPage = 21;
+
+    // The page a texel samples, or ~0u for none, counted texel by texel.
+    uint32_t GetPage( uint32_t texel )
+    {
+        if ((texel & TILE_FEEDBACK_VALID_BIT) == 0)
+            return ~0u;
+        const uint32_t mip = (texel >> TILE_FEEDBACK_MIP_SHIFT) & TILE_FEEDBACK_MIP_MASK;
+        if (mip >= kPagesX.size())
+            return kPackedPage;
+        const uint32_t x = texel & TILE_FEEDBACK_COORD_MASK;
+        const uint32_t y = (texel >> TILE_FEEDBACK_Y_SHIFT) & TILE_FEEDBACK_COORD_MASK;
+        if (x >= kPagesX[mip] || y >= kPagesY[mip])
+            return ~0u;
+        const uint32_t firstPage[] = { 0, 16, 20 };
+        return firstPage[mip] + y * kPagesX[mip] + x;
+    }
+
+    bool SameRequests( const vector<TileFeedbackRequest>& a, const vector<TileFeedbackRequest>& b )
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].page != b[i].page || a[i].coverage != b[i].coverage || a[i].mipLevel != b[i].mipLevel)
+                return false;
+        }
+        return true;
+    }
+
+    // A small buffer whose order is known: the packed page, then mip 1, then the mip 0 pages by coverage.
+    void TestRequestOrder()
+    {
+        vector<uint32_t> texels;
+        texels.insert(texels.end(), 10, TileFeedbackAggregator::Pack(0, 1, 1));
+        texels.insert(texels.end(), 2, 0u);
+        texels.insert(texels.end(), 20, TileFeedbackAggregator::Pack(0, 3, 0));
+        texels.insert(texels.end(), 5, TileFeedbackAggregator::Pack(1, 1, 0));
+        texels.insert(texels.end(), 1, TileFeedbackAggregator::Pack(4, 0, 0));
+        texels.insert(texels.end(), 10, TileFeedbackAggregator::Pack(0, 0, 2));
+
+        for (int simd = 0; simd < 2; ++simd)
+        {
+            TileFeedbackAggregator aggregator;
+            aggregator.Reset(kPagesX, kPagesY);
+            CHECK(aggregator.GetPageCount() == kPackedPage + 1);
+            aggregator.Accumulate(texels.data(), uint32_t(texels.size()), 1, uint32_t(texels.size()), simd != 0);
+            CHECK(aggregator.GetSeenPageCount() == 5 && aggregator.GetSampleCount() == 46);
+
+            vector<TileFeedbackRequest> requests;
+            aggregator.BuildRequests(requests);
+            const vector<TileFeedbackRequest> expected = { { kPackedPage, 1, 3 }, { 17, 5, 1 }, { 3, 20, 0 }, { 5, 10, 0 }, { 8, 10, 0 } };
+            CHECK(SameRequests(requests, expected));
+
+            aggregator.Clear();
+            requests.clear();
+            aggregator.BuildRequests(requests);
+            CHECK(requests.empty() && aggregator.GetSampleCount() == 0);
+        }
+    }
+
+    // Runs of random length of random pages, cleared texels and out of range pages, in rows narrower than their pitch
+    // and not a multiple of four texels wide.
+    void TestAgainstHistogram( mt19937& random )
+    {
+        const uint32_t width = 37, height = 23, rowPitch = 40;
+        vector<uint32_t> texels(size_t(rowPitch) * height, TileFeedbackAggregator::Pack(0, 0, 0));
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; )
+            {
+                const uint32_t mip = random() % 5;
+                uint32_t texel = TileFeedbackAggregator::Pack(mip, random() % 5, random() % 5);
+                if (random() % 8 == 0)
+                    texel = 0;
+                const uint32_t run = 1 + random() % 9;
+                for (uint32_t i = 0; i < run && x < width; ++i, ++x)
+                    texels[size_t(y) * rowPitch + x] = texel;
+            }
+        }
+
+        map<uint32_t, uint32_t> histogram;
+        uint64_t samples = 0;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint32_t page = GetPage(texels[size_t(y) * rowPitch + x]);
+                if (page != ~0u)
+                {
+                    histogram[page]++;
+                    samples++;
+                }
+            }
+        }
+
+        TileFeedbackAggregator aggregator;
+        aggregator.Reset(kPagesX, kPagesY);
+        vector<TileFeedbackRequest> requests[2];
+        for (int simd = 0; simd < 2; ++simd)
+        {
+            // Accumulated twice to check that coverage adds up across buffers.
+            aggregator.Clear();
+            aggregator.Accumulate(texels.data(), width, height, rowPitch, simd != 0);
+            aggregator.Accumulate(texels.data(), width, height, rowPitch, simd != 0);
+            aggregator.BuildRequests(requests[simd]);
+            CHECK(aggregator.GetSampleCount() == 2 * samples);
+        }
+        CHECK(SameRequests(requests[0], requests[1]));
+
+        bool matches = requests[1].size() == histogram.size();
+        bool ordered = true;
+        for (size_t i = 0; i < requests[1].size(); ++i)
+        {
+            const TileFeedbackRequest& request = requests[1][i];
+            const auto found = histogram.find(request.page);
+            matches &= found != histogram.end() && request.coverage == 2 * found->second;
+            if (i > 0)
+            {
+                const TileFeedbackRequest& previous = requests[1][i - 1];
+                ordered &= previous.mipLevel > request.mipLevel ||
+                    (previous.mipLevel == request.mipLevel && previous.coverage >= request.coverage);
+            }
+        }
+        CHECK(matches);
+        CHECK(ordered);
+    }
+}
+
+void TestTileFeedback()
+{
+    mt19937 random(5077);
+    TestRequestOrder();
+    for (int i = 0; i < 20; ++i)
+        TestAgainstHistogram(random);
+}
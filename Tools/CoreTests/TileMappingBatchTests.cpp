@@ -0,0 +1,239 @@
+//
+// The coalescing of TileMappingBatch: neighbouring tiles merged into box regions and consecutive heap tiles into
+// ranges, breaks at mip, mapping and heap offset discontinuities, unmaps, calls split at the region limit, and
+// random changes replayed onto a page table.
+//
+
+#include "CoreTests.h"
+#include "../../Core/TileMappingBatch.h"
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const U32 kUnmapped = ~0u;
+
+    D3D12_TILED_RESOURCE_COORDINATE Coordinate( U32 subresource, U32 x, U32 y )
+    {
+        return CD3DX12_TILED_RESOURCE_COORDINATE(x, y, 0, subresource);
+    }
+
+    bool IsBox( const TileMappingBatch& batch, size_t region, U32 subresource, U32 x, U32 y, U32 width, U32 height )
+    {
+        const D3D12_TILED_RESOURCE_COORDINATE& start = batch.GetStartCoordinates()[region];
+        const D3D12_TILE_REGION_SIZE& size = batch.GetRegionSizes()[region];
+        return start.Subresource == subresource && start.X == x && start.Y == y && size.UseBox && size.Width == width &&
+            size.Height == height && size.Depth == 1 && size.NumTiles == width * height;
+    }
+
+    // heapOffset is kUnmapped for a null range.
+    bool IsRange( const TileMappingBatch& batch, size_t range, U32 heapOffset, U32 tileCount )
+    {
+        if (heapOffset == kUnmapped)
+            return batch.GetRangeFlags()[range] == D3D12_TILE_RANGE_FLAG_NULL && batch.GetRangeTileCounts()[range] == tileCount;
+        return batch.GetRangeFlags()[range] == D3D12_TILE_RANGE_FLAG_NONE && batch.GetHeapRangeStartOffsets()[range] == heapOffset &&
+            batch.GetRangeTileCounts()[range] == tileCount;
+    }
+
+    bool IsSingleCall( const TileMappingBatch& batch, U32 regions, U32 ranges )
+    {
+        const vector<TileMappingCall>& calls = batch.GetCalls();
+        return calls.size() == 1 && calls[0].firstRegion == 0 && calls[0].regionCount == regions && calls[0].firstRange == 0 &&
+            calls[0].rangeCount == ranges && batch.GetRegionSizes().size() == regions && batch.GetRangeFlags().size() == ranges;
+    }
+
+    void TestContiguousRuns()
+    {
+        // Two rows of four tiles bound to heap tiles 10 to 17, added out of order.
+        TileMappingBatch batch;
+        for (U32 i = 8; i-- > 0; )
+            batch.Map(Coordinate(0, 2 + i % 4, 5 + i / 4), 10 + i);
+        batch.Build();
+        CHECK(IsSingleCall(batch, 1, 1));
+        CHECK(IsBox(batch, 0, 0, 2, 5, 4, 2));
+        CHECK(IsRange(batch, 0, 10, 8));
+        CHECK(batch.GetStats().calls == 1 && batch.GetStats().regions == 1 && batch.GetStats().ranges == 1 && batch.GetStats().tiles == 8);
+
+        // Built batches are empty.
+        CHECK(batch.IsEmpty());
+        batch.Build();
+        CHECK(batch.GetCalls().empty() && batch.GetStats().calls == 0 && batch.GetStats().tiles == 0);
+    }
+
+    void TestDiscontinuities()
+    {
+        // Neighbours in different mips are different regions, though their heap tiles continue one range.
+        TileMappingBatch batch;
+        batch.Map(Coordinate(0, 3, 0), 4);
+        batch.Map(Coordinate(1, 4, 0), 5);
+        batch.Build();
+        CHECK(IsSingleCall(batch, 2, 1));
+        CHECK(IsBox(batch, 0, 0, 3, 0, 1, 1) && IsBox(batch, 1, 1, 4, 0, 1, 1));
+        CHECK(IsRange(batch, 0, 4, 2));
+
+        // A jump in heap offsets splits the range but not the box.
+        const U32 heapOffsets[] = { 10, 11, 20, 21 };
+        for (U32 x = 0; x < 4; ++x)
+            batch.Map(Coordinate(0, x, 1), heapOffsets[x]);
+        batch.Build();
+        CHECK(IsSingleCall(batch, 1, 2));
+        CHECK(IsBox(batch, 0, 0, 0, 1, 4, 1));
+        CHECK(IsRange(batch, 0, 10, 2) && IsRange(batch, 1, 20, 2));
+
+        // Mapped and unmapped tiles are different boxes; rows of different widths or starts don't stack.
+        batch.Map(Coordinate(0, 0, 0), 7);
+        batch.Map(Coordinate(0, 1, 0), 8);
+        batch.Unmap(Coordinate(0, 2, 0));
+        batch.Unmap(Coordinate(0, 3, 0));
+        batch.Map(Coordinate(0, 1, 1), 9);
+        batch.Map(Coordinate(0, 2, 1), 10);
+        batch.Build();
+        CHECK(IsSingleCall(batch, 3, 3));
+        CHECK(IsBox(batch, 0, 0, 0, 0, 2, 1) && IsBox(batch, 1, 0, 2, 0, 2, 1) && IsBox(batch, 2, 0, 1, 1, 2, 1));
+        CHECK(IsRange(batch, 0, 7, 2) && IsRange(batch, 1, kUnmapped, 2) && IsRange(batch, 2, 9, 2));
+
+        // An unmapped row doesn't stack onto a mapped one.
+        batch.Map(Coordinate(0, 0, 0), 3);
+        batch.Map(Coordinate(0, 1, 0), 4);
+        batch.Unmap(Coordinate(0, 0, 1));
+        batch.Unmap(Coordinate(0, 1, 1));
+        batch.Build();
+        CHECK(IsSingleCall(batch, 2, 2));
+        CHECK(IsBox(batch, 0, 0, 0, 0, 2, 1) && IsBox(batch, 1, 0, 0, 1, 2, 1));
+    }
+
+    void TestUnmaps()
+    {
+        // A 3x2 block of unmaps is one null range; the latest change to a tile wins.
+        TileMappingBatch batch;
+        batch.Map(Coordinate(2, 1, 1), 40);
+        for (U32 y = 0; y < 2; ++y)
+            for (U32 x = 0; x < 3; ++x)
+                batch.Unmap(Coordinate(2, x, y));
+        batch.Build();
+        CHECK(IsSingleCall(batch, 1, 1));
+        CHECK(IsBox(batch, 0, 2, 0, 0, 3, 2));
+        CHECK(IsRange(batch, 0, kUnmapped, 6));
+        CHECK(batch.GetHeapRangeStartOffsets()[0] == 0);
+        CHECK(batch.GetStats().tiles == 6);
+
+        // The packed mips' region follows the boxes as it is, and continues the range of a tile before it.
+        batch.Unmap(Coordinate(0, 0, 0));
+        batch.Map(Coordinate(0, 1, 0), 6);
+        D3D12_TILE_REGION_SIZE packed = {};
+        packed.NumTiles = 3;
+        batch.MapRegion(Coordinate(5, 0, 0), packed, 7);
+        batch.Build();
+        CHECK(IsSingleCall(batch, 3, 2));
+        CHECK(batch.GetStartCoordinates()[2].Subresource == 5 && batch.GetRegionSizes()[2].NumTiles == 3);
+        CHECK(IsRange(batch, 0, kUnmapped, 1) && IsRange(batch, 1, 6, 4));
+        CHECK(batch.GetStats().tiles == 5);
+    }
+
+    // Five separate tiles with consecutive heap tiles, two regions a call: the ranges restart with every call.
+    void TestRegionLimit()
+    {
+        TileMappingBatch batch;
+        batch.SetMaxRegionsPerCall(2);
+        for (U32 i = 0; i < 5; ++i)
+            batch.Map(Coordinate(0, 2 * i, 0), 30 + i);
+        batch.Build();
+        const vector<TileMappingCall>& calls = batch.GetCalls();
+        CHECK(calls.size() == 3);
+        CHECK(batch.GetStats().calls == 3 && batch.GetStats().regions == 5 && batch.GetStats().ranges == 3);
+        if (calls.size() == 3)
+        {
+            CHECK(calls[0].firstRegion == 0 && calls[0].regionCount == 2 && calls[0].firstRange == 0 && calls[0].rangeCount == 1);
+            CHECK(calls[1].firstRegion == 2 && calls[1].regionCount == 2 && calls[1].firstRange == 1 && calls[1].rangeCount == 1);
+            CHECK(calls[2].firstRegion == 4 && calls[2].regionCount == 1 && calls[2].firstRange == 2 && calls[2].rangeCount == 1);
+            CHECK(IsRange(batch, 0, 30, 2) && IsRange(batch, 1, 32, 2) && IsRange(batch, 2, 34, 1));
+        }
+    }
+
+    // Applies the calls the way UpdateTileMappings does: each call walks its regions row by row, taking tiles from
+    // its ranges in order.  Returns false if the regions and ranges of a call do not hold the same number of tiles.
+    bool Apply( const TileMappingBatch& batch, U32 width, U32 height, vector<vector<U32>>& pageTable )
+    {
+        for (const TileMappingCall& call : batch.GetCalls())
+        {
+            U32 range = call.firstRange, taken = 0;
+            for (U32 region = call.firstRegion; region < call.firstRegion + call.regionCount; ++region)
+            {
+                const D3D12_TILED_RESOURCE_COORDINATE& start = batch.GetStartCoordinates()[region];
+                const D3D12_TILE_REGION_SIZE& size = batch.GetRegionSizes()[region];
+                for (U32 i = 0; i < size.NumTiles; ++i)
+                {
+                    while (range < call.firstRange + call.rangeCount && taken == batch.GetRangeTileCounts()[range])
+                    {
+                        range++;
+                        taken = 0;
+                    }
+                    if (range == call.firstRange + call.rangeCount)
+                        return false;
+                    const U32 x = start.X + i % size.Width, y = start.Y + i / size.Width;
+                    if (x >= width || y >= height)
+                        return false;
+                    pageTable[start.Subresource][y * width + x] = batch.GetRangeFlags()[range] == D3D12_TILE_RANGE_FLAG_NULL ?
+                        kUnmapped : batch.GetHeapRangeStartOffsets()[range] + taken;
+                    taken++;
+                }
+            }
+            if (range + 1 != call.firstRange + call.rangeCount || taken != batch.GetRangeTileCounts()[range])
+                return false;
+        }
+        return true;
+    }
+
+    void TestAgainstPageTable( mt19937& random )
+    {
+        const U32 width = 12, height = 9, mips = 2;
+        vector<vector<U32>> pageTable(mips, vector<U32>(width * height, kUnmapped));
+        vector<vector<U32>> expected = pageTable;
+        TileMappingBatch batch;
+        bool applied = true;
+        for (int frame = 0; frame < 40; ++frame)
+        {
+            batch.SetMaxRegionsPerCall(1 + random() % 6);
+            // Mostly blocks of consecutive heap tiles, the way slots are handed out, with some scattered changes.
+            const U32 changes = random() % 30;
+            U32 heapOffset = random() % 64;
+            for (U32 i = 0; i < changes; ++i)
+            {
+                const U32 mip = random() % mips, x = random() % width, y = random() % height;
+                const U32 length = 1 + random() % 6;
+                const bool unmap = random() % 4 == 0;
+                for (U32 j = 0; j < length && x + j < width; ++j)
+                {
+                    U32& tile = expected[mip][y * width + x + j];
+                    if (unmap)
+                    {
+                        batch.Unmap(Coordinate(mip, x + j, y));
+                        tile = kUnmapped;
+                    }
+                    else
+                    {
+                        tile = random() % 5 == 0 ? U32(random() % 64) : heapOffset++;
+                        batch.Map(Coordinate(mip, x + j, y), tile);
+                    }
+                }
+            }
+            batch.Build();
+            applied &= Apply(batch, width, height, pageTable);
+        }
+        CHECK(applied);
+        CHECK(pageTable == expected);
+    }
+}
+
+void TestTileMappingBatch()
+{
+    mt19937 random(9127);
+    TestContiguousRuns();
+    TestDiscontinuities();
+    TestUnmaps();
+    TestRegionLimit();
+    for (int i = 0; i < 20; ++i)
+        TestAgainstPageTable(random);
+}
@@ -0,0 +1,122 @@
+//
+// The tile slot bookkeeping of TilePool: least recently used eviction and free slot reuse, the eviction delay,
+// overflow, and the CLOCK and first-in policies.
+//
+
+#include "CoreTests.h"
+#include "../../Core/TilePool.h"
+
+using namespace std;
+
+namespace
+{
+    // Allocates pages 0 to count - 1 in the given frame, slot i to page i.
+    bool Fill( TilePool& pool, uint32_t count, uint64_t frame )
+    {
+        bool inOrder = true;
+        for (uint32_t page = 0; page < count; ++page)
+        {
+            uint32_t evicted;
+            inOrder &= pool.Allocate(page, frame, evicted) == page && evicted == TilePool::kInvalid;
+        }
+        return inOrder;
+    }
+
+    void TestLeastRecentlyUsed()
+    {
+        TilePool pool;
+        pool.Reset(3, 10, TilePool::kLeastRecentlyUsed);
+        CHECK(Fill(pool, 3, 0));
+        CHECK(pool.GetResidentCount() == 3);
+        CHECK(!pool.Touch(5, 1));
+        CHECK(pool.Touch(0, 1));
+
+        // Pages 1 and 2 were both used in frame 0, page 1 the longest ago.
+        uint32_t evicted;
+        CHECK(pool.Allocate(3, 2, evicted) == 1 && evicted == 1);
+        CHECK(!pool.IsResident(1) && pool.GetSlot(3) == 1);
+        CHECK(pool.Allocate(4, 2, evicted) == 2 && evicted == 2);
+        CHECK(pool.GetEvictionCount() == 2);
+
+        // A freed slot is handed out again before anything is evicted.
+        pool.Free(0);
+        CHECK(pool.GetResidentCount() == 2);
+        CHECK(pool.Allocate(5, 3, evicted) == 0 && evicted == TilePool::kInvalid);
+        CHECK(pool.GetEvictionCount() == 2);
+
+        // Page 3 is now the least recently used.
+        CHECK(pool.Allocate(6, 4, evicted) == 1 && evicted == 3);
+    }
+
+    // Pages used within the delay are in use, or may still be sampled by frames in flight, and are never evicted.
+    void TestEvictionDelay()
+    {
+        TilePool pool;
+        pool.Reset(2, 10, TilePool::kLeastRecentlyUsed);
+        uint32_t evicted;
+
+        // The default delay protects the current frame.
+        CHECK(pool.GetEvictionDelay() == 1);
+        CHECK(Fill(pool, 2, 5));
+        CHECK(pool.Allocate(2, 5, evicted) == TilePool::kInvalid && evicted == TilePool::kInvalid);
+        CHECK(pool.GetOverflowCount() == 1);
+
+        pool.SetEvictionDelay(3);
+        pool.Touch(0, 10);
+        pool.Touch(1, 11);
+        CHECK(pool.Allocate(2, 12, evicted) == TilePool::kInvalid);
+        CHECK(pool.IsResident(0) && pool.IsResident(1) && !pool.IsResident(2));
+        CHECK(pool.GetResidentCount() == 2 && pool.GetEvictionCount() == 0);
+        CHECK(pool.GetOverflowCount() == 2);
+
+        // Three frames after its last use page 0 may go, page 1 not yet.
+        CHECK(pool.Allocate(2, 13, evicted) == 0 && evicted == 0);
+        CHECK(pool.Allocate(3, 13, evicted) == TilePool::kInvalid);
+        CHECK(pool.Allocate(3, 14, evicted) == 1 && evicted == 1);
+        CHECK(pool.GetOverflowCount() == 3);
+
+        // The delay is never below a frame.
+        pool.SetEvictionDelay(0);
+        CHECK(pool.GetEvictionDelay() == 1);
+    }
+
+    void TestSecondChance()
+    {
+        TilePool pool;
+        pool.Reset(3, 10, TilePool::kSecondChance);
+        CHECK(Fill(pool, 3, 0));
+        pool.Touch(0, 1);
+
+        // Page 0 is the oldest but was used, so it goes round again and page 1 is evicted.
+        uint32_t evicted;
+        CHECK(pool.Allocate(3, 2, evicted) == 1 && evicted == 1);
+        // Then page 2, the oldest left, and page 0 once its second chance is used up.
+        CHECK(pool.Allocate(4, 3, evicted) == 2 && evicted == 2);
+        CHECK(pool.Allocate(5, 4, evicted) == 0 && evicted == 0);
+        CHECK(pool.IsResident(3) && pool.IsResident(4) && pool.IsResident(5));
+    }
+
+    void TestFirstIn()
+    {
+        TilePool pool;
+        pool.Reset(3, 10, TilePool::kFirstIn);
+        CHECK(Fill(pool, 3, 0));
+        pool.Touch(0, 1);
+
+        // The oldest allocation goes however recently it was used.
+        uint32_t evicted;
+        CHECK(pool.Allocate(3, 2, evicted) == 0 && evicted == 0);
+        CHECK(pool.Allocate(4, 2, evicted) == 1 && evicted == 1);
+        CHECK(pool.Allocate(5, 2, evicted) == 2 && evicted == 2);
+        // Page 3 was allocated in frame 2, so the delay protects it.
+        CHECK(pool.Allocate(6, 2, evicted) == TilePool::kInvalid);
+    }
+}
+
+void TestTilePool()
+{
+    TestLeastRecentlyUsed();
+    TestEvictionDelay();
+    TestSecondChance();
+    TestFirstIn();
+}
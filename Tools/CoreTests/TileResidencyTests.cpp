@@ -0,0 +1,131 @@
+//
+// The streaming policy of TileResidency: the packed page first and never evicted, demand loads in feedback order
+// within the budget, queued pages not asked for twice, evictions and dropped uploads, and prefetch cancellation.
+//
+
+#include "CoreTests.h"
+#include "../../Core/TileResidency.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Eight standard pages and the packed page, 8.
+    const uint32_t kPageCount = 9;
+    const uint32_t kPackedPage = kPageCount - 1;
+
+    TileFeedbackRequest Seen( uint32_t page, uint32_t coverage, uint32_t mipLevel )
+    {
+        return TileFeedbackRequest{ page, coverage, mipLevel };
+    }
+
+    bool HasLoad( const vector<TileLoad>& loads, uint32_t page, bool prefetch )
+    {
+        return any_of(loads.begin(), loads.end(), [=]( const TileLoad& load ) { return load.page == page && load.prefetch == prefetch; });
+    }
+
+    void TestDemandLoads()
+    {
+        TileResidency residency;
+        residency.Reset(kPageCount, 2, TilePool::kLeastRecentlyUsed);
+        const vector<TileFeedbackRequest> demanded = { Seen(6, 40, 2), Seen(1, 90, 0), Seen(2, 30, 0) };
+        vector<TileLoad> loads;
+        vector<uint32_t> cancelled;
+
+        // The packed page comes first, unseen, then the demanded pages in feedback order up to the budget.
+        residency.Update(0, demanded, {}, 2, 0, loads, cancelled);
+        CHECK(loads.size() == 3 && cancelled.empty());
+        CHECK(loads[0].page == kPackedPage && loads[0].priority == ~0u && !loads[0].prefetch);
+        CHECK(loads[1].page == 6 && loads[2].page == 1);
+        CHECK(loads[1].priority == (TileResidency::kDemandPriority | (2u << 24) | 40));
+        CHECK(loads[1].priority > loads[2].priority);
+
+        // Queued pages are in flight and not asked for again; the one left over now fits the budget.
+        loads.clear();
+        residency.Update(1, demanded, {}, 2, 0, loads, cancelled);
+        CHECK(loads.size() == 1 && loads[0].page == 2);
+        CHECK(residency.GetStats().loads == 4);
+
+        // The packed page has no pool slot.
+        vector<TileMapping> mappings;
+        CHECK(residency.Place(kPackedPage, 1, mappings));
+        CHECK(mappings.size() == 1 && mappings[0].page == kPackedPage && mappings[0].slot == TilePool::kInvalid && mappings[0].mapped);
+        CHECK(!residency.Place(kPackedPage, 1, mappings));
+
+        mappings.clear();
+        CHECK(residency.Place(6, 1, mappings) && residency.Place(1, 1, mappings));
+        CHECK(mappings.size() == 2 && mappings[0].page == 6 && mappings[0].slot == 0 && mappings[1].slot == 1);
+        CHECK(residency.GetStats().peakResident == 2);
+
+        // Both slots were used this frame, so page 2 is dropped rather than evicting either.
+        mappings.clear();
+        CHECK(!residency.Place(2, 1, mappings) && mappings.empty());
+        CHECK(residency.GetStats().droppedUploads == 1);
+
+        // Page 6 stays in view and page 1 does not, so page 1 makes room for page 2 once it is asked for again.
+        loads.clear();
+        residency.Update(2, { Seen(6, 40, 2), Seen(2, 30, 0) }, {}, 2, 0, loads, cancelled);
+        CHECK(loads.size() == 1 && loads[0].page == 2);
+        CHECK(residency.Place(2, 3, mappings));
+        CHECK(mappings.size() == 2 && mappings[0].page == 1 && !mappings[0].mapped);
+        CHECK(mappings[1].page == 2 && mappings[1].slot == 1 && mappings[1].mapped);
+        CHECK(residency.GetStats().evictions == 1);
+
+        // The packed page is never evicted, so it is not loaded again.
+        CHECK(residency.IsResident(kPackedPage) && residency.IsResident(6) && !residency.IsResident(1));
+        loads.clear();
+        residency.Update(4, { Seen(1, 10, 0) }, {}, 2, 0, loads, cancelled);
+        CHECK(loads.size() == 1 && loads[0].page == 1);
+
+        // Misses are counted against what was resident when the feedback was read.
+        CHECK(residency.GetStats().feedbackSamples == 2 * (40 + 90 + 30) + 40 + 30 + 10);
+        CHECK(residency.GetStats().missedSamples == 2 * (40 + 90 + 30) + 30 + 10);
+    }
+
+    void TestPrefetchCancellation()
+    {
+        TileResidency residency;
+        residency.Reset(kPageCount, 4, TilePool::kLeastRecentlyUsed);
+        vector<TileLoad> loads;
+        vector<uint32_t> cancelled;
+        vector<TileMapping> mappings;
+        residency.Update(0, {}, {}, 4, 0, loads, cancelled);
+        residency.Place(kPackedPage, 0, mappings);
+
+        // Prefetches come after the demand loads and within their own budget.
+        loads.clear();
+        residency.Update(1, { Seen(0, 10, 0) }, { Seen(3, 20, 1), Seen(4, 20, 1), Seen(5, 20, 1) }, 4, 2, loads, cancelled);
+        CHECK(loads.size() == 3 && HasLoad(loads, 0, false) && HasLoad(loads, 3, true) && HasLoad(loads, 4, true));
+        CHECK(loads[0].priority > loads[1].priority);
+        CHECK(residency.GetStats().prefetchLoads == 2);
+
+        // Still predicted, page 3 stays queued.  Page 4 is no longer predicted and page 5 is now needed by the view,
+        // so page 4 is cancelled and page 5 loaded at demand priority.
+        loads.clear();
+        residency.Update(2, { Seen(5, 10, 0) }, { Seen(3, 20, 1) }, 4, 2, loads, cancelled);
+        CHECK(cancelled.size() == 1 && cancelled[0] == 4);
+        CHECK(loads.size() == 1 && HasLoad(loads, 5, false));
+
+        // A queued prefetch the view needs is cancelled and asked for again as a demand load.
+        loads.clear();
+        cancelled.clear();
+        residency.Update(3, { Seen(3, 10, 1) }, { Seen(3, 20, 1) }, 4, 2, loads, cancelled);
+        CHECK(cancelled.size() == 1 && cancelled[0] == 3);
+        CHECK(loads.size() == 1 && HasLoad(loads, 3, false));
+        CHECK(residency.GetStats().cancelledPrefetches == 2);
+
+        // A cancelled page can be prefetched again.
+        loads.clear();
+        cancelled.clear();
+        residency.Update(4, {}, { Seen(4, 20, 1) }, 4, 2, loads, cancelled);
+        CHECK(cancelled.empty() && loads.size() == 1 && HasLoad(loads, 4, true));
+    }
+}
+
+void TestTileResidency()
+{
+    TestDemandLoads();
+    TestPrefetchCancellation();
+}
@@ -0,0 +1,213 @@
+//
+// Benchmarks the CPU clustered light assignment (see Core/ClusteredLightGrid.h) on random lights scattered through a
+// view frustum, scalar against SSE, for growing light counts.  With -verify both are checked cell by cell against
+// the reference that tests every light against every cluster's planes.
+//
+
+#include "../../Core/ClusteredLightGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+vector<uint32_t> g_lightCounts;
+uint32_t g_width = 1920;
+uint32_t g_height = 1080;
+uint32_t g_tileDim = 16;
+uint32_t g_sliceCount = 16;
+uint32_t g_capacity = 256;
+uint32_t g_iterations = 10;
+float g_fov = 45.0f;
+float g_nearZ = 1.0f;
+float g_farZ = 1000.0f;
+float g_radius = 40.0f;
+bool g_verify = false;
+
+void SetLightCounts( const char* list )
+{
+    g_lightCounts.clear();
+    for (const char* count = list; *count != '\0'; )
+    {
+        char* end;
+        const unsigned long lights = strtoul(count, &end, 10);
+        if (end == count || lights == 0 || (*end != ',' && *end != '\0'))
+            throw runtime_error("Invalid light count");
+        g_lightCounts.push_back((uint32_t)lights);
+        count = *end == ',' ? end + 1 : end;
+    }
+}
+
+// Lights of radii between a tenth of g_radius and g_radius, up to a fifth of them a little outside the frustum.
+// Types are split as CreateRandomLights splits them: a quarter spheres, half cones and the rest shadowed cones.  When
+// verifying, lights that nearly touch a cluster boundary are drawn again, see ClusteredLightGrid::IsNearBoundary.
+vector<LightClusterLight> CreateLights( uint32_t count, const LightClusterDesc& desc, float tanHalfFovX, float tanHalfFovY )
+{
+    mt19937 random(12645);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    vector<LightClusterLight> lights(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        LightClusterLight& light = lights[i];
+        const float depth = g_nearZ + (g_farZ - g_nearZ) * unit(random) * unit(random);
+        light.pos[0] = (unit(random) * 2.4f - 1.2f) * depth * tanHalfFovX;
+        light.pos[1] = (unit(random) * 2.4f - 1.2f) * depth * tanHalfFovY;
+        light.pos[2] = -depth;
+        light.radius = g_radius * (0.1f + 0.9f * unit(random));
+        light.type = i < count / 4 ? kLightClusterSphere : i < count * 3 / 4 ? kLightClusterCone : kLightClusterConeShadowed;
+        if (g_verify && ClusteredLightGrid::IsNearBoundary(desc, light, 1e-5f))
+            --i;
+    }
+    return lights;
+}
+
+// The fastest of g_iterations builds, in milliseconds.
+double TimeBuild( ClusteredLightGrid& grid, const LightClusterDesc& desc, const vector<LightClusterLight>& lights, bool simd )
+{
+    double best = 1e30;
+    for (uint32_t i = 0; i < g_iterations; ++i)
+    {
+        const auto start = chrono::high_resolution_clock::now();
+        grid.Build(desc, lights, simd);
+        const chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+// The clusters whose cells or bit masks differ.
+uint32_t CountMismatches( const ClusteredLightGrid& grid, const ClusteredLightGrid& reference, const LightClusterDesc& desc )
+{
+    uint32_t mismatches = 0;
+    const uint32_t cellWords = 1 + desc.cellCapacity;
+    for (uint32_t cluster = 0; cluster < reference.GetClusterCount(); ++cluster)
+    {
+        const uint32_t* cell = &grid.GetGrid()[size_t(cluster) * cellWords];
+        const uint32_t* expected = &reference.GetGrid()[size_t(cluster) * cellWords];
+        const uint32_t count = (expected[0] & 0xff) + ((expected[0] >> 8) & 0xff) + ((expected[0] >> 16) & 0xff);
+        bool same = memcmp(cell, expected, (1 + count) * sizeof(uint32_t)) == 0;
+        same = same && memcmp(&grid.GetBitMask()[size_t(cluster) * desc.bitMaskWords], &reference.GetBitMask()[size_t(cluster) * desc.bitMaskWords],
+            desc.bitMaskWords * sizeof(uint32_t)) == 0;
+        mismatches += same ? 0 : 1;
+    }
+    return mismatches;
+}
+
+int main( int argc, const char** argv )
+{
+    try
+    {
+        for (int arg = 1; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (strcmp("-verify", argv[arg]) == 0)
+                g_verify = true;
+            else if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-lights", argv[arg]) == 0)
+                SetLightCounts(argv[++arg]);
+            else if (strcmp("-width", argv[arg]) == 0)
+                g_width = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-height", argv[arg]) == 0)
+                g_height = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-tile", argv[arg]) == 0)
+                g_tileDim = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-slices", argv[arg]) == 0)
+                g_sliceCount = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-capacity", argv[arg]) == 0)
+                g_capacity = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-radius", argv[arg]) == 0)
+                g_radius = (float)atof(argv[++arg]);
+            else if (strcmp("-far", argv[arg]) == 0)
+                g_farZ = (float)atof(argv[++arg]);
+            else if (strcmp("-iterations", argv[arg]) == 0)
+                g_iterations = (uint32_t)atoi(argv[++arg]);
+            else
+                throw runtime_error("Invalid option");
+        }
+        if (g_width == 0 || g_height == 0 || g_tileDim == 0 || g_sliceCount == 0 || g_iterations == 0)
+            throw runtime_error("Invalid grid");
+        if (g_capacity == 0 || g_capacity > 3 * 255)
+            throw runtime_error("Invalid cell capacity");
+        if (!(g_radius > 0.0f) || !(g_farZ > g_nearZ))
+            throw runtime_error("Invalid light radius or far plane");
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s [options]*\n\n"
+            "Options:\n\n"
+            "-lights <integer>[,<integer>]*\n\tLight counts to benchmark.\n\tDefaults to 128,1000,2000,5000,10000.\n"
+            "-width <integer>\n-height <integer>\n\tViewport size in pixels.\n\tDefaults to 1920x1080.\n"
+            "-tile <integer>\n\tPixels per side of a tile.\n\tDefaults to 16.\n"
+            "-slices <integer>\n\tDepth slices; 1 gives the 2D light grid.\n\tDefaults to 16.\n"
+            "-capacity <integer>\n\tLight indices a cell holds, at most 765.\n\tDefaults to 256, MAX_LIGHTS in LightGrid.hlsli.\n"
+            "-radius <float>\n\tLargest light radius.\n\tDefaults to 40.\n"
+            "-far <float>\n\tFar plane; the near plane is at 1.\n\tDefaults to 1000.\n"
+            "-iterations <integer>\n\tBuilds timed per light count, of which the fastest is reported.\n\tDefaults to 10.\n"
+            "-verify\n\tChecks every cell against the brute force reference, leaving out lights that nearly touch a cluster boundary.\n"
+            "\n\nExample:  %s -lights 1000,10000 -tile 32 -slices 24 -verify\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    if (g_lightCounts.empty())
+        SetLightCounts("128,1000,2000,5000,10000");
+
+    const float tanHalfFovY = tan(g_fov * 3.14159265f / 360.0f);
+    const float tanHalfFovX = tanHalfFovY * float(g_width) / float(g_height);
+    LightClusterDesc desc = {};
+    desc.viewportWidth = g_width;
+    desc.viewportHeight = g_height;
+    desc.tileDim = g_tileDim;
+    desc.sliceCount = g_sliceCount;
+    desc.nearZ = g_nearZ;
+    desc.farZ = g_farZ;
+    desc.projScaleX = 1.0f / tanHalfFovX;
+    desc.projScaleY = 1.0f / tanHalfFovY;
+    desc.cellCapacity = g_capacity;
+    desc.bitMaskWords = 4;
+
+    ClusteredLightGrid grid;
+    ClusteredLightGrid reference;
+    grid.Build(desc, vector<LightClusterLight>(), false);
+    printf("%ux%u, %u pixel tiles, %u slices: %u clusters of %u lights\n\n", g_width, g_height, g_tileDim, g_sliceCount,
+        grid.GetClusterCount(), g_capacity);
+    printf("%8s %12s %14s %10s %10s %11s %11s %8s%s\n", "Lights", "Indices", "Lights/cell", "Max/cell", "Dropped", "Scalar ms",
+        "SSE ms", "Speedup", g_verify ? "  Mismatches (scalar, SSE)" : "");
+
+    bool failed = false;
+    for (uint32_t lightCount : g_lightCounts)
+    {
+        const vector<LightClusterLight> lights = CreateLights(lightCount, desc, tanHalfFovX, tanHalfFovY);
+        const double scalarMs = TimeBuild(grid, desc, lights, false);
+        uint32_t scalarMismatches = 0;
+        if (g_verify)
+        {
+            reference.BuildReference(desc, lights);
+            scalarMismatches = CountMismatches(grid, reference, desc);
+        }
+        const double simdMs = TimeBuild(grid, desc, lights, true);
+        const LightClusterStats& stats = grid.GetStats();
+        printf("%8u %12llu %14.2f %10u %10llu %11.3f %11.3f %7.2fx", lightCount, (unsigned long long)stats.indices,
+            stats.occupiedCells ? double(stats.indices) / double(stats.occupiedCells) : 0.0, stats.maxCellLights,
+            (unsigned long long)stats.droppedIndices, scalarMs, simdMs, scalarMs / max(simdMs, 1e-6));
+        if (g_verify)
+        {
+            const uint32_t simdMismatches = CountMismatches(grid, reference, desc);
+            printf("  %u, %u", scalarMismatches, simdMismatches);
+            failed = failed || scalarMismatches != 0 || simdMismatches != 0;
+        }
+        printf("\n");
+    }
+    return failed ? 1 : 0;
+}
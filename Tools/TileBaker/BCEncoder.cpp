@@ -0,0 +1,488 @@
+#include "BCEncoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    // Decoded colors of a block's palette.  Entry i lies at weights[i] along the line from endpoint 0 to endpoint 1.
+    struct Palette
+    {
+        uint32_t count;
+        float colors[16][4];
+        float weights[16];
+    };
+
+    float SquaredError( const float* a, const float* b, uint32_t channels )
+    {
+        float error = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c)
+            error += (a[c] - b[c]) * (a[c] - b[c]);
+        return error;
+    }
+
+    // Fits a line through the texels that are not skipped and returns its extent as two endpoints.  Returns false
+    // when every texel is skipped.
+    bool FitEndpoints( const float (*texels)[4], const bool* skip, uint32_t channels, uint32_t quality, float* lo, float* hi )
+    {
+        float mean[4] = {}, minimum[4], maximum[4];
+        fill(minimum, minimum + 4, 255.0f);
+        fill(maximum, maximum + 4, 0.0f);
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (skip[i])
+                continue;
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                mean[c] += texels[i][c];
+                minimum[c] = min(minimum[c], texels[i][c]);
+                maximum[c] = max(maximum[c], texels[i][c]);
+            }
+            ++count;
+        }
+        if (count == 0)
+            return false;
+
+        if (quality == 0)
+        {
+            memcpy(lo, minimum, sizeof(float) * channels);
+            memcpy(hi, maximum, sizeof(float) * channels);
+            return true;
+        }
+
+        for (uint32_t c = 0; c < channels; ++c)
+            mean[c] /= count;
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (skip[i])
+                continue;
+            for (uint32_t a = 0; a < channels; ++a)
+            {
+                for (uint32_t b = 0; b < channels; ++b)
+                    covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+
+        // Power iteration for the principal axis, starting from the bounding box diagonal.
+        float axis[4] = {};
+        for (uint32_t c = 0; c < channels; ++c)
+            axis[c] = maximum[c] - minimum[c];
+        for (uint32_t iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (uint32_t a = 0; a < channels; ++a)
+            {
+                for (uint32_t b = 0; b < channels; ++b)
+                    next[a] += covariance[a][b] * axis[b];
+                length = max(length, fabsf(next[a]));
+            }
+            if (length == 0.0f)
+                break;
+            for (uint32_t c = 0; c < channels; ++c)
+                axis[c] = next[c] / length;
+        }
+        float lengthSq = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c)
+            lengthSq += axis[c] * axis[c];
+        if (lengthSq == 0.0f)
+        {
+            memcpy(lo, mean, sizeof(float) * channels);
+            memcpy(hi, mean, sizeof(float) * channels);
+            return true;
+        }
+
+        float tMin = 1e30f, tMax = -1e30f;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (skip[i])
+                continue;
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channels; ++c)
+                t += (texels[i][c] - mean[c]) * axis[c];
+            tMin = min(tMin, t / lengthSq);
+            tMax = max(tMax, t / lengthSq);
+        }
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            lo[c] = min(max(mean[c] + axis[c] * tMin, 0.0f), 255.0f);
+            hi[c] = min(max(mean[c] + axis[c] * tMax, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    // Picks a palette entry for every texel that is not skipped and returns the total squared error.  Unless
+    // exhaustive, a texel takes the entry whose weight is nearest its projection onto the endpoint line.
+    float ChooseIndices( const float (*texels)[4], const bool* skip, uint32_t channels, const Palette& palette,
+        const float* e0, const float* e1, bool exhaustive, uint8_t* indices )
+    {
+        float axis[4] = {};
+        float lengthSq = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            axis[c] = e1[c] - e0[c];
+            lengthSq += axis[c] * axis[c];
+        }
+
+        float error = 0.0f;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (skip[i])
+                continue;
+
+            float t = 0.0f;
+            if (!exhaustive && lengthSq > 0.0f)
+            {
+                for (uint32_t c = 0; c < channels; ++c)
+                    t += (texels[i][c] - e0[c]) * axis[c];
+                t /= lengthSq;
+            }
+
+            uint32_t best = 0;
+            float bestScore = 1e30f;
+            for (uint32_t entry = 0; entry < palette.count; ++entry)
+            {
+                const float score = exhaustive ? SquaredError(texels[i], palette.colors[entry], channels) : fabsf(t - palette.weights[entry]);
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    best = entry;
+                }
+            }
+            indices[i] = (uint8_t)best;
+            error += SquaredError(texels[i], palette.colors[best], channels);
+        }
+        return error;
+    }
+
+    // Least squares endpoints for the chosen indices.  Returns false when the indices do not constrain a line.
+    bool RefineEndpoints( const float (*texels)[4], const bool* skip, uint32_t channels, const Palette& palette,
+        const uint8_t* indices, float* lo, float* hi )
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float x0[4] = {}, x1[4] = {};
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (skip[i])
+                continue;
+            const float t = palette.weights[indices[i]];
+            a += (1.0f - t) * (1.0f - t);
+            b += t * (1.0f - t);
+            c += t * t;
+            for (uint32_t ch = 0; ch < channels; ++ch)
+            {
+                x0[ch] += (1.0f - t) * texels[i][ch];
+                x1[ch] += t * texels[i][ch];
+            }
+        }
+        const float determinant = a * c - b * b;
+        if (fabsf(determinant) < 1e-6f)
+            return false;
+        for (uint32_t ch = 0; ch < channels; ++ch)
+        {
+            lo[ch] = min(max((c * x0[ch] - b * x1[ch]) / determinant, 0.0f), 255.0f);
+            hi[ch] = min(max((a * x1[ch] - b * x0[ch]) / determinant, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    void LoadTexels( const uint8_t* rgba, float (*texels)[4] )
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+                texels[i][c] = rgba[i * 4 + c];
+        }
+    }
+
+    uint16_t To565( const float* color )
+    {
+        const uint32_t r = (uint32_t)(color[0] * 31.0f / 255.0f + 0.5f);
+        const uint32_t g = (uint32_t)(color[1] * 63.0f / 255.0f + 0.5f);
+        const uint32_t b = (uint32_t)(color[2] * 31.0f / 255.0f + 0.5f);
+        return (uint16_t)(r << 11 | g << 5 | b);
+    }
+
+    void From565( uint16_t value, float* color )
+    {
+        const uint32_t r = value >> 11 & 31, g = value >> 5 & 63, b = value & 31;
+        color[0] = (float)(r << 3 | r >> 2);
+        color[1] = (float)(g << 2 | g >> 4);
+        color[2] = (float)(b << 3 | b >> 2);
+        color[3] = 255.0f;
+    }
+
+    struct ColorBlock
+    {
+        uint16_t color0;
+        uint16_t color1;
+        uint8_t indices[16];
+        float error;
+    };
+
+    // Quantizes the endpoints to 5:6:5 and picks indices.  Blocks with transparent texels need BC1's three color
+    // mode (color0 <= color1), the others use four colors.
+    ColorBlock QuantizeColorBlock( const float (*texels)[4], const bool* transparent, bool threeColor, bool exhaustive,
+        const float* lo, const float* hi )
+    {
+        ColorBlock block;
+        block.color0 = To565(hi);
+        block.color1 = To565(lo);
+        if (threeColor ? block.color0 > block.color1 : block.color0 < block.color1)
+            swap(block.color0, block.color1);
+
+        float e0[4], e1[4];
+        From565(block.color0, e0);
+        From565(block.color1, e1);
+        Palette palette;
+        memcpy(palette.colors[0], e0, sizeof(e0));
+        memcpy(palette.colors[1], e1, sizeof(e1));
+        palette.weights[0] = 0.0f;
+        palette.weights[1] = 1.0f;
+        if (block.color0 > block.color1)
+        {
+            palette.count = 4;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                palette.colors[2][c] = floorf((2.0f * e0[c] + e1[c]) / 3.0f);
+                palette.colors[3][c] = floorf((e0[c] + 2.0f * e1[c]) / 3.0f);
+            }
+            palette.weights[2] = 1.0f / 3.0f;
+            palette.weights[3] = 2.0f / 3.0f;
+        }
+        else
+        {
+            // Index 3 is transparent black, so only three colors are available.
+            palette.count = 3;
+            for (uint32_t c = 0; c < 3; ++c)
+                palette.colors[2][c] = floorf((e0[c] + e1[c]) / 2.0f);
+            palette.weights[2] = 0.5f;
+        }
+
+        block.error = ChooseIndices(texels, transparent, 3, palette, e0, e1, exhaustive, block.indices);
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (transparent[i])
+                block.indices[i] = 3;
+        }
+        return block;
+    }
+
+    void EncodeColorBlock( const uint8_t* rgba, uint8_t* out, uint32_t quality, bool punchThrough )
+    {
+        float texels[16][4];
+        LoadTexels(rgba, texels);
+        bool transparent[16];
+        bool anyTransparent = false;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            transparent[i] = punchThrough && rgba[i * 4 + 3] < 128;
+            anyTransparent |= transparent[i];
+        }
+
+        ColorBlock best = {};
+        memset(best.indices, 3, sizeof(best.indices));
+        best.error = 1e30f;
+        const bool exhaustive = quality >= 2;
+        for (uint32_t fit = exhaustive ? 0 : quality; fit <= min(quality, 1u); ++fit)
+        {
+            float lo[4], hi[4];
+            if (!FitEndpoints(texels, transparent, 3, fit, lo, hi))
+                break;
+
+            ColorBlock block = QuantizeColorBlock(texels, transparent, anyTransparent, exhaustive, lo, hi);
+            for (uint32_t iteration = 0; exhaustive && iteration < 2; ++iteration)
+            {
+                Palette weights;
+                weights.count = 4;
+                const float kWeights[4] = { 0.0f, 1.0f, block.color0 > block.color1 ? 1.0f / 3.0f : 0.5f, 2.0f / 3.0f };
+                memcpy(weights.weights, kWeights, sizeof(kWeights));
+                if (!RefineEndpoints(texels, transparent, 3, weights, block.indices, hi, lo))
+                    break;
+                const ColorBlock refined = QuantizeColorBlock(texels, transparent, anyTransparent, exhaustive, lo, hi);
+                if (refined.error >= block.error)
+                    break;
+                block = refined;
+            }
+            if (block.error < best.error)
+                best = block;
+        }
+        const ColorBlock& block = best;
+
+        out[0] = (uint8_t)block.color0;
+        out[1] = (uint8_t)(block.color0 >> 8);
+        out[2] = (uint8_t)block.color1;
+        out[3] = (uint8_t)(block.color1 >> 8);
+        uint32_t indexBits = 0;
+        for (uint32_t i = 0; i < 16; ++i)
+            indexBits |= uint32_t(block.indices[i]) << (2 * i);
+        memcpy(out + 4, &indexBits, sizeof(indexBits));
+    }
+
+    // Eight interpolated alpha values between the block's extremes.
+    void EncodeAlphaBlock( const uint8_t* rgba, uint8_t* out )
+    {
+        uint32_t alpha0 = 0, alpha1 = 255;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            alpha0 = max<uint32_t>(alpha0, rgba[i * 4 + 3]);
+            alpha1 = min<uint32_t>(alpha1, rgba[i * 4 + 3]);
+        }
+        out[0] = (uint8_t)alpha0;
+        out[1] = (uint8_t)alpha1;
+
+        uint32_t palette[8] = { alpha0, alpha1 };
+        for (uint32_t k = 2; k < 8; ++k)
+            palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+
+        uint64_t indexBits = 0;
+        for (uint32_t i = 0; alpha0 > alpha1 && i < 16; ++i)
+        {
+            uint32_t best = 0;
+            int bestError = 256;
+            for (uint32_t k = 0; k < 8; ++k)
+            {
+                const int error = abs((int)palette[k] - (int)rgba[i * 4 + 3]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = k;
+                }
+            }
+            indexBits |= uint64_t(best) << (3 * i);
+        }
+        for (uint32_t b = 0; b < 6; ++b)
+            out[2 + b] = (uint8_t)(indexBits >> (8 * b));
+    }
+
+    struct Mode6Block
+    {
+        uint32_t endpoint0[4];
+        uint32_t endpoint1[4];
+        uint32_t pbit0;
+        uint32_t pbit1;
+        uint8_t indices[16];
+        float error;
+    };
+
+    const uint32_t kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Quantizes the endpoints to 7 bits plus a p-bit, keeping the p-bits that give the least error.
+    Mode6Block QuantizeMode6( const float (*texels)[4], bool exhaustive, const float* lo, const float* hi )
+    {
+        const bool kNone[16] = {};
+        Mode6Block best = {};
+        best.error = 1e30f;
+        for (uint32_t pbits = 0; pbits < 4; ++pbits)
+        {
+            Mode6Block block = {};
+            block.pbit0 = pbits & 1;
+            block.pbit1 = pbits >> 1;
+            float e0[4], e1[4];
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                block.endpoint0[c] = (uint32_t)min(max((lo[c] - block.pbit0) * 0.5f + 0.5f, 0.0f), 127.0f);
+                block.endpoint1[c] = (uint32_t)min(max((hi[c] - block.pbit1) * 0.5f + 0.5f, 0.0f), 127.0f);
+                e0[c] = (float)(block.endpoint0[c] << 1 | block.pbit0);
+                e1[c] = (float)(block.endpoint1[c] << 1 | block.pbit1);
+            }
+
+            Palette palette;
+            palette.count = 16;
+            for (uint32_t k = 0; k < 16; ++k)
+            {
+                const uint32_t w = kBC7Weights4[k];
+                for (uint32_t c = 0; c < 4; ++c)
+                    palette.colors[k][c] = (float)(((64 - w) * (uint32_t)e0[c] + w * (uint32_t)e1[c] + 32) >> 6);
+                palette.weights[k] = w / 64.0f;
+            }
+            block.error = ChooseIndices(texels, kNone, 4, palette, e0, e1, exhaustive, block.indices);
+            if (block.error < best.error)
+                best = block;
+        }
+        return best;
+    }
+
+    struct BitWriter
+    {
+        uint8_t* out;
+        uint32_t position;
+
+        void Write( uint32_t value, uint32_t bits )
+        {
+            for (uint32_t i = 0; i < bits; ++i, ++position)
+                out[position >> 3] |= (uint8_t)((value >> i & 1) << (position & 7));
+        }
+    };
+}
+
+void EncodeBC1Block( const uint8_t* rgba, uint8_t* block, uint32_t quality )
+{
+    EncodeColorBlock(rgba, block, quality, true);
+}
+
+void EncodeBC3Block( const uint8_t* rgba, uint8_t* block, uint32_t quality )
+{
+    EncodeAlphaBlock(rgba, block);
+    // BC3 always decodes the color block with four colors.
+    EncodeColorBlock(rgba, block + 8, quality, false);
+}
+
+void EncodeBC7Block( const uint8_t* rgba, uint8_t* block, uint32_t quality )
+{
+    float texels[16][4];
+    LoadTexels(rgba, texels);
+    const bool kNone[16] = {};
+    const bool exhaustive = quality >= 2;
+    Mode6Block best = {};
+    best.error = 1e30f;
+    for (uint32_t fit = exhaustive ? 0 : quality; fit <= min(quality, 1u); ++fit)
+    {
+        float lo[4], hi[4];
+        FitEndpoints(texels, kNone, 4, fit, lo, hi);
+
+        Mode6Block block = QuantizeMode6(texels, exhaustive, lo, hi);
+        for (uint32_t iteration = 0; exhaustive && iteration < 2; ++iteration)
+        {
+            Palette weights;
+            weights.count = 16;
+            for (uint32_t k = 0; k < 16; ++k)
+                weights.weights[k] = kBC7Weights4[k] / 64.0f;
+            if (!RefineEndpoints(texels, kNone, 4, weights, block.indices, lo, hi))
+                break;
+            const Mode6Block refined = QuantizeMode6(texels, exhaustive, lo, hi);
+            if (refined.error >= block.error)
+                break;
+            block = refined;
+        }
+        if (block.error < best.error)
+            best = block;
+    }
+
+    // The anchor texel's index is stored without its top bit, so it must be below 8.
+    if (best.indices[0] & 8)
+    {
+        swap(best.endpoint0, best.endpoint1);
+        swap(best.pbit0, best.pbit1);
+        for (uint8_t& index : best.indices)
+            index = (uint8_t)(15 - index);
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer = { block, 0 };
+    writer.Write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        writer.Write(best.endpoint0[c], 7);
+        writer.Write(best.endpoint1[c], 7);
+    }
+    writer.Write(best.pbit0, 1);
+    writer.Write(best.pbit1, 1);
+    writer.Write(best.indices[0], 3);
+    for (uint32_t i = 1; i < 16; ++i)
+        writer.Write(best.indices[i], 4);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU block compression for the tile baker.  Each call encodes one 4x4 block of RGBA8 texels given row by row.
+//
+// Quality trades speed for error:
+//   0  endpoints span the block's bounding box, texels are projected onto the endpoint line
+//   1  endpoints span the block's principal axis, texels are projected onto the endpoint line
+//   2  starts from both fits, tries every palette entry per texel and refines the endpoints by least squares
+static const uint32_t kMaxBCQuality = 2;
+
+// 8 bytes.  Texels with alpha below 128 use BC1's transparent index.
+void EncodeBC1Block( const uint8_t* rgba, uint8_t* block, uint32_t quality );
+
+// 16 bytes: interpolated alpha followed by a BC1 color block.
+void EncodeBC3Block( const uint8_t* rgba, uint8_t* block, uint32_t quality );
+
+// 16 bytes.  Only mode 6 (one subset, 7.7.7.7 endpoints with a p-bit each, 4 bit indices) is used, which suits
+// smooth texture content and keeps the encoder simple.
+void EncodeBC7Block( const uint8_t* rgba, uint8_t* block, uint32_t quality );
@@ -0,0 +1,454 @@
+//
+// Bakes a source image into a virtual texture tile archive (see Core/TileArchive.h).  The mip chain is built with a
+// Lanczos filter, and every mip is filtered, cut into tiles and block compressed on all cores.
+//
+
+#include "../../Core/TileArchive.h"
+#include "BCEncoder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Image
+{
+    uint32_t width;
+    uint32_t height;
+    vector<uint8_t> texels;    // RGBA8, rows tightly packed
+};
+
+uint32_t g_numThreads = 0;
+uint32_t g_codec = kTileCodecRGBA8;
+uint32_t g_quality = 1;
+uint32_t g_tileWidth = 128;
+uint32_t g_tileHeight = 128;
+uint32_t g_borderSize = 0;
+bool g_sRGB = false;
+
+// Tiles are baked in the 64 KB standard tile shape of their format, so one stored tile fills one tile of the
+// reserved resource.
+void SetCodec( const char* name )
+{
+    if (strcmp(name, "rgba8") == 0)
+    {
+        g_codec = kTileCodecRGBA8;
+        g_tileWidth = 128;
+        g_tileHeight = 128;
+    }
+    else if (strcmp(name, "bc1") == 0)
+    {
+        g_codec = kTileCodecBC1;
+        g_tileWidth = 512;
+        g_tileHeight = 256;
+    }
+    else if (strcmp(name, "bc3") == 0 || strcmp(name, "bc7") == 0)
+    {
+        g_codec = name[2] == '3' ? kTileCodecBC3 : kTileCodecBC7;
+        g_tileWidth = 256;
+        g_tileHeight = 256;
+    }
+    else
+    {
+        throw runtime_error("Invalid format");
+    }
+}
+
+// Runs body(0) ... body(count - 1) on g_numThreads threads, the calling thread included.
+void ParallelFor( uint32_t count, const function<void(uint32_t)>& body )
+{
+    atomic<uint32_t> next(0);
+    auto worker = [&]()
+    {
+        for (uint32_t i = next++; i < count; i = next++)
+            body(i);
+    };
+
+    vector<thread> Threads;
+    for (uint32_t i = 1; i < g_numThreads; ++i)
+        Threads.emplace_back(worker);
+    worker();
+    for_each( Threads.begin(), Threads.end(), []( thread& T ) { T.join(); } );
+}
+
+// Reads uncompressed or run-length encoded 24 and 32 bit Targa files.
+Image LoadTGA( const string& filename )
+{
+    FILE* file = nullptr;
+    if (fopen_s(&file, filename.c_str(), "rb") != 0 || file == nullptr)
+        throw runtime_error("Unable to open source image");
+    vector<uint8_t> bytes;
+    uint8_t buffer[64 * 1024];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0; )
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    fclose(file);
+
+    if (bytes.size() < 18)
+        throw runtime_error("Source image is not a Targa file");
+    const uint8_t imageType = bytes[2];
+    const uint32_t width = bytes[12] | bytes[13] << 8;
+    const uint32_t height = bytes[14] | bytes[15] << 8;
+    const uint32_t pixelBytes = bytes[16] / 8;
+    const bool topDown = (bytes[17] & 0x20) != 0;
+    if ((imageType != 2 && imageType != 10) || (pixelBytes != 3 && pixelBytes != 4) || bytes[1] != 0)
+        throw runtime_error("Only 24 and 32 bit true color Targa files are supported");
+
+    Image image = { width, height, vector<uint8_t>(size_t(width) * height * 4) };
+    const uint8_t* src = bytes.data() + 18 + bytes[0];
+    const uint8_t* end = bytes.data() + bytes.size();
+    auto storePixel = [&]( size_t index, const uint8_t* bgra )
+    {
+        // Targa rows run bottom to top unless the descriptor says otherwise.
+        const size_t x = index % width;
+        const size_t y = topDown ? index / width : height - 1 - index / width;
+        uint8_t* dest = &image.texels[(y * width + x) * 4];
+        dest[0] = bgra[2];
+        dest[1] = bgra[1];
+        dest[2] = bgra[0];
+        dest[3] = pixelBytes == 4 ? bgra[3] : 255;
+    };
+
+    const size_t pixelCount = size_t(width) * height;
+    for (size_t i = 0; i < pixelCount; )
+    {
+        size_t run = 1;
+        bool repeat = false;
+        if (imageType == 10)
+        {
+            if (src >= end)
+                throw runtime_error("Source image is truncated");
+            repeat = (*src & 0x80) != 0;
+            run = (*src++ & 0x7F) + 1;
+        }
+        if (src + (repeat ? 1 : run) * pixelBytes > end || i + run > pixelCount)
+            throw runtime_error("Source image is truncated");
+        for (size_t j = 0; j < run; ++j)
+            storePixel(i + j, src + (repeat ? 0 : j * pixelBytes));
+        src += (repeat ? 1 : run) * pixelBytes;
+        i += run;
+    }
+    return image;
+}
+
+// 2:1 Lanczos-3 reduction.  A destination texel is centred between two source texels, so the taps sit at half
+// texel offsets from -5.5 to 5.5 source texels.
+static const int kFilterTaps = 12;
+float g_FilterWeights[kFilterTaps];
+float g_ToLinear[256];
+
+double Sinc( double x )
+{
+    if (x == 0.0)
+        return 1.0;
+    const double px = 3.14159265358979323846 * x;
+    return sin(px) / px;
+}
+
+void InitializeFilter( void )
+{
+    float sum = 0.0f;
+    for (int k = 0; k < kFilterTaps; ++k)
+    {
+        const double x = (k - 5.5) * 0.5;
+        g_FilterWeights[k] = (float)(Sinc(x) * Sinc(x / 3.0));
+        sum += g_FilterWeights[k];
+    }
+    for (int k = 0; k < kFilterTaps; ++k)
+        g_FilterWeights[k] /= sum;
+
+    for (int i = 0; i < 256; ++i)
+    {
+        const float c = i / 255.0f;
+        g_ToLinear[i] = g_sRGB ? (c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f)) : c;
+    }
+}
+
+uint8_t FromLinear( float c, bool isAlpha )
+{
+    c = min(max(c, 0.0f), 1.0f);
+    if (g_sRGB && !isAlpha)
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+Image Downsample( const Image& src )
+{
+    Image dst = { max(src.width / 2, 1u), max(src.height / 2, 1u) };
+    dst.texels.resize(size_t(dst.width) * dst.height * 4);
+
+    // Strips of destination rows are filtered horizontally into a private buffer, then vertically.
+    const uint32_t kStripRows = 32;
+    const uint32_t stripCount = (dst.height + kStripRows - 1) / kStripRows;
+    ParallelFor(stripCount, [&]( uint32_t strip )
+    {
+        const int firstRow = strip * kStripRows;
+        const int lastRow = min(firstRow + (int)kStripRows, (int)dst.height);
+        const int srcFirst = src.height > 1 ? 2 * firstRow - 5 : 0;
+        const int srcCount = src.height > 1 ? 2 * (lastRow - firstRow) + 10 : 1;
+
+        vector<float> row(src.width * 4);
+        vector<float> horizontal(size_t(srcCount) * dst.width * 4);
+        for (int r = 0; r < srcCount; ++r)
+        {
+            const int sy = min(max(srcFirst + r, 0), (int)src.height - 1);
+            const uint8_t* srcRow = &src.texels[size_t(sy) * src.width * 4];
+            for (uint32_t i = 0; i < src.width * 4; ++i)
+                row[i] = (i & 3) == 3 ? srcRow[i] / 255.0f : g_ToLinear[srcRow[i]];
+
+            float* out = &horizontal[size_t(r) * dst.width * 4];
+            for (int x = 0; x < (int)dst.width; ++x)
+            {
+                float sum[4] = {};
+                for (int k = 0; k < kFilterTaps; ++k)
+                {
+                    const int sx = src.width > 1 ? min(max(2 * x - 5 + k, 0), (int)src.width - 1) : 0;
+                    for (int c = 0; c < 4; ++c)
+                        sum[c] += row[sx * 4 + c] * g_FilterWeights[k];
+                }
+                memcpy(&out[x * 4], sum, sizeof(sum));
+            }
+        }
+
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            uint8_t* out = &dst.texels[size_t(y) * dst.width * 4];
+            for (uint32_t i = 0; i < dst.width * 4; ++i)
+            {
+                float sum = 0.0f;
+                if (src.height > 1)
+                {
+                    for (int k = 0; k < kFilterTaps; ++k)
+                        sum += horizontal[size_t(2 * y - 5 + k - srcFirst) * dst.width * 4 + i] * g_FilterWeights[k];
+                }
+                else
+                {
+                    sum = horizontal[i];
+                }
+                out[i] = FromLinear(sum, (i & 3) == 3);
+            }
+        }
+    });
+    return dst;
+}
+
+// Tiles of a mip, row by row, in the order of the archive index.
+void AppendMipEntries( vector<TileArchiveEntry>& entries, uint32_t mip, uint32_t width, uint32_t height )
+{
+    const uint32_t tilesX = (width + g_tileWidth - 1) / g_tileWidth;
+    const uint32_t tilesY = (height + g_tileHeight - 1) / g_tileHeight;
+    for (uint32_t y = 0; y < tilesY; ++y)
+    {
+        for (uint32_t x = 0; x < tilesX; ++x)
+        {
+            TileArchiveEntry entry = {};
+            entry.mip = (uint16_t)mip;
+            entry.codec = (uint16_t)g_codec;
+            entry.x = (uint16_t)x;
+            entry.y = (uint16_t)y;
+            // Mips smaller than a block are padded out to one by CutTile's edge clamp.
+            const uint32_t blockSize = GetTileCodecBlockSize(g_codec);
+            const uint32_t interiorWidth = (min(g_tileWidth, width) + blockSize - 1) / blockSize * blockSize;
+            const uint32_t interiorHeight = (min(g_tileHeight, height) + blockSize - 1) / blockSize * blockSize;
+            entry.width = (uint16_t)(interiorWidth + 2 * g_borderSize);
+            entry.height = (uint16_t)(interiorHeight + 2 * g_borderSize);
+            entry.size = entry.width / blockSize * (entry.height / blockSize) * GetTileCodecBlockBytes(g_codec);
+            entries.push_back(entry);
+        }
+    }
+}
+
+// Copies a tile and its border out of the mip, clamping at the texture edge.
+void CutTile( const Image& image, const TileArchiveEntry& entry, vector<uint8_t>& tile )
+{
+    tile.resize(size_t(entry.width) * entry.height * 4);
+    const int left = entry.x * g_tileWidth - g_borderSize;
+    const int top = entry.y * g_tileHeight - g_borderSize;
+    for (int y = 0; y < entry.height; ++y)
+    {
+        const int sy = min(max(top + y, 0), (int)image.height - 1);
+        for (int x = 0; x < entry.width; ++x)
+        {
+            const int sx = min(max(left + x, 0), (int)image.width - 1);
+            memcpy(&tile[(size_t(y) * entry.width + x) * 4], &image.texels[(size_t(sy) * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+// Compresses a cut tile in place, block rows top to bottom.
+void EncodeTile( const TileArchiveEntry& entry, vector<uint8_t>& tile )
+{
+    if (g_codec == kTileCodecRGBA8)
+        return;
+
+    auto encodeBlock = g_codec == kTileCodecBC1 ? EncodeBC1Block : g_codec == kTileCodecBC3 ? EncodeBC3Block : EncodeBC7Block;
+    const uint32_t blockBytes = GetTileCodecBlockBytes(g_codec);
+    const uint32_t blocksX = entry.width / 4;
+    const uint32_t blocksY = entry.height / 4;
+    vector<uint8_t> blocks(entry.size);
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            uint8_t texels[16 * 4];
+            for (uint32_t row = 0; row < 4; ++row)
+                memcpy(&texels[row * 16], &tile[((size_t(by) * 4 + row) * entry.width + bx * 4) * 4], 16);
+            encodeBlock(texels, &blocks[(size_t(by) * blocksX + bx) * blockBytes], g_quality);
+        }
+    }
+    tile.swap(blocks);
+}
+
+void BakeArchive( const string& inputFile, const string& outputFile )
+{
+    const auto startTime = chrono::steady_clock::now();
+    InitializeFilter();
+    Image level = LoadTGA(inputFile);
+
+    // Same mip count as the tiled texture: the chain stops when either side reaches one texel.
+    TileArchiveHeader header = {};
+    header.magic = kTileArchiveMagic;
+    header.version = kTileArchiveVersion;
+    header.width = level.width;
+    header.height = level.height;
+    for (uint32_t w = level.width, h = level.height; w > 0 && h > 0; w >>= 1, h >>= 1)
+        header.mipCount++;
+    header.tileWidth = g_tileWidth;
+    header.tileHeight = g_tileHeight;
+    header.border = g_borderSize;
+    header.codec = g_codec;
+
+    // Tile sizes only depend on the mip sizes, so the whole index is laid out before any mip is built.
+    vector<TileArchiveEntry> entries;
+    vector<size_t> mipFirstEntry;
+    for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+    {
+        mipFirstEntry.push_back(entries.size());
+        AppendMipEntries(entries, mip, max(header.width >> mip, 1u), max(header.height >> mip, 1u));
+    }
+    mipFirstEntry.push_back(entries.size());
+    header.tileCount = (uint32_t)entries.size();
+
+    auto alignUp = []( uint64_t offset ) { return (offset + kTileArchiveAlignment - 1) & ~uint64_t(kTileArchiveAlignment - 1); };
+    uint64_t offset = alignUp(sizeof(header) + entries.size() * sizeof(TileArchiveEntry));
+    for (TileArchiveEntry& entry : entries)
+    {
+        entry.offset = offset;
+        offset = alignUp(offset + entry.size);
+    }
+
+    FILE* file = nullptr;
+    if (fopen_s(&file, outputFile.c_str(), "wb") != 0 || file == nullptr)
+        throw runtime_error("Unable to create output file");
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries.data(), sizeof(TileArchiveEntry), entries.size(), file);
+
+    mutex fileMutex;
+    bool writeFailed = false;
+    for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+    {
+        if (mip > 0)
+            level = Downsample(level);
+
+        ParallelFor((uint32_t)(mipFirstEntry[mip + 1] - mipFirstEntry[mip]), [&]( uint32_t i )
+        {
+            const TileArchiveEntry& entry = entries[mipFirstEntry[mip] + i];
+            vector<uint8_t> tile;
+            CutTile(level, entry, tile);
+            EncodeTile(entry, tile);
+
+            lock_guard<mutex> lock(fileMutex);
+            if (_fseeki64(file, (int64_t)entry.offset, SEEK_SET) != 0 || fwrite(tile.data(), 1, tile.size(), file) != tile.size())
+                writeFailed = true;
+        });
+        printf("Mip %u: %ux%u, %zu tiles\n", mip, level.width, level.height, mipFirstEntry[mip + 1] - mipFirstEntry[mip]);
+    }
+    if (fclose(file) != 0 || writeFailed)
+        throw runtime_error("Unable to write output file");
+
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    printf("Finished creating %s (%u tiles, %llu MB) in %.1f s\n", outputFile.c_str(), header.tileCount,
+        (unsigned long long)(offset >> 20), seconds);
+}
+
+int main( int argc, const char** argv )
+{
+    string inputFile = "";
+    string outputFile = "";
+
+    try
+    {
+        if (argc < 2)
+            throw runtime_error("No source image specified");
+        inputFile = argv[1];
+
+        for (int arg = 2; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (strcmp("-srgb", argv[arg]) == 0)
+                g_sRGB = true;
+            else if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-output", argv[arg]) == 0)
+                outputFile = argv[++arg];
+            else if (strcmp("-format", argv[arg]) == 0)
+                SetCodec(argv[++arg]);
+            else if (strcmp("-quality", argv[arg]) == 0)
+                g_quality = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-border", argv[arg]) == 0)
+                g_borderSize = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-threads", argv[arg]) == 0)
+                g_numThreads = (uint32_t)atoi(argv[++arg]);
+            else
+                throw runtime_error("Invalid option");
+        }
+        if (g_tileWidth + 2 * g_borderSize > 0xFFFF)
+            throw runtime_error("Invalid border size");
+        if (g_borderSize % GetTileCodecBlockSize(g_codec) != 0)
+            throw runtime_error("Block compressed tiles need a border that is a multiple of 4");
+        if (g_quality > kMaxBCQuality)
+            throw runtime_error("Invalid quality");
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s <source.tga> [options]*\n\n"
+            "Options:\n\n"
+            "-output <filename>\n\tThe tile archive to write.\n\tDefaults to the source name with a .vta extension.\n"
+            "-format <rgba8|bc1|bc3|bc7>\n\tTile format.  Tiles take the 64 KB standard tile shape of the format.\n\tDefaults to rgba8.\n"
+            "-quality <0-2>\n\tBlock compression effort; 0 is fastest, 2 gives the least error.\n\tDefaults to 1.\n"
+            "-border <integer>\n\tTexels copied from the neighbouring tiles on each side of a tile.\n\tMust be a multiple of 4 for block compressed formats.\n\tDefaults to 0.\n"
+            "-srgb\n\tFilter the color channels in linear space.\n"
+            "-threads <integer>\n\tWorker threads.\n\tDefaults to the number of hardware threads.\n"
+            "\n\nExample:  %s StreamingAssets.tga -srgb -format bc7 -output StreamingAssets.vta\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    if (outputFile.length() == 0)
+        outputFile = inputFile.substr(0, inputFile.rfind('.')) + ".vta";
+
+    if (g_numThreads == 0)
+        g_numThreads = max(thread::hardware_concurrency(), 1u);
+
+    try
+    {
+        BakeArchive(inputFile, outputFile);
+    }
+    catch (exception& e)
+    {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
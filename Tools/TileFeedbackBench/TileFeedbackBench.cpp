@@ -0,0 +1,129 @@
+//
+// Benchmarks the tile feedback aggregation (see Core/TileFeedback.h) on a captured feedback buffer without a device,
+// scalar against SSE2, and checks that both build the same requests.  Capture a buffer with
+// Graphics/Virtual Texture/Capture Feedback.
+//
+
+#include "../../Core/TileFeedback.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+uint32_t g_iterations = 200;
+uint32_t g_repeat = 1;
+
+struct BenchResult
+{
+    double accumulateMs;
+    double requestsMs;
+    vector<TileFeedbackRequest> requests;
+};
+
+// The fastest of g_iterations aggregations of the capture, g_repeat times over, in milliseconds.
+BenchResult Aggregate( TileFeedbackAggregator& aggregator, const vector<uint32_t>& texels, uint32_t width, uint32_t height, bool simd )
+{
+    BenchResult result = { 1e30, 1e30 };
+    for (uint32_t i = 0; i < g_iterations; ++i)
+    {
+        aggregator.Clear();
+        const auto start = chrono::high_resolution_clock::now();
+        for (uint32_t repeat = 0; repeat < g_repeat; ++repeat)
+            aggregator.Accumulate(texels.data(), width, height, width, simd);
+        const auto accumulated = chrono::high_resolution_clock::now();
+        result.requests.clear();
+        aggregator.BuildRequests(result.requests);
+        const auto built = chrono::high_resolution_clock::now();
+        result.accumulateMs = min(result.accumulateMs, chrono::duration<double, milli>(accumulated - start).count());
+        result.requestsMs = min(result.requestsMs, chrono::duration<double, milli>(built - accumulated).count());
+    }
+    return result;
+}
+
+bool SameRequests( const vector<TileFeedbackRequest>& a, const vector<TileFeedbackRequest>& b )
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].page != b[i].page || a[i].coverage != b[i].coverage || a[i].mipLevel != b[i].mipLevel)
+            return false;
+    }
+    return true;
+}
+
+int main( int argc, const char** argv )
+{
+    string captureFile = "";
+
+    try
+    {
+        if (argc < 2)
+            throw runtime_error("No capture specified");
+        captureFile = argv[1];
+
+        for (int arg = 2; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-iterations", argv[arg]) == 0)
+                g_iterations = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-repeat", argv[arg]) == 0)
+                g_repeat = (uint32_t)atoi(argv[++arg]);
+            else
+                throw runtime_error("Invalid option");
+        }
+        if (g_iterations == 0 || g_repeat == 0)
+            throw runtime_error("Invalid iteration count");
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s <capture.bin> [options]*\n\n"
+            "Options:\n\n"
+            "-iterations <integer>\n\tAggregations timed, of which the fastest is reported.\n\tDefaults to 200.\n"
+            "-repeat <integer>\n\tTimes the capture is accumulated per aggregation, as if the buffer were that many times taller.\n"
+            "\tDefaults to 1.\n"
+            "\n\nExample:  %s TileFeedback.bin -iterations 1000 -repeat 16\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    vector<uint32_t> texels, pagesX, pagesY;
+    uint32_t width = 0, height = 0;
+    if (!LoadTileFeedbackCapture(wstring(captureFile.begin(), captureFile.end()), texels, width, height, pagesX, pagesY))
+    {
+        printf("Error: Unable to read capture %s\n", captureFile.c_str());
+        return 1;
+    }
+
+    TileFeedbackAggregator aggregator;
+    aggregator.Reset(pagesX, pagesY);
+    const BenchResult scalar = Aggregate(aggregator, texels, width, height, false);
+    const BenchResult simd = Aggregate(aggregator, texels, width, height, true);
+    const double texelCount = double(width) * height * g_repeat;
+
+    printf("%s: %ux%u texels, %u mips, %u pages\n", captureFile.c_str(), width, height, (uint32_t)pagesX.size(), aggregator.GetPageCount());
+    printf("%u pages seen, %llu samples, %u requests\n\n", aggregator.GetSeenPageCount(), (unsigned long long)aggregator.GetSampleCount(),
+        (uint32_t)simd.requests.size());
+    printf("%-8s %14s %14s %14s\n", "", "Accumulate ms", "Mtexels/s", "Requests ms");
+    printf("%-8s %14.4f %14.1f %14.4f\n", "Scalar", scalar.accumulateMs, texelCount / max(scalar.accumulateMs, 1e-6) / 1000.0, scalar.requestsMs);
+    printf("%-8s %14.4f %14.1f %14.4f\n", "SSE2", simd.accumulateMs, texelCount / max(simd.accumulateMs, 1e-6) / 1000.0, simd.requestsMs);
+    printf("\nSpeedup %.2fx\n", scalar.accumulateMs / max(simd.accumulateMs, 1e-6));
+
+    if (!SameRequests(scalar.requests, simd.requests))
+    {
+        printf("Error: The scalar and SSE2 aggregations built different requests\n");
+        return 1;
+    }
+    return 0;
+}
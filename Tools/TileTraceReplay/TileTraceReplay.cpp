@@ -0,0 +1,251 @@
+//
+// Replays a tile trace (see Core/TileTrace.h) through the virtual texture residency policy without a device, and
+// reports how well each combination of pool size and eviction policy keeps up with the recorded feedback.  Record a
+// trace with Graphics/Virtual Texture/Record Trace.
+//
+
+#include "../../Core/TileResidency.h"
+#include "../../Core/TileTrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+vector<uint32_t> g_slotCounts;
+vector<TilePool::Policy> g_policies;
+uint32_t g_requestBudget = 0;
+uint32_t g_prefetchBudget = 0;
+uint32_t g_uploadBudget = 0;
+uint32_t g_latency = 2;
+uint32_t g_evictionDelay = 0;
+bool g_requestBudgetSet = false;
+bool g_prefetchBudgetSet = false;
+bool g_uploadBudgetSet = false;
+
+const char* const kPolicyNames[TilePool::kPolicyCount] = { "lru", "clock", "fifo" };
+
+void SetPolicies( const char* name )
+{
+    g_policies.clear();
+    for (uint32_t policy = 0; policy < TilePool::kPolicyCount; ++policy)
+    {
+        if (strcmp(name, "all") == 0 || strcmp(name, kPolicyNames[policy]) == 0)
+            g_policies.push_back((TilePool::Policy)policy);
+    }
+    if (g_policies.empty())
+        throw runtime_error("Invalid policy");
+}
+
+void SetSlotCounts( const char* list )
+{
+    g_slotCounts.clear();
+    for (const char* count = list; *count != '\0'; )
+    {
+        char* end;
+        const unsigned long slots = strtoul(count, &end, 10);
+        if (end == count || slots == 0 || (*end != ',' && *end != '\0'))
+            throw runtime_error("Invalid slot count");
+        g_slotCounts.push_back((uint32_t)slots);
+        count = *end == ',' ? end + 1 : end;
+    }
+}
+
+struct ReplayResult
+{
+    TileResidencyStats stats;
+    uint32_t peakUploads;
+};
+
+// Stands in for TileStreamer and the upload ring: requests are started in priority order, at most g_uploadBudget a
+// frame, and each takes g_latency frames before it can be placed, again at most g_uploadBudget a frame.  Only
+// requests that have not started can be cancelled, as with the streamer's workers.
+ReplayResult Replay( const TileTraceHeader& header, const vector<TileTraceFrame>& frames, uint32_t slotCount, TilePool::Policy policy )
+{
+    struct QueuedLoad
+    {
+        TileLoad load;
+        uint64_t sequence;
+        bool operator<( const QueuedLoad& rhs ) const
+        {
+            return load.priority != rhs.load.priority ? load.priority < rhs.load.priority : sequence > rhs.sequence;
+        }
+    };
+    struct StartedLoad
+    {
+        uint32_t page;
+        uint64_t readyFrame;
+    };
+
+    TileResidency residency;
+    residency.Reset(header.pageCount, min(slotCount, header.pageCount - 1), policy);
+    residency.SetEvictionDelay(g_evictionDelay);
+
+    priority_queue<QueuedLoad> queue;
+    vector<StartedLoad> started;
+    unordered_set<uint32_t> pending;
+    uint64_t sequence = 0;
+    vector<TileLoad> loads;
+    vector<uint32_t> cancelled;
+    vector<TileMapping> mappings;
+    ReplayResult result = {};
+
+    for (uint64_t frame = 0; frame < frames.size(); ++frame)
+    {
+        const TileTraceFrame& traced = frames[frame];
+        if (traced.hasFeedback)
+        {
+            loads.clear();
+            cancelled.clear();
+            residency.Update(frame, traced.demanded, traced.predicted, g_requestBudget, g_prefetchBudget, loads, cancelled);
+            if (!cancelled.empty())
+            {
+                sort(cancelled.begin(), cancelled.end());
+                vector<QueuedLoad> kept;
+                for (; !queue.empty(); queue.pop())
+                {
+                    const QueuedLoad& queued = queue.top();
+                    if (queued.load.prefetch && binary_search(cancelled.begin(), cancelled.end(), queued.load.page))
+                        pending.erase(queued.load.page);
+                    else
+                        kept.push_back(queued);
+                }
+                queue = priority_queue<QueuedLoad>(kept.begin(), kept.end());
+            }
+            for (const TileLoad& load : loads)
+            {
+                if (pending.insert(load.page).second)
+                    queue.push(QueuedLoad{ load, sequence++ });
+            }
+        }
+        else
+        {
+            residency.SkipFrame();
+        }
+
+        for (uint32_t i = 0; i < g_uploadBudget && !queue.empty(); ++i, queue.pop())
+            started.push_back(StartedLoad{ queue.top().load.page, frame + g_latency });
+
+        uint32_t uploads = 0;
+        size_t kept = 0;
+        for (const StartedLoad& load : started)
+        {
+            if (load.readyFrame > frame || uploads == g_uploadBudget)
+            {
+                started[kept++] = load;
+                continue;
+            }
+            pending.erase(load.page);
+            mappings.clear();
+            if (residency.Place(load.page, frame, mappings))
+                uploads++;
+        }
+        started.resize(kept);
+        result.peakUploads = max(result.peakUploads, uploads);
+    }
+
+    result.stats = residency.GetStats();
+    return result;
+}
+
+int main( int argc, const char** argv )
+{
+    string traceFile = "";
+
+    try
+    {
+        if (argc < 2)
+            throw runtime_error("No trace specified");
+        traceFile = argv[1];
+
+        for (int arg = 2; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-slots", argv[arg]) == 0)
+                SetSlotCounts(argv[++arg]);
+            else if (strcmp("-policy", argv[arg]) == 0)
+                SetPolicies(argv[++arg]);
+            else if (strcmp("-requests", argv[arg]) == 0)
+                g_requestBudget = (uint32_t)atoi(argv[++arg]), g_requestBudgetSet = true;
+            else if (strcmp("-prefetch", argv[arg]) == 0)
+                g_prefetchBudget = (uint32_t)atoi(argv[++arg]), g_prefetchBudgetSet = true;
+            else if (strcmp("-uploads", argv[arg]) == 0)
+                g_uploadBudget = (uint32_t)atoi(argv[++arg]), g_uploadBudgetSet = true;
+            else if (strcmp("-latency", argv[arg]) == 0)
+                g_latency = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-delay", argv[arg]) == 0)
+                g_evictionDelay = (uint32_t)atoi(argv[++arg]);
+            else
+                throw runtime_error("Invalid option");
+        }
+        if (g_uploadBudgetSet && g_uploadBudget == 0)
+            throw runtime_error("Invalid upload budget");
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s <trace.bin> [options]*\n\n"
+            "Options:\n\n"
+            "-slots <integer>[,<integer>]*\n\tPool sizes in 64 KB tiles to replay.\n\tDefaults to the pool size of the recording.\n"
+            "-policy <lru|clock|fifo|all>\n\tEviction policy to replay.\n\tDefaults to all.\n"
+            "-requests <integer>\n\tDemand loads queued per frame.\n\tDefaults to the budget of the recording.\n"
+            "-prefetch <integer>\n\tPrefetch loads queued per frame; 0 turns prefetching off.\n\tDefaults to the budget of the recording.\n"
+            "-uploads <integer>\n\tTiles loaded, and tiles placed, per frame.\n\tDefaults to the budget of the recording.\n"
+            "-latency <integer>\n\tFrames a tile takes to load.\n\tDefaults to 2.\n"
+            "-delay <integer>\n\tFrames a page stays resident after its last use.\n\tDefaults to the delay of the recording.\n"
+            "\n\nExample:  %s TileTrace.bin -slots 256,512,1024 -policy all -prefetch 0\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    TileTraceHeader header;
+    vector<TileTraceFrame> frames;
+    if (!LoadTileTrace(wstring(traceFile.begin(), traceFile.end()), header, frames))
+    {
+        printf("Error: Unable to read trace %s\n", traceFile.c_str());
+        return 1;
+    }
+
+    if (g_slotCounts.empty())
+        g_slotCounts.push_back(header.slotCount);
+    if (g_policies.empty())
+        SetPolicies("all");
+    if (!g_requestBudgetSet)
+        g_requestBudget = header.requestBudget;
+    if (!g_prefetchBudgetSet)
+        g_prefetchBudget = header.prefetchBudget;
+    if (!g_uploadBudgetSet)
+        g_uploadBudget = max(header.uploadBudget, 1u);
+    if (g_evictionDelay == 0)
+        g_evictionDelay = max(header.evictionDelay, 1u);
+
+    printf("%s: %u frames, %u pages, recorded with %u slots\n", traceFile.c_str(), (uint32_t)frames.size(), header.pageCount, header.slotCount);
+    printf("Budgets per frame: %u requests, %u prefetches, %u uploads, %u frames load latency, %u frames eviction delay\n\n",
+        g_requestBudget, g_prefetchBudget, g_uploadBudget, g_latency, g_evictionDelay);
+    printf("%-6s %8s %9s %14s %12s %10s %14s %9s %10s\n", "Policy", "Slots", "Hit rate", "Uploads/frame", "Max uploads", "Evictions", "Peak resident", "Dropped", "Cancelled");
+
+    for (uint32_t slotCount : g_slotCounts)
+    {
+        for (TilePool::Policy policy : g_policies)
+        {
+            const ReplayResult result = Replay(header, frames, slotCount, policy);
+            const TileResidencyStats& stats = result.stats;
+            const double hitRate = stats.feedbackSamples ? 100.0 * (1.0 - double(stats.missedSamples) / double(stats.feedbackSamples)) : 100.0;
+            const double uploadsPerFrame = stats.frames ? double(stats.uploads) / double(stats.frames) : 0.0;
+            printf("%-6s %8u %8.2f%% %14.2f %12u %10llu %14u %9llu %10llu\n", kPolicyNames[policy], slotCount, hitRate, uploadsPerFrame,
+                result.peakUploads, (unsigned long long)stats.evictions, stats.peakResident,
+                (unsigned long long)stats.droppedUploads, (unsigned long long)stats.cancelledPrefetches);
+        }
+    }
+    return 0;
+}
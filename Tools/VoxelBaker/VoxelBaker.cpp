@@ -0,0 +1,349 @@
+//
+// Voxelizes H3D models on the CPU into a voxel cache (see Core/VoxelCache.h) for VCT to load for its static models
+// instead of revoxelizing them on the GPU.  Level 0 is voxelized on all cores and every coarser level is built from
+// the one below.  The cache can be checked against the scalar reference voxelizer or compared with another cache.
+//
+
+#include "../../Core/CpuVoxelizer.h"
+#include "../../Core/VoxelCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+uint32_t g_numThreads = 0;
+uint32_t g_levelCount = 6;
+uint32_t g_resolution = 128;
+float g_level0Extent = 0.0f;
+bool g_verify = false;
+
+// Model::Header and Model::Mesh as ModelH3D.cpp reads them, and the size of a Model::Material; the bounding boxes
+// are pairs of 16 byte aligned Math::Vector3.
+struct alignas(16) H3DVector
+{
+    float x, y, z, w;
+};
+
+struct H3DHeader
+{
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint32_t vertexDataByteSize;
+    uint32_t indexDataByteSize;
+    uint32_t vertexDataByteSizeDepth;
+    H3DVector boundsMin;
+    H3DVector boundsMax;
+};
+
+struct H3DAttrib
+{
+    uint16_t offset;
+    uint16_t normalized;
+    uint16_t components;
+    uint16_t format;
+};
+
+struct H3DMesh
+{
+    H3DVector boundsMin;
+    H3DVector boundsMax;
+    uint32_t materialIndex;
+    uint32_t attribsEnabled;
+    uint32_t attribsEnabledDepth;
+    uint32_t vertexStride;
+    uint32_t vertexStrideDepth;
+    H3DAttrib attrib[16];
+    H3DAttrib attribDepth[16];
+    uint32_t vertexDataByteOffset;
+    uint32_t vertexCount;
+    uint32_t indexDataByteOffset;
+    uint32_t indexCount;
+    uint32_t vertexDataByteOffsetDepth;
+    uint32_t vertexCountDepth;
+};
+
+const size_t kH3DMaterialSize = 992;
+
+static_assert(sizeof(H3DHeader) == 64, "H3DHeader does not match Model::Header");
+static_assert(sizeof(H3DMesh) == 336, "H3DMesh does not match Model::Mesh");
+
+struct Geometry
+{
+    vector<float> positions;
+    vector<uint32_t> indices;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+void ReadBytes( FILE* file, void* data, size_t size, const string& filename )
+{
+    if (size > 0 && fread(data, size, 1, file) != 1)
+        throw runtime_error("Unable to read " + filename);
+}
+
+// Appends the triangles of every mesh of the model, with the vertex positions of the full vertex format.
+void LoadH3D( const string& filename, Geometry& geometry )
+{
+    FILE* file = nullptr;
+    if (fopen_s(&file, filename.c_str(), "rb") != 0)
+        throw runtime_error("Unable to open " + filename);
+
+    try
+    {
+        H3DHeader header;
+        ReadBytes(file, &header, sizeof(header), filename);
+        vector<H3DMesh> meshes(header.meshCount);
+        ReadBytes(file, meshes.data(), meshes.size() * sizeof(H3DMesh), filename);
+        _fseeki64(file, int64_t(header.materialCount) * kH3DMaterialSize, SEEK_CUR);
+        vector<uint8_t> vertexData(header.vertexDataByteSize);
+        vector<uint8_t> indexData(header.indexDataByteSize);
+        ReadBytes(file, vertexData.data(), vertexData.size(), filename);
+        ReadBytes(file, indexData.data(), indexData.size(), filename);
+        fclose(file);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            geometry.boundsMin[c] = min(geometry.boundsMin[c], (&header.boundsMin.x)[c]);
+            geometry.boundsMax[c] = max(geometry.boundsMax[c], (&header.boundsMax.x)[c]);
+        }
+
+        for (const H3DMesh& mesh : meshes)
+        {
+            if (mesh.attrib[0].components != 3 || uint64_t(mesh.vertexDataByteOffset) + uint64_t(mesh.vertexCount) * mesh.vertexStride > vertexData.size() ||
+                uint64_t(mesh.indexDataByteOffset) + mesh.indexCount * sizeof(uint16_t) > indexData.size())
+                throw runtime_error("Malformed mesh in " + filename);
+
+            const uint32_t baseVertex = static_cast<uint32_t>(geometry.positions.size() / 3);
+            const uint8_t* positions = vertexData.data() + mesh.vertexDataByteOffset + mesh.attrib[0].offset;
+            for (uint32_t vertex = 0; vertex < mesh.vertexCount; ++vertex)
+            {
+                float position[3];
+                memcpy(position, positions + size_t(vertex) * mesh.vertexStride, sizeof(position));
+                geometry.positions.insert(geometry.positions.end(), position, position + 3);
+            }
+
+            const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData.data() + mesh.indexDataByteOffset);
+            for (uint32_t i = 0; i < mesh.indexCount / 3 * 3; ++i)
+            {
+                if (indices[i] >= mesh.vertexCount)
+                    throw runtime_error("Malformed mesh in " + filename);
+                geometry.indices.push_back(baseVertex + indices[i]);
+            }
+        }
+    }
+    catch (...)
+    {
+        if (file != nullptr)
+            fclose(file);
+        throw;
+    }
+}
+
+void SplitList( const char* list, vector<string>& items )
+{
+    for (const char* item = list; *item != '\0'; )
+    {
+        const char* end = strchr(item, ',');
+        if (end == nullptr)
+            end = item + strlen(item);
+        if (end == item)
+            throw runtime_error("Malformed model list");
+        items.emplace_back(item, end);
+        item = *end == ',' ? end + 1 : end;
+    }
+}
+
+uint64_t CountDifferences( const VoxelBrickSet& a, const VoxelBrickSet& b )
+{
+    VoxelBrickSet difference = a;
+    for (const auto& entry : b)
+    {
+        auto found = difference.find(entry.first);
+        if (found == difference.end())
+        {
+            difference.emplace(entry.first, entry.second);
+            continue;
+        }
+        for (uint32_t i = 0; i < kVoxelBrickWords; ++i)
+            found->second.bits[i] ^= entry.second.bits[i];
+    }
+    return CpuVoxelizer::CountVoxels(difference);
+}
+
+// The bricks of a level of a loaded cache, to compare against.
+void GetLevelBricks( const VoxelCache& cache, uint32_t level, VoxelBrickSet& bricks )
+{
+    const VoxelCacheLevel& info = cache.GetLevel(level);
+    for (uint32_t i = info.firstBrick; i < info.firstBrick + info.brickCount; ++i)
+    {
+        const VoxelCacheBrick& brick = cache.GetBrick(i);
+        bricks.emplace(PackVoxelBrick(brick.x, brick.y, brick.z), brick);
+    }
+}
+
+double Milliseconds( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main( int argc, const char** argv )
+{
+    vector<string> modelFiles;
+    string outputFile = "voxels.vxc";
+    string compareFile = "";
+
+    try
+    {
+        if (argc < 2)
+            throw runtime_error("No models specified");
+        SplitList(argv[1], modelFiles);
+
+        for (int arg = 2; arg < argc; ++arg)
+        {
+            if (argv[arg][0] != '-')
+                throw runtime_error("Malformed option");
+
+            if (strcmp("-verify", argv[arg]) == 0)
+                g_verify = true;
+            else if (arg + 1 == argc)
+                throw runtime_error("Missing operand");
+            else if (strcmp("-output", argv[arg]) == 0)
+                outputFile = argv[++arg];
+            else if (strcmp("-extent", argv[arg]) == 0)
+                g_level0Extent = (float)atof(argv[++arg]);
+            else if (strcmp("-levels", argv[arg]) == 0)
+                g_levelCount = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-resolution", argv[arg]) == 0)
+                g_resolution = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-threads", argv[arg]) == 0)
+                g_numThreads = (uint32_t)atoi(argv[++arg]);
+            else if (strcmp("-compare", argv[arg]) == 0)
+                compareFile = argv[++arg];
+            else
+                throw runtime_error("Invalid option");
+        }
+        if (g_levelCount == 0 || g_levelCount > 16)
+            throw runtime_error("Invalid level count");
+        if (g_resolution < kVoxelBrickSize || (g_resolution & (g_resolution - 1)) != 0)
+            throw runtime_error("The resolution must be a power of two of at least 8");
+        if (g_level0Extent < 0.0f)
+            throw runtime_error("Invalid extent");
+    }
+    catch (exception& e)
+    {
+        printf(
+            "Error: %s\n\n"
+            "Usage:  %s <model.h3d>[,<model.h3d>]* [options]*\n\n"
+            "Options:\n\n"
+            "-output <filename>\n\tThe voxel cache to write.\n\tDefaults to voxels.vxc.\n"
+            "-extent <float>\n\tWorld extent of clipmap level 0; must match the extent VCT runs with, which it prints when\n\tthe cache does not match.\n\tDefaults to the models' largest dimension over 2^(levels - 1), as VCT computes it for these models alone.\n"
+            "-levels <integer>\n\tClipmap levels.\n\tDefaults to 6.\n"
+            "-resolution <integer>\n\tVoxels along each axis of a clipmap level.\n\tDefaults to 128.\n"
+            "-threads <integer>\n\tWorker threads.\n\tDefaults to the number of hardware threads.\n"
+            "-verify\n\tVoxelize level 0 again with the scalar reference test and report the voxels that differ.\n"
+            "-compare <filename>\n\tReport the voxels that differ from another voxel cache, per level.\n"
+            "\n\nExample:  %s Models/sponza.h3d -extent 117.5 -output Models/voxels.vxc\n\n", e.what(), argv[0], argv[0]);
+        return 1;
+    }
+
+    if (g_numThreads == 0)
+        g_numThreads = max(thread::hardware_concurrency(), 1u);
+
+    try
+    {
+        Geometry geometry;
+        for (int c = 0; c < 3; ++c)
+        {
+            geometry.boundsMin[c] = numeric_limits<float>::max();
+            geometry.boundsMax[c] = -numeric_limits<float>::max();
+        }
+        for (const string& modelFile : modelFiles)
+            LoadH3D(modelFile, geometry);
+
+        if (g_level0Extent == 0.0f)
+        {
+            float maxDimension = 0.0f;
+            for (int c = 0; c < 3; ++c)
+                maxDimension = max(maxDimension, geometry.boundsMax[c] - geometry.boundsMin[c]);
+            g_level0Extent = maxDimension / exp2f(float(g_levelCount - 1));
+        }
+
+        printf("%u models, %u triangles, level 0 extent %g over %u voxels, %u levels, %u threads\n", (uint32_t)modelFiles.size(),
+            (uint32_t)(geometry.indices.size() / 3), g_level0Extent, g_resolution, g_levelCount, g_numThreads);
+
+        // Level 0 from the triangles, then each level from the one below.
+        vector<VoxelBrickSet> levels(g_levelCount);
+        auto start = chrono::steady_clock::now();
+        const float voxelSize0 = g_level0Extent / g_resolution;
+        CpuVoxelizer::Voxelize(geometry.positions, geometry.indices, voxelSize0, g_numThreads, true, levels[0]);
+        printf("Voxelized level 0 in %.1f ms\n", Milliseconds(start));
+        start = chrono::steady_clock::now();
+        for (uint32_t level = 1; level < g_levelCount; ++level)
+            CpuVoxelizer::Downsample(levels[level - 1], levels[level]);
+        printf("Downsampled %u levels in %.1f ms\n", g_levelCount - 1, Milliseconds(start));
+
+        if (g_verify)
+        {
+            start = chrono::steady_clock::now();
+            VoxelBrickSet reference;
+            CpuVoxelizer::Voxelize(geometry.positions, geometry.indices, voxelSize0, g_numThreads, false, reference);
+            const uint64_t differences = CountDifferences(levels[0], reference);
+            printf("Scalar reference in %.1f ms: %llu of %llu voxels differ\n", Milliseconds(start),
+                (unsigned long long)differences, (unsigned long long)CpuVoxelizer::CountVoxels(reference));
+        }
+
+        VoxelCacheHeader header = {};
+        header.resolution = g_resolution;
+        header.level0Extent = g_level0Extent;
+        vector<VoxelCacheLevel> levelInfos(g_levelCount);
+        vector<VoxelCacheBrick> bricks;
+        printf("\n%-6s %10s %10s %12s\n", "Level", "Voxel", "Bricks", "Voxels");
+        for (uint32_t level = 0; level < g_levelCount; ++level)
+        {
+            levelInfos[level].voxelSize = voxelSize0 * exp2f(float(level));
+            levelInfos[level].firstBrick = static_cast<uint32_t>(bricks.size());
+            levelInfos[level].brickCount = static_cast<uint32_t>(levels[level].size());
+            levelInfos[level].reserved = 0;
+            CpuVoxelizer::AppendSorted(levels[level], bricks);
+            printf("%-6u %10g %10u %12llu\n", level, levelInfos[level].voxelSize, levelInfos[level].brickCount,
+                (unsigned long long)CpuVoxelizer::CountVoxels(levels[level]));
+        }
+
+        if (!VoxelCache::Save(wstring(outputFile.begin(), outputFile.end()), header, modelFiles, levelInfos, bricks))
+            throw runtime_error("Unable to write " + outputFile);
+        printf("\nWrote %s: %.1f MB\n", outputFile.c_str(), (sizeof(VoxelCacheHeader) + modelFiles.size() * kVoxelCacheNameLength +
+            levelInfos.size() * sizeof(VoxelCacheLevel) + bricks.size() * sizeof(VoxelCacheBrick)) / (1024.0 * 1024.0));
+
+        if (compareFile.length() > 0)
+        {
+            VoxelCache other;
+            if (!other.Load(wstring(compareFile.begin(), compareFile.end())))
+                throw runtime_error("Unable to read " + compareFile);
+            if (other.GetHeader().resolution != g_resolution || other.GetHeader().level0Extent != g_level0Extent)
+                printf("%s was baked with level 0 extent %g over %u voxels\n", compareFile.c_str(), other.GetHeader().level0Extent, other.GetHeader().resolution);
+            printf("\n%-6s %12s %12s %12s\n", "Level", "Voxels", "Other", "Differ");
+            for (uint32_t level = 0; level < min(g_levelCount, other.GetHeader().levelCount); ++level)
+            {
+                VoxelBrickSet otherBricks;
+                GetLevelBricks(other, level, otherBricks);
+                printf("%-6u %12llu %12llu %12llu\n", level, (unsigned long long)CpuVoxelizer::CountVoxels(levels[level]),
+                    (unsigned long long)CpuVoxelizer::CountVoxels(otherBricks), (unsigned long long)CountDifferences(levels[level], otherBricks));
+            }
+        }
+    }
+    catch (exception& e)
+    {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "ConeTracingPass.hpp"
+#include "ConeTraceUpsample.h"
+#include "BufferManager.h"
+#include "TemporalEffects.h"
+#include "CompiledShaders/ConeTraceCS.h"
+#include "CompiledShaders/ConeTraceResolveCS.h"
+
+using namespace Graphics;
+
+namespace ConeTracingPass
+{
+    BoolVar Enable("Voxel/Cone Tracing/Enable", false);
+    const char* ResolutionLabels[] = { "Full", "Half", "Quarter" };
+    // Each step traces one pixel in 1, 4 or 16.
+    EnumVar TraceResolution("Voxel/Cone Tracing/Resolution", 1, _countof(ResolutionLabels), ResolutionLabels);
+    // In voxels of the finest level.
+    NumVar MaxDistance("Voxel/Cone Tracing/Max Distance", 32.0f, 4.0f, 256.0f, 4.0f);
+    NumVar Strength("Voxel/Cone Tracing/Strength", 1.0f, 0.0f, 2.0f, 0.05f);
+    // The weight of the new frame in the history; 1 keeps no history.
+    NumVar TemporalWeight("Voxel/Cone Tracing/Temporal Weight", 0.25f, 0.05f, 1.0f, 0.05f);
+    // Relative linear depth difference past which a sample, or the history, is rejected.
+    NumVar DepthTolerance("Voxel/Cone Tracing/Depth Tolerance", 0.05f, 0.005f, 1.0f, 0.005f);
+    NumVar NormalPower("Voxel/Cone Tracing/Normal Power", 8.0f, 0.0f, 64.0f, 1.0f);
+
+    // tan(30 degrees), the half angle of the six cones.
+    const float kConeAperture = 0.577350f;
+
+    RootSignature s_RootSignature;
+    ComputePSO s_TraceCS;
+    ComputePSO s_ResolveCS;
+
+    // Visibility, linear depth and the encoded normal of the pixel each texel traced.
+    ColorBuffer s_Traced;
+    // Ping-ponged so the resolve reads last frame's.
+    ColorBuffer s_Visibility[2] = { ColorBuffer(Color(1.0f, 1.0f, 1.0f, 1.0f)), ColorBuffer(Color(1.0f, 1.0f, 1.0f, 1.0f)) };
+    uint32_t s_Current = 0;
+    uint32_t s_Scale = 0;
+    bool s_HistoryValid = false;
+
+    void Initialize(void)
+    {
+        static_assert(CLIP_REGION_COUNT == 6, "CONE_TRACE_LEVELS in ConeTracing.hlsli has to match");
+
+        s_RootSignature.Reset(4, 1);
+        s_RootSignature[0].InitAsConstantBuffer(0);
+        s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 8);
+        s_RootSignature[2].InitAsBufferSRV(8);
+        s_RootSignature[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+        s_RootSignature.InitStaticSampler(0, SamplerLinearClampDesc);
+        s_RootSignature.Finalize(L"Cone Tracing");
+        s_TraceCS.SetRootSignature(s_RootSignature);
+        s_TraceCS.SetComputeShader(SHADER_ARGS(g_pConeTraceCS));
+        s_TraceCS.Finalize();
+        s_ResolveCS.SetRootSignature(s_RootSignature);
+        s_ResolveCS.SetComputeShader(SHADER_ARGS(g_pConeTraceResolveCS));
+        s_ResolveCS.Finalize();
+    }
+
+    // (Re)creates the buffers when the screen or the trace resolution changed.
+    void createBuffers(uint32_t width, uint32_t height, uint32_t scale)
+    {
+        if (s_Visibility[0].GetWidth() == width && s_Visibility[0].GetHeight() == height && s_Scale == scale)
+            return;
+
+        // The old buffers may still be in flight.
+        if (s_Scale != 0)
+            g_CommandManager.IdleGPU();
+        s_Traced.Create(L"Cone Trace Samples", Math::DivideByMultiple(width, scale), Math::DivideByMultiple(height, scale), 1,
+            DXGI_FORMAT_R16G16B16A16_FLOAT);
+        s_Visibility[0].Create(L"Cone Trace Visibility 0", width, height, 1, DXGI_FORMAT_R16_FLOAT);
+        s_Visibility[1].Create(L"Cone Trace Visibility 1", width, height, 1, DXGI_FORMAT_R16_FLOAT);
+        s_Scale = scale;
+        s_HistoryValid = false;
+    }
+
+    void Render(GraphicsContext& context, const Math::Camera& camera, Voxel::Voxelization& voxelization)
+    {
+        ScopedTimer _prof(L"Cone Tracing", context);
+        ComputeContext& computeContext = context.GetComputeContext();
+
+        const uint32_t width = g_SceneColorBuffer.GetWidth();
+        const uint32_t height = g_SceneColorBuffer.GetHeight();
+        createBuffers(width, height, 1u << uint32_t(int32_t(TraceResolution)));
+
+        s_Current ^= 1;
+        ColorBuffer& visibility = s_Visibility[s_Current];
+        if (!Enable)
+        {
+            computeContext.TransitionResource(visibility, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+            computeContext.ClearUAV(visibility);
+            computeContext.TransitionResource(visibility, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            s_HistoryValid = false;
+            return;
+        }
+
+        const std::vector<Voxel::VoxelRegion>& clipRegions = voxelization.GetClieRegions();
+        ConeTraceConstants cbv;
+        cbv.u_projectionToWorld = Invert(camera.GetViewProjMatrix());
+        for (uint32_t level = 0; level < CLIP_REGION_COUNT; ++level)
+        {
+            const Voxel::VoxelRegion& region = clipRegions[level];
+            cbv.u_levelMin[level] = glm::vec4(region.getMinPosWorld(), region.voxelSize);
+            cbv.u_levelMax[level] = glm::vec4(region.getMaxPosWorld(), 0.0f);
+        }
+        cbv.u_tracedSize = glm::uvec2(s_Traced.GetWidth(), s_Traced.GetHeight());
+        cbv.u_screenSize = glm::uvec2(width, height);
+        // The block offset keeps its own Bayer walk rather than following TemporalEffects::GetJitterOffset.  That is the
+        // subpixel shift of the viewport, already in the depths and normals traced; it has 8 phases where a quarter
+        // resolution block has 16 pixels, and it stays at 0.5 with TAA off.  Both step with the frame count.
+        int32_t jitter[2];
+        ConeTraceUpsample::GetTraceJitter(GetFrameCount(), s_Scale, jitter);
+        cbv.u_jitter = glm::ivec2(jitter[0], jitter[1]);
+        cbv.u_scale = s_Scale;
+        cbv.u_resolution = VOXEL_RESOLUTION;
+        cbv.u_maxDistance = MaxDistance * clipRegions[0].voxelSize;
+        cbv.u_aperture = kConeAperture;
+        cbv.u_strength = Strength;
+        cbv.u_depthTolerance = DepthTolerance;
+        cbv.u_normalPower = NormalPower;
+        cbv.u_currentWeight = s_HistoryValid ? float(TemporalWeight) : 1.0f;
+
+        const uint32_t frameIndex = TemporalEffects::GetFrameIndexMod2();
+        ColorBuffer& linearDepth = g_LinearDepth[frameIndex];
+        ColorBuffer& prevLinearDepth = g_LinearDepth[frameIndex ^ 1];
+        ColorBuffer& history = s_Visibility[s_Current ^ 1];
+        computeContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(g_GBufferNormalBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(linearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(prevLinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(g_VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(voxelization.VoxelOpacity(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(history, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(s_Traced, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        // The trace writes the texels the resolve reads; the history stands in for them in the table meanwhile.
+        D3D12_CPU_DESCRIPTOR_HANDLE srvs[] = { g_SceneDepthBuffer.GetDepthSRV(), g_GBufferNormalBuffer.GetSRV(), linearDepth.GetSRV(),
+            prevLinearDepth.GetSRV(), g_VelocityBuffer.GetSRV(), history.GetSRV(), history.GetSRV(), voxelization.VoxelOpacitySRV() };
+        computeContext.SetRootSignature(s_RootSignature);
+        computeContext.SetDynamicConstantBufferView(0, sizeof(cbv), &cbv);
+        computeContext.SetBufferSRV(2, voxelization.BrickIndirection());
+        {
+            ScopedTimer _prof1(L"Trace", computeContext);
+            computeContext.SetPipelineState(s_TraceCS);
+            computeContext.SetDynamicDescriptors(1, 0, _countof(srvs), srvs);
+            computeContext.SetDynamicDescriptor(3, 0, s_Traced.GetUAV());
+            computeContext.Dispatch2D(cbv.u_tracedSize.x, cbv.u_tracedSize.y);
+        }
+        {
+            ScopedTimer _prof2(L"Resolve", computeContext);
+            computeContext.TransitionResource(s_Traced, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            computeContext.TransitionResource(visibility, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+            srvs[5] = s_Traced.GetSRV();
+            computeContext.SetPipelineState(s_ResolveCS);
+            computeContext.SetDynamicDescriptors(1, 0, _countof(srvs), srvs);
+            computeContext.SetDynamicDescriptor(3, 0, visibility.GetUAV());
+            computeContext.Dispatch2D(width, height);
+        }
+        computeContext.TransitionResource(visibility, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        s_HistoryValid = true;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetVisibilitySRV(void)
+    {
+        return s_Visibility[s_Current].GetSRV();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "GameCore.h"
+#include "GraphicsCore.h"
+#include "CommandContext.h"
+#include "ColorBuffer.h"
+#include "Camera.h"
+#include "Voxelization.hpp"
+
+using namespace Math;
+using namespace GameCore;
+
+namespace ConeTracingPass
+{
+    // Mirrors ConeTraceConstants in ConeTracing.hlsli.
+    __declspec(align(16)) struct ConeTraceConstants
+    {
+        Matrix4 u_projectionToWorld;
+        glm::vec4 u_levelMin[CLIP_REGION_COUNT];
+        glm::vec4 u_levelMax[CLIP_REGION_COUNT];
+        glm::uvec2 u_tracedSize;
+        glm::uvec2 u_screenSize;
+        glm::ivec2 u_jitter;
+        uint32_t u_scale;
+        int u_resolution;
+        float u_maxDistance;
+        float u_aperture;
+        float u_strength;
+        float u_depthTolerance;
+        float u_normalPower;
+        float u_currentWeight;
+    };
+
+    void Initialize(void);
+
+    // Traces the voxel occlusion of one pixel per block of the chosen resolution, a different one each frame, then
+    // upsamples it to every pixel along the depths and normals and blends it into the reprojected history.  Needs
+    // the GBuffer, this frame's linear depth and the camera velocity.  Traces nothing when disabled, leaving the
+    // visibility at 1.
+    void Render(GraphicsContext& context, const Math::Camera& camera, Voxel::Voxelization& voxelization);
+
+    // The full resolution visibility of the last Render, ready for the pixel shader.
+    D3D12_CPU_DESCRIPTOR_HANDLE GetVisibilitySRV(void);
+}
@@ -0,0 +1,52 @@
+#include "ClearClipMap.hlsli"
+
+// Where the baked voxels of a region are: the bricks the region touches, in world brick coordinates, each with an
+// entry that is INVALID_BRICK or the brick's index into the masks.  Mirrors VoxelClear::BakedRegion.
+struct BakedRegion
+{
+    int3 voxelMin;
+    uint firstEntry;
+    int3 brickMin;
+    uint pad0;
+    int3 brickDims;
+    uint pad1;
+};
+
+// Mirrors the bricks of Core/VoxelCache.h: 512 bits per brick, bit (z * 8 + y) * 8 + x for voxel (x, y, z).
+#define BAKED_BRICK_WORDS 16
+
+RWTexture3D<float4> voxel_opacity : register(u0);
+StructuredBuffer<BakedRegion> u_bakedRegions : register(t3);
+StructuredBuffer<uint> u_bakedEntries : register(t4);
+StructuredBuffer<uint> u_bakedMasks : register(t5);
+
+// Splats the baked static voxels into the cleared regions.
+[numthreads(64, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    uint r;
+    int3 offset;
+    if (!getRegionVoxel(DTid, r, offset)) return;
+
+    BakedRegion baked = u_bakedRegions[r];
+    int3 voxel = baked.voxelMin + offset;
+    // Arithmetic shifts round towards negative infinity, as the baker does.
+    int3 brick = (voxel >> 3) - baked.brickMin;
+    uint entry = u_bakedEntries[baked.firstEntry + (brick.z * baked.brickDims.y + brick.y) * baked.brickDims.x + brick.x];
+    if (entry == INVALID_BRICK) return;
+
+    int3 local = voxel & (BRICK_SIZE - 1);
+    uint bit = (local.z * BRICK_SIZE + local.y) * BRICK_SIZE + local.x;
+    if ((u_bakedMasks[entry * BAKED_BRICK_WORDS + bit / 32] & (1u << (bit % 32))) == 0) return;
+
+    int3 pos;
+    if (!getVoxelTexel(r, offset, pos)) return;
+
+    // Opaque on every face, as the conservative voxelization pass writes them.
+    const float4 fillColor = (1.0).xxxx;
+    for (int face = 0; face < 6; ++face)
+    {
+        voxel_opacity[pos] = fillColor;
+        pos.x += BRICK_FACE_STRIDE;
+    }
+}
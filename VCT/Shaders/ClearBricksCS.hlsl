@@ -0,0 +1,33 @@
+#include "VoxelBricks.hlsli"
+
+cbuffer CB1 : register(b0)
+{
+    uint u_brickCount;
+}
+
+StructuredBuffer<uint> u_newBricks : register(t0);
+
+RWTexture3D<float4> voxel_opacity : register(u0);
+RWTexture3D<float4> voxel_radiance : register(u1);
+RWTexture3D<float4> static_opacity : register(u2);
+
+// Clears the slots handed out this frame; a group row per brick, 512 voxels in 8 groups.
+[numthreads(64, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (DTid.y >= u_brickCount) return;
+
+    uint slot = u_newBricks[DTid.y];
+    int3 slotCoords = int3(slot % BRICK_ATLAS_BRICKS, (slot / BRICK_ATLAS_BRICKS) % BRICK_ATLAS_BRICKS, slot / (BRICK_ATLAS_BRICKS * BRICK_ATLAS_BRICKS));
+    int3 offset = int3(DTid.x % BRICK_SIZE, (DTid.x / BRICK_SIZE) % BRICK_SIZE, DTid.x / (BRICK_SIZE * BRICK_SIZE));
+    int3 pos = slotCoords * BRICK_SIZE + offset;
+
+    const float4 clearColor = (0.0).xxxx;
+    for (int face = 0; face < 6; ++face)
+    {
+        voxel_opacity[pos] = clearColor;
+        voxel_radiance[pos] = clearColor;
+        static_opacity[pos] = clearColor;
+        pos.x += BRICK_FACE_STRIDE;
+    }
+}
@@ -0,0 +1,69 @@
+#include "VoxelBricks.hlsli"
+
+struct ClearRegion
+{
+    int3 imageMin;
+    int clipmapLevel;
+    int3 extent;
+    uint firstVoxel;
+};
+
+cbuffer CB1 : register(b0)
+{
+    uint u_regionCount;
+    uint u_voxelCount;
+    int u_resolution;
+}
+
+StructuredBuffer<ClearRegion> u_regions : register(t0);
+StructuredBuffer<uint> u_brickIndirection : register(t2);
+
+// A row of the dispatch is 1024 groups.
+#define ROW_THREADS (64 * 1024)
+
+// Finds the region of the thread's voxel and the voxel's offset inside it; false past the last region.
+bool getRegionVoxel(uint3 DTid, out uint r, out int3 offset)
+{
+    r = 0;
+    offset = int3(0, 0, 0);
+
+    uint voxel = DTid.y * ROW_THREADS + DTid.x;
+    if (voxel >= u_voxelCount) return false;
+
+    // The last region starting at or before the voxel.  A dispatch holds the slabs of every moved clipmap level and the
+    // regions the dynamic models cover, so the list is walked whole.  Mirrors ClipmapClear::FindRegion.
+    for (uint i = 1; i < u_regionCount; ++i)
+    {
+        if (u_regions[i].firstVoxel <= voxel)
+            r = i;
+    }
+    ClearRegion region = u_regions[r];
+
+    int local = int(voxel - region.firstVoxel);
+    offset = int3(local % region.extent.x, (local / region.extent.x) % region.extent.y, local / (region.extent.x * region.extent.y));
+    return true;
+}
+
+// Finds the atlas texel of the first face for a voxel of a region; false for voxels of bricks without a slot, which
+// hold nothing to clear.
+bool getVoxelTexel(uint r, int3 offset, out int3 pos)
+{
+    ClearRegion region = u_regions[r];
+    // Mirrors ClipmapClear::GetImageCoords.
+    int3 imageCoords = (region.imageMin + offset) & (u_resolution - 1);
+
+    return getBrickTexel(u_brickIndirection, imageCoords, region.clipmapLevel, u_resolution, pos);
+}
+
+// Finds the atlas texel of the first face for the thread's voxel; false past the last region and for voxels of
+// bricks without a slot.
+bool getRegionTexel(uint3 DTid, out int3 pos)
+{
+    pos = int3(0, 0, 0);
+
+    uint r;
+    int3 offset;
+    if (!getRegionVoxel(DTid, r, offset)) return false;
+
+    return getVoxelTexel(r, offset, pos);
+}
@@ -0,0 +1,129 @@
+#include "ConeTracing.hlsli"
+#include "VoxelBricks.hlsli"
+
+Texture2D<float> u_depth : register(t0);
+Texture2D<float4> u_normal : register(t1);
+Texture2D<float> u_linearDepth : register(t2);
+Texture3D<float4> u_opacity : register(t7);
+StructuredBuffer<uint> u_brickIndirection : register(t8);
+
+RWTexture2D<float4> u_traced : register(u0);
+
+// Six cones over the hemisphere: one along the normal and five around it 60 degrees off, weighted by the solid
+// angle they cover.
+#define CONE_COUNT 6
+static const float3 kConeDirections[CONE_COUNT] =
+{
+    float3(0.0, 0.0, 1.0),
+    float3(0.0, 0.866025, 0.5),
+    float3(0.823639, 0.267617, 0.5),
+    float3(0.509037, -0.700629, 0.5),
+    float3(-0.509037, -0.700629, 0.5),
+    float3(-0.823639, 0.267617, 0.5)
+};
+static const float kConeWeights[CONE_COUNT] = { 0.25, 0.15, 0.15, 0.15, 0.15, 0.15 };
+
+float3 reconstructWorld(uint2 pixel, float depth)
+{
+    float2 uv = (pixel + 0.5) / float2(u_screenSize) * 2.0 - 1.0;
+    uv.y = -uv.y;
+    float4 posW = mul(u_projectionToWorld, float4(uv, depth, 1.0));
+    return posW.xyz / posW.w;
+}
+
+// A voxel of a level, in world voxel coordinates; 0 when its brick has no slot.
+float loadOpacity(int3 voxel, int level)
+{
+    int3 texel;
+    if (!getBrickTexel(u_brickIndirection, voxel & (u_resolution - 1), level, u_resolution, texel))
+        return 0.0;
+    return u_opacity[texel].a;
+}
+
+// Trilinear between the voxel centers; the atlas is sparse and wraps toroidally, so the sampler cannot do it.
+float sampleOpacity(float3 posW, int level)
+{
+    float3 p = posW / u_levelMin[level].w - 0.5;
+    int3 base = int3(floor(p));
+    float3 f = p - base;
+    float4 x0 = float4(loadOpacity(base + int3(0, 0, 0), level), loadOpacity(base + int3(0, 1, 0), level),
+        loadOpacity(base + int3(0, 0, 1), level), loadOpacity(base + int3(0, 1, 1), level));
+    float4 x1 = float4(loadOpacity(base + int3(1, 0, 0), level), loadOpacity(base + int3(1, 1, 0), level),
+        loadOpacity(base + int3(1, 0, 1), level), loadOpacity(base + int3(1, 1, 1), level));
+    float4 x = lerp(x0, x1, f.x);
+    float2 y = lerp(x.xz, x.yw, f.y);
+    return lerp(y.x, y.y, f.z);
+}
+
+// The first level from the given one whose region holds the point with a voxel to spare for the trilinear taps,
+// CONE_TRACE_LEVELS when none does.
+int findLevel(float3 posW, int level)
+{
+    [loop]
+    for (; level < CONE_TRACE_LEVELS; ++level)
+    {
+        float margin = u_levelMin[level].w;
+        if (all(posW > u_levelMin[level].xyz + margin) && all(posW < u_levelMax[level].xyz - margin))
+            break;
+    }
+    return level;
+}
+
+// The occlusion along a cone, composited front to back.  The sample of each step is read from the level whose
+// voxels match the cone's diameter there.
+float traceCone(float3 origin, float3 direction)
+{
+    float voxelSize0 = u_levelMin[0].w;
+    float t = voxelSize0;
+    float occlusion = 0.0;
+    [loop]
+    while (t < u_maxDistance && occlusion < 0.99)
+    {
+        float diameter = max(voxelSize0, 2.0 * u_aperture * t);
+        float3 posW = origin + direction * t;
+        int level = findLevel(posW, clamp(int(ceil(log2(diameter / voxelSize0))), 0, CONE_TRACE_LEVELS - 1));
+        if (level >= CONE_TRACE_LEVELS)
+            break;
+
+        // The opacity is per voxel of the level; correct it for the length of the step.
+        float step = diameter * 0.5;
+        float alpha = 1.0 - pow(saturate(1.0 - sampleOpacity(posW, level)), step / u_levelMin[level].w);
+        occlusion += (1.0 - occlusion) * alpha;
+        t += step;
+    }
+    return occlusion;
+}
+
+float traceVisibility(float3 posW, float3 normal)
+{
+    float3 up = abs(normal.y) < 0.999 ? float3(0.0, 1.0, 0.0) : float3(1.0, 0.0, 0.0);
+    float3 tangent = normalize(cross(up, normal));
+    float3 bitangent = cross(normal, tangent);
+
+    // Start off the surface's own voxels.
+    float3 origin = posW + normal * u_levelMin[0].w * 1.5;
+    float occlusion = 0.0;
+    [unroll]
+    for (int i = 0; i < CONE_COUNT; ++i)
+    {
+        float3 direction = kConeDirections[i].x * tangent + kConeDirections[i].y * bitangent + kConeDirections[i].z * normal;
+        occlusion += kConeWeights[i] * traceCone(origin, direction);
+    }
+    return saturate(1.0 - u_strength * occlusion);
+}
+
+// Traces one pixel of every u_scale x u_scale block, the one u_jitter picks this frame.
+[numthreads(8, 8, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= u_tracedSize)) return;
+
+    uint2 pixel = min(DTid.xy * u_scale + uint2(u_jitter), u_screenSize - 1);
+    float depth = u_depth[pixel];
+    float2 encodedNormal = u_normal[pixel].xy;
+    float visibility = 1.0;
+    // Depth is reversed; the cleared far plane is sky.
+    if (depth > 0.0)
+        visibility = traceVisibility(reconstructWorld(pixel, depth), decodeNormal(encodedNormal));
+    u_traced[DTid.xy] = float4(visibility, u_linearDepth[pixel], encodedNormal);
+}
@@ -0,0 +1,39 @@
+#include "ConeTracing.hlsli"
+#include "../../Core/Shaders/PixelPacking_Velocity.hlsli"
+
+Texture2D<float4> u_normal : register(t1);
+Texture2D<float> u_linearDepth : register(t2);
+Texture2D<float> u_prevLinearDepth : register(t3);
+Texture2D<packed_velocity_t> u_velocity : register(t4);
+Texture2D<float4> u_traced : register(t5);
+Texture2D<float> u_history : register(t6);
+SamplerState s_linearClamp : register(s0);
+
+RWTexture2D<float> u_visibility : register(u0);
+
+// Upsamples the traced visibility to every pixel and blends it into last frame's, reprojected along the camera
+// velocity.  History is dropped where the reprojected depth does not match, as where the pixel was hidden.  Mirrors
+// ConeTraceUpsample::ResolveVisibility.
+[numthreads(8, 8, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= u_screenSize)) return;
+
+    int2 pixel = int2(DTid.xy);
+    float depth = u_linearDepth[pixel];
+    float current = upsampleVisibility(u_traced, pixel, depth, decodeNormal(u_normal[pixel].xy));
+
+    float3 velocity = UnpackVelocity(u_velocity[pixel]);
+    float2 prevPos = pixel + 0.5 + velocity.xy;
+    float weight = u_currentWeight;
+    if (any(prevPos < 0.0) || any(prevPos >= float2(u_screenSize)))
+        weight = 1.0;
+    else
+    {
+        float expectedDepth = depth + velocity.z;
+        if (abs(u_prevLinearDepth[uint2(prevPos)] - expectedDepth) > u_depthTolerance * expectedDepth)
+            weight = 1.0;
+    }
+    float history = u_history.SampleLevel(s_linearClamp, prevPos / float2(u_screenSize), 0);
+    u_visibility[pixel] = lerp(history, current, weight);
+}
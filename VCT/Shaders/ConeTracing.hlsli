@@ -0,0 +1,77 @@
+// Shared by the cone tracing passes.
+
+// Keep in sync with CLIP_REGION_COUNT.
+#define CONE_TRACE_LEVELS 6
+
+// Below this the taps of a pixel are all rejected; mirrors kUpsampleMinWeight in ConeTraceUpsample.h.
+#define UPSAMPLE_MIN_WEIGHT 1.0e-4
+
+// Mirrors ConeTracingPass::ConeTraceConstants.
+cbuffer ConeTraceConstants : register(b0)
+{
+    float4x4 u_projectionToWorld;
+    // Per clip level, the region's world bounds; w of the minimum is the voxel size.
+    float4 u_levelMin[CONE_TRACE_LEVELS];
+    float4 u_levelMax[CONE_TRACE_LEVELS];
+    uint2 u_tracedSize;
+    uint2 u_screenSize;
+    int2 u_jitter;
+    uint u_scale;
+    int u_resolution;
+    float u_maxDistance;
+    float u_aperture;
+    float u_strength;
+    float u_depthTolerance;
+    float u_normalPower;
+    // The weight of this frame against the history; 1 when there is no history.
+    float u_currentWeight;
+};
+
+// The GBuffer's normal encoding, see EncodeUnitVector_CryEngine in GBufferPS.hlsl.
+float3 decodeNormal(float2 g)
+{
+    if (abs(length(g)) < 0.0001f)
+        g = float2(0.000f, 0.001f);
+    float z = dot(g, g) * 2.0f - 1.0f;
+    float2 xy = normalize(g) * sqrt(1 - z * z);
+    return float3(xy, z);
+}
+
+// Mirrors ConeTraceUpsample::GetUpsampleWeight.
+float getUpsampleWeight(float bilinear, float sampleDepth, float3 sampleNormal, float pixelDepth, float3 pixelNormal)
+{
+    float depthWeight = saturate(1.0 - abs(sampleDepth - pixelDepth) / (u_depthTolerance * max(pixelDepth, 1.0e-6)));
+    float normalWeight = pow(saturate(dot(sampleNormal, pixelNormal)), u_normalPower);
+    return bilinear * depthWeight * normalWeight;
+}
+
+// Mirrors ConeTraceUpsample::UpsampleVisibility for one pixel.  The traced texels hold the visibility, the linear depth and the
+// encoded normal of the pixel they sampled.
+float upsampleVisibility(Texture2D<float4> traced, int2 pixel, float pixelDepth, float3 pixelNormal)
+{
+    // Texel t sampled pixel t * u_scale + u_jitter, so the pixel lies between the texels around this.
+    float2 pos = float2(pixel - u_jitter) / u_scale;
+    int2 base = int2(floor(pos));
+    float2 f = pos - base;
+
+    float sum = 0.0, weightSum = 0.0;
+    float closest = 1.0e30, fallback = 1.0;
+    [unroll]
+    for (int i = 0; i < 4; ++i)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        int2 texel = clamp(base + offset, int2(0, 0), int2(u_tracedSize) - 1);
+        float4 s = traced[texel];
+        float bilinear = (offset.x ? f.x : 1.0 - f.x) * (offset.y ? f.y : 1.0 - f.y);
+        float weight = getUpsampleWeight(bilinear, s.y, decodeNormal(s.zw), pixelDepth, pixelNormal);
+        sum += weight * s.x;
+        weightSum += weight;
+        float distance = abs(s.y - pixelDepth);
+        if (distance < closest)
+        {
+            closest = distance;
+            fallback = s.x;
+        }
+    }
+    return weightSum > UPSAMPLE_MIN_WEIGHT ? sum / weightSum : fallback;
+}
@@ -1,10 +1,12 @@
+#include "VoxelizationRegions.hlsli"
+
 struct GSOutput
 {
 	float4 position : SV_Position;
     float2 texCoord : TexCoord0;
     float3 normal : Normal;
     float3 posW : TexCoord1;
-    uint  vpindex  : SV_ViewportArrayIndex;
+    nointerpolation uint regionIndex : RegionIndex;
 };
 
 struct GSInput
@@ -13,13 +15,7 @@ struct GSInput
     float2 texCoord : TexCoord0;
     float3 normal : Normal;
     float3 posW : TexCoord1;
-};
-
-cbuffer regionInfo: register(b0)
-{
-    float4x4 u_viewProj[3];
-    float4x4 u_invViewProj[3];
-    float2 u_viewportSizes[3];
+    nointerpolation uint regionIndex : RegionIndex;
 };
 
 int getDominantAxisIdx(float3 v0, float3 v1, float3 v2)
@@ -40,15 +36,23 @@ void main(
 	inout TriangleStream< GSOutput > output
 )
 {
+    RegionInfo region = u_regions[input[0].regionIndex];
+
+    // The mesh overlaps the region, but most of its triangles may not.
+    float3 triMin = min(input[0].position.xyz, min(input[1].position.xyz, input[2].position.xyz));
+    float3 triMax = max(input[0].position.xyz, max(input[1].position.xyz, input[2].position.xyz));
+    if (any(triMin > region.cullMax) || any(triMax < region.cullMin))
+        return;
+
     int idx = getDominantAxisIdx(input[0].position.xyz, input[1].position.xyz, input[2].position.xyz);
     for (uint i = 0; i < 3; i++)
 	{
 		GSOutput element;
-        element.position = mul(u_viewProj[idx], float4(input[i].position.xyz,1.0f));
-        element.vpindex = idx;
+        element.position = mul(region.viewProj[idx], float4(input[i].position.xyz,1.0f));
         element.posW = input[i].position.xyz;
         element.texCoord = input[i].texCoord;
         element.normal = input[i].normal;
+        element.regionIndex = input[i].regionIndex;
 		output.Append(element);
 	}
-}
\ No newline at end of file
+}
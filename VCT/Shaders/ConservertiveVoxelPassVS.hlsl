@@ -1,4 +1,3 @@
-
 struct VSInput
 {
     float3 position : POSITION;
@@ -6,6 +5,7 @@ struct VSInput
     float3 normal : NORMAL;
     float3 tangent : TANGENT;
     float3 bitangent : BITANGENT;
+    uint instanceID : SV_InstanceID;
 };
 
 struct VSOutput
@@ -14,15 +14,27 @@ struct VSOutput
     float2 texCoord : TexCoord0;
     float3 normal : Normal;
     float3 posW : TexCoord1;
+    nointerpolation uint regionIndex : RegionIndex;
+};
+
+cbuffer drawInfo : register(b0)
+{
+    // The regions the mesh overlaps; instance i voxelizes the i-th set bit.
+    uint u_regionMask;
 };
 
 VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
 
+    uint mask = u_regionMask;
+    for (uint i = 0; i < vsInput.instanceID; ++i)
+        mask &= mask - 1;
+
     vsOutput.position = float4(vsInput.position, 1.0);
     vsOutput.texCoord = vsInput.texcoord0;
     vsOutput.normal = vsInput.normal;
     vsOutput.posW = vsInput.position.xyz;
+    vsOutput.regionIndex = firstbitlow(mask);
     return vsOutput;
 }
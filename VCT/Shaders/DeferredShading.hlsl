@@ -37,6 +37,8 @@ Texture2D<float4> ColorTex : register(t32);
 Texture2D<float4> NormalTex : register(t33);
 Texture2D<float2> MaterialTex:register(t34);
 Texture2D<float> DepthTex:register(t35);
+// The voxel cone traced visibility, see ConeTracingPass.
+Texture2D<float> ConeVisibilityTex:register(t36);
 
 
 
@@ -83,7 +85,7 @@ float3 main(float4 position : SV_Position) : SV_Target0
 	float3 diffuseAlbedo = ColorTex[pixelPos].xyz;
 	float depth = DepthTex[pixelPos];
 	{
-		 float ao = texSSAO[pixelPos];
+		 float ao = texSSAO[pixelPos] * ConeVisibilityTex[pixelPos];
 		 colorSum += ApplyAmbientLight(diffuseAlbedo, ao, AmbientColor);
 	}
 	float gloss = 128.0;
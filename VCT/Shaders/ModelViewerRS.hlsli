@@ -22,7 +22,7 @@
 	ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_WORLD, SHADER_VISIBILITY_PIXEL) ", " \
     "DescriptorTable(SRV(t0, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
     "DescriptorTable(SRV(t64, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
-	"DescriptorTable(SRV(t32, numDescriptors = 4), visibility = SHADER_VISIBILITY_PIXEL)," \
+	"DescriptorTable(SRV(t32, numDescriptors = 5), visibility = SHADER_VISIBILITY_PIXEL)," \
     "RootConstants(b1, num32BitConstants = 2, visibility = SHADER_VISIBILITY_VERTEX), " \
     "StaticSampler(s0, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s1, visibility = SHADER_VISIBILITY_PIXEL," \
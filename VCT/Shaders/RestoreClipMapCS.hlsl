@@ -0,0 +1,21 @@
+#include "ClearClipMap.hlsli"
+
+RWTexture3D<float4> voxel_opacity : register(u0);
+RWTexture3D<float4> voxel_radiance : register(u1);
+Texture3D<float4> static_opacity : register(t1);
+
+// Resets the regions to the cached static voxelization, ready for the dynamic objects to be splatted on top.
+[numthreads(64, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    int3 pos;
+    if (!getRegionTexel(DTid, pos)) return;
+
+    const float4 clearColor = (0.0).xxxx;
+    for (int face = 0; face < 6; ++face)
+    {
+        voxel_opacity[pos] = static_opacity[pos];
+        voxel_radiance[pos] = clearColor;
+        pos.x += BRICK_FACE_STRIDE;
+    }
+}
@@ -0,0 +1,25 @@
+// The clipmap is stored sparsely: each level is cut into bricks of BRICK_SIZE^3 voxels in image space and the
+// bricks holding geometry are given a slot of the atlas.  Mirrors BrickMap.h.
+#define BRICK_SIZE 8
+// Bricks along x and y of the atlas; it has as many layers of them along z as the brick map needs.
+#define BRICK_ATLAS_BRICKS 16
+#define INVALID_BRICK 0xffffffff
+
+// The faces lie side by side along x, as they did in the dense volume.
+#define BRICK_FACE_STRIDE (BRICK_ATLAS_BRICKS * BRICK_SIZE)
+
+// Finds the atlas texel of the first face for a voxel, imageCoords being its toroidal coordinates inside the level.
+// False when the voxel's brick has no slot, which means it holds no geometry.
+bool getBrickTexel(StructuredBuffer<uint> indirection, int3 imageCoords, int level, int resolution, out int3 texel)
+{
+    texel = int3(0, 0, 0);
+
+    int bricksPerAxis = resolution / BRICK_SIZE;
+    int3 brick = imageCoords / BRICK_SIZE;
+    uint slot = indirection[((level * bricksPerAxis + brick.z) * bricksPerAxis + brick.y) * bricksPerAxis + brick.x];
+    if (slot == INVALID_BRICK) return false;
+
+    int3 slotCoords = int3(slot % BRICK_ATLAS_BRICKS, (slot / BRICK_ATLAS_BRICKS) % BRICK_ATLAS_BRICKS, slot / (BRICK_ATLAS_BRICKS * BRICK_ATLAS_BRICKS));
+    texel = slotCoords * BRICK_SIZE + (imageCoords & (BRICK_SIZE - 1));
+    return true;
+}
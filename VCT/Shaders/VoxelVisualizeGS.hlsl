@@ -1,4 +1,5 @@
-#define VOXEL_TEXTURE_WITH_BORDER
+#include "VoxelBricks.hlsli"
+
 struct GSOutput
 {
 	float4 pos : SV_POSITION;
@@ -28,6 +29,7 @@ cbuffer regionInfo: register(b0)
 };
 
 Texture3D<float4> u_3dTexture : register(t0);
+StructuredBuffer<uint> u_brickIndirection : register(t1);
 
 
 float3 toWorld(int3 p)
@@ -35,7 +37,6 @@ float3 toWorld(int3 p)
     return p * u_voxelSize;
 }
 
-static const int BORDER_WIDTH = 1;
 static const float EPSILON = 0.00001;
 
 void createQuad(float4 v0, float4 v1, float4 v2, float4 v3, float4 uni_color,float3 normal, inout TriangleStream< GSOutput > output)
@@ -76,16 +77,12 @@ void main(
     int3 pos = int3(point_pos.xyz);
     int3 posV = pos + u_regionMin;
 
-    int3 samplePos = (u_imageMin + pos) & (u_clipmapResolution - 1);
-
-#ifdef VOXEL_TEXTURE_WITH_BORDER
-    int resolution = u_clipmapResolution + BORDER_WIDTH * 2;
-    samplePos += int3(BORDER_WIDTH, BORDER_WIDTH, BORDER_WIDTH);
-#else
-    int resolution = u_clipmapResolution;
-#endif
+    int3 imageCoords = (u_imageMin + pos) & (u_clipmapResolution - 1);
 
-    samplePos.y += u_clipmapLevel * resolution;
+    // Empty bricks have no slot.
+    int3 samplePos;
+    if (!getBrickTexel(u_brickIndirection, imageCoords, u_clipmapLevel, u_clipmapResolution, samplePos))
+        return;
 
     float4 color = u_3dTexture.Load(int4(samplePos,0));
 
@@ -0,0 +1,16 @@
+// One entry per region voxelized this frame; mirrors VoxelizationPass::RegionInfo.
+struct RegionInfo
+{
+    float4x4 viewProj[3];
+    float3 regionMin;
+    int clipmapLevel;
+    float3 regionMax;
+    float voxelSize;
+    // The region grown by the border voxel, which triangles are culled against.
+    float3 cullMin;
+    float maxExtent;
+    float3 cullMax;
+    float _pad;
+};
+
+StructuredBuffer<RegionInfo> u_regions : register(t0);
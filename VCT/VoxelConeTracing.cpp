@@ -6,6 +6,7 @@
 #include "BufferManager.h"
 #include "Camera.h"
 #include "World.hpp"
+#include "ConeTracingPass.hpp"
 #include "GpuBuffer.h"
 #include "Texture3D.h"
 #include "CommandContext.h"
@@ -71,6 +72,7 @@ public:
 
     virtual void Update( float deltaT ) override;
     virtual void RenderScene( void ) override;
+    virtual void RenderUI( GraphicsContext& gfxContext ) override;
 
  
 
@@ -148,7 +150,7 @@ void VoxelConeTracing::Startup( void )
     m_RootSig[RootParams::LightingParam].InitAsConstantBuffer(SLOT_CBUFFER_LIGHT, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::MaterialsSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::LightingSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 6, D3D12_SHADER_VISIBILITY_PIXEL);
-	m_RootSig[RootParams::GBufferSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 32, 4, D3D12_SHADER_VISIBILITY_PIXEL);
+	m_RootSig[RootParams::GBufferSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 32, 5, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::PerModelConstant].InitAsConstants(1, 2, D3D12_SHADER_VISIBILITY_VERTEX);
 	m_RootSig[RootParams::WorldParam].InitAsConstantBuffer(SLOT_CBUFFER_WORLD, D3D12_SHADER_VISIBILITY_ALL);
     m_RootSig.Finalize(L"ModelViewer", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -249,6 +251,7 @@ void VoxelConeTracing::Startup( void )
 
     TextureManager::Initialize(L"Textures/");
 	m_world.Create();
+    ConeTracingPass::Initialize();
 
     // The caller of this function can override which materials are considered cutouts
     
@@ -559,6 +562,12 @@ void VoxelConeTracing::RenderScene( void )
             g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
         }
 
+        // Some systems generate a per-pixel velocity buffer to better track dynamic and skinned meshes.  Everything
+        // is static in our scene, so we generate velocity from camera motion and the depth buffer.  A velocity buffer
+        // is necessary for all temporal effects (and motion blur), the cone tracing's among them.  It reads the linear
+        // depth, which SSAO may still be writing on the compute queue until the stall above.
+        MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_world.GetMainCamera(), true);
+
         {
             ScopedTimer _prof4(L"Render Color", gfxContext);
 
@@ -584,7 +593,8 @@ void VoxelConeTracing::RenderScene( void )
             m_world.voxelVisualize(gfxContext);
         }
 
-       
+        ConeTracingPass::Render(gfxContext, m_world.GetMainCamera(), m_world.GetVoxelization());
+
         {
             pfnSetupGraphicsState();
             ScopedTimer _prof6(L"Shading Pass", gfxContext);
@@ -592,7 +602,8 @@ void VoxelConeTracing::RenderScene( void )
             gfxContext.TransitionResource(g_GBufferNormalBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
             gfxContext.TransitionResource(g_GBufferMaterialBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
             gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            D3D12_CPU_DESCRIPTOR_HANDLE GBuffers[4] = { g_GBufferColorBuffer.GetSRV(),g_GBufferNormalBuffer.GetSRV(),g_GBufferMaterialBuffer.GetSRV(),g_SceneDepthBuffer.GetDepthSRV() };
+            D3D12_CPU_DESCRIPTOR_HANDLE GBuffers[5] = { g_GBufferColorBuffer.GetSRV(),g_GBufferNormalBuffer.GetSRV(),g_GBufferMaterialBuffer.GetSRV(),g_SceneDepthBuffer.GetDepthSRV(),
+                ConeTracingPass::GetVisibilitySRV() };
             gfxContext.SetDynamicDescriptors(RootParams::GBufferSRVs, 0, _countof(GBuffers), GBuffers);
             gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
             gfxContext.ClearColor(g_SceneColorBuffer);
@@ -604,13 +615,13 @@ void VoxelConeTracing::RenderScene( void )
 
         }
     }
+    else
+    {
+        // SSAO's debug draw has already waited for the compute queue.
+        MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_world.GetMainCamera(), true);
+    }
     SkyPass::Render(gfxContext, m_world.GetMainCamera());
 
-    // Some systems generate a per-pixel velocity buffer to better track dynamic and skinned meshes.  Everything
-    // is static in our scene, so we generate velocity from camera motion and the depth buffer.  A velocity buffer
-    // is necessary for all temporal effects (and motion blur).
-    MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_world.GetMainCamera(), true);
-
     TemporalEffects::ResolveImage(gfxContext);
 
     ParticleEffects::Render(gfxContext, m_world.GetMainCamera(), g_SceneColorBuffer, g_SceneDepthBuffer,  g_LinearDepth[FrameIndex]);
@@ -624,6 +635,42 @@ void VoxelConeTracing::RenderScene( void )
     gfxContext.Finish();
 }
 
+void VoxelConeTracing::RenderUI( GraphicsContext& gfxContext )
+{
+    const Voxel::Voxelization& voxelization = m_world.GetVoxelization();
+    const std::vector<Voxel::RegionVoxelizationStats>& regions = voxelization.GetVoxelizationStats();
+    const BrickMapStats& bricks = voxelization.GetBrickStats();
+
+    TextContext Text(gfxContext);
+    Text.Begin();
+    Text.ResetCursor(10.0f, 880.0f);
+    Text.DrawFormattedString("Voxel bricks %u / %u: %u new, %u freed, %u grew the atlas (%llu total), atlases %.0f MB, dense %.0f MB\n",
+        bricks.allocated, bricks.capacity, bricks.newBricks, bricks.freedBricks, bricks.overflows, bricks.totalOverflows,
+        voxelization.GetAtlasBytes() / (1024.0 * 1024.0), Voxel::Voxelization::GetDenseBytes() / (1024.0 * 1024.0));
+    const ClipmapUpdateStats& schedule = voxelization.GetScheduleStats();
+    Text.DrawFormattedString("Voxel levels updated 0x%02x, deferred 0x%02x (waited %u frames): %.2f ms estimated, %.2f ms measured, budget %.2f ms, %.1f Mvoxels/ms\n",
+        schedule.updatedLevels, schedule.deferredLevels, schedule.maxWait, schedule.estimatedMs, schedule.measuredMs,
+        schedule.budgetMs, schedule.voxelsPerMs / 1.0e6f);
+    if (!regions.empty())
+    {
+        uint32_t meshes = 0, culledMeshes = 0;
+        uint64_t triangles = 0;
+        for (const Voxel::RegionVoxelizationStats& region : regions)
+        {
+            meshes += region.meshes;
+            culledMeshes += region.culledMeshes;
+            triangles += region.triangles;
+        }
+
+        Text.DrawFormattedString("Voxelized %u regions in %u draws: %u meshes drawn, %u culled, %llu triangles\n",
+            uint32_t(regions.size()), voxelization.GetVoxelizationDraws(), meshes, culledMeshes, triangles);
+        for (const Voxel::RegionVoxelizationStats& region : regions)
+            Text.DrawFormattedString("  L%u %s: %u meshes, %llu triangles\n", region.clipmapLevel,
+                region.dynamic ? "dynamic" : "static", region.meshes, region.triangles);
+    }
+    Text.End();
+}
+
 void VoxelConeTracing::CreateParticleEffects()
 {
     ParticleEffectProperties Effect = ParticleEffectProperties();
@@ -0,0 +1,41 @@
+#pragma once
+#include "GameCore.h"
+#include "RegionCulling.h"
+#include "VoxelRegion.hpp"
+#include <vector>
+
+namespace Voxel
+{
+    /**
+     * Adds a mesh to the bounds by its model space box; the scene's models have no transform.
+     */
+    inline void AddMeshBounds(MeshBoundsSoA& meshBounds, const Math::BoundingBox& bounds, uint32_t model, uint32_t mesh, uint32_t triangleCount)
+    {
+        const float minBound[3] = { bounds.min.GetX(), bounds.min.GetY(), bounds.min.GetZ() };
+        const float maxBound[3] = { bounds.max.GetX(), bounds.max.GetY(), bounds.max.GetZ() };
+        meshBounds.Add(minBound, maxBound, model, mesh, triangleCount);
+    }
+
+    /**
+     * Appends the indices of the meshes that are not outside the region's world space box.
+     */
+    inline void CullMeshBounds(const MeshBoundsSoA& meshBounds, const VoxelRegion& region, std::vector<uint32_t>& visible)
+    {
+        const Dagon::Vec3f regionMin = region.getMinPosWorld();
+        const Dagon::Vec3f regionMax = region.getMaxPosWorld();
+        meshBounds.Cull(&regionMin[0], &regionMax[0], visible);
+    }
+
+    /**
+     * What one VoxelizationPass::Render call drew.
+     */
+    struct RegionVoxelizationStats
+    {
+        uint32_t clipmapLevel;
+        // Whether the region was in the dynamic pass, which draws into the opacity volume on top of the static cache.
+        bool dynamic;
+        uint32_t meshes;
+        uint32_t culledMeshes;
+        uint64_t triangles;
+    };
+}
@@ -16,6 +16,7 @@ namespace VoxelVisualization
     enum class VoxelVisualizationParams: U8
     {
         Texture3d,
+        BrickIndirection,
         GSParam,
         PSParam,
         Count
@@ -31,6 +32,7 @@ namespace VoxelVisualization
     {
         s_RootSignature.Reset((UINT)VoxelVisualizationParams::Count, 0);
         s_RootSignature[(UINT)VoxelVisualizationParams::Texture3d].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+        s_RootSignature[(UINT)VoxelVisualizationParams::BrickIndirection].InitAsBufferSRV(1, D3D12_SHADER_VISIBILITY_GEOMETRY);
         s_RootSignature[(UINT)VoxelVisualizationParams::GSParam].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_GEOMETRY);
         s_RootSignature[(UINT)VoxelVisualizationParams::PSParam].InitAsConstantBuffer(1, D3D12_SHADER_VISIBILITY_PIXEL);
         s_RootSignature.Finalize(L"Voxel Visualize", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -60,12 +62,13 @@ namespace VoxelVisualization
         m_visual_mesh->Create(res_num);
     }
 
-    void VoxelVisualize::DrawClip(GraphicsContext& context, const D3D12_CPU_DESCRIPTOR_HANDLE& texSrv)
+    void VoxelVisualize::DrawClip(GraphicsContext& context, const D3D12_CPU_DESCRIPTOR_HANDLE& texSrv, const GpuBuffer& brickIndirection)
     {
         assert(m_visual_mesh != nullptr);
         context.SetRootSignature(s_RootSignature);
         context.SetPipelineState(s_voxel_visualPSO);
         context.SetDynamicDescriptor((UINT)VoxelVisualizationParams::Texture3d, 0, texSrv);
+        context.SetBufferSRV((UINT)VoxelVisualizationParams::BrickIndirection, brickIndirection);
         context.SetDynamicConstantBufferView((UINT)VoxelVisualizationParams::GSParam, sizeof(s_gsbuffer), &s_gsbuffer);
         context.SetDynamicConstantBufferView((UINT)VoxelVisualizationParams::PSParam, sizeof(s_psbuffer), &s_psbuffer);
         m_visual_mesh->Draw(context);
@@ -5,6 +5,7 @@
 #include "VoxelVisualizePass.hpp"
 #include "VisualizeMesh.hpp"
 #include "Texture3D.h"
+#include "GpuBuffer.h"
 #include "VoxelRegion.hpp"
 
 using namespace Voxel;
@@ -46,7 +47,7 @@ namespace VoxelVisualization
         ~VoxelVisualize() = default;
         VoxelVisualize(const VoxelVisualize& _) = delete;
         VoxelVisualize& operator = (const VoxelVisualize& _) = delete;
-        void DrawClip(GraphicsContext& context, const D3D12_CPU_DESCRIPTOR_HANDLE& texSrv);
+        void DrawClip(GraphicsContext& context, const D3D12_CPU_DESCRIPTOR_HANDLE& texSrv, const GpuBuffer& brickIndirection);
         void InitMesh(const size_t res_num);
         void Visualize3DClipmapGS( const VoxelRegion& region, U32 clipmapLevel, const VoxelRegion& prevRegion, const Math::Matrix4& mvp,
             bool hasPrevLevel, bool hasFaces, int numColorComponents);
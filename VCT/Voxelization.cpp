@@ -5,19 +5,64 @@
 #include "voxelClear.hpp"
 #include "voxelizationPass.hpp"
 #include <glm/glm.hpp>
+#include <limits>
 
 #pragma endregion
 
 namespace Voxel
 {
+    BoolVar UseBakedCache("Voxel/Use Baked Cache", true);
+
+    // Off revoxelizes every level as soon as it needs it.
+    BoolVar ScheduleUpdates("Voxel/Schedule/Enable", true);
+    // Level k is revoxelized at most every 2^(k * shift) frames; 0 keeps every level current.
+    IntVar LevelPeriodShift("Voxel/Schedule/Level Period Shift", 1, 0, 3);
+    NumVar UpdateBudget("Voxel/Schedule/GPU Budget (ms)", 1.0f, 0.1f, 20.0f, 0.1f);
+    // Frames a pending level may be deferred past its due frame for the budget.
+    IntVar MaxUpdateLatency("Voxel/Schedule/Max Latency", 8, 0, 120);
+
+    // The timer block around Voxelize, whose GPU time the scheduler is fed.
+    const wchar_t* const kVoxelizeTimer = L"Voxel Update";
+
+    // Frames between a frame's Voxelize and the Update its GPU time is read back in: the timestamps EngineProfiling
+    // reads at the start of a frame were resolved at the start of the one before, after the frame before that.
+    const uint64_t kGpuTimeLatency = 2;
+
     RootSignature s_RootSignature;
     GraphicsPSO s_VoxelizePSO;
+
+    // Opacity, radiance and static opacity, RGBA8 with six faces per voxel.
+    const uint64_t kVolumeCount = 3;
+    const uint64_t kVoxelBytes = 4 * FACE_COUNT;
+    const uint32_t kAtlasExtent = BRICK_ATLAS_BRICKS * BRICK_SIZE;
+
+    // Ten layers of bricks, a tenth of the memory of the dense volumes.  The brick map grows the atlases when a
+    // scene needs more.
+    const uint32_t kInitialAtlasCapacity = 10 * BRICK_ATLAS_LAYER;
+
+    // Writes the camera boxes of every frame to ClipmapTrace.bin, for Tools/ClipmapReplay.
+    BoolVar RecordClipmapTrace("Voxel/Record Camera Path", false);
+
+    ClipmapBox toClipmapBox(const VoxelRegion& region)
+    {
+        return ClipmapBox{ { region.minPos.x, region.minPos.y, region.minPos.z }, { region.extent.x, region.extent.y, region.extent.z } };
+    }
+
+    VoxelRegion toVoxelRegion(const ClipmapBox& box, float voxelSize)
+    {
+        return VoxelRegion(glm::ivec3(box.minPos[0], box.minPos[1], box.minPos[2]), glm::ivec3(box.extent[0], box.extent[1], box.extent[2]), voxelSize);
+    }
 }
 
 using namespace Voxel;
 Voxelization::Voxelization():m_visualize(false)
 {
     m_clipRegions.resize(CLIP_REGION_COUNT);
+    for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+    {
+        m_footprintMin[i] = Dagon::Vec3f(std::numeric_limits<float>::max());
+        m_footprintMax[i] = Dagon::Vec3f(-std::numeric_limits<float>::max());
+    }
 }
 
 void Voxelization::Init(float extentWorldLevel0, const std::vector<BoundingBox>& clipRegionBBoxes)
@@ -40,10 +85,13 @@ void Voxelization::Init(float extentWorldLevel0, const std::vector<BoundingBox>&
     }
 
     m_forceFullRevoxelization = true;
+    m_scheduler.Reset(CLIP_REGION_COUNT);
 
-    constexpr const uint32_t voxelSizeWithBorder = VOXEL_RESOLUTION + 2;
-    m_voxelOpacity.Create(L"voxel Opacity", voxelSizeWithBorder * FACE_COUNT, CLIP_REGION_COUNT * voxelSizeWithBorder, voxelSizeWithBorder, DXGI_FORMAT_R8G8B8A8_UNORM);
-    m_voxelRadiance.Create(L"voxel Radiance", voxelSizeWithBorder * FACE_COUNT, CLIP_REGION_COUNT * voxelSizeWithBorder, voxelSizeWithBorder, DXGI_FORMAT_R8G8B8A8_UNORM);
+    // Only bricks that may hold geometry are stored.
+    m_brickMap.Reset(CLIP_REGION_COUNT, VOXEL_RESOLUTION, kInitialAtlasCapacity);
+    const std::vector<uint32_t>& indirection = m_brickMap.GetIndirection();
+    m_brickIndirection.Create(L"voxel Brick Indirection", uint32_t(indirection.size()), sizeof(uint32_t), indirection.data());
+    createAtlases(kInitialAtlasCapacity);
     VoxelClear::Initialize();
     VoxelizationPass::Initialize();
     VoxelVisualization::Initialize();
@@ -51,125 +99,343 @@ void Voxelization::Init(float extentWorldLevel0, const std::vector<BoundingBox>&
 
 }
 
+bool Voxelization::LoadBakedCache(const std::wstring& path)
+{
+    if (!m_bakedCache.Load(path))
+        return false;
+
+    const VoxelCacheHeader& header = m_bakedCache.GetHeader();
+    const float extentL0 = m_clipRegions[0].voxelSize * VOXEL_RESOLUTION;
+    bool matches = header.resolution == VOXEL_RESOLUTION && header.levelCount >= CLIP_REGION_COUNT;
+    for (uint32_t i = 0; matches && i < CLIP_REGION_COUNT; ++i)
+        matches = std::abs(m_bakedCache.GetLevel(i).voxelSize - m_clipRegions[i].voxelSize) <= m_clipRegions[i].voxelSize * 1e-4f;
+    if (!matches)
+    {
+        Utility::Printf(L"%s was baked for %u levels of %u voxels over %g, the scene needs %u levels of %u over %g; rebake with -extent %g\n",
+            path.c_str(), header.levelCount, header.resolution, header.level0Extent, CLIP_REGION_COUNT, VOXEL_RESOLUTION, extentL0, extentL0);
+        m_bakedCache.Close();
+        return false;
+    }
+    Utility::Printf(L"Loaded %s: %u models, %u bricks\n", path.c_str(), header.modelCount, header.brickCount);
+    return true;
+}
+
 glm::ivec3 Voxelization::computeChangeDeltaV(uint32_t level, const BoundingBox& cameraRegionBBox)
 {
-    const auto & clipRegion = m_clipRegions[level];
-    const float voxelSize = clipRegion.voxelSize;
-    Dagon::Vec3f deltaW = Dagon::Vec3f(cameraRegionBBox.min) - clipRegion.getMinPosWorld();
-    float minChange = voxelSize * m_minChange[level];
-    glm::ivec3 delta = glm::ivec3(glm::trunc(deltaW / minChange)) *m_minChange[level];
+    const VoxelRegion& clipRegion = m_clipRegions[level];
+    const Dagon::Vec3f boxMin(cameraRegionBBox.min);
+    glm::ivec3 delta;
+    ClipmapPlanner::ComputeDelta(toClipmapBox(clipRegion), clipRegion.voxelSize, &boxMin.x, m_minChange[level], &delta.x);
     return delta;
 }
 
-void Voxelization::computeRevoxelizationRegionsClipmap(uint32_t level, const BoundingBox& curBBox)
+void Voxelization::computeRevoxelizationRegionsClipmap(uint32_t level, const BoundingBox& curBBox, VoxelRegion& clipRegion)
 {
-    auto & clipRegion = m_clipRegions[level];
-    const float voxelSize = clipRegion.voxelSize;
-    const glm::ivec3 extent = clipRegion.extent;
-    const glm::ivec3 delta = computeChangeDeltaV(level, curBBox);
-    const glm::ivec3 absDelta = glm::abs(delta);
-    clipRegion.minPos += delta;
-    if (absDelta.x >= extent.x || absDelta.y >= extent.y || absDelta.z >= extent.z)
-    {
-        m_revoxelizationRegions[level].push_back(clipRegion);
-        return;
-    }
-    glm::ivec3 newMin = clipRegion.minPos;
-    glm::ivec3 newMax = clipRegion.getMaxPos();
+    const Dagon::Vec3f boxMin(curBBox.min);
+    ClipmapBox region = toClipmapBox(clipRegion);
+    m_plannedSlabs.clear();
+    ClipmapPlanner::Move(region, clipRegion.voxelSize, &boxMin.x, m_minChange[level], m_plannedSlabs);
+    clipRegion.minPos = glm::ivec3(region.minPos[0], region.minPos[1], region.minPos[2]);
+    for (const ClipmapBox& slab : m_plannedSlabs)
+        m_revoxelizationRegions[level].push_back(toVoxelRegion(slab, clipRegion.voxelSize));
+}
 
-    if (absDelta.x >= m_minChange[level])
-    {
-        auto regionExtent = glm::ivec3(absDelta.x, extent.y, extent.z);
 
-        if (delta.x < 0)
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMin, regionExtent, voxelSize));
-        else
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMax - regionExtent, regionExtent, voxelSize));
-    }
+void Voxelization::computeDynamicRegion(uint32_t level, const VoxelRegion& clipRegion)
+{
+    // One box per level covers every footprint, which keeps the regions of a frame within a draw's region mask.
+    const Dagon::Vec3f& footprintMin = m_footprintMin[level];
+    const Dagon::Vec3f& footprintMax = m_footprintMax[level];
+    if (glm::any(glm::greaterThan(footprintMin, footprintMax)))
+        return;
 
-    if (absDelta.y >= m_minChange[level])
-    {
-        auto regionExtent = glm::ivec3(extent.x, absDelta.y, extent.z);
+    // A voxel of margin absorbs the rounding of the pixel shader's image coordinates.
+    glm::ivec3 minPos = glm::ivec3(glm::floor(footprintMin / clipRegion.voxelSize)) - 1;
+    glm::ivec3 maxPos = glm::ivec3(glm::ceil(footprintMax / clipRegion.voxelSize)) + 1;
+    minPos = glm::max(minPos, clipRegion.minPos);
+    maxPos = glm::min(maxPos, clipRegion.getMaxPos());
+    if (glm::any(glm::lessThanEqual(maxPos, minPos)))
+        return;
+    m_dynamicRegions[level].push_back(VoxelRegion(minPos, maxPos - minPos, clipRegion.voxelSize));
+}
 
-        if (delta.y < 0)
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMin, regionExtent, voxelSize));
-        else
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMax - regionExtent, regionExtent, voxelSize));
+void Voxelization::Update(const std::vector<BoundingBox>& bboxs, const std::vector<BoundingBox>& dynamicFootprints)
+{
+    // The brick map outgrew the atlases last frame, and the bricks past their end were dropped.  The larger atlases
+    // start out empty, so every level is revoxelized into them.
+    if (m_brickMap.GetStats().capacity > m_atlasCapacity)
+    {
+        // The old atlases may still be in flight.
+        Graphics::g_CommandManager.IdleGPU();
+        createAtlases(m_brickMap.GetStats().capacity);
+        m_forceFullRevoxelization = true;
     }
 
-    if (absDelta.z >= m_minChange[level])
+    // The static cache is rebuilt whole when it switches between the baked and the rasterized voxels.
+    const bool useBakedCache = UseBakedCache && m_bakedCache.IsOpen();
+    if (useBakedCache != m_usedBakedCache)
     {
-        auto regionExtent = glm::ivec3(extent.x, extent.y, absDelta.z);
-
-        if (delta.z < 0)
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMin, regionExtent, voxelSize));
-        else
-            m_revoxelizationRegions[level].push_back(VoxelRegion(newMax - regionExtent, regionExtent, voxelSize));
+        m_usedBakedCache = useBakedCache;
+        m_forceFullRevoxelization = true;
     }
-}
 
+    // The voxels last frame's Voxelize covered, and the GPU time of the frame kGpuTimeLatency back, which the
+    // scheduler pairs with that frame's voxels.
+    if (m_frame > 0)
+        m_scheduler.RecordVoxels(m_frame - 1, m_voxelizedVoxels);
+    if (m_frame >= kGpuTimeLatency)
+        m_scheduler.Measure(m_frame - kGpuTimeLatency, EngineProfiling::GetGpuTime(kVoxelizeTimer));
+    recordClipmapTrace(bboxs);
 
-void Voxelization::Update(const std::vector<BoundingBox>& bboxs)
-{
-   
     if (m_forceFullRevoxelization)
     {
         for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
         {
-            m_revoxelizationRegions[i].clear();
-            m_revoxelizationRegions[i].push_back(m_clipRegions[i]);
+            m_fullRevoxelization[i] = true;
+            m_scheduler.Request(i, m_frame);
         }
-        for (uint32_t clipmapLevel = 0; clipmapLevel < CLIP_REGION_COUNT; ++clipmapLevel)
-        {
-            auto& clipRegion = m_clipRegions[clipmapLevel];
+        m_forceFullRevoxelization = false;
+    }
 
-            glm::ivec3 delta = computeChangeDeltaV(clipmapLevel, bboxs.at(clipmapLevel));
+    // Plans every level's update as if it ran this frame.  A level that is not updated keeps its clip region, so
+    // its voxels stay consistent with it, and keeps gathering the dynamic footprints it will have to clear.
+    VoxelRegion plannedRegions[CLIP_REGION_COUNT];
+    std::vector<uint64_t> levelVoxels(CLIP_REGION_COUNT, 0);
+    for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+    {
+        for (auto& footprint : dynamicFootprints)
+        {
+            m_footprintMin[i] = glm::min(m_footprintMin[i], Dagon::Vec3f(footprint.min));
+            m_footprintMax[i] = glm::max(m_footprintMax[i], Dagon::Vec3f(footprint.max));
+        }
 
-            clipRegion.minPos += delta;
+        m_revoxelizationRegions[i].clear();
+        m_dynamicRegions[i].clear();
+        plannedRegions[i] = m_clipRegions[i];
+        if (m_fullRevoxelization[i])
+        {
+            plannedRegions[i].minPos += computeChangeDeltaV(i, bboxs.at(i));
+            m_revoxelizationRegions[i].push_back(plannedRegions[i]);
         }
+        else
+            computeRevoxelizationRegionsClipmap(i, bboxs.at(i), plannedRegions[i]);
+        computeDynamicRegion(i, plannedRegions[i]);
 
+        for (auto& region : m_revoxelizationRegions[i])
+            levelVoxels[i] += uint64_t(region.extent.x) * region.extent.y * region.extent.z;
+        for (auto& region : m_dynamicRegions[i])
+            levelVoxels[i] += uint64_t(region.extent.x) * region.extent.y * region.extent.z;
     }
-    else
+
+    const uint32_t allLevels = (1u << CLIP_REGION_COUNT) - 1;
+    const uint32_t updatedLevels = ScheduleUpdates ?
+        m_scheduler.Schedule(m_frame, levelVoxels, uint32_t(int(LevelPeriodShift)), UpdateBudget, uint32_t(int(MaxUpdateLatency))) : allLevels;
+    for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
     {
-        for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+        if ((updatedLevels & (1u << i)) == 0)
         {
             m_revoxelizationRegions[i].clear();
-            computeRevoxelizationRegionsClipmap(i, bboxs.at(i));
+            m_dynamicRegions[i].clear();
+            continue;
         }
+        m_clipRegions[i] = plannedRegions[i];
+        m_fullRevoxelization[i] = false;
+        m_footprintMin[i] = Dagon::Vec3f(std::numeric_limits<float>::max());
+        m_footprintMax[i] = Dagon::Vec3f(-std::numeric_limits<float>::max());
     }
-    ComputeContext& context = ComputeContext::Begin(L"Voxel Clear", true);
+    ++m_frame;
+}
+
+void Voxelization::recordClipmapTrace(const std::vector<BoundingBox>& bboxs)
+{
+    if (RecordClipmapTrace && !m_clipmapTrace.IsOpen())
     {
-        ScopedTimer _prof(L"Voxel Clear", context);
-        context.TransitionResource(m_voxelOpacity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        ClipmapTraceHeader header = {};
+        header.levelCount = CLIP_REGION_COUNT;
+        header.resolution = VOXEL_RESOLUTION;
+        header.voxelSize = m_clipRegions[0].voxelSize;
         for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+            header.minChange[i] = uint32_t(m_minChange[i]);
+        if (!m_clipmapTrace.Open(L"ClipmapTrace.bin", header))
+            RecordClipmapTrace = false;
+    }
+    else if (!RecordClipmapTrace && m_clipmapTrace.IsOpen())
+    {
+        m_clipmapTrace.Close();
+    }
+    if (m_clipmapTrace.IsOpen())
+    {
+        ClipmapTraceBox boxes[CLIP_REGION_COUNT];
+        for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+        {
+            const Dagon::Vec3f boxMin(bboxs.at(i).min);
+            const Dagon::Vec3f boxMax(bboxs.at(i).max);
+            boxes[i] = ClipmapTraceBox{ { boxMin.x, boxMin.y, boxMin.z }, { boxMax.x, boxMax.y, boxMax.z } };
+        }
+        m_clipmapTrace.WriteFrame(boxes);
+    }
+}
+
+void Voxelization::appendRegionDraws(const std::vector<VoxelRegion> (&regions)[CLIP_REGION_COUNT])
+{
+    for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
+    {
+        for (auto& region : regions[i])
+            m_regionDraws.push_back(VoxelizationPass::RegionDraw{ region, i });
+    }
+
+    m_clearRegions.clear();
+    for (auto& draw : m_regionDraws)
+        ClipmapClear::AppendRegion(m_clearRegions, toClipmapBox(draw.region), draw.clipmapLevel, VOXEL_RESOLUTION);
+}
+
+void Voxelization::gatherBakedVoxels()
+{
+    m_bakedVoxels.regions.clear();
+    m_bakedVoxels.brickEntries.clear();
+    m_bakedVoxels.brickMasks.clear();
+    for (auto& draw : m_regionDraws)
+    {
+        const glm::ivec3 minPos = draw.region.minPos;
+        const glm::ivec3 maxPos = draw.region.getMaxPos() - 1;
+        const glm::ivec3 brickMin(GetVoxelBrick(minPos.x), GetVoxelBrick(minPos.y), GetVoxelBrick(minPos.z));
+        const glm::ivec3 brickMax(GetVoxelBrick(maxPos.x), GetVoxelBrick(maxPos.y), GetVoxelBrick(maxPos.z));
+
+        VoxelClear::BakedRegion baked = {};
+        baked.u_voxelMin = minPos;
+        baked.u_firstEntry = static_cast<uint32_t>(m_bakedVoxels.brickEntries.size());
+        baked.u_brickMin = brickMin;
+        baked.u_brickDims = brickMax - brickMin + 1;
+        m_bakedVoxels.regions.push_back(baked);
+
+        for (int z = brickMin.z; z <= brickMax.z; ++z)
         {
-            for (auto& region : m_revoxelizationRegions[i])
+            for (int y = brickMin.y; y <= brickMax.y; ++y)
             {
-                VoxelClear::ConstantBuffer cbv;
-                cbv.u_clipmapLevel = i;
-                cbv.u_extent = region.extent;
-                cbv.u_resolution = VOXEL_RESOLUTION;
-                cbv.u_min = region.getMinPosImage(m_clipRegions[i].extent);
-                VoxelClear::SetConstantBuffer(cbv);
-                VoxelClear::SetUAV(m_voxelOpacity.GetUAV());
-                VoxelClear::Apply(context);
-              }
+                for (int x = brickMin.x; x <= brickMax.x; ++x)
+                {
+                    const VoxelCacheBrick* brick = m_bakedCache.FindBrick(draw.clipmapLevel, x, y, z);
+                    if (brick == nullptr)
+                    {
+                        m_bakedVoxels.brickEntries.push_back(INVALID_BRICK);
+                        continue;
+                    }
+                    m_bakedVoxels.brickEntries.push_back(static_cast<uint32_t>(m_bakedVoxels.brickMasks.size() / kVoxelBrickWords));
+                    m_bakedVoxels.brickMasks.insert(m_bakedVoxels.brickMasks.end(), brick->bits, brick->bits + kVoxelBrickWords);
+                }
+            }
         }
     }
-    context.Finish();
 }
 
-void Voxelization::Voxelize(GraphicsContext& context)
+void Voxelization::createAtlases(uint32_t capacity)
 {
-    ScopedTimer _prof(L"world voxelization", context);
-    for (int i = 0; i < CLIP_REGION_COUNT; ++i)
+    // The faces of a brick lie side by side along x, and the layers of bricks along z.
+    const uint32_t depth = capacity / BRICK_ATLAS_LAYER * BRICK_SIZE;
+    m_voxelOpacity.Create(L"voxel Opacity", kAtlasExtent * FACE_COUNT, kAtlasExtent, depth, DXGI_FORMAT_R8G8B8A8_UNORM);
+    m_voxelRadiance.Create(L"voxel Radiance", kAtlasExtent * FACE_COUNT, kAtlasExtent, depth, DXGI_FORMAT_R8G8B8A8_UNORM);
+    m_staticOpacity.Create(L"voxel Static Opacity", kAtlasExtent * FACE_COUNT, kAtlasExtent, depth, DXGI_FORMAT_R8G8B8A8_UNORM);
+    m_atlasCapacity = capacity;
+}
+
+uint64_t Voxelization::GetAtlasBytes() const
+{
+    const uint64_t brickVoxels = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    return kVolumeCount * kVoxelBytes * brickVoxels * m_atlasCapacity;
+}
+
+uint64_t Voxelization::GetDenseBytes()
+{
+    const uint64_t voxelSizeWithBorder = VOXEL_RESOLUTION + 2;
+    return kVolumeCount * kVoxelBytes * CLIP_REGION_COUNT * voxelSizeWithBorder * voxelSizeWithBorder * voxelSizeWithBorder;
+}
+
+void Voxelization::updateBricks(ComputeContext& computeContext, const MeshBoundsSoA& dynamicMeshes, const MeshBoundsSoA& staticOccupancy)
+{
+    m_brickMap.BeginFrame();
+    for (uint32_t i = 0; i < CLIP_REGION_COUNT; ++i)
     {
-        // Voxelize the regions
+        const ClipmapBox clipRegion = toClipmapBox(m_clipRegions[i]);
         for (auto& region : m_revoxelizationRegions[i])
+            m_brickMap.UpdateRegion(i, clipRegion, m_clipRegions[i].voxelSize, toClipmapBox(region), { &staticOccupancy, &dynamicMeshes });
+        for (auto& region : m_dynamicRegions[i])
+            m_brickMap.UpdateRegion(i, clipRegion, m_clipRegions[i].voxelSize, toClipmapBox(region), { &staticOccupancy, &dynamicMeshes });
+    }
+
+    if (m_brickMap.IsDirty())
+    {
+        ScopedTimer _prof(L"Voxel Bricks", computeContext);
+        const std::vector<uint32_t>& indirection = m_brickMap.GetIndirection();
+        computeContext.WriteBuffer(m_brickIndirection, 0, indirection.data(), indirection.size() * sizeof(uint32_t));
+
+        // New slots hold whatever the bricks that had them left, in all three atlases.
+        computeContext.TransitionResource(m_voxelOpacity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        computeContext.TransitionResource(m_voxelRadiance, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        computeContext.TransitionResource(m_staticOpacity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        VoxelClear::ClearBricks(computeContext, m_brickMap.GetNewBricks(), m_voxelOpacity.GetUAV(), m_voxelRadiance.GetUAV(), m_staticOpacity.GetUAV());
+        computeContext.InsertUAVBarrier(m_voxelOpacity);
+        computeContext.InsertUAVBarrier(m_voxelRadiance);
+        computeContext.InsertUAVBarrier(m_staticOpacity, true);
+    }
+    computeContext.TransitionResource(m_brickIndirection, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, true);
+}
+
+void Voxelization::Voxelize(GraphicsContext& context, const MeshBoundsSoA& staticMeshes, const MeshBoundsSoA& dynamicMeshes,
+    const MeshBoundsSoA& staticOccupancy)
+{
+    ScopedTimer _profUpdate(kVoxelizeTimer, context);
+    ComputeContext& computeContext = context.GetComputeContext();
+    m_voxelizationStats.clear();
+    m_voxelizationDraws = 0;
+    m_voxelizedVoxels = 0;
+
+    // The indirection is final for the frame before any pass reads it.
+    updateBricks(computeContext, dynamicMeshes, staticOccupancy);
+
+    // The static models are only voxelized into the regions the clipmap moved into, and kept in the static cache.
+    m_regionDraws.clear();
+    appendRegionDraws(m_revoxelizationRegions);
+    if (!m_regionDraws.empty())
+    {
         {
-            VoxelizationPass::Render(context, region,i);
+            ScopedTimer _prof(L"Voxel Clear", computeContext);
+            computeContext.TransitionResource(m_staticOpacity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            computeContext.TransitionResource(m_voxelRadiance, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+            VoxelClear::Apply(computeContext, m_clearRegions, m_brickIndirection, m_staticOpacity.GetUAV(), m_voxelRadiance.GetUAV());
+            // The baked voxels and the voxelization write the cleared voxels next.
+            computeContext.InsertUAVBarrier(m_staticOpacity, true);
         }
+        if (m_usedBakedCache)
+        {
+            ScopedTimer _prof(L"Voxel Baked", computeContext);
+            gatherBakedVoxels();
+            VoxelClear::ApplyBaked(computeContext, m_clearRegions, m_bakedVoxels, m_brickIndirection, m_staticOpacity.GetUAV(), m_voxelRadiance.GetUAV());
+            computeContext.InsertUAVBarrier(m_staticOpacity, true);
+        }
+        ScopedTimer _prof(L"static voxelization", context);
+        m_voxelizationDraws += VoxelizationPass::Render(context, m_regionDraws, staticMeshes, m_brickIndirection, m_staticOpacity.GetUAV(), m_voxelizationStats);
+    }
+
+    // Those regions, and the ones the dynamic models that moved cover now or covered last frame, are reset to the
+    // static cache and the dynamic models are splatted on top.  With nothing moving, nothing is.
+    appendRegionDraws(m_dynamicRegions);
+    if (m_regionDraws.empty())
+        return;
+    m_voxelizedVoxels = ClipmapClear::CountVoxels(m_clearRegions);
+    {
+        ScopedTimer _prof(L"Voxel Restore", computeContext);
+        computeContext.TransitionResource(m_staticOpacity, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        computeContext.TransitionResource(m_voxelOpacity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        computeContext.TransitionResource(m_voxelRadiance, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        VoxelClear::Restore(computeContext, m_clearRegions, m_brickIndirection, m_staticOpacity.GetSRV(), m_voxelOpacity.GetUAV(), m_voxelRadiance.GetUAV());
+        computeContext.InsertUAVBarrier(m_voxelOpacity);
+        computeContext.InsertUAVBarrier(m_voxelRadiance, true);
     }
+    ScopedTimer _prof(L"dynamic voxelization", context);
+    const size_t firstDynamic = m_voxelizationStats.size();
+    m_voxelizationDraws += VoxelizationPass::Render(context, m_regionDraws, dynamicMeshes, m_brickIndirection, m_voxelOpacity.GetUAV(), m_voxelizationStats);
+    for (size_t i = firstDynamic; i < m_voxelizationStats.size(); ++i)
+        m_voxelizationStats[i].dynamic = true;
 }
 
 void Voxelization::Visualize(GraphicsContext& context, const Math::Matrix4& mvpMatrix)
@@ -187,7 +453,7 @@ void Voxelization::Visualize(GraphicsContext& context, const Math::Matrix4& mvpM
     for (int i = 0; i < CLIP_REGION_COUNT; ++i)
     {
         m_voxelvisualize.Visualize3DClipmapGS(clipRegions.at(size_t(i)), uint32_t(i), prevRegion, mvpMatrix, hasPrevLevel, hasMultipleFaces, numColorComponents);
-        m_voxelvisualize.DrawClip(context, m_voxelOpacity.GetSRV());
+        m_voxelvisualize.DrawClip(context, m_voxelOpacity.GetSRV(), m_brickIndirection);
         hasPrevLevel = true;
         prevRegion = clipRegions.at(size_t(i));
     }
@@ -1,8 +1,18 @@
 
 #pragma once
 #include "VoxelRegion.hpp"
+#include "VoxelRegionCulling.hpp"
 #include "Texture3D.h"
 #include "VoxelVisualizePass.hpp"
+#include "voxelizationPass.hpp"
+#include "voxelClear.hpp"
+#include "BrickMap.h"
+#include "ClipmapUpdateScheduler.h"
+#include "GpuBuffer.h"
+#include "VoxelCache.h"
+#include "ClipmapPlanner.h"
+#include "ClipmapTrace.h"
+#include <string>
 
 using namespace Math;
 using namespace GameCore;
@@ -16,9 +26,27 @@ namespace Voxel
 
         void Init(float extentWorldLevel0, const std::vector<BoundingBox>& clipRegionBBoxes);
 
-        void Update(const std::vector<BoundingBox>& bboxs);
+        // Loads the static voxelization Tools/VoxelBaker baked, to splat into the static cache in place of
+        // rasterizing the models it holds.  Call after Init; the cache has to match the clipmap's levels.
+        bool LoadBakedCache(const std::wstring& path);
 
-        void Voxelize(GraphicsContext& context);
+        inline const VoxelCache& GetBakedCache() const { return m_bakedCache; }
+
+        // Whether this frame's static voxelization comes from the baked cache, in which case Voxelize only
+        // rasterizes the static models the cache does not hold.
+        inline bool UsesBakedCache() const { return m_usedBakedCache; }
+
+        // Plans the regions to revoxelize: where the clip regions moved to the camera's boxes, and the boxes the
+        // dynamic models cover.  Only the levels the scheduler picks within the GPU budget keep their plan; the others
+        // keep their clip regions and gather the dynamic footprints until their turn.
+        void Update(const std::vector<BoundingBox>& bboxs, const std::vector<BoundingBox>& dynamicFootprints);
+
+        // Reallocates the bricks of every planned region, voxelizes the static meshes into the static cache where the
+        // clipmap moved, after splatting the baked voxels there when the baked cache is used, then resets every
+        // planned region to the cache and voxelizes the dynamic meshes on top.
+        // Bricks are given slots where the static occupancy boxes or the dynamic meshes are.
+        void Voxelize(GraphicsContext& context, const MeshBoundsSoA& staticMeshes, const MeshBoundsSoA& dynamicMeshes,
+            const MeshBoundsSoA& staticOccupancy);
 
         void Visualize(GraphicsContext& context, const Math::Matrix4& mvpMatrix);
 
@@ -26,6 +54,11 @@ namespace Voxel
 
         inline bool GetVisualization() noexcept { return m_visualize; } 
 
+        // The volumes are brick atlases; voxels are found through the indirection, see VoxelBricks.hlsli.
+        inline const StructuredBuffer& BrickIndirection() const { return m_brickIndirection; }
+
+        inline Texture3D& VoxelOpacity() { return m_voxelOpacity; }
+
         inline const D3D12_CPU_DESCRIPTOR_HANDLE& VoxelOpacitySRV() { return m_voxelOpacity.GetSRV(); }
 
         inline const D3D12_CPU_DESCRIPTOR_HANDLE& VoxelOpacityUAV() { return m_voxelOpacity.GetUAV(); }
@@ -38,24 +71,104 @@ namespace Voxel
 
         inline std::vector<VoxelRegion>& GetRevoxelRegions(const int i) { ASSERT(i >= 0 && i < CLIP_REGION_COUNT); return m_revoxelizationRegions[i]; }
 
+        // One entry per region voxelized by the last Voxelize.
+        inline const std::vector<RegionVoxelizationStats>& GetVoxelizationStats() const { return m_voxelizationStats; }
+
+        // Draws the last Voxelize took for all its regions.
+        inline uint32_t GetVoxelizationDraws() const { return m_voxelizationDraws; }
+
+        inline const BrickMapStats& GetBrickStats() const { return m_brickMap.GetStats(); }
+
+        inline const ClipmapUpdateStats& GetScheduleStats() const { return m_scheduler.GetStats(); }
+
+        // Bytes of the three brick atlases, and of the dense volumes with borders they replace.
+        uint64_t GetAtlasBytes() const;
+
+        static uint64_t GetDenseBytes();
+
     private:
 
-        void computeRevoxelizationRegionsClipmap(uint32_t clipmapLevel, const BoundingBox& curBBox);
+        // Moves the clip region to the camera's box and appends the slabs it moved into, see ClipmapPlanner.
+        void computeRevoxelizationRegionsClipmap(uint32_t clipmapLevel, const BoundingBox& curBBox, VoxelRegion& clipRegion);
 
         glm::ivec3 computeChangeDeltaV(uint32_t clipmapLevel, const BoundingBox& cameraRegionBBox);
 
+        // Appends the box of the level's gathered dynamic footprints inside the clip region.
+        void computeDynamicRegion(uint32_t clipmapLevel, const VoxelRegion& clipRegion);
+
+        // Creates the three atlases with room for the slots; their voxels start out empty.
+        void createAtlases(uint32_t capacity);
+
+        // Gives slots to the bricks of the planned regions that may hold geometry, uploads the indirection and clears
+        // the new bricks.
+        void updateBricks(ComputeContext& computeContext, const MeshBoundsSoA& dynamicMeshes, const MeshBoundsSoA& staticOccupancy);
+
+        // Gathers the baked bricks the regions of m_regionDraws touch, in m_clearRegions order.
+        void gatherBakedVoxels();
+
+        // Appends the regions to m_regionDraws and rebuilds m_clearRegions to match all of them.
+        void appendRegionDraws(const std::vector<VoxelRegion> (&regions)[CLIP_REGION_COUNT]);
+
+        // Opens, writes to or closes the trace as Voxel/Record Camera Path asks.
+        void recordClipmapTrace(const std::vector<BoundingBox>& bboxs);
+
         int m_minChange[CLIP_REGION_COUNT] = { 2, 2, 2, 2, 2, 1 };
 
+        std::vector<ClipmapBox> m_plannedSlabs;
+
+        ClipmapTraceRecorder m_clipmapTrace;
+
         std::vector<VoxelRegion> m_clipRegions;
 
         std::vector<VoxelRegion> m_revoxelizationRegions[CLIP_REGION_COUNT];
 
+        std::vector<VoxelRegion> m_dynamicRegions[CLIP_REGION_COUNT];
+
+        std::vector<VoxelClear::ClearRegion> m_clearRegions;
+
+        std::vector<VoxelizationPass::RegionDraw> m_regionDraws;
+
+        std::vector<RegionVoxelizationStats> m_voxelizationStats;
+
+        uint32_t m_voxelizationDraws{ 0 };
+
         bool m_forceFullRevoxelization{ false };
 
+        // Levels waiting for the scheduler to revoxelize them whole.
+        bool m_fullRevoxelization[CLIP_REGION_COUNT] = {};
+
+        ClipmapUpdateScheduler m_scheduler;
+
+        uint64_t m_frame{ 0 };
+
+        // The voxels the last Voxelize covered.
+        uint64_t m_voxelizedVoxels{ 0 };
+
+        // Per level, the box of the dynamic footprints since the level was last updated; empty when min > max.
+        Dagon::Vec3f m_footprintMin[CLIP_REGION_COUNT];
+
+        Dagon::Vec3f m_footprintMax[CLIP_REGION_COUNT];
+
+        VoxelCache m_bakedCache;
+
+        VoxelClear::BakedVoxels m_bakedVoxels;
+
+        bool m_usedBakedCache{ false };
+
+        BrickMap m_brickMap;
+
+        // Slots of the atlas textures, which lag the brick map's capacity by a frame when it grows.
+        uint32_t m_atlasCapacity{ 0 };
+
+        StructuredBuffer m_brickIndirection;
+
         Texture3D m_voxelOpacity;
 
         Texture3D m_voxelRadiance;
 
+        // The static models alone, kept across frames; only the regions the clipmap moves into are revoxelized.
+        Texture3D m_staticOpacity;
+
         VoxelVisualization::VoxelVisualize m_voxelvisualize;
 
         bool m_visualize;
@@ -17,21 +17,22 @@ namespace SceneView
 		s_world = this;
 	}
 
-	void World::AddModel(const std::string& filename)
+	void World::AddModel(const std::string& filename, Mobility mobility)
 	{
 		AssimpModel model;;
 		ASSERT(model.Load(filename.c_str()), "Failed to load model:" );
 		model.PrintInfo();
 		m_models.emplace_back(std::move(model));
+        m_modelMobility.push_back(mobility);
 
 	}
 
 	void World::Create()
 	{
 #if 1
-		AddModel("Models/box.obj");
-		AddModel("Models/sphere.obj");
-		AddModel("Models/capsule.obj");
+		AddModel("Models/box.obj", Mobility::Dynamic);
+		AddModel("Models/sphere.obj", Mobility::Dynamic);
+		AddModel("Models/capsule.obj", Mobility::Dynamic);
 		AddModel("Models/plane.obj");
 		AddModel("Models/sponza.h3d");
 #else
@@ -52,13 +53,17 @@ namespace SceneView
 
         UpdateClipBoundgingBoxs();
         m_voxelization.Init(m_clipRegionBBoxExtentL0, m_clip_bboxs);
+        // Bake it with Tools/VoxelBaker; without it every static model is rasterized.
+        m_voxelization.LoadBakedCache(L"Models/voxels.vxc");
+        BuildMeshBounds();
 	}
 
 	void World::Update(const float deltaT)
 	{
 		m_CameraController->Update(deltaT);
         UpdateClipBoundgingBoxs();
-        m_voxelization.Update(m_clip_bboxs);
+        UpdateDynamicFootprints();
+        m_voxelization.Update(m_clip_bboxs, m_dynamicFootprints);
         m_voxelization.ToggleVisualization(VoxelVisualize);
         const Vector3& cam_pos = m_Camera.GetPosition();
         EngineProfiling::SetCameraPosition(cam_pos.GetX(), cam_pos.GetY(), cam_pos.GetZ());
@@ -79,6 +84,56 @@ namespace SceneView
         m_clipRegionBBoxExtentL0 = std::max<float>(delta.GetZ(), std::max<float>(delta.GetX(), delta.GetY())) / std::exp2f(float(CLIP_REGION_COUNT-1));
 	}
 
+    void World::BuildMeshBounds()
+    {
+        // The meshes are not transformed, so the bounds are gathered once for every revoxelization to cull against.
+        for (auto& meshBounds : m_meshBounds)
+            meshBounds.Clear();
+        m_staticClusterBounds.Clear();
+        m_unbakedStaticBounds.Clear();
+        const VoxelCache& bakedCache = m_voxelization.GetBakedCache();
+        for (uint32_t modelIndex = 0; modelIndex < m_models.size(); ++modelIndex)
+        {
+            const AssimpModel& model = m_models[modelIndex];
+            MeshBoundsSoA& meshBounds = m_meshBounds[size_t(m_modelMobility[modelIndex])];
+            const bool unbakedStatic = m_modelMobility[modelIndex] == Mobility::Static && !bakedCache.HasModel(model.GetFileName());
+            for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; ++meshIndex)
+            {
+                const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+                Voxel::AddMeshBounds(meshBounds, mesh.boundingBox, modelIndex, meshIndex, mesh.indexCount / 3);
+                if (unbakedStatic)
+                    Voxel::AddMeshBounds(m_unbakedStaticBounds, mesh.boundingBox, modelIndex, meshIndex, mesh.indexCount / 3);
+            }
+            // Baked or not, the static models decide the bricks that get a slot.
+            if (m_modelMobility[modelIndex] != Mobility::Static)
+                continue;
+            for (const Model::Cluster& cluster : model.m_clusters)
+                Voxel::AddMeshBounds(m_staticClusterBounds, cluster.boundingBox, modelIndex, cluster.mesh, cluster.triangleCount);
+        }
+    }
+
+    void World::UpdateDynamicFootprints()
+    {
+        // A dynamic model that moved is cleared where it was and splatted where it is, so both boxes need
+        // revoxelizing.  One that kept its bounds is still in the voxels from the frame it was splatted, and the
+        // clipmap's own regions splat it wherever they reset the voxels, so it costs nothing.
+        m_dynamicFootprints.clear();
+        size_t dynamicIndex = 0;
+        for (size_t modelIndex = 0; modelIndex < m_models.size(); ++modelIndex)
+        {
+            if (m_modelMobility[modelIndex] != Mobility::Dynamic)
+                continue;
+            const BoundingBox& bounds = m_models[modelIndex].GetBoundingBox();
+            if (dynamicIndex == m_dynamicBounds.size())
+                m_dynamicBounds.push_back(bounds);
+            BoundingBox& previous = m_dynamicBounds[dynamicIndex++];
+            if (XMVector3Equal(previous.min, bounds.min) && XMVector3Equal(previous.max, bounds.max))
+                continue;
+            m_dynamicFootprints.emplace_back(Min(previous.min, bounds.min), Max(previous.max, bounds.max));
+            previous = bounds;
+        }
+    }
+
     const BoundingBox  World::GetClipBoundingBox(const int level) const
     {
         const Vector3 center = m_Camera.GetPosition();
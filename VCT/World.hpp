@@ -14,6 +14,13 @@ using namespace GameCore;
 
 namespace SceneView
 {
+    // Static models are voxelized once into the static cache, dynamic ones every frame where they are.
+    enum class Mobility
+    {
+        Static,
+        Dynamic
+    };
+
 	class World final
 	{
 	public:
@@ -29,7 +36,7 @@ namespace SceneView
 
         World& operator = (const World&) = delete;
 
-		void AddModel(const std::string& filename);
+		void AddModel(const std::string& filename, Mobility mobility = Mobility::Static);
 
 		void Create();
 
@@ -50,6 +57,10 @@ namespace SceneView
 
         inline Voxel::Voxelization& GetVoxelization() { return m_voxelization; }
 
+        inline const MeshBoundsSoA& GetMeshBounds(Mobility mobility) const noexcept { return m_meshBounds[size_t(mobility)]; }
+
+        inline Mobility GetMobility(size_t model) const noexcept { return m_modelMobility[model]; }
+
         [[nodiscard]]
 		NotNull<Lighting*> GetLighting() noexcept { return NotNull<Lighting*>(m_lighting.get()); }
 
@@ -64,7 +75,12 @@ namespace SceneView
 			}
 		}
 
-        void voxelize(GraphicsContext& context) { m_voxelization.Voxelize(context); }
+        // The static models of the baked voxel cache are splatted from it rather than rasterized.
+        void voxelize(GraphicsContext& context)
+        {
+            const MeshBoundsSoA& staticMeshes = m_voxelization.UsesBakedCache() ? m_unbakedStaticBounds : GetMeshBounds(Mobility::Static);
+            m_voxelization.Voxelize(context, staticMeshes, GetMeshBounds(Mobility::Dynamic), m_staticClusterBounds);
+        }
 
         void voxelVisualize(GraphicsContext& context) { m_voxelization.Visualize(context, m_Camera.GetViewProjMatrix()); };
 
@@ -76,6 +92,10 @@ namespace SceneView
 
 		void CaculateBoundingBox();
 
+        void BuildMeshBounds();
+
+        void UpdateDynamicFootprints();
+
 		Camera m_Camera;
 
 		const std::unique_ptr<Lighting> m_lighting;
@@ -91,5 +111,21 @@ namespace SceneView
         std::vector<BoundingBox> m_clip_bboxs;
 
         Voxel::Voxelization m_voxelization;
+
+        std::vector<Mobility> m_modelMobility;
+
+        MeshBoundsSoA m_meshBounds[2];
+
+        // The static models the baked voxel cache does not hold.
+        MeshBoundsSoA m_unbakedStaticBounds;
+
+        // The triangle clusters of the static models, which decide the bricks that get an atlas slot.
+        MeshBoundsSoA m_staticClusterBounds;
+
+        // Per dynamic model, the bounds it was voxelized at last frame.
+        std::vector<BoundingBox> m_dynamicBounds;
+
+        // For each dynamic model that moved since last frame, the box it covers now or covered then.
+        std::vector<BoundingBox> m_dynamicFootprints;
 	};
 }
@@ -1,44 +1,130 @@
 #include "voxelClear.hpp"
 #include "CompiledShaders/ClearClipMapCS.h"
+#include "CompiledShaders/RestoreClipMapCS.h"
+#include "CompiledShaders/ClearBricksCS.h"
+#include "CompiledShaders/BakedVoxelsCS.h"
+#include "BrickMap.h"
 
 namespace VoxelClear
 {
     RootSignature s_RootSignature;
     ComputePSO s_ClearVoxelCS;
+    ComputePSO s_RestoreVoxelCS;
+    ComputePSO s_BakedVoxelCS;
+    RootSignature s_BrickRootSignature;
+    ComputePSO s_ClearBricksCS;
 
-    ConstantBuffer cbv;
+    __declspec(align(16)) struct ConstantBuffer
+    {
+        uint32_t u_regionCount;
+        uint32_t u_voxelCount;
+        int u_resolution;
+    };
 
-    D3D12_CPU_DESCRIPTOR_HANDLE handle;
+    // Matches the [numthreads] of the shaders; a row of groups is kRowThreads voxels.
+    const uint32_t kGroupSize = 64;
+    const uint32_t kRowThreads = kGroupSize * 1024;
 
     void Initialize(void)
     {
-        s_RootSignature.Reset(2, 0);
+        s_RootSignature.Reset(8, 0);
         s_RootSignature[0].InitAsConstantBuffer(0);
-        s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+        s_RootSignature[1].InitAsBufferSRV(0);
+        s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+        s_RootSignature[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+        s_RootSignature[4].InitAsBufferSRV(2);
+        s_RootSignature[5].InitAsBufferSRV(3);
+        s_RootSignature[6].InitAsBufferSRV(4);
+        s_RootSignature[7].InitAsBufferSRV(5);
         s_RootSignature.Finalize(L"Reset Voxel");
         s_ClearVoxelCS.SetRootSignature(s_RootSignature);
         s_ClearVoxelCS.SetComputeShader(SHADER_ARGS(g_pClearClipMapCS));
         s_ClearVoxelCS.Finalize();
+        s_RestoreVoxelCS.SetRootSignature(s_RootSignature);
+        s_RestoreVoxelCS.SetComputeShader(SHADER_ARGS(g_pRestoreClipMapCS));
+        s_RestoreVoxelCS.Finalize();
+        s_BakedVoxelCS.SetRootSignature(s_RootSignature);
+        s_BakedVoxelCS.SetComputeShader(SHADER_ARGS(g_pBakedVoxelsCS));
+        s_BakedVoxelCS.Finalize();
+
+        s_BrickRootSignature.Reset(3, 0);
+        s_BrickRootSignature[0].InitAsConstants(0, 1);
+        s_BrickRootSignature[1].InitAsBufferSRV(0);
+        s_BrickRootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+        s_BrickRootSignature.Finalize(L"Clear Voxel Bricks");
+        s_ClearBricksCS.SetRootSignature(s_BrickRootSignature);
+        s_ClearBricksCS.SetComputeShader(SHADER_ARGS(g_pClearBricksCS));
+        s_ClearBricksCS.Finalize();
     }
 
-    void Apply(ComputeContext& context)
+    void Dispatch(ComputeContext& context, const ComputePSO& pso, const std::vector<ClearRegion>& regions, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV, const D3D12_CPU_DESCRIPTOR_HANDLE* staticOpacitySRV = nullptr,
+        const BakedVoxels* baked = nullptr)
     {
-        ASSERT(handle.ptr != D3D12_GPU_VIRTUAL_ADDRESS_NULL && handle.ptr != D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN);
+        ConstantBuffer cbv;
+        cbv.u_regionCount = static_cast<uint32_t>(regions.size());
+        cbv.u_voxelCount = ClipmapClear::CountVoxels(regions);
+        cbv.u_resolution = VOXEL_RESOLUTION;
+
+        D3D12_CPU_DESCRIPTOR_HANDLE handles[] = { opacityUAV, radianceUAV };
         context.SetRootSignature(s_RootSignature);
-        context.SetPipelineState(s_ClearVoxelCS);
+        context.SetPipelineState(pso);
         context.SetDynamicConstantBufferView(0, sizeof(cbv), &cbv);
-        context.SetDynamicDescriptor(1, 0, handle);
-        context.Dispatch3D(VOXEL_RESOLUTION, VOXEL_RESOLUTION, VOXEL_RESOLUTION,8,8,8);
+        context.SetDynamicSRV(1, regions.size() * sizeof(ClearRegion), regions.data());
+        context.SetDynamicDescriptors(2, 0, 2, handles);
+        context.SetBufferSRV(4, brickIndirection);
+        if (staticOpacitySRV != nullptr)
+            context.SetDynamicDescriptor(3, 0, *staticOpacitySRV);
+        if (baked != nullptr)
+        {
+            context.SetDynamicSRV(5, baked->regions.size() * sizeof(BakedRegion), baked->regions.data());
+            context.SetDynamicSRV(6, baked->brickEntries.size() * sizeof(uint32_t), baked->brickEntries.data());
+            context.SetDynamicSRV(7, baked->brickMasks.size() * sizeof(uint32_t), baked->brickMasks.data());
+        }
+        const uint32_t rows = (cbv.u_voxelCount + kRowThreads - 1) / kRowThreads;
+        context.Dispatch(kRowThreads / kGroupSize, rows);
+    }
+
+    void Apply(ComputeContext& context, const std::vector<ClearRegion>& regions, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV)
+    {
+        if (regions.empty())
+            return;
+        Dispatch(context, s_ClearVoxelCS, regions, brickIndirection, opacityUAV, radianceUAV);
+    }
+
+    void Restore(ComputeContext& context, const std::vector<ClearRegion>& regions, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE staticOpacitySRV, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV)
+    {
+        if (regions.empty())
+            return;
+        Dispatch(context, s_RestoreVoxelCS, regions, brickIndirection, opacityUAV, radianceUAV, &staticOpacitySRV);
     }
 
-    void SetConstantBuffer(ConstantBuffer buffer)
+    void ApplyBaked(ComputeContext& context, const std::vector<ClearRegion>& regions, const BakedVoxels& baked, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV)
     {
-        cbv = buffer;
+        // Nothing baked lies in the regions.
+        if (regions.empty() || baked.brickMasks.empty())
+            return;
+        ASSERT(baked.regions.size() == regions.size());
+        Dispatch(context, s_BakedVoxelCS, regions, brickIndirection, opacityUAV, radianceUAV, nullptr, &baked);
     }
 
-    void SetUAV(D3D12_CPU_DESCRIPTOR_HANDLE _handle)
+    void ClearBricks(ComputeContext& context, const std::vector<uint32_t>& slots, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV,
+        D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV, D3D12_CPU_DESCRIPTOR_HANDLE staticOpacityUAV)
     {
-        handle = _handle;
+        if (slots.empty())
+            return;
+        D3D12_CPU_DESCRIPTOR_HANDLE handles[] = { opacityUAV, radianceUAV, staticOpacityUAV };
+        context.SetRootSignature(s_BrickRootSignature);
+        context.SetPipelineState(s_ClearBricksCS);
+        context.SetConstants(0, static_cast<uint32_t>(slots.size()));
+        context.SetDynamicSRV(1, slots.size() * sizeof(uint32_t), slots.data());
+        context.SetDynamicDescriptors(2, 0, 3, handles);
+        // A row of groups per brick.
+        const uint32_t brickVoxels = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+        context.Dispatch(brickVoxels / kGroupSize, static_cast<uint32_t>(slots.size()));
     }
 
 }
\ No newline at end of file
@@ -1,31 +1,58 @@
-
 #pragma once
 #include "GameCore.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "Texture3D.h"
+#include "GpuBuffer.h"
+#include "ClipmapClear.h"
 
 using namespace Math;
 using namespace GameCore;
 
 namespace VoxelClear
 {
-    void Initialize(void);
+    // One region to clear.  Voxels are found in the brick atlas through the brick indirection, and those of bricks
+    // without a slot are skipped.
+    typedef ClipmapClearRegion ClearRegion;
 
-    void Apply(ComputeContext& context);
+    // Where the baked voxels of a clear region are, for ApplyBaked.  Mirrors BakedRegion in BakedVoxelsCS.hlsl.
+    __declspec(align(16)) struct BakedRegion
+    {
+        // The region's first voxel, in world voxel coordinates of its level.
+        glm::ivec3 u_voxelMin;
+        uint32_t u_firstEntry;
+        // The bricks of the cache the region touches.
+        glm::ivec3 u_brickMin;
+        uint32_t u_pad0;
+        glm::ivec3 u_brickDims;
+        uint32_t u_pad1;
+    };
 
-    __declspec(align(16)) struct ConstantBuffer
+    // The baked voxels of the regions of a dispatch: a BakedRegion per region, an entry per brick of those regions
+    // holding INVALID_BRICK or the brick's index in the masks, and kVoxelBrickWords mask words per brick.
+    struct BakedVoxels
     {
-        glm::ivec3 u_min;
-        int u_resolution;
-        int u_clipmapLevel;
-        glm::ivec3 u_extent;
-        int u_borderWidth = 1;
+        std::vector<BakedRegion> regions;
+        std::vector<uint32_t> brickEntries;
+        std::vector<uint32_t> brickMasks;
     };
 
-    void SetConstantBuffer(ConstantBuffer buffer);
+    void Initialize(void);
+
+    // Clears the opacity and radiance of every region in one dispatch.
+    void Apply(ComputeContext& context, const std::vector<ClearRegion>& regions, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV);
+
+    // Copies the static opacity cache into the opacity of every region and clears their radiance, in one dispatch.
+    void Restore(ComputeContext& context, const std::vector<ClearRegion>& regions, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE staticOpacitySRV, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV);
+
+    // Sets the voxels of every region the baked cache holds, in one dispatch.  The regions have to be cleared first.
+    void ApplyBaked(ComputeContext& context, const std::vector<ClearRegion>& regions, const BakedVoxels& baked, const GpuBuffer& brickIndirection,
+        D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV);
 
-    void SetUAV(D3D12_CPU_DESCRIPTOR_HANDLE _handle);
-    
+    // Clears every voxel of the atlas slots in all three atlases, in one dispatch.
+    void ClearBricks(ComputeContext& context, const std::vector<uint32_t>& slots, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV,
+        D3D12_CPU_DESCRIPTOR_HANDLE radianceUAV, D3D12_CPU_DESCRIPTOR_HANDLE staticOpacityUAV);
 
 }
@@ -5,6 +5,8 @@
 #include "CompiledShaders/ConservertiveVoxelPassPS.h"
 
 
+BoolVar CullVoxelizationDraws("Voxel/Cull Region Draws", true);
+
 namespace VoxelizationPass
 {
     RootSignature s_RootSignature;
@@ -12,10 +14,12 @@ namespace VoxelizationPass
 
     void Initialize(void)
     {
-        s_RootSignature.Reset(3, 0);
-        s_RootSignature[0].InitAsConstantBuffer(0,D3D12_SHADER_VISIBILITY_GEOMETRY);
+        s_RootSignature.Reset(5, 0);
+        s_RootSignature[0].InitAsConstants(0, 1, D3D12_SHADER_VISIBILITY_VERTEX);
         s_RootSignature[1].InitAsConstantBuffer(1, D3D12_SHADER_VISIBILITY_PIXEL);
         s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+        s_RootSignature[3].InitAsBufferSRV(0, D3D12_SHADER_VISIBILITY_ALL);
+        s_RootSignature[4].InitAsBufferSRV(1, D3D12_SHADER_VISIBILITY_PIXEL);
         s_RootSignature.Finalize(L"Voxelization", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
         s_voxelPSO.SetRootSignature(s_RootSignature);
         s_voxelPSO.SetVertexShader(SHADER_ARGS(g_pConservertiveVoxelPassVS));
@@ -43,35 +47,16 @@ namespace VoxelizationPass
         s_voxelPSO.Finalize();
     }
 
-    voxelizationGSCBuffer s_gsbuffer;
     voxelizationPSCBuffer s_psbuffer;
+    std::vector<RegionInfo> s_regionInfos;
+    std::vector<uint32_t> s_visibleMeshes;
+    std::vector<uint32_t> s_meshRegionMasks;
+    std::vector<uint32_t> s_meshRegionCounts;
+
+    // Every region is rasterized into the same square viewport, one pixel per voxel of its level, large enough
+    // for a full clipmap level with its border.
+    const uint32_t kViewportSize = VOXEL_RESOLUTION + 2;
 
-    void setViewports(GraphicsContext& context, const Dagon::Vec3f viewportSize)
-    {
-        F32x2 viewportSizes[3];
-        viewportSizes[0] = F32x2{ viewportSize.z, viewportSize.y };
-        viewportSizes[1] = F32x2{ viewportSize.x, viewportSize.z };
-        viewportSizes[2] = F32x2{ viewportSize.x, viewportSize.y };
-        D3D12_VIEWPORT viewports[3];
-        D3D12_RECT rects[3];
-        for (int i = 0; i < 3; i++)
-        {
-            viewports[i].Width = viewportSizes[i][0];
-            viewports[i].Height = viewportSizes[i][1];
-            viewports[i].MinDepth = 0.0f;
-            viewports[i].MaxDepth = 1.0f;
-            viewports[i].TopLeftX = 0.0f;
-            viewports[i].TopLeftY = 0.0f;
-            rects[i].left = 0;
-            rects[i].top = 0;
-            rects[i].right = (LONG)viewportSizes[i][0];
-            rects[i].bottom = (LONG)viewportSizes[i][1];
-        }
-        context.SetViewportAndScissors(3, viewports, rects);
-        memcpy(s_gsbuffer.u_viewportSizes, viewportSizes, 3 * sizeof(F32x2));
-    }
-    
-   
     Math::Matrix4 LookAt(Dagon::Vec3f Eye, Dagon::Vec3f LookAt, Dagon::Vec3f LookUp)
     {
         XMVECTOR EyeV = XMVectorSet(Eye.x, Eye.y, Eye.z, 0.0f);
@@ -81,17 +66,19 @@ namespace VoxelizationPass
         return Math::Matrix4(View);
     }
 
-    void SetViewProjectionMatris(const VoxelRegion& voxelRegion)
+    void SetViewProjectionMatris(const VoxelRegion& voxelRegion, RegionInfo& info)
     {
         Dagon::Vec3f size = voxelRegion.getExtentWorld();
+        // The region keeps the corner of the viewport it had when the viewport was its own size; the rest of the
+        // window is empty space the geometry shader and the region test in the pixel shader keep clear.
+        const float window = kViewportSize * voxelRegion.voxelSize;
         Matrix4 proj[3];
 
-        proj[0] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.z, 0.0f, 0.0f, size.y, 0.0f, size.x));
-        proj[1] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.x, 0.0f, 0.0f, size.z, 0.0f, size.y));
-        proj[2] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.x, 0.0f, 0.0f, size.y, 0.0f, size.z));
+        proj[0] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.z, window - size.z, 0.0f, window, 0.0f, size.x));
+        proj[1] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.x, window - size.x, 0.0f, window, 0.0f, size.y));
+        proj[2] = Matrix4(XMMatrixOrthographicOffCenterRH(-size.x, window - size.x, 0.0f, window, 0.0f, size.z));
 
         Matrix4 viewProj[3];
-        Matrix4 viewProjInv[3];
 
         Dagon::Vec3f xyStart = voxelRegion.getMinPosWorld() + glm::vec3(0.0f, 0.0f, size.z);
 
@@ -100,12 +87,7 @@ namespace VoxelizationPass
         viewProj[2] = LookAt(voxelRegion.getMinPosWorld(), voxelRegion.getMinPosWorld() + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
         for (int i = 0; i < 3; ++i)
-        {
-            viewProj[i] = proj[i] * viewProj[i];
-            viewProjInv[i] = Math::Invert(viewProj[i]);
-        }
-        memcpy(s_gsbuffer.u_viewProj, viewProj, 3 * sizeof(Matrix4));
-        memcpy(s_gsbuffer.u_viewProjInv, viewProjInv, 3 * sizeof(Matrix4));
+            info.u_viewProj[i] = proj[i] * viewProj[i];
     }
     
     F32x3 convertFormat(Dagon::Vec3f v)
@@ -113,56 +95,112 @@ namespace VoxelizationPass
         return F32x3{v.x, v.y, v.z };
     }
 
-    void Render(GraphicsContext& context, const VoxelRegion& voxelRegion, const int clip_level)
+    // Draws the meshes into up to kMaxRegions regions, one bit of the region mask each.
+    uint32_t RenderRegions(GraphicsContext& context, const RegionDraw* regions, uint32_t regionCount, const MeshBoundsSoA& meshBounds,
+        std::vector<RegionVoxelizationStats>& stats)
     {
+        ASSERT(regionCount <= kMaxRegions);
         SceneView::World * world = SceneView::World::Get();
         std::vector<VoxelRegion>& clipRegions = world->GetVoxelization().GetClieRegions();
-        Dagon::Vec3f regionMinWorld = voxelRegion.getMinPosWorld() - Dagon::EPSILON5;
-        Dagon::Vec3f regionMaxWorld = voxelRegion.getMaxPosWorld() + Dagon::EPSILON5;
 
-        VoxelRegion extendedRegion = voxelRegion;
-        extendedRegion.extent = voxelRegion.extent + 2;
-        extendedRegion.minPos -= 1;
+        s_regionInfos.resize(regionCount);
+        s_meshRegionMasks.assign(meshBounds.GetMeshCount(), 0);
+        s_meshRegionCounts.assign(meshBounds.GetMeshCount(), 0);
+        for (uint32_t r = 0; r < regionCount; ++r)
+        {
+            const VoxelRegion& voxelRegion = regions[r].region;
+            const uint32_t clip_level = regions[r].clipmapLevel;
+
+            VoxelRegion extendedRegion = voxelRegion;
+            extendedRegion.extent = voxelRegion.extent + 2;
+            extendedRegion.minPos -= 1;
+
+            RegionInfo& info = s_regionInfos[r];
+            SetViewProjectionMatris(extendedRegion, info);
+            info.u_regionMin = convertFormat(voxelRegion.getMinPosWorld() - Dagon::EPSILON5);
+            info.u_regionMax = convertFormat(voxelRegion.getMaxPosWorld() + Dagon::EPSILON5);
+            info.u_clipmapLevel = clip_level;
+            info.u_voxelSize = clipRegions[clip_level].voxelSize;
+            // The extended region's box includes the border voxel the rasterizer covers around the region.
+            info.u_cullMin = convertFormat(extendedRegion.getMinPosWorld());
+            info.u_cullMax = convertFormat(extendedRegion.getMaxPosWorld());
+            info.u_maxExtent = clipRegions[clip_level].getExtentWorld().x;
+
+            s_visibleMeshes.clear();
+            if (CullVoxelizationDraws)
+            {
+                CullMeshBounds(meshBounds, extendedRegion, s_visibleMeshes);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < meshBounds.GetMeshCount(); ++i)
+                    s_visibleMeshes.push_back(i);
+            }
 
-        setViewports(context, Dagon::Vec3f(extendedRegion.extent));
-        SetViewProjectionMatris( extendedRegion);
+            RegionVoxelizationStats regionStats = {};
+            regionStats.clipmapLevel = clip_level;
+            regionStats.meshes = static_cast<uint32_t>(s_visibleMeshes.size());
+            regionStats.culledMeshes = meshBounds.GetMeshCount() - regionStats.meshes;
+            for (uint32_t index : s_visibleMeshes)
+            {
+                s_meshRegionMasks[index] |= 1u << r;
+                s_meshRegionCounts[index]++;
+                regionStats.triangles += meshBounds.GetMesh(index).triangleCount;
+            }
+            stats.push_back(regionStats);
+        }
 
-        s_psbuffer.u_regionMin = convertFormat(regionMinWorld);
-        s_psbuffer.u_regionMax = convertFormat(regionMaxWorld);
-        s_psbuffer.u_clipmapLevel = clip_level;
-        s_psbuffer.u_maxExtent = clipRegions[clip_level].getExtentWorld().x;
-        s_psbuffer.u_voxelSize = clipRegions[clip_level].voxelSize;
-        s_psbuffer.u_clipmapResolution = VOXEL_RESOLUTION;
-        s_psbuffer.u_clipmapResolutionWithBorder = VOXEL_RESOLUTION + 2;
+        context.SetDynamicSRV(3, s_regionInfos.size() * sizeof(RegionInfo), s_regionInfos.data());
 
-        if (clip_level > 0)
+        // Meshes are in model order, so the buffers only change between models.
+        uint32_t currentModel = ~0u;
+        uint32_t draws = 0;
+        for (uint32_t index = 0; index < meshBounds.GetMeshCount(); ++index)
         {
-            s_psbuffer.u_prevRegionMin = convertFormat(clipRegions[clip_level - 1].getMinPosWorld());
-            s_psbuffer.u_prevRegionMax = convertFormat(clipRegions[clip_level - 1].getMaxPosWorld());
-      
+            if (s_meshRegionMasks[index] == 0)
+                continue;
+            const MeshBoundsSoA::MeshRef& ref = meshBounds.GetMesh(index);
+            const Model& model = world->m_models[ref.model];
+            if (ref.model != currentModel)
+            {
+                context.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
+                context.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
+                currentModel = ref.model;
+            }
+            const Model::Mesh& mesh = model.m_pMesh[ref.mesh];
+            uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
+            uint32_t baseVertex = mesh.vertexDataByteOffset / model.m_VertexStride;
+            context.SetConstants(0, s_meshRegionMasks[index]);
+            context.DrawIndexedInstanced(mesh.indexCount, s_meshRegionCounts[index], startIndex, baseVertex, 0);
+            draws++;
         }
+        return draws;
+    }
+
+    uint32_t Render(GraphicsContext& context, const std::vector<RegionDraw>& regions, const MeshBoundsSoA& meshBounds,
+        const GpuBuffer& brickIndirection, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, std::vector<RegionVoxelizationStats>& stats)
+    {
+        if (regions.empty())
+            return 0;
+
+        s_psbuffer.u_clipmapResolution = VOXEL_RESOLUTION;
+
         context.SetRootSignature(s_RootSignature);
         context.SetPipelineState(s_voxelPSO);
-        context.SetDynamicConstantBufferView(0, sizeof(s_gsbuffer), &s_gsbuffer);
+        context.SetViewportAndScissor(0, 0, kViewportSize, kViewportSize);
         context.SetDynamicConstantBufferView(1, sizeof(s_psbuffer), &s_psbuffer);
-        context.SetDynamicDescriptor(2, 0, world->GetVoxelization().VoxelOpacityUAV());
+        context.SetDynamicDescriptor(2, 0, opacityUAV);
+        context.SetBufferSRV(4, brickIndirection);
+        context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        SceneView::World::Get()->ForEach([&](Model &model)
+        // The region mask has a bit per region, so longer lists are drawn kMaxRegions regions at a time.
+        uint32_t draws = 0;
+        for (size_t first = 0; first < regions.size(); first += kMaxRegions)
         {
-            uint32_t VertexStride = model.m_VertexStride;
-            context.SetRootSignature(s_RootSignature);
-            context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            context.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
-            context.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
-            for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
-            {
-                const Model::Mesh& mesh = model.m_pMesh[meshIndex];
-                uint32_t indexCount = mesh.indexCount;
-                uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
-                uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
-                context.DrawIndexed(indexCount, startIndex, baseVertex);
-            }
-        });
+            const uint32_t regionCount = static_cast<uint32_t>(std::min<size_t>(regions.size() - first, kMaxRegions));
+            draws += RenderRegions(context, regions.data() + first, regionCount, meshBounds, stats);
+        }
+        return draws;
     }
 
 
@@ -5,7 +5,9 @@
 #include "GameCore.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
+#include "GpuBuffer.h"
 #include "VoxelRegion.hpp"
+#include "VoxelRegionCulling.hpp"
 
 using namespace Math;
 using namespace GameCore;
@@ -13,34 +15,41 @@ using namespace Voxel;
 
 namespace VoxelizationPass
 {
+    // A region to revoxelize and the clipmap level it belongs to.
+    struct RegionDraw
+    {
+        VoxelRegion region;
+        uint32_t clipmapLevel;
+    };
+
+    // Each draw routes a mesh to the regions it overlaps through a bit mask, so a pass covers at most this many.
+    static const uint32_t kMaxRegions = 32;
+
     void Initialize(void);
 
-    void Render(GraphicsContext& context, const VoxelRegion& region, const int clip_level);
+    // Voxelizes the meshes into the regions of the opacity atlas, kMaxRegions regions a pass: every mesh that overlaps
+    // at least one region of a pass is drawn once, instanced over the regions it overlaps.  Appends one stats entry
+    // per region and returns the number of draws.
+    uint32_t Render(GraphicsContext& context, const std::vector<RegionDraw>& regions, const MeshBoundsSoA& meshBounds,
+        const GpuBuffer& brickIndirection, D3D12_CPU_DESCRIPTOR_HANDLE opacityUAV, std::vector<RegionVoxelizationStats>& stats);
 
-    __declspec(align(16)) struct voxelizationGSCBuffer
+    // Mirrors RegionInfo in VoxelizationRegions.hlsli.
+    __declspec(align(16)) struct RegionInfo
     {
         Matrix4 u_viewProj[3];
-        Matrix4 u_viewProjInv[3];
-        F32x2   u_viewportSizes[3]; 
+        F32x3 u_regionMin;
+        int u_clipmapLevel;
+        F32x3 u_regionMax;
+        float u_voxelSize;
+        F32x3 u_cullMin;
+        float u_maxExtent;
+        F32x3 u_cullMax;
+        float _;
     };
 
     __declspec(align(16)) struct voxelizationPSCBuffer
     {
-        int u_clipmapLevel;
         int u_clipmapResolution;
-        int u_clipmapResolutionWithBorder;
-        int _;
-        F32x3 u_regionMin;
-        float __;
-        F32x3 u_regionMax;
-        float ___;
-        F32x3 u_prevRegionMin;
-        float ____;
-        F32x3 u_prevRegionMax;
-        float _____;
-        float u_downsampleTransitionRegionSize;
-        float u_maxExtent;
-        float u_voxelSize;
     };
 
 }
@@ -0,0 +1,43 @@
+//
+// Writes the virtual texture page each pixel samples into the low resolution feedback target.  The CPU reads it
+// back and builds the tile requests from it, see TileFeedbackAggregator.
+//
+
+#include "ModelViewerRS.hlsli"
+
+struct VSOutput
+{
+    float4 position : SV_Position;
+    float3 worldPos : WorldPos;
+    float2 uv : TexCoord0;
+    float3 viewDir : TexCoord1;
+    float3 shadowCoord : TexCoord2;
+    float3 normal : Normal;
+    float3 tangent : Tangent;
+    float3 bitangent : Bitangent;
+};
+
+cbuffer TexlInfo: register(b1)
+{
+    uint maxLod;
+    uint active_mip;
+    uint Size;
+    uint pageSize;
+};
+
+[RootSignature(ModelViewer_RootSig)]
+uint main(VSOutput vsOutput) : SV_Target0
+{
+    // Derivatives here span 2^TILE_FEEDBACK_DOWNSCALE_LOG2 screen pixels, so the mip the full resolution pass
+    // samples is that many levels finer.
+    float2 texel = vsOutput.uv * Size;
+    float2 dx = ddx(texel);
+    float2 dy = ddy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) - TILE_FEEDBACK_DOWNSCALE_LOG2;
+    uint mip = (uint)clamp(floor(lod), 0.0, (float)maxLod);
+
+    uint pageCount = max((Size / pageSize) >> mip, 1);
+    uint2 page = min(uint2(frac(vsOutput.uv) * pageCount), pageCount - 1);
+
+    return TILE_FEEDBACK_VALID_BIT | (mip << TILE_FEEDBACK_MIP_SHIFT) | (page.y << TILE_FEEDBACK_Y_SHIFT) | page.x;
+}
@@ -38,7 +38,6 @@ Texture2D<float4> texTiled        : register(t2);
 Texture2D<float3> texNormal            : register(t3);
 //Texture2D<float4> texLightmap        : register(t4);
 //Texture2D<float4> texReflection    : register(t5);
-RWStructuredBuffer<uint> VisibilityBuffer : register(u1);
 cbuffer TexlInfo: register(b1)
 {
     uint maxLod;
@@ -74,17 +73,6 @@ float3 main(VSOutput vsOutput) : SV_Target0
             break;
 
     } while (!CheckAccessFullyMapped(residencyCode));
-   uint pageOffset = 0;
 
-   uint pageCount = Size / pageSize;
-   for (int i = 1; i <= int(minLod); i++)
-   {
-       pageOffset += pageCount * pageCount;
-       pageCount = pageCount / 2;
-   }
-
-   pageOffset += uint(float(pageCount) *  vsOutput.uv.x) + uint(float(pageCount) *  vsOutput.uv.y) * pageCount;
-   VisibilityBuffer[pageOffset] = 1;
-  
     return color.xyz;
 }
@@ -19,7 +19,6 @@
     ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_CAMERA, SHADER_VISIBILITY_VERTEX) ", " \
     ADD_CBUFFER_VIEW_VISIBILITY(SLOT_CBUFFER_WORLD, SHADER_VISIBILITY_VERTEX) ", " \
    "DescriptorTable(SRV(t0, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
-    "DescriptorTable(UAV(u1, numDescriptors = 1)), "\
     "RootConstants(b1, num32BitConstants = 4, visibility = SHADER_VISIBILITY_PIXEL), " \
     "StaticSampler(s0, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s1, visibility = SHADER_VISIBILITY_PIXEL," \
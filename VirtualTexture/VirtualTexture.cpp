@@ -35,6 +35,7 @@
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
 #include "TiledTexture.h"
+#include "CameraPredictor.h"
 
 // To enable wave intrinsics, uncomment this macro and #define DXIL in Core/GraphcisCore.cpp.
 // Run CompileSM6Test.bat to compile the relevant shaders with DXC.
@@ -44,6 +45,7 @@
 #include "CompiledShaders/DepthViewerPS.h"
 #include "CompiledShaders/ModelViewerVS.h"
 #include "CompiledShaders/ModelViewerPS.h"
+#include "CompiledShaders/FeedbackPS.h"
 #ifdef _WAVE_OP
 #include "CompiledShaders/DepthViewerVS_SM6.h"
 #include "CompiledShaders/ModelViewerVS_SM6.h"
@@ -63,7 +65,6 @@ enum RootParams
 {
 	CameraParam,
 	MaterialsSRVs,
-    VisibilitiUAVs,
 	PerModelConstant,
 	WorldParam,
 	NumPassRootParams,
@@ -89,12 +90,16 @@ public:
 
     virtual void Update( float deltaT ) override;
     virtual void RenderScene( void ) override;
+    virtual void RenderUI( GraphicsContext& gfxContext ) override;
 
  
 
 private:
 
     void UpdateGpuWorld(GraphicsContext& gfxContext);
+    void CreateTiledTexture(void);
+    // Drives the camera along the recorded path.  Returns the frame time the path recorded.
+    float UpdateCameraPathReplay(void);
 
     enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0 };
     void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll);
@@ -106,6 +111,7 @@ private:
     RootSignature m_RootSig;
     GraphicsPSO m_DepthPSO;
     GraphicsPSO m_ForwardPlusPSO;
+    GraphicsPSO m_FeedbackPSO;
 #ifdef _WAVE_OP
     GraphicsPSO m_DepthWaveOpsPSO;
     GraphicsPSO m_ModelWaveOpsPSO;
@@ -120,6 +126,18 @@ private:
     ShadowCamera m_SunShadow;
 
     TiledTexture m_tiledTexture;
+    // Stream Tile Archive as of the last CreateTiledTexture.
+    bool m_streamingTileArchive = false;
+    CameraPredictor m_cameraPredictor;
+
+    // Camera path replay plays the recorded path once with prefetching off and once with it on, starting each pass
+    // from an empty tile pool, and reports the share of feedback samples that missed.
+    std::vector<CameraPathFrame> m_cameraPath;
+    bool m_recordingCameraPath = false;
+    U32 m_replayFrame = 0;
+    U32 m_replayPass = 0;
+    bool m_replayPrefetch = true;
+    float m_replayMissRate[2] = { -1.0f, -1.0f };
 };
 
 CREATE_APPLICATION(VirtureTexture)
@@ -136,6 +154,13 @@ NumVar ShadowDimX("Application/Lighting/Shadow Dim X", 5000, 1000, 10000, 100 );
 NumVar ShadowDimY("Application/Lighting/Shadow Dim Y", 3000, 1000, 10000, 100 );
 NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 1000, 10000, 100 );
 
+NumVar TilePrefetchLead("Application/Virtual Texture/Prefetch Lead (s)", 0.25f, 0.0f, 2.0f, 0.05f);
+BoolVar RecordCameraPath("Application/Virtual Texture/Record Camera Path", false);
+BoolVar ReplayCameraPath("Application/Virtual Texture/Replay Camera Path", false);
+BoolVar StreamTileArchive("Application/Virtual Texture/Stream Tile Archive", true);
+const wchar_t* const kTileArchivePath = L"StreamingAssets.vta";
+extern BoolVar EnableTilePrefetch;
+
 #ifdef _WAVE_OP
 BoolVar EnableWaveOps("Application/Forward+/Enable Wave Ops", true);
 #endif
@@ -156,7 +181,6 @@ void VirtureTexture::Startup( void )
     m_RootSig.InitStaticSampler(1, SamplerShadowDesc, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::CameraParam].InitAsConstantBuffer(SLOT_CBUFFER_CAMERA, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig[RootParams::MaterialsSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[RootParams::VisibilitiUAVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV,1, 1, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[RootParams::PerModelConstant].InitAsConstants(1, 4, D3D12_SHADER_VISIBILITY_PIXEL);
 	m_RootSig[RootParams::WorldParam].InitAsConstantBuffer(SLOT_CBUFFER_WORLD, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig.Finalize(L"ModelViewer", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -194,6 +218,14 @@ void VirtureTexture::Startup( void )
 	m_ForwardPlusPSO.SetPixelShader(SHADER_ARGS(g_pModelViewerPS));
     m_ForwardPlusPSO.Finalize();
 
+    // Virtual texture feedback, rendered at low resolution with its own depth
+    const DXGI_FORMAT FeedbackFormat = TiledTexture::kFeedbackFormat;
+    m_FeedbackPSO = m_ForwardPlusPSO;
+    m_FeedbackPSO.SetDepthStencilState(DepthStateReadWrite);
+    m_FeedbackPSO.SetRenderTargetFormats(1, &FeedbackFormat, TiledTexture::kFeedbackDepthFormat);
+    m_FeedbackPSO.SetPixelShader(SHADER_ARGS(g_pFeedbackPS));
+    m_FeedbackPSO.Finalize();
+
 
 
 
@@ -227,8 +259,36 @@ void VirtureTexture::Startup( void )
     SSAO::Enable = false;
 
     SkyPass::Initialize();
+    CreateTiledTexture();
+}
+
+// The format the tiles of an archive are sampled in.
+static DXGI_FORMAT GetTileArchiveFormat( uint32_t codec )
+{
+    switch (codec)
+    {
+    case kTileCodecBC1: return DXGI_FORMAT_BC1_UNORM;
+    case kTileCodecBC3: return DXGI_FORMAT_BC3_UNORM;
+    case kTileCodecBC7: return DXGI_FORMAT_BC7_UNORM;
+    default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+void VirtureTexture::CreateTiledTexture( void )
+{
+    // Tiles stream from the archive in the format of its codec; "TileBaker StreamingAssets.tga -format bc7" takes a
+    // quarter of the memory and upload bandwidth of RGBA8.  Without the archive, or with Stream Tile Archive off, the
+    // tiles are generated as a checkerboard.
+    m_streamingTileArchive = StreamTileArchive;
+    TileArchive archive;
+    if (StreamTileArchive && archive.Open(kTileArchivePath))
+    {
+        const TileArchiveHeader header = archive.GetHeader();
+        archive.Close();
+        m_tiledTexture.Create(kTileArchivePath, header.width, header.height, GetTileArchiveFormat(header.codec));
+        return;
+    }
     m_tiledTexture.Create(L"", TEXTURETILESIZE*TILENUMBER1D, TEXTURETILESIZE*TILENUMBER1D, DXGI_FORMAT_R8G8B8A8_UNORM);
-    //m_tiledTexture.Create(L"StreamingAssets", TEXTURETILESIZE*TILENUMBER1D, TEXTURETILESIZE*TILENUMBER1D, DXGI_FORMAT_R8G8B8A8_UNORM);
 }
 
 void VirtureTexture::Cleanup( void )
@@ -246,6 +306,12 @@ void VirtureTexture::Update( float deltaT )
 {
     ScopedTimer _prof(L"Update State");
 
+    if (StreamTileArchive != m_streamingTileArchive)
+    {
+        g_CommandManager.IdleGPU();
+        CreateTiledTexture();
+    }
+
     if (GameInput::IsFirstPressed(GameInput::kLShoulder))
         DebugZoom.Decrement();
     else if (GameInput::IsFirstPressed(GameInput::kRShoulder))
@@ -258,7 +324,38 @@ void VirtureTexture::Update( float deltaT )
     {
         m_tiledTexture.LevelDown();
     }
-	m_world.Update(deltaT);
+    if (ReplayCameraPath)
+    {
+        deltaT = UpdateCameraPathReplay();
+    }
+    else
+    {
+        if (m_replayFrame != 0 || m_replayPass != 0)
+        {
+            // The replay was switched off part way through.
+            m_replayFrame = m_replayPass = 0;
+            m_cameraPath.clear();
+            EnableTilePrefetch = m_replayPrefetch;
+        }
+        m_world.Update(deltaT);
+        const Camera& camera = m_world.GetMainCamera();
+        if (RecordCameraPath)
+        {
+            CameraPathFrame frame = { deltaT };
+            XMStoreFloat3(&frame.position, camera.GetPosition());
+            XMStoreFloat4(&frame.rotation, camera.GetRotation());
+            m_cameraPath.push_back(frame);
+            m_recordingCameraPath = true;
+        }
+        else if (m_recordingCameraPath)
+        {
+            if (!SaveCameraPath(L"CameraPath.bin", m_cameraPath))
+                Utility::Printf(L"Couldn't save CameraPath.bin\n");
+            m_cameraPath.clear();
+            m_recordingCameraPath = false;
+        }
+    }
+    m_cameraPredictor.Update(m_world.GetMainCamera(), deltaT);
 
     float costheta = cosf(m_SunOrientation);
     float sintheta = sinf(m_SunOrientation);
@@ -287,6 +384,55 @@ void VirtureTexture::Update( float deltaT )
     m_MainScissor.bottom = (LONG)g_SceneColorBuffer.GetHeight();
 }
 
+float VirtureTexture::UpdateCameraPathReplay( void )
+{
+    if (m_replayFrame == 0 && m_replayPass == 0)
+    {
+        if (!LoadCameraPath(L"CameraPath.bin", m_cameraPath) || m_cameraPath.empty())
+        {
+            Utility::Printf(L"Couldn't load CameraPath.bin\n");
+            ReplayCameraPath = false;
+            return 0.0f;
+        }
+        m_replayPrefetch = EnableTilePrefetch;
+        m_replayMissRate[0] = m_replayMissRate[1] = -1.0f;
+    }
+
+    if (m_replayFrame == m_cameraPath.size())
+    {
+        // Feedback trails the camera by a few frames, which both passes share.
+        const TileResidencyStats& stats = m_tiledTexture.GetResidency().GetStats();
+        m_replayMissRate[m_replayPass] = stats.feedbackSamples ? float(double(stats.missedSamples) / double(stats.feedbackSamples)) : 0.0f;
+        Utility::Printf("Camera path replay, prefetch %s: %.2f%% of %llu feedback samples missed, %llu prefetches cancelled\n",
+            m_replayPass ? "on" : "off", m_replayMissRate[m_replayPass] * 100.0f, stats.feedbackSamples, stats.cancelledPrefetches);
+        m_replayFrame = 0;
+        if (++m_replayPass == 2)
+        {
+            m_replayPass = 0;
+            m_cameraPath.clear();
+            EnableTilePrefetch = m_replayPrefetch;
+            ReplayCameraPath = false;
+            return 0.0f;
+        }
+    }
+
+    if (m_replayFrame == 0)
+    {
+        // Both passes start from nothing but what the first frames request.
+        EnableTilePrefetch = m_replayPass == 1;
+        g_CommandManager.IdleGPU();
+        CreateTiledTexture();
+        m_cameraPredictor.Reset();
+    }
+
+    const CameraPathFrame& frame = m_cameraPath[m_replayFrame++];
+    Camera& camera = m_world.GetMainCamera();
+    camera.SetRotation(Quaternion(XMLoadFloat4(&frame.rotation)));
+    camera.SetPosition(Vector3(frame.position));
+    camera.Update();
+    return frame.deltaT;
+}
+
 __declspec(align(16))struct CameraBufferConstant
 {
     Matrix4 modelToProjection;
@@ -325,7 +471,6 @@ void VirtureTexture::RenderObjects(GraphicsContext& gfxContext, const Matrix4& v
 {
 
 	cameraConstant.modelToProjection = viewProjMat;
-    gfxContext.TransitionResource(m_tiledTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, true);
 	gfxContext.SetDynamicConstantBufferView(RootParams::CameraParam, sizeof(cameraConstant), &cameraConstant);
 
 	uint32_t materialIdx = 0xFFFFFFFFul;
@@ -354,7 +499,6 @@ void VirtureTexture::RenderObjects(GraphicsContext& gfxContext, const Matrix4& v
 				materialIdx = mesh.materialIndex;
 				gfxContext.SetDynamicDescriptors(RootParams::MaterialsSRVs, 0, 6, model.GetSRVs(materialIdx));
                 gfxContext.SetDynamicDescriptor(RootParams::MaterialsSRVs, 2, m_tiledTexture.GetSRV());
-                gfxContext.SetDynamicDescriptor(RootParams::VisibilitiUAVs, 0, m_tiledTexture.GetVisibilityUAV());
 			}
 
 			gfxContext.SetConstants(RootParams::PerModelConstant, m_tiledTexture.GetMipsLevel(), m_tiledTexture.GetActiveMip(),m_tiledTexture.GetVirtualWidth(),m_tiledTexture.GetTiledWidth());
@@ -406,6 +550,19 @@ void VirtureTexture::RenderScene( void )
     }
 
 
+    {
+        ScopedTimer _prof(L"Tile Feedback", gfxContext);
+        m_tiledTexture.BeginFeedback(gfxContext);
+        gfxContext.SetPipelineState(m_FeedbackPSO);
+        RenderObjects(gfxContext, camViewProjMat, kOpaque);
+        if (m_tiledTexture.BeginPrefetchFeedback(gfxContext))
+        {
+            const Camera predicted = m_cameraPredictor.Predict(m_world.GetMainCamera(), TilePrefetchLead);
+            RenderObjects(gfxContext, predicted.GetViewProjMatrix(), kOpaque);
+        }
+        m_tiledTexture.EndFeedback(gfxContext);
+    }
+
     if (!SSAO::DebugDraw)
     {
         ScopedTimer _prof(L"Main Render", gfxContext);
@@ -470,6 +627,43 @@ void VirtureTexture::RenderScene( void )
     else
         MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
 
-    gfxContext.Finish();
+    m_tiledTexture.EndFrame(gfxContext.Finish());
 }
 
+void VirtureTexture::RenderUI( GraphicsContext& gfxContext )
+{
+    const TileUploadStats& stats = m_tiledTexture.GetUploadStats();
+    const TileResidencyStats& residency = m_tiledTexture.GetResidency().GetStats();
+    TextContext Text(gfxContext);
+    Text.Begin();
+    Text.ResetCursor(10.0f, 880.0f);
+    Text.DrawFormattedString("Tiles uploaded: %u this frame, %llu total  Resident: %u of %u\n",
+        stats.tilesLastFrame, stats.tilesUploaded,
+        m_tiledTexture.GetTilePool().GetResidentCount(), m_tiledTexture.GetTilePool().GetCapacity());
+    Text.DrawString("Upload latency (ms):");
+    for (U32 bucket = 0; bucket < TileUploadStats::kLatencyBuckets; bucket++)
+    {
+        if (bucket + 1 < TileUploadStats::kLatencyBuckets)
+            Text.DrawFormattedString("  <%u: %u", 1u << bucket, stats.latencyHistogram[bucket]);
+        else
+            Text.DrawFormattedString("  more: %u", stats.latencyHistogram[bucket]);
+    }
+    Text.DrawString("\n");
+    Text.DrawFormattedString("Feedback age: %u frames  Feedback to upload: %u frames\n",
+        stats.feedbackLatencyFrames, stats.residentLatencyFrames);
+    Text.DrawFormattedString("Feedback: %u pages seen, %u requested, aggregated in %.2f ms\n",
+        stats.feedbackPages, stats.feedbackRequests, stats.feedbackAggregateMs);
+    Text.DrawFormattedString("Prefetch: %u requested, %llu cancelled  Missed: %.2f%% of feedback samples\n",
+        stats.prefetchRequests, residency.cancelledPrefetches,
+        residency.feedbackSamples ? 100.0 * double(residency.missedSamples) / double(residency.feedbackSamples) : 0.0);
+    Text.DrawFormattedString("Evictions: %llu  Dropped uploads: %llu  Peak resident: %u\n",
+        residency.evictions, residency.droppedUploads, residency.peakResident);
+    Text.DrawFormattedString("Tile mappings: %u calls, %u regions, %u ranges for %u tiles\n",
+        stats.mappings.calls, stats.mappings.regions, stats.mappings.ranges, stats.mappings.tiles);
+    if (m_replayMissRate[1] >= 0.0f)
+    {
+        Text.DrawFormattedString("Camera path replay missed: %.2f%% without prefetch, %.2f%% with\n",
+            m_replayMissRate[0] * 100.0f, m_replayMissRate[1] * 100.0f);
+    }
+    Text.End();
+}